@@ -1,8 +1,25 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "clustered_lighting.glsl"
 
 layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec4 currentPosition;
+layout (location = 2) in vec4 previousPosition;
+
 layout (location = 0) out vec4 outColor;
+layout (location = 1) out vec2 outMotion; // Screen motion since the previous frame, in UV units
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    // View space position of the fragment
+    vec4 ndc = vec4(currentPosition.xyz / currentPosition.w, 1.0);
+    vec4 view = params.inverseProjection * ndc;
+    vec3 position = view.xyz / view.w;
+    // No normals yet: the surface faces the camera
+    vec3 normal = vec3(0.0, 0.0, 1.0);
+
+    vec3 lighting = clusteredLighting(position, normal, gl_FragCoord.xy);
+
+    outColor = vec4(fragColor * lighting, 1.0);
+    outMotion = (currentPosition.xy / currentPosition.w - previousPosition.xy / previousPosition.w) * 0.5;
 }
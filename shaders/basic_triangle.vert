@@ -3,9 +3,21 @@
 layout (location = 0) in vec2 inPosition; // Vertex attributes
 layout (location = 1) in vec3 inColor; // Vertex attributes
 
+layout (push_constant) uniform ScenePushConstants {
+    vec2 jitter; // Sub-pixel offset of the projection, in NDC units
+} scene;
+
 layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec4 currentPosition;  // Unjittered, for the motion vectors
+layout (location = 2) out vec4 previousPosition; // Unjittered, for the motion vectors
 
 void main() {
-    gl_Position = vec4(inPosition, 0.0, 1.0);
+    // Halfway in the depth range: passes the depth test against the cleared far plane,
+    // with a reversed or a regular depth range
+    vec4 position = vec4(inPosition, 0.5, 1.0);
+    currentPosition = position;
+    // No transforms yet: the geometry is at the same place as in the previous frame
+    previousPosition = position;
+    gl_Position = position + vec4(scene.jitter * position.w, 0.0, 0.0);
     fragColor = inColor;
 }
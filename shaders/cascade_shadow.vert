@@ -0,0 +1,35 @@
+#version 450
+#extension GL_EXT_multiview : require
+
+layout (location = 0) in vec2 inPosition; // Vertex attributes (the color is not read)
+
+// Must match CascadedShadowMaps (cascaded_shadows.hpp)
+layout (set = 0, binding = 0) uniform CascadeParams {
+    mat4 worldToClip[4];
+    mat4 viewToClip[4];
+    vec4 cullScale[4];   // Clip units per world unit, on X and Y
+    vec4 splits;
+    vec4 directionCount;
+    vec4 colorIntensity;
+} cascades;
+
+layout (push_constant) uniform CasterPushConstants {
+    mat4 model;  // Object space to world space
+    vec4 bounds; // World space bounding sphere (center, radius), radius 0 to disable the culling
+} caster;
+
+void main() {
+    // One view per cascade
+    mat4 worldToClip = cascades.worldToClip[gl_ViewIndex];
+    // A caster outside of this cascade is moved out of the clip volume: all its
+    // triangles are then clipped before the rasterization
+    if (caster.bounds.w > 0.0) {
+        vec4 center = worldToClip * vec4(caster.bounds.xyz, 1.0);
+        vec2 extent = 1.0 + caster.bounds.w * cascades.cullScale[gl_ViewIndex].xy;
+        if (any(greaterThan(abs(center.xy), extent))) {
+            gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+            return;
+        }
+    }
+    gl_Position = worldToClip * caster.model * vec4(inPosition, 0.0, 1.0);
+}
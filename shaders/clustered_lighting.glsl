@@ -0,0 +1,113 @@
+// Clustered lighting of a surface: the set 0 of the scene pipelines, shared by the
+// forward shading (basic_triangle.frag) and the deferred shading (deferred_lighting.frag)
+
+// Must match ClusteredLighting (lighting.hpp)
+struct Light {
+    vec4 positionRadius;     // View space
+    vec4 colorIntensity;
+    vec4 directionCosOuter;  // View space
+    vec4 cosInnerType;       // Cosine of the inner angle, type (0: point, 1: spot), first shadow view (-1: none), shadow view count
+};
+
+// Must match ShadowAtlas (shadow_atlas.hpp)
+struct ShadowView {
+    mat4 viewToClip; // Camera view space to the clip space of the shadow view
+    vec4 rect;       // Offset (xy) and scale (zw) of the tile in the atlas
+};
+
+layout (set = 0, binding = 0) uniform ClusterParams {
+    mat4 inverseProjection;
+    vec4 screen;  // Render width, render height, near, far
+    vec4 ambient;
+    uvec4 grid;   // Grid size on X, Y, Z, number of lights
+    uvec4 limits;
+} params;
+layout (std430, set = 0, binding = 1) readonly buffer Lights { Light lights[]; };
+layout (std430, set = 0, binding = 2) readonly buffer LightGrid { uvec2 lightGrid[]; }; // Offset, count
+layout (std430, set = 0, binding = 3) readonly buffer LightIndices { uint lightIndices[]; };
+layout (set = 0, binding = 5) uniform sampler2DShadow shadowAtlas;
+layout (std430, set = 0, binding = 6) readonly buffer ShadowViews { ShadowView shadowViews[]; };
+layout (set = 0, binding = 7) uniform sampler2DArrayShadow cascadeShadowMaps;
+// Must match CascadedShadowMaps (cascaded_shadows.hpp)
+layout (set = 0, binding = 8) uniform CascadeParams {
+    mat4 worldToClip[4];
+    mat4 viewToClip[4];  // Camera view space to the clip space of each cascade
+    vec4 cullScale[4];
+    vec4 splits;         // Far distance of each cascade
+    vec4 directionCount; // Direction to the light (view space), number of cascades
+    vec4 colorIntensity;
+} cascades;
+
+// Smooth window: 1 at the light, 0 at its radius
+float attenuation(float distance, float radius) {
+    float ratio = distance / radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / (distance * distance + 1.0);
+}
+
+// 1 if lit, 0 if in the shadow of the light. A point light has one view per cube face:
+// the first one containing the fragment is used
+float shadow(uint firstView, uint viewCount, vec3 position) {
+    for (uint i = firstView; i < firstView + viewCount; ++i) {
+        vec4 clip = shadowViews[i].viewToClip * vec4(position, 1.0);
+        if (clip.w <= 0.0)
+            continue;
+        vec3 ndc = clip.xyz / clip.w;
+        if (any(greaterThan(abs(ndc.xy), vec2(1.0))))
+            continue;
+        vec2 uv = (ndc.xy * 0.5 + 0.5) * shadowViews[i].rect.zw + shadowViews[i].rect.xy;
+        return textureLod(shadowAtlas, vec3(uv, ndc.z), 0.0);
+    }
+    return 1.0;
+}
+
+// 1 if lit by the directional light, 0 if in its shadow. No shadows after the last cascade
+float cascadeShadow(vec3 position) {
+    uint cascadeCount = uint(cascades.directionCount.w);
+    for (uint i = 0; i < cascadeCount; ++i) {
+        if (-position.z > cascades.splits[i])
+            continue;
+        vec4 clip = cascades.viewToClip[i] * vec4(position, 1.0);
+        vec2 uv = clip.xy * 0.5 + 0.5;
+        // Explicit (null) gradients: the cascade can change between neighbour fragments
+        return textureGrad(cascadeShadowMaps, vec4(uv, float(i), clip.z), vec2(0.0), vec2(0.0));
+    }
+    return 1.0;
+}
+
+// Light received by a surface (ambient, directional light and the lights of its cluster)
+// position: view space position, normal: view space normal, fragCoord: pixel position
+vec3 clusteredLighting(vec3 position, vec3 normal, vec2 fragCoord) {
+    // Cluster of the fragment
+    float zNear = params.screen.z;
+    float zFar = params.screen.w;
+    uvec2 tile = min(uvec2(fragCoord / params.screen.xy * vec2(params.grid.xy)), params.grid.xy - 1);
+    uint slice = uint(clamp(log(-position.z / zNear) / log(zFar / zNear) * float(params.grid.z), 0.0, float(params.grid.z - 1)));
+    uint clusterIndex = tile.x + params.grid.x * (tile.y + params.grid.y * slice);
+    uvec2 clusterLights = lightGrid[clusterIndex];
+
+    vec3 lighting = params.ambient.rgb;
+    if (cascades.colorIntensity.w > 0.0) {
+        float sun = max(dot(normal, cascades.directionCount.xyz), 0.0);
+        if (sun > 0.0)
+            sun *= cascadeShadow(position);
+        lighting += cascades.colorIntensity.rgb * cascades.colorIntensity.w * sun;
+    }
+    for (uint i = 0; i < clusterLights.y; ++i) {
+        Light light = lights[lightIndices[clusterLights.x + i]];
+        vec3 toLight = light.positionRadius.xyz - position;
+        float distance = length(toLight);
+        if (distance >= light.positionRadius.w)
+            continue;
+        vec3 direction = toLight / max(distance, 1e-4);
+        float intensity = light.colorIntensity.w * attenuation(distance, light.positionRadius.w);
+        if (light.cosInnerType.y > 0.5) {
+            float cosAngle = dot(-direction, light.directionCosOuter.xyz);
+            intensity *= smoothstep(light.directionCosOuter.w, light.cosInnerType.x, cosAngle);
+        }
+        if (light.cosInnerType.z >= 0.0 && intensity > 0.0)
+            intensity *= shadow(uint(light.cosInnerType.z), uint(light.cosInnerType.w), position);
+        lighting += light.colorIntensity.rgb * intensity * max(dot(normal, direction), 0.0);
+    }
+    return lighting;
+}
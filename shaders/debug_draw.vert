@@ -0,0 +1,16 @@
+#version 450
+
+// Must match DebugDraw::PushConstants (debug_draw.hpp)
+layout (push_constant) uniform DebugDrawPushConstants {
+    mat4 viewProjection; // World space to clip space, jittered like the scene
+} debugDraw;
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec4 inColor;
+
+layout (location = 0) out vec4 fragColor;
+
+void main() {
+    gl_Position = debugDraw.viewProjection * vec4(inPosition, 1.0);
+    fragColor = inColor;
+}
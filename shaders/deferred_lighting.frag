@@ -0,0 +1,29 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "clustered_lighting.glsl"
+
+// The G-buffer written by gbuffer.frag, and the depth, at the pixel being shaded
+layout (input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput gbufferAlbedo;
+layout (input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput gbufferNormal;
+layout (input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput gbufferDepth;
+
+layout (location = 0) out vec4 outColor;
+
+void main() {
+    vec4 albedo = subpassLoad(gbufferAlbedo);
+    // Nothing has been drawn on this pixel
+    if (albedo.a == 0.0) {
+        outColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+    vec3 normal = normalize(subpassLoad(gbufferNormal).xyz * 2.0 - 1.0);
+
+    // View space position of the pixel, from its depth
+    vec2 uv = gl_FragCoord.xy / params.screen.xy;
+    vec4 ndc = vec4(uv * 2.0 - 1.0, subpassLoad(gbufferDepth).r, 1.0);
+    vec4 view = params.inverseProjection * ndc;
+    vec3 position = view.xyz / view.w;
+
+    outColor = vec4(albedo.rgb * clusteredLighting(position, normal, gl_FragCoord.xy), 1.0);
+}
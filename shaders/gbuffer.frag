@@ -0,0 +1,19 @@
+#version 450
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec4 currentPosition;
+layout (location = 2) in vec4 previousPosition;
+
+// Must match the G-buffer of the render pass (pipeline.cpp), read by deferred_lighting.frag
+layout (location = 0) out vec4 outAlbedo; // Albedo, coverage
+layout (location = 1) out vec4 outNormal; // View space normal, mapped to [0, 1]
+layout (location = 2) out vec2 outMotion; // Screen motion since the previous frame, in UV units
+
+void main() {
+    // No normals yet: the surface faces the camera
+    vec3 normal = vec3(0.0, 0.0, 1.0);
+
+    outAlbedo = vec4(fragColor, 1.0);
+    outNormal = vec4(normal * 0.5 + 0.5, 0.0);
+    outMotion = (currentPosition.xy / currentPosition.w - previousPosition.xy / previousPosition.w) * 0.5;
+}
@@ -0,0 +1,47 @@
+// Level of detail selection from the projected screen-space error, shared by the GPU
+// passes that pick the levels of their instances (lod_select.comp). Declare LOD_SET
+// before the include to bind the level tables to another set than 0.
+
+#ifndef LOD_SET
+#define LOD_SET 0
+#endif
+
+// Must match LevelsOfDetail (lod.hpp)
+struct LodLevel {
+    uint firstIndex; // In the index buffer
+    uint indexCount;
+    float error;     // Mesh units
+    float padding;
+};
+struct LodMesh {
+    vec4 sphere;     // Bounding sphere, in mesh units
+    uint firstLevel;
+    uint levelCount;
+    int vertexOffset;
+    uint padding;
+};
+
+layout (std430, set = LOD_SET, binding = 0) readonly buffer LodLevels { LodLevel lodLevels[]; };
+layout (std430, set = LOD_SET, binding = 1) readonly buffer LodMeshes { LodMesh lodMeshes[]; };
+
+// The coarsest level whose error projects under the threshold, in pixels. The levels
+// coarser than the previous one are held to a lower threshold (hysteresis).
+// Must match LevelsOfDetail::select (lod.cpp)
+uint selectLod(uint mesh, mat4 transform, vec3 eye, float nearPlane, float pixelsPerUnit, float pixelError, float hysteresis, uint previousLevel) {
+    LodMesh lodMesh = lodMeshes[mesh];
+    vec3 center = (transform * vec4(lodMesh.sphere.xyz, 1.0)).xyz;
+    float scale = sqrt(max(max(
+        dot(transform[0].xyz, transform[0].xyz),
+        dot(transform[1].xyz, transform[1].xyz)),
+        dot(transform[2].xyz, transform[2].xyz)));
+    // The closest point of the bounding sphere, never closer than the near plane
+    float distance = max(length(center - eye) - scale * lodMesh.sphere.w, nearPlane);
+    float pixelsPerError = scale * pixelsPerUnit / distance;
+    for (uint level = lodMesh.levelCount - 1u; level > 0u; --level) {
+        float threshold = level > previousLevel ? pixelError * (1.0 - hysteresis) : pixelError;
+        if (lodLevels[lodMesh.firstLevel + level].error * pixelsPerError <= threshold) {
+            return level;
+        }
+    }
+    return 0u;
+}
@@ -0,0 +1,88 @@
+// Meshlet culling, shared by the compute pass (meshlet_cull.comp) and the task shaders
+// (meshlet.task). Declare MESHLET_SET before the include to bind the meshlet tables to
+// another set than 0.
+
+#ifndef MESHLET_SET
+#define MESHLET_SET 0
+#endif
+
+// Must match MeshletCulling (meshlets.hpp)
+struct Meshlet {
+    vec4 sphere;        // Bounding sphere, in mesh units
+    vec4 cone;          // Axis of the normal cone (xyz), cutoff (w: 1 if never culled)
+    uint firstIndex;    // In the index buffer of the indirect draws
+    uint triangleCount;
+    uint firstVertex;   // In the meshlet vertices
+    uint vertexCount;
+    uint firstTriangle; // In the meshlet triangles
+    int vertexOffset;   // In the vertex buffer of the indirect draws
+    uint padding0;
+    uint padding1;
+};
+struct MeshletInstance {
+    mat4 transform;  // Mesh units to world space
+    vec4 scale;      // Largest scale (x), normal cones tested (y)
+    uvec4 occlusion; // Object in the occlusion queries (x), UINT32_MAX if none
+};
+struct MeshletCluster {
+    uint instance;
+    uint meshlet;
+};
+
+layout (std430, set = MESHLET_SET, binding = 0) readonly buffer Meshlets { Meshlet meshlets[]; };
+layout (std430, set = MESHLET_SET, binding = 1) readonly buffer MeshletInstances { MeshletInstance meshletInstances[]; };
+layout (std430, set = MESHLET_SET, binding = 2) readonly buffer MeshletClusters { MeshletCluster meshletClusters[]; };
+// The sample counts of the occlusion queries, 0 if hidden (occlusion.hpp)
+layout (std430, set = MESHLET_SET, binding = 3) readonly buffer OcclusionResults { uint occlusionResults[]; };
+
+layout (push_constant) uniform MeshletPushConstants {
+    mat4 viewProjection; // Unjittered
+    vec4 eye;            // Camera position, in world space
+    vec4 jitter;         // Sub-pixel offset of the projection (xy), in NDC units
+    uvec4 counts;        // Clusters, first occlusion result of the previous frame, occlusion results
+} culling;
+
+// A plane of the view frustum, in world space, normalized (inside: positive).
+// Left, right, top, bottom, then the z = 0 and z = w planes (near and far, in either
+// order with a reversed depth): a plane at infinity never culls
+vec4 frustumPlane(int index) {
+    mat4 m = transpose(culling.viewProjection);
+    vec4 plane;
+    if (index < 4) {
+        plane = m[3] + ((index & 1) == 0 ? 1.0 : -1.0) * m[index / 2];
+    } else {
+        plane = index == 4 ? m[2] : m[3] - m[2];
+    }
+    float normalLength = length(plane.xyz);
+    return normalLength > 1e-6 ? plane / normalLength : vec4(0.0, 0.0, 0.0, 1.0);
+}
+
+// If a meshlet of an instance may be visible: not hidden by the occlusion queries of the
+// previous frame, in the view frustum, and not facing away from the camera
+bool isClusterVisible(MeshletCluster cluster) {
+    MeshletInstance instance = meshletInstances[cluster.instance];
+    uint object = instance.occlusion.x;
+    if (object < culling.counts.z && occlusionResults[culling.counts.y + object] == 0u) {
+        return false;
+    }
+
+    Meshlet meshlet = meshlets[cluster.meshlet];
+    vec3 center = (instance.transform * vec4(meshlet.sphere.xyz, 1.0)).xyz;
+    float radius = meshlet.sphere.w * instance.scale.x;
+    for (int i = 0; i < 6; ++i) {
+        vec4 plane = frustumPlane(i);
+        if (dot(plane.xyz, center) + plane.w < -radius) {
+            return false;
+        }
+    }
+
+    // The camera is in the back-facing region of all the triangles
+    if (instance.scale.y > 0.0 && meshlet.cone.w < 1.0) {
+        vec3 axis = normalize(mat3(instance.transform) * meshlet.cone.xyz);
+        vec3 toCenter = center - culling.eye.xyz;
+        if (dot(toCenter, axis) >= meshlet.cone.w * length(toCenter) + radius) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,20 @@
+#version 450
+
+// Must match OcclusionQueries::PushConstants (occlusion.hpp)
+layout (push_constant) uniform ProxyPushConstants {
+    mat4 viewProjection; // World space to clip space, jittered like the scene
+    vec4 boxMin;         // World space bounding box
+    vec4 boxMax;
+} proxy;
+
+void main() {
+    // The 14 vertices of a cube as a single triangle strip: each mask holds one axis
+    // of the corner of each vertex
+    uint vertexBit = 1u << gl_VertexIndex;
+    vec3 corner = vec3(
+        (0x287au & vertexBit) != 0u ? 1.0 : 0.0,
+        (0x02afu & vertexBit) != 0u ? 1.0 : 0.0,
+        (0x31e3u & vertexBit) != 0u ? 1.0 : 0.0);
+    vec3 position = mix(proxy.boxMin.xyz, proxy.boxMax.xyz, corner);
+    gl_Position = proxy.viewProjection * vec4(position, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 450
+
+layout (location = 0) in vec2 inPosition; // Vertex attributes (the color is not read)
+
+// Must match ShadowAtlas::PushConstants (shadow_atlas.hpp)
+layout (push_constant) uniform ShadowPushConstants {
+    mat4 viewProjection; // World space to the clip space of the shadow view
+    mat4 model;          // Object space to world space
+} shadow;
+
+void main() {
+    gl_Position = shadow.viewProjection * shadow.model * vec4(inPosition, 0.0, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 450
+
+// All the sprite textures, one per layer
+layout (set = 0, binding = 0) uniform sampler2DArray textures;
+
+layout (location = 0) in vec2 fragUV;
+layout (location = 1) in vec4 fragColor;
+layout (location = 2) flat in uint fragTexture;
+
+layout (location = 0) out vec4 outColor;
+
+void main() {
+    vec4 texel = fragTexture == 0xFFFFu ? vec4(1.0) : texture(textures, vec3(fragUV, float(fragTexture)));
+    outColor = fragColor * texel;
+}
@@ -0,0 +1,23 @@
+#version 450
+
+layout (location = 0) in vec2 inPosition; // In pixels, from the top-left corner
+layout (location = 1) in vec2 inUV;
+layout (location = 2) in vec4 inColor;
+layout (location = 3) in uint inTexture; // Layer of the texture array, 0xFFFF for none
+
+// Must match SpriteBatcher::PushConstants (sprites.hpp)
+layout (push_constant) uniform SpritePushConstants {
+    vec2 scale;  // From pixels to NDC
+    vec2 offset;
+} sprites;
+
+layout (location = 0) out vec2 fragUV;
+layout (location = 1) out vec4 fragColor;
+layout (location = 2) flat out uint fragTexture;
+
+void main() {
+    gl_Position = vec4(inPosition * sprites.scale + sprites.offset, 0.0, 1.0);
+    fragUV = inUV;
+    fragColor = inColor;
+    fragTexture = inTexture;
+}
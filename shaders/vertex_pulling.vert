@@ -0,0 +1,66 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Must match VertexPulling (vertex_pulling.hpp): no vertex input, the vertices and the
+// indices are read through their device address
+
+#define NO_COLOR 0xFFFFFFFFu
+
+layout (buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexData {
+    float values[];
+};
+
+layout (buffer_reference, std430, buffer_reference_align = 4) readonly buffer IndexData {
+    uint values[];
+};
+
+// The pointers and the vertex layout of a mesh (offsets and stride in floats)
+struct PulledDraw {
+    VertexData vertices;
+    IndexData indices;
+    uint stride;
+    uint positionOffset;
+    uint positionSize; // 2 (at mid-depth) or 3
+    uint colorOffset;  // Or NO_COLOR
+};
+
+layout (buffer_reference, std430, buffer_reference_align = 8) readonly buffer DrawData {
+    PulledDraw draws[];
+};
+
+layout (push_constant) uniform PushConstants {
+    vec2 jitter;     // Sub-pixel offset of the projection, in NDC units
+    DrawData draws;  // A record per mesh
+    PulledDraw draw; // The mesh of a direct draw
+    uint merged;     // 1: the record is selected by the first instance (merged indirect draw)
+} scene;
+
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec4 currentPosition;  // Unjittered, for the motion vectors
+layout (location = 2) out vec4 previousPosition; // Unjittered, for the motion vectors
+
+void main() {
+    PulledDraw draw = scene.merged != 0u ? scene.draws.draws[gl_InstanceIndex] : scene.draw;
+    // Non-indexed draw: the index is fetched here
+    uint vertex = draw.indices.values[gl_VertexIndex] * draw.stride;
+
+    uint position_offset = vertex + draw.positionOffset;
+    vec4 position = vec4(
+        draw.vertices.values[position_offset],
+        draw.vertices.values[position_offset + 1u],
+        draw.positionSize > 2u ? draw.vertices.values[position_offset + 2u] : 0.5,
+        1.0);
+    currentPosition = position;
+    // No transforms yet: the geometry is at the same place as in the previous frame
+    previousPosition = position;
+    gl_Position = position + vec4(scene.jitter * position.w, 0.0, 0.0);
+
+    fragColor = vec3(1.0);
+    if (draw.colorOffset != NO_COLOR) {
+        uint color_offset = vertex + draw.colorOffset;
+        fragColor = vec3(
+            draw.vertices.values[color_offset],
+            draw.vertices.values[color_offset + 1u],
+            draw.vertices.values[color_offset + 2u]);
+    }
+}
@@ -0,0 +1,564 @@
+//
+//  animation.cpp
+//
+
+#include "animation.hpp"
+#include "../utils/debug_tools.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// SSE2 is part of every x86-64 target: no build flag is needed. The other targets
+// (arm64) use the scalar path, with the same layout.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANIMATION_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+/// @brief The number of joints of a block
+static constexpr uint32_t LANES = app::graphics::AnimationPose::LANE_COUNT;
+/// @brief The number of keys of a block in a frame (three components per joint)
+static constexpr uint32_t BLOCK_KEYS = 3 * LANES;
+/// @brief The number of floats of the translation range of a block (minimum and step)
+static constexpr uint32_t BLOCK_RANGES = 6 * LANES;
+/// @brief The largest magnitude of the three smallest components of a unit quaternion (1 / sqrt(2))
+static constexpr float SMALLEST_THREE_RANGE = 0.70710678f;
+/// @brief The largest quantized value of a rotation component (15 bits)
+static constexpr float ROTATION_QUANTA = 32767.0f;
+/// @brief The largest quantized value of a translation component (16 bits)
+static constexpr float TRANSLATION_QUANTA = 65535.0f;
+/// @brief The bit of a rotation key holding a bit of the index of the dropped component
+static constexpr uint16_t ROTATION_INDEX_BIT = 0x8000;
+
+#ifdef ANIMATION_SIMD_SSE2
+/// @brief A component of the joints of a block
+using float4 = __m128;
+
+static inline float4 splat(const float value) { return _mm_set1_ps(value); }
+static inline float4 load(const float* values) { return _mm_loadu_ps(values); }
+static inline void store(float* values, const float4 a) { _mm_storeu_ps(values, a); }
+static inline float4 add(const float4 a, const float4 b) { return _mm_add_ps(a, b); }
+static inline float4 sub(const float4 a, const float4 b) { return _mm_sub_ps(a, b); }
+static inline float4 mul(const float4 a, const float4 b) { return _mm_mul_ps(a, b); }
+static inline float4 max(const float4 a, const float4 b) { return _mm_max_ps(a, b); }
+static inline float4 sqrt(const float4 a) { return _mm_sqrt_ps(a); }
+static inline float4 div(const float4 a, const float4 b) { return _mm_div_ps(a, b); }
+static inline float4 equal(const float4 a, const float4 b) { return _mm_cmpeq_ps(a, b); }
+static inline float4 less(const float4 a, const float4 b) { return _mm_cmplt_ps(a, b); }
+static inline float4 greaterEqual(const float4 a, const float4 b) { return _mm_cmpge_ps(a, b); }
+/// @brief Returns `a` where the mask is set, 0 elsewhere
+static inline float4 mask(const float4 condition, const float4 a) { return _mm_and_ps(condition, a); }
+/// @brief Returns `a` where the mask is set, `b` elsewhere
+static inline float4 select(const float4 condition, const float4 a, const float4 b)
+{
+    return _mm_or_ps(_mm_and_ps(condition, a), _mm_andnot_ps(condition, b));
+}
+/// @brief Loads 4 unsigned 16 bits keys as floats
+static inline float4 loadKeys(const uint16_t* keys)
+{
+    const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(keys));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, _mm_setzero_si128()));
+}
+#else
+/// @brief A component of the joints of a block
+struct float4
+{
+    float v[LANES];
+};
+
+/// @brief Applies an operation to each lane
+template <typename Operation>
+static inline float4 lanes(Operation operation)
+{
+    float4 result;
+    for (uint32_t lane = 0; lane < LANES; ++lane)
+        result.v[lane] = operation(lane);
+    return result;
+}
+/// @brief The value of a set mask lane
+static inline float maskBits(const bool condition)
+{
+    return condition ? 1.0f : 0.0f;
+}
+
+static inline float4 splat(const float value)
+{
+    return lanes([&](uint32_t) { return value; });
+}
+static inline float4 load(const float* values)
+{
+    return lanes([&](uint32_t i) { return values[i]; });
+}
+static inline void store(float* values, const float4 a)
+{
+    for (uint32_t lane = 0; lane < LANES; ++lane)
+        values[lane] = a.v[lane];
+}
+static inline float4 add(const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return a.v[i] + b.v[i]; });
+}
+static inline float4 sub(const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return a.v[i] - b.v[i]; });
+}
+static inline float4 mul(const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return a.v[i] * b.v[i]; });
+}
+static inline float4 max(const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return std::max(a.v[i], b.v[i]); });
+}
+static inline float4 sqrt(const float4 a)
+{
+    return lanes([&](uint32_t i) { return std::sqrt(a.v[i]); });
+}
+static inline float4 div(const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return a.v[i] / b.v[i]; });
+}
+static inline float4 equal(const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return maskBits(a.v[i] == b.v[i]); });
+}
+static inline float4 less(const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return maskBits(a.v[i] < b.v[i]); });
+}
+static inline float4 greaterEqual(const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return maskBits(a.v[i] >= b.v[i]); });
+}
+/// @brief Returns `a` where the mask is set, 0 elsewhere
+static inline float4 mask(const float4 condition, const float4 a)
+{
+    return lanes([&](uint32_t i) { return condition.v[i] != 0.0f ? a.v[i] : 0.0f; });
+}
+/// @brief Returns `a` where the mask is set, `b` elsewhere
+static inline float4 select(const float4 condition, const float4 a, const float4 b)
+{
+    return lanes([&](uint32_t i) { return condition.v[i] != 0.0f ? a.v[i] : b.v[i]; });
+}
+/// @brief Loads 4 unsigned 16 bits keys as floats
+static inline float4 loadKeys(const uint16_t* keys)
+{
+    return lanes([&](uint32_t i) { return static_cast<float>(keys[i]); });
+}
+#endif
+
+/// @brief Encodes a rotation with the smallest-three encoding
+/// @param rotation A unit quaternion
+/// @param keys Receives the three smallest components, and the index of the largest one
+/// in the top bits of the first two
+static void encodeRotation(const glm::quat& rotation, uint16_t keys[3])
+{
+    const float components[4] = {rotation.x, rotation.y, rotation.z, rotation.w};
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; ++i)
+    {
+        if (std::abs(components[i]) > std::abs(components[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation: the dropped component is kept positive
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    uint32_t key = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        const float value = std::clamp(components[i] * sign, -SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE);
+        keys[key++] = static_cast<uint16_t>(std::lround((value + SMALLEST_THREE_RANGE) / (2.0f * SMALLEST_THREE_RANGE) * ROTATION_QUANTA));
+    }
+    if (largest & 1)
+        keys[0] |= ROTATION_INDEX_BIT;
+    if (largest & 2)
+        keys[1] |= ROTATION_INDEX_BIT;
+}
+
+/// @brief Decodes the rotations of the joints of a block
+/// @param keys The rotation keys of the block in a frame
+/// @param rotation Receives the x, y, z, w components of the rotations
+static inline void decodeRotations(const uint16_t* keys, float4 rotation[4])
+{
+    const float4 index_bit = splat(static_cast<float>(ROTATION_INDEX_BIT));
+    float4 a = loadKeys(keys);
+    float4 b = loadKeys(keys + LANES);
+    float4 c = loadKeys(keys + 2 * LANES);
+    const float4 high_a = greaterEqual(a, index_bit);
+    const float4 high_b = greaterEqual(b, index_bit);
+    a = sub(a, mask(high_a, index_bit));
+    b = sub(b, mask(high_b, index_bit));
+    const float4 index = add(mask(high_a, splat(1.0f)), mask(high_b, splat(2.0f)));
+
+    const float4 scale = splat(2.0f * SMALLEST_THREE_RANGE / ROTATION_QUANTA);
+    const float4 offset = splat(-SMALLEST_THREE_RANGE);
+    a = add(mul(a, scale), offset);
+    b = add(mul(b, scale), offset);
+    c = add(mul(c, scale), offset);
+    const float4 squares = add(add(mul(a, a), mul(b, b)), mul(c, c));
+    const float4 largest = sqrt(max(sub(splat(1.0f), squares), splat(0.0f)));
+
+    // The stored components are the other ones, in order
+    const float4 is_x = equal(index, splat(0.0f));
+    const float4 is_y = equal(index, splat(1.0f));
+    const float4 is_z = equal(index, splat(2.0f));
+    const float4 is_w = equal(index, splat(3.0f));
+    rotation[0] = select(is_x, largest, a);
+    rotation[1] = select(is_y, largest, select(is_x, a, b));
+    rotation[2] = select(is_z, largest, select(is_w, c, b));
+    rotation[3] = select(is_w, largest, c);
+}
+
+/// @brief Decodes the translations of the joints of a block
+/// @param keys The translation keys of the block in a frame
+/// @param ranges The translation range of the block
+/// @param translation Receives the x, y, z components of the translations
+static inline void decodeTranslations(const uint16_t* keys, const float* ranges, float4 translation[3])
+{
+    for (uint32_t axis = 0; axis < 3; ++axis)
+        translation[axis] = add(load(ranges + axis * LANES), mul(loadKeys(keys + axis * LANES), load(ranges + (3 + axis) * LANES)));
+}
+
+/// @brief Interpolates the rotations of the joints of a block, along the shortest path
+/// (normalized lerp)
+static inline void nlerp(const float4 from[4], const float4 to[4], const float4 weight, float4 rotation[4])
+{
+    float4 dot = mul(from[0], to[0]);
+    for (uint32_t i = 1; i < 4; ++i)
+        dot = add(dot, mul(from[i], to[i]));
+    const float4 sign = select(less(dot, splat(0.0f)), splat(-1.0f), splat(1.0f));
+    float4 length = splat(0.0f);
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        rotation[i] = add(from[i], mul(sub(mul(to[i], sign), from[i]), weight));
+        length = add(length, mul(rotation[i], rotation[i]));
+    }
+    const float4 inverse_length = div(splat(1.0f), sqrt(max(length, splat(1e-12f))));
+    for (uint32_t i = 0; i < 4; ++i)
+        rotation[i] = mul(rotation[i], inverse_length);
+}
+
+/// @brief Interpolates the translations of the joints of a block
+static inline void lerp(const float4 from[3], const float4 to[3], const float4 weight, float4 translation[3])
+{
+    for (uint32_t axis = 0; axis < 3; ++axis)
+        translation[axis] = add(from[axis], mul(sub(to[axis], from[axis]), weight));
+}
+
+/// @brief Stores the transforms of the joints of a block
+static inline void storeBlock(const float4 rotation[4], const float4 translation[3], app::graphics::AnimationPose::Block& block)
+{
+    for (uint32_t i = 0; i < 4; ++i)
+        store(block.m_rotation[i], rotation[i]);
+    for (uint32_t axis = 0; axis < 3; ++axis)
+        store(block.m_translation[axis], translation[axis]);
+}
+
+void app::graphics::AnimationPose::resize(const uint32_t joint_count)
+{
+    m_joint_count = joint_count;
+    m_blocks.resize((joint_count + LANE_COUNT - 1) / LANE_COUNT);
+}
+
+app::graphics::JointPose app::graphics::AnimationPose::getJoint(const uint32_t joint) const
+{
+    assert(joint < m_joint_count);
+    const Block& block = m_blocks[joint / LANE_COUNT];
+    const uint32_t lane = joint % LANE_COUNT;
+    return JointPose{
+        .m_rotation = glm::quat(block.m_rotation[3][lane], block.m_rotation[0][lane], block.m_rotation[1][lane], block.m_rotation[2][lane]),
+        .m_translation = glm::vec3(block.m_translation[0][lane], block.m_translation[1][lane], block.m_translation[2][lane]),
+    };
+}
+
+void app::graphics::AnimationPose::blend(const AnimationPose& from, const AnimationPose& to, const float weight, AnimationPose& pose)
+{
+    assert(from.m_joint_count == to.m_joint_count);
+    pose.resize(from.m_joint_count);
+    const float4 blend_weight = splat(weight);
+    for (size_t i = 0; i < pose.m_blocks.size(); ++i)
+    {
+        const Block& from_block = from.m_blocks[i];
+        const Block& to_block = to.m_blocks[i];
+        float4 from_rotation[4], to_rotation[4], rotation[4];
+        float4 from_translation[3], to_translation[3], translation[3];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            from_rotation[c] = load(from_block.m_rotation[c]);
+            to_rotation[c] = load(to_block.m_rotation[c]);
+        }
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            from_translation[axis] = load(from_block.m_translation[axis]);
+            to_translation[axis] = load(to_block.m_translation[axis]);
+        }
+        nlerp(from_rotation, to_rotation, blend_weight, rotation);
+        lerp(from_translation, to_translation, blend_weight, translation);
+        storeBlock(rotation, translation, pose.m_blocks[i]);
+    }
+}
+
+void app::graphics::Skeleton::computeSkinningMatrices(const AnimationPose& pose, glm::mat4* skinning_matrices) const
+{
+    const uint32_t joint_count = static_cast<uint32_t>(m_parents.size());
+    assert(pose.m_joint_count == joint_count && m_inverse_bind_matrices.size() == joint_count);
+    // The model transforms first: the parents are before their children
+    for (uint32_t joint = 0; joint < joint_count; ++joint)
+    {
+        const JointPose local_pose = pose.getJoint(joint);
+        glm::mat4 local = glm::mat4_cast(local_pose.m_rotation);
+        local[3] = glm::vec4(local_pose.m_translation, 1.0f);
+        const int32_t parent = m_parents[joint];
+        assert(parent < static_cast<int32_t>(joint));
+        skinning_matrices[joint] = parent >= 0 ? skinning_matrices[parent] * local : local;
+    }
+    for (uint32_t joint = 0; joint < joint_count; ++joint)
+        skinning_matrices[joint] = skinning_matrices[joint] * m_inverse_bind_matrices[joint];
+}
+
+utils::Result<app::graphics::AnimationClip> app::graphics::AnimationClip::compress(const uint32_t joint_count, const float sample_rate, const std::vector<JointPose>& frames)
+{
+    if (joint_count == 0 || frames.empty() || frames.size() % joint_count != 0)
+        return utils::Result<AnimationClip>::Error((char*)"The keys of the clip are not a whole number of frames");
+    if (!(sample_rate > 0.0f))
+        return utils::Result<AnimationClip>::Error((char*)"The sample rate of the clip is not positive");
+
+    AnimationClip clip;
+    clip.m_joint_count = joint_count;
+    clip.m_block_count = (joint_count + LANES - 1) / LANES;
+    clip.m_frame_count = static_cast<uint32_t>(frames.size() / joint_count);
+    clip.m_sample_rate = sample_rate;
+
+    // The range of the translations of each joint, over the clip
+    std::vector<glm::vec3> minimums(joint_count, glm::vec3(INFINITY));
+    std::vector<glm::vec3> maximums(joint_count, glm::vec3(-INFINITY));
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        const glm::vec3& translation = frames[i].m_translation;
+        if (!std::isfinite(translation.x) || !std::isfinite(translation.y) || !std::isfinite(translation.z))
+            return utils::Result<AnimationClip>::Error((char*)"A translation key of the clip is not finite");
+        minimums[i % joint_count] = glm::min(minimums[i % joint_count], translation);
+        maximums[i % joint_count] = glm::max(maximums[i % joint_count], translation);
+    }
+    // The padding joints of the last block stay at the origin
+    clip.m_translation_ranges.assign(clip.m_block_count * BLOCK_RANGES, 0.0f);
+    for (uint32_t joint = 0; joint < joint_count; ++joint)
+    {
+        float* ranges = &clip.m_translation_ranges[(joint / LANES) * BLOCK_RANGES];
+        const uint32_t lane = joint % LANES;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            ranges[axis * LANES + lane] = minimums[joint][axis];
+            ranges[(3 + axis) * LANES + lane] = (maximums[joint][axis] - minimums[joint][axis]) / TRANSLATION_QUANTA;
+        }
+    }
+
+    // The padding joints of the last block keep the identity rotation
+    uint16_t identity[3];
+    encodeRotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), identity);
+    const size_t key_count = static_cast<size_t>(clip.m_frame_count) * clip.m_block_count * BLOCK_KEYS;
+    clip.m_rotations.resize(key_count);
+    clip.m_translations.assign(key_count, 0);
+    for (size_t i = 0; i < key_count; ++i)
+        clip.m_rotations[i] = identity[(i % BLOCK_KEYS) / LANES];
+
+    for (uint32_t frame = 0; frame < clip.m_frame_count; ++frame)
+    {
+        for (uint32_t joint = 0; joint < joint_count; ++joint)
+        {
+            const JointPose& key = frames[static_cast<size_t>(frame) * joint_count + joint];
+            const float length = glm::length(key.m_rotation);
+            if (!std::isfinite(length) || length < 1e-6f)
+                return utils::Result<AnimationClip>::Error((char*)"A rotation key of the clip is not a valid quaternion");
+            uint16_t rotation[3];
+            encodeRotation(key.m_rotation / length, rotation);
+
+            const size_t first_key = (static_cast<size_t>(frame) * clip.m_block_count + joint / LANES) * BLOCK_KEYS + joint % LANES;
+            for (uint32_t component = 0; component < 3; ++component)
+                clip.m_rotations[first_key + component * LANES] = rotation[component];
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float extent = maximums[joint][axis] - minimums[joint][axis];
+                if (extent <= 0.0f)
+                    continue;
+                const float normalized = (key.m_translation[axis] - minimums[joint][axis]) / extent;
+                clip.m_translations[first_key + axis * LANES] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * TRANSLATION_QUANTA));
+            }
+        }
+    }
+    return utils::Result<AnimationClip>::Ok(std::move(clip));
+}
+
+void app::graphics::AnimationClip::sample(const float time, const bool loop, AnimationPose& pose) const
+{
+    pose.resize(m_joint_count);
+    if (m_frame_count == 0)
+        return;
+    const float duration = getDuration();
+    float clip_time = 0.0f;
+    if (loop && duration > 0.0f)
+    {
+        clip_time = std::fmod(time, duration);
+        if (clip_time < 0.0f)
+            clip_time += duration;
+    }
+    else
+        clip_time = std::clamp(time, 0.0f, duration);
+
+    // Uniform sampling: the two closest frames are found without any search
+    const float position = clip_time * m_sample_rate;
+    const uint32_t first_frame = std::min(static_cast<uint32_t>(position), m_frame_count - 1);
+    const uint32_t second_frame = std::min(first_frame + 1, m_frame_count - 1);
+    const float4 weight = splat(std::clamp(position - static_cast<float>(first_frame), 0.0f, 1.0f));
+
+    const size_t frame_keys = static_cast<size_t>(m_block_count) * BLOCK_KEYS;
+    const uint16_t* first_rotations = &m_rotations[first_frame * frame_keys];
+    const uint16_t* second_rotations = &m_rotations[second_frame * frame_keys];
+    const uint16_t* first_translations = &m_translations[first_frame * frame_keys];
+    const uint16_t* second_translations = &m_translations[second_frame * frame_keys];
+    for (uint32_t block = 0; block < m_block_count; ++block)
+    {
+        const size_t offset = static_cast<size_t>(block) * BLOCK_KEYS;
+        const float* ranges = &m_translation_ranges[static_cast<size_t>(block) * BLOCK_RANGES];
+        float4 from_rotation[4], to_rotation[4], rotation[4];
+        float4 from_translation[3], to_translation[3], translation[3];
+        decodeRotations(first_rotations + offset, from_rotation);
+        decodeRotations(second_rotations + offset, to_rotation);
+        decodeTranslations(first_translations + offset, ranges, from_translation);
+        decodeTranslations(second_translations + offset, ranges, to_translation);
+        nlerp(from_rotation, to_rotation, weight, rotation);
+        lerp(from_translation, to_translation, weight, translation);
+        storeBlock(rotation, translation, pose.m_blocks[block]);
+    }
+}
+
+uint32_t app::graphics::AnimationClip::getJointCount() const noexcept
+{
+    return m_joint_count;
+}
+
+float app::graphics::AnimationClip::getDuration() const noexcept
+{
+    if (m_frame_count == 0)
+        return 0.0f;
+    return static_cast<float>(m_frame_count - 1) / m_sample_rate;
+}
+
+size_t app::graphics::AnimationClip::getMemorySize() const noexcept
+{
+    return (m_rotations.size() + m_translations.size()) * sizeof(uint16_t) + m_translation_ranges.size() * sizeof(float);
+}
+
+/// @brief Evaluates the animation of a character
+/// @param job The clips and the skeleton of the character
+/// @param pose Scratch pose of the calling thread
+/// @param blend_pose Scratch pose of the calling thread, for the blended clip
+static void evaluateJob(const app::graphics::AnimationSystem::Job& job, app::graphics::AnimationPose& pose, app::graphics::AnimationPose& blend_pose)
+{
+    if (job.m_clip == nullptr || job.m_skeleton == nullptr || job.m_skinning_matrices == nullptr)
+        return;
+    job.m_clip->sample(job.m_time, job.m_loop, pose);
+    if (job.m_blend_clip != nullptr && job.m_blend_weight > 0.0f)
+    {
+        job.m_blend_clip->sample(job.m_blend_time, job.m_loop, blend_pose);
+        app::graphics::AnimationPose::blend(pose, blend_pose, std::min(job.m_blend_weight, 1.0f), pose);
+    }
+    job.m_skeleton->computeSkinningMatrices(pose, job.m_skinning_matrices);
+}
+
+app::graphics::AnimationSystem::AnimationSystem(){};
+
+app::graphics::AnimationSystem::~AnimationSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+};
+
+utils::VResult app::graphics::AnimationSystem::create(const uint32_t worker_count)
+{
+    uint32_t count = worker_count;
+    if (count == 0)
+    {
+        // The calling thread evaluates jobs too
+        const uint32_t hardware_threads = std::thread::hardware_concurrency();
+        count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+    }
+    Log("> Creating the animation system (up to %d worker threads)", count);
+    m_worker_count = count;
+    return utils::VResult::Ok();
+}
+
+void app::graphics::AnimationSystem::evaluate(const std::vector<Job>& jobs)
+{
+    if (jobs.empty())
+        return;
+    // No thread is started until there are several characters to animate
+    if (m_workers.empty() && jobs.size() > 1)
+        startWorkers();
+    if (m_workers.empty() || jobs.size() == 1)
+    {
+        m_jobs = &jobs;
+        m_next_job.store(0, std::memory_order_relaxed);
+        runJobs();
+        m_jobs = nullptr;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs = &jobs;
+        m_next_job.store(0, std::memory_order_relaxed);
+        m_busy_workers = static_cast<uint32_t>(m_workers.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+    // The calling thread takes jobs as well, instead of only waiting
+    runJobs();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy_workers == 0; });
+    m_jobs = nullptr;
+}
+
+void app::graphics::AnimationSystem::startWorkers()
+{
+    if (m_worker_count == 0)
+        return;
+    Log("> Starting the %d worker threads of the animation system", m_worker_count);
+    m_workers.reserve(m_worker_count);
+    for (uint32_t i = 0; i < m_worker_count; ++i)
+        m_workers.emplace_back(&AnimationSystem::workerLoop, this);
+}
+
+void app::graphics::AnimationSystem::runJobs()
+{
+    // The poses are only scratch memory: kept per thread, to not allocate each frame
+    thread_local AnimationPose pose, blend_pose;
+    const std::vector<Job>& jobs = *m_jobs;
+    for (size_t i = m_next_job.fetch_add(1, std::memory_order_relaxed); i < jobs.size(); i = m_next_job.fetch_add(1, std::memory_order_relaxed))
+        evaluateJob(jobs[i], pose, blend_pose);
+}
+
+void app::graphics::AnimationSystem::workerLoop()
+{
+    uint64_t generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stopping || m_generation != generation; });
+            if (m_stopping)
+                return;
+            generation = m_generation;
+        }
+        runJobs();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy_workers == 0)
+            m_done.notify_one();
+    }
+}
@@ -0,0 +1,202 @@
+//
+//  animation.hpp
+//
+
+#pragma once
+#ifndef animation_h
+#define animation_h
+
+#include "../utils/result.h"
+#include <atomic>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief The local transform of a joint, relative to its parent
+        struct JointPose
+        {
+            /// @brief The rotation
+            glm::quat m_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+            /// @brief The translation, in mesh units
+            glm::vec3 m_translation = glm::vec3(0.0f);
+        };
+
+        /// @brief The joints of a pose, by blocks of LANE_COUNT joints in SoA: a component of
+        /// the transforms of the joints of a block is a SIMD register
+        struct AnimationPose
+        {
+            /// @brief The number of joints of a block
+            static constexpr uint32_t LANE_COUNT = 4;
+
+            /// @brief LANE_COUNT joints
+            struct Block
+            {
+                /// @brief The rotations: x, y, z, w components of the joints
+                alignas(16) float m_rotation[4][LANE_COUNT];
+                /// @brief The translations: x, y, z components of the joints
+                alignas(16) float m_translation[3][LANE_COUNT];
+            };
+
+            /// @brief Sets the number of joints (the last block is padded)
+            void resize(const uint32_t joint_count);
+            /// @brief Returns the pose of a joint
+            JointPose getJoint(const uint32_t joint) const;
+            /// @brief Blends two poses of the same skeleton (normalized lerp of the rotations)
+            /// @param from The pose at a weight of 0
+            /// @param to The pose at a weight of 1
+            /// @param weight The weight of `to`
+            /// @param pose Receives the blended pose (may be `from` or `to`)
+            static void blend(const AnimationPose& from, const AnimationPose& to, const float weight, AnimationPose& pose);
+
+            /// @brief The blocks of joints
+            std::vector<Block> m_blocks;
+            /// @brief The number of joints
+            uint32_t m_joint_count = 0;
+        };
+
+        /// @brief The hierarchy of the joints of a skinned mesh
+        struct Skeleton
+        {
+            /// @brief The parent of each joint, before it (-1 for the roots)
+            std::vector<int32_t> m_parents;
+            /// @brief From mesh units to the space of each joint, in the bind pose
+            std::vector<glm::mat4> m_inverse_bind_matrices;
+
+            /// @brief Computes the skinning matrices of a pose (read by GpuSkinning::setJoints)
+            /// @param pose The local transforms of the joints
+            /// @param skinning_matrices Receives the model transform of each joint times its
+            /// inverse bind matrix (as many as the joints)
+            void computeSkinningMatrices(const AnimationPose& pose, glm::mat4* skinning_matrices) const;
+        };
+
+        /// @brief A compressed animation clip, sampled at a uniform rate.
+        ///
+        /// The rotations are quantized with the smallest-three encoding (the largest
+        /// component is dropped and rebuilt from the unit length, the other three are
+        /// stored on 15 bits), the translations on 16 bits in the range of their joint.
+        /// The keys are stored frame after frame, by blocks of AnimationPose::LANE_COUNT
+        /// joints: a sample reads two contiguous frames, decoded straight into SIMD
+        /// registers. 12 bytes per joint and per frame, instead of 28.
+        class AnimationClip
+        {
+        public:
+            /// @brief Compresses the keys of a clip
+            /// @param joint_count The number of joints of the skeleton
+            /// @param sample_rate The number of frames per second
+            /// @param frames The local poses of the joints, frame after frame (joint_count per frame)
+            /// @return The compressed clip, or an error if the keys are invalid
+            static utils::Result<AnimationClip> compress(const uint32_t joint_count, const float sample_rate, const std::vector<JointPose>& frames);
+            /// @brief Samples the clip (interpolated between its two closest frames)
+            /// @param time The time in the clip, in seconds
+            /// @param loop If the time wraps around the duration, rather than being clamped
+            /// @param pose Receives the local poses of the joints
+            void sample(const float time, const bool loop, AnimationPose& pose) const;
+            /// @brief Returns the number of joints of the clip
+            uint32_t getJointCount() const noexcept;
+            /// @brief Returns the duration of the clip, in seconds
+            float getDuration() const noexcept;
+            /// @brief Returns the size of the compressed keys, in bytes
+            size_t getMemorySize() const noexcept;
+
+        private:
+            /// @brief The number of joints
+            uint32_t m_joint_count = 0;
+            /// @brief The number of blocks of joints of a frame
+            uint32_t m_block_count = 0;
+            /// @brief The number of frames
+            uint32_t m_frame_count = 0;
+            /// @brief The number of frames per second
+            float m_sample_rate = 30.0f;
+            /// @brief The smallest three components of the rotations: per frame and block,
+            /// the first, second and third components of the joints of the block.
+            /// The top bits of the first two hold the index of the dropped component.
+            std::vector<uint16_t> m_rotations;
+            /// @brief The translations, in the range of their joint: per frame and block,
+            /// the x, y and z components of the joints of the block
+            std::vector<uint16_t> m_translations;
+            /// @brief The range of the translations: per block, the minimum (x, y, z) then
+            /// the quantization step (x, y, z) of the joints of the block
+            std::vector<float> m_translation_ranges;
+        };
+
+        /// @brief Evaluates the poses of many characters in parallel, on worker threads
+        /// owned by the system (the calling thread helps)
+        class AnimationSystem
+        {
+        public:
+            /// @brief The animation of a character for a frame: a clip, or the blend of two
+            struct Job
+            {
+                /// @brief The main clip
+                const AnimationClip* m_clip = nullptr;
+                /// @brief The time in the main clip, in seconds
+                float m_time = 0.0f;
+                /// @brief The clip blended over the main one, or nullptr
+                const AnimationClip* m_blend_clip = nullptr;
+                /// @brief The time in the blended clip, in seconds
+                float m_blend_time = 0.0f;
+                /// @brief The weight of the blended clip
+                float m_blend_weight = 0.0f;
+                /// @brief If the times wrap around the durations of the clips
+                bool m_loop = true;
+                /// @brief The skeleton animated by the clips
+                const Skeleton* m_skeleton = nullptr;
+                /// @brief Receives the skinning matrices of the joints
+                glm::mat4* m_skinning_matrices = nullptr;
+            };
+
+            /// @brief Public constructor
+            AnimationSystem();
+            /// @brief Public destructor: stops the workers
+            ~AnimationSystem();
+            /// @brief Sets the number of workers, started by the first evaluation that needs them
+            /// @param worker_count The number of worker threads, 0 for one per hardware
+            /// thread besides the calling one
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t worker_count);
+            /// @brief Evaluates the jobs, and returns once all are done
+            void evaluate(const std::vector<Job>& jobs);
+
+        private:
+            /// @brief AnimationSystem should not be cloneable
+            AnimationSystem(AnimationSystem& other) = delete;
+            /// @brief AnimationSystem should not be assignable
+            void operator=(const AnimationSystem& other) = delete;
+            /// @brief Runs the jobs of the current evaluation, until none is left
+            void runJobs();
+            /// @brief The loop of a worker thread
+            void workerLoop();
+            /// @brief Starts the worker threads
+            void startWorkers();
+            /// @brief The number of worker threads to start
+            uint32_t m_worker_count = 0;
+            /// @brief The worker threads
+            std::vector<std::thread> m_workers;
+            /// @brief Protects the state shared with the workers
+            std::mutex m_mutex;
+            /// @brief Wakes the workers up for an evaluation, or to stop
+            std::condition_variable m_wake;
+            /// @brief Signals the end of an evaluation
+            std::condition_variable m_done;
+            /// @brief The jobs of the current evaluation
+            const std::vector<Job>* m_jobs = nullptr;
+            /// @brief The next job to run
+            std::atomic<size_t> m_next_job{0};
+            /// @brief The number of workers still running the current evaluation
+            uint32_t m_busy_workers = 0;
+            /// @brief Incremented by each evaluation
+            uint64_t m_generation = 0;
+            /// @brief If the workers have to stop
+            bool m_stopping = false;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // animation_h
@@ -0,0 +1,93 @@
+//
+//  attachment.cpp
+//
+
+#include "attachment.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+
+app::graphics::Attachment::Attachment(){};
+
+app::graphics::Attachment::~Attachment()
+{
+    destroy();
+};
+
+utils::VResult app::graphics::Attachment::create(
+    const VkExtent2D& extent,
+    const VkFormat format,
+    const VkImageUsageFlags usage,
+    const VkImageAspectFlags aspect,
+    const VkSampleCountFlagBits samples,
+    const uint32_t layers,
+    const uint32_t depth)
+{
+    if (!m_handle.isNull())
+    {
+        LogW("the attachment has already been initialized - resetting it...");
+        destroy();
+    }
+    const auto result = app::Engine::getInstance()->m_resources->createImage(extent, format, usage, aspect, samples, layers, depth);
+    if (result.IsError())
+    {
+        LogE("> Cannot create an attachment of %dx%d pixels", extent.width, extent.height);
+        return utils::VResult::Error((char*)"Cannot create the image of the attachment");
+    }
+    m_handle = result.GetValue();
+    return utils::VResult::Ok();
+}
+
+void app::graphics::Attachment::destroy()
+{
+    if (m_handle.isNull())
+        return;
+    app::Engine::getInstance()->m_resources->destroy(m_handle);
+    m_handle = app::graphics::ImageHandle();
+}
+
+VkImage app::graphics::Attachment::getImage() const noexcept
+{
+    if (m_handle.isNull())
+        return VK_NULL_HANDLE;
+    return app::Engine::getInstance()->m_resources->getImage(m_handle).m_image;
+}
+
+VkImageView app::graphics::Attachment::getImageView() const noexcept
+{
+    if (m_handle.isNull())
+        return VK_NULL_HANDLE;
+    return app::Engine::getInstance()->m_resources->getImage(m_handle).m_image_view;
+}
+
+VkFormat app::graphics::Attachment::getFormat() const noexcept
+{
+    if (m_handle.isNull())
+        return VK_FORMAT_UNDEFINED;
+    return app::Engine::getInstance()->m_resources->getImage(m_handle).m_format;
+}
+
+VkExtent2D app::graphics::Attachment::getExtent() const noexcept
+{
+    if (m_handle.isNull())
+        return VkExtent2D{0, 0};
+    return app::Engine::getInstance()->m_resources->getImage(m_handle).m_extent;
+}
+
+uint32_t app::graphics::Attachment::getLayers() const noexcept
+{
+    if (m_handle.isNull())
+        return 1;
+    return app::Engine::getInstance()->m_resources->getImage(m_handle).m_layers;
+}
+
+uint32_t app::graphics::Attachment::getDepth() const noexcept
+{
+    if (m_handle.isNull())
+        return 1;
+    return app::Engine::getInstance()->m_resources->getImage(m_handle).m_depth;
+}
+
+app::graphics::ImageHandle app::graphics::Attachment::getHandle() const noexcept
+{
+    return m_handle;
+}
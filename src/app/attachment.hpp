@@ -0,0 +1,74 @@
+//
+//  attachment.hpp
+//
+
+#pragma once
+#ifndef attachment_h
+#define attachment_h
+
+#include "../utils/result.h"
+#include "resources.hpp"
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief An image of the resource pools (not owned by the swapchain), with its
+        /// view, owned by a module of the engine: its handle is destroyed with it. Bound as a
+        /// framebuffer attachment (depth buffer, offscreen color target, ...) or as a storage
+        /// image.
+        class Attachment
+        {
+        public:
+            /// @brief Public constructor
+            Attachment();
+            /// @brief Public destructor
+            ~Attachment();
+            /// @brief Creates the image, its memory and its view
+            /// @param extent The size of the attachment, in pixels
+            /// @param format The format of the attachment
+            /// @param usage Usage flag(s) of the image
+            /// @param aspect The aspect of the image view (color, depth, ...)
+            /// @param samples The number of samples per pixel
+            /// @param layers The number of layers: the view is a 2D array view if more than one
+            /// @param depth The depth, in pixels: the image and its view are 3D if more than one
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(
+                const VkExtent2D& extent,
+                const VkFormat format,
+                const VkImageUsageFlags usage,
+                const VkImageAspectFlags aspect,
+                const VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT,
+                const uint32_t layers = 1,
+                const uint32_t depth = 1);
+            /// @brief Destroys the image view, the image and its memory, if those exist
+            void destroy();
+            /// @brief Returns the image
+            VkImage getImage() const noexcept;
+            /// @brief Returns the image view
+            VkImageView getImageView() const noexcept;
+            /// @brief Returns the format of the image
+            VkFormat getFormat() const noexcept;
+            /// @brief Returns the size of the image
+            VkExtent2D getExtent() const noexcept;
+            /// @brief Returns the number of layers of the image
+            uint32_t getLayers() const noexcept;
+            /// @brief Returns the depth of the image (1 for 2D images)
+            uint32_t getDepth() const noexcept;
+            /// @brief Returns the handle of the image in the resource pools
+            app::graphics::ImageHandle getHandle() const noexcept;
+
+        private:
+            /// @brief Attachment should not be cloneable
+            Attachment(Attachment& other) = delete;
+            /// @brief Attachment should not be assignable
+            void operator=(const Attachment& other) = delete;
+            /// @brief The image and its view, in the resource pools
+            app::graphics::ImageHandle m_handle;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // attachment_h
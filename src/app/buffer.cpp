@@ -0,0 +1,94 @@
+//
+//  buffer.cpp
+//
+
+#include "buffer.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include <cstring>
+
+app::graphics::Buffer::Buffer(){};
+
+app::graphics::Buffer::~Buffer()
+{
+    destroy();
+};
+
+utils::VResult app::graphics::Buffer::create(const VkDeviceSize size, const VkBufferUsageFlags usage, const bool host_visible)
+{
+    if (!m_handle.isNull())
+    {
+        LogW("the buffer has already been initialized - resetting it...");
+        destroy();
+    }
+    const auto result = app::Engine::getInstance()->m_resources->createBuffer(size, usage, host_visible);
+    if (result.IsError())
+    {
+        LogE("> Cannot create a buffer of %llu bytes", size);
+        return utils::VResult::Error((char*)"Cannot create the buffer");
+    }
+    m_handle = result.GetValue();
+    return utils::VResult::Ok();
+}
+
+void app::graphics::Buffer::destroy()
+{
+    if (m_handle.isNull())
+        return;
+    app::Engine::getInstance()->m_resources->destroy(m_handle);
+    m_handle = app::graphics::BufferHandle();
+}
+
+void app::graphics::Buffer::write(const void* data, const VkDeviceSize size, const VkDeviceSize offset)
+{
+    const auto& buffer = app::Engine::getInstance()->m_resources->getBuffer(m_handle);
+    assert(nullptr != buffer.m_mapped_data);
+    assert(offset + size <= buffer.m_size);
+    memcpy(static_cast<char*>(buffer.m_mapped_data) + offset, data, static_cast<size_t>(size));
+    // No-op if the memory is host-coherent
+    vmaFlushAllocation(app::Engine::getInstance()->m_allocator, buffer.m_allocation, offset, size);
+}
+
+void app::graphics::Buffer::flush(const VkDeviceSize size, const VkDeviceSize offset)
+{
+    const auto& buffer = app::Engine::getInstance()->m_resources->getBuffer(m_handle);
+    assert(nullptr != buffer.m_mapped_data);
+    assert(offset + size <= buffer.m_size);
+    vmaFlushAllocation(app::Engine::getInstance()->m_allocator, buffer.m_allocation, offset, size);
+}
+
+VkBuffer app::graphics::Buffer::getBuffer() const noexcept
+{
+    if (m_handle.isNull())
+        return VK_NULL_HANDLE;
+    return app::Engine::getInstance()->m_resources->getBuffer(m_handle).m_buffer;
+}
+
+VkDeviceSize app::graphics::Buffer::getSize() const noexcept
+{
+    if (m_handle.isNull())
+        return 0;
+    return app::Engine::getInstance()->m_resources->getBuffer(m_handle).m_size;
+}
+
+void* app::graphics::Buffer::getMappedData() const noexcept
+{
+    if (m_handle.isNull())
+        return nullptr;
+    return app::Engine::getInstance()->m_resources->getBuffer(m_handle).m_mapped_data;
+}
+
+VkDeviceAddress app::graphics::Buffer::getDeviceAddress() const
+{
+    assert(!m_handle.isNull());
+    const VkBufferDeviceAddressInfo address_info{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .buffer = getBuffer(),
+    };
+    return vkGetBufferDeviceAddress(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &address_info);
+}
+
+app::graphics::BufferHandle app::graphics::Buffer::getHandle() const noexcept
+{
+    return m_handle;
+}
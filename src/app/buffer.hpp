@@ -0,0 +1,70 @@
+//
+//  buffer.hpp
+//
+
+#pragma once
+#ifndef buffer_h
+#define buffer_h
+
+#include "../utils/result.h"
+#include "resources.hpp"
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief A buffer of the resource pools, owned by a module of the engine: its handle
+        /// is destroyed with it. Host-visible buffers stay mapped for their whole lifetime,
+        /// to be written every frame without map / unmap calls.
+        class Buffer
+        {
+        public:
+            /// @brief Public constructor
+            Buffer();
+            /// @brief Public destructor
+            ~Buffer();
+            /// @brief Creates the buffer and its memory
+            /// @param size The size of the buffer, in bytes
+            /// @param usage Usage flag(s) of the buffer
+            /// @param host_visible If the CPU writes the buffer (mapped), or if only the GPU accesses it
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const VkDeviceSize size, const VkBufferUsageFlags usage, const bool host_visible);
+            /// @brief Destroys the buffer and its memory, if those exist
+            void destroy();
+            /// @brief Copies data in a host-visible buffer
+            /// @param data The data to copy
+            /// @param size The size of the data, in bytes
+            /// @param offset The offset in the buffer, in bytes
+            void write(const void* data, const VkDeviceSize size, const VkDeviceSize offset = 0);
+            /// @brief Makes the writes to the mapped memory of a host-visible buffer visible
+            /// to the device (no-op if the memory is host-coherent)
+            /// @param size The number of bytes written
+            /// @param offset The offset of the written bytes
+            void flush(const VkDeviceSize size, const VkDeviceSize offset = 0);
+            /// @brief Returns the buffer
+            VkBuffer getBuffer() const noexcept;
+            /// @brief Returns the size of the buffer, in bytes
+            VkDeviceSize getSize() const noexcept;
+            /// @brief Returns the mapped memory of the buffer, or nullptr if not host-visible
+            void* getMappedData() const noexcept;
+            /// @brief Returns the address of the buffer, read by the shaders through buffer
+            /// references. The buffer must have been created with
+            /// VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT.
+            VkDeviceAddress getDeviceAddress() const;
+            /// @brief Returns the handle of the buffer in the resource pools
+            app::graphics::BufferHandle getHandle() const noexcept;
+
+        private:
+            /// @brief Buffer should not be cloneable
+            Buffer(Buffer& other) = delete;
+            /// @brief Buffer should not be assignable
+            void operator=(const Buffer& other) = delete;
+            /// @brief The buffer, in the resource pools
+            app::graphics::BufferHandle m_handle;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // buffer_h
@@ -0,0 +1,57 @@
+//
+//  camera.cpp
+//
+
+#include "camera.hpp"
+#include "depth.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+app::graphics::Camera::Camera()
+{
+    m_view = glm::mat4(1.0f);
+    m_fovy = glm::radians(60.0f);
+    m_near = 0.1f;
+    m_far = 100.0f;
+}
+
+void app::graphics::Camera::setView(const glm::mat4& view) noexcept
+{
+    m_view = view;
+}
+
+void app::graphics::Camera::lookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up) noexcept
+{
+    m_view = glm::lookAtRH(eye, target, up);
+}
+
+void app::graphics::Camera::setPerspective(const float fovy, const float z_near, const float z_far) noexcept
+{
+    m_fovy = fovy;
+    m_near = z_near;
+    m_far = z_far;
+}
+
+const glm::mat4& app::graphics::Camera::getView() const noexcept
+{
+    return m_view;
+}
+
+glm::mat4 app::graphics::Camera::getProjection(const float aspect) const noexcept
+{
+    return app::graphics::Depth::perspective(m_fovy, aspect, m_near, m_far);
+}
+
+float app::graphics::Camera::getFovY() const noexcept
+{
+    return m_fovy;
+}
+
+float app::graphics::Camera::getNear() const noexcept
+{
+    return m_near;
+}
+
+float app::graphics::Camera::getFar() const noexcept
+{
+    return m_far;
+}
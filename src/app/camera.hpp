@@ -0,0 +1,60 @@
+//
+//  camera.hpp
+//
+
+#pragma once
+#ifndef camera_h
+#define camera_h
+
+#include <glm/glm.hpp>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief The point of view of the scene: a view matrix (world to view space,
+        /// right-handed, looking down -Z) and a perspective projection
+        class Camera
+        {
+        public:
+            /// @brief Public constructor: at the origin, looking down -Z
+            Camera();
+            /// @brief Sets the view matrix
+            /// @param view The world to view space transform
+            void setView(const glm::mat4& view) noexcept;
+            /// @brief Sets the view matrix from a position and a target
+            /// @param eye The position of the camera
+            /// @param target The point to look at
+            /// @param up The up direction
+            void lookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up = glm::vec3(0.0f, 1.0f, 0.0f)) noexcept;
+            /// @brief Sets the parameters of the perspective projection
+            /// @param fovy The vertical field of view, in radians
+            /// @param z_near The distance of the near plane
+            /// @param z_far The distance of the far plane
+            void setPerspective(const float fovy, const float z_near, const float z_far) noexcept;
+            /// @brief Returns the world to view space transform
+            const glm::mat4& getView() const noexcept;
+            /// @brief Returns the projection (see Depth::perspective)
+            /// @param aspect The aspect ratio (width / height) of the viewport
+            glm::mat4 getProjection(const float aspect) const noexcept;
+            /// @brief Returns the vertical field of view, in radians
+            float getFovY() const noexcept;
+            /// @brief Returns the distance of the near plane
+            float getNear() const noexcept;
+            /// @brief Returns the distance of the far plane
+            float getFar() const noexcept;
+
+        private:
+            /// @brief The world to view space transform
+            glm::mat4 m_view;
+            /// @brief The vertical field of view, in radians
+            float m_fovy;
+            /// @brief The distance of the near plane
+            float m_near;
+            /// @brief The distance of the far plane
+            float m_far;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // camera_h
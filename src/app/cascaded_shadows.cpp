@@ -0,0 +1,517 @@
+//
+//  cascaded_shadows.cpp
+//
+
+#include "cascaded_shadows.hpp"
+#include "../utils/debug_tools.h"
+#include "depth.hpp"
+#include "engine.hpp"
+#include "pipeline.hpp"
+#include "shaders.h"
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+/// @brief Granularity of the radius of the cascades, in world units: rounding it up
+/// keeps the texel size constant despite the float errors
+constexpr float RADIUS_GRANULARITY = 1.0f / 16.0f;
+
+app::graphics::CascadedShadowMaps::CascadedShadowMaps(){};
+
+app::graphics::CascadedShadowMaps::~CascadedShadowMaps()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    if (VK_NULL_HANDLE != m_descriptor_set)
+    {
+        vkFreeDescriptorSets(graphics_device, app::Engine::getInstance()->getDescriptorPool(), 1, &m_descriptor_set);
+        m_descriptor_set = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_pipeline_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_pipeline_layout, nullptr);
+        m_pipeline_layout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_descriptor_set_layout)
+    {
+        vkDestroyDescriptorSetLayout(graphics_device, m_descriptor_set_layout, nullptr);
+        m_descriptor_set_layout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_framebuffer)
+    {
+        vkDestroyFramebuffer(graphics_device, m_framebuffer, nullptr);
+        m_framebuffer = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_render_pass)
+    {
+        vkDestroyRenderPass(graphics_device, m_render_pass, nullptr);
+        m_render_pass = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_sampler)
+    {
+        vkDestroySampler(graphics_device, m_sampler, nullptr);
+        m_sampler = VK_NULL_HANDLE;
+    }
+    m_shadow_maps = nullptr;
+    m_params_buffer = nullptr;
+};
+
+utils::VResult app::graphics::CascadedShadowMaps::create(const uint32_t cascade_count, const uint32_t resolution)
+{
+    Log("> Creating the cascaded shadow maps (%d cascades of %dx%d)", cascade_count, resolution, resolution);
+    // A single cascade would get a 2D view, not the array view the shaders read
+    if (cascade_count < 2 || cascade_count > MAX_CASCADES)
+        return utils::VResult::Error((char*)"The number of shadow cascades should be between 2 and MAX_CASCADES");
+    m_cascade_count = cascade_count;
+    m_resolution = resolution;
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(app::Engine::getInstance()->m_graphics_device.getPhysicalDevice(), FORMAT, &format_properties);
+    constexpr VkFormatFeatureFlags required_features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                       VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                       VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((format_properties.optimalTilingFeatures & required_features) != required_features)
+        return utils::VResult::Error((char*)"The format of the cascaded shadow maps is not supported");
+
+    m_shadow_maps = std::make_shared<app::graphics::Attachment>();
+    if (const auto result = m_shadow_maps->create(
+            VkExtent2D{m_resolution, m_resolution},
+            FORMAT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_IMAGE_ASPECT_DEPTH_BIT,
+            VK_SAMPLE_COUNT_1_BIT,
+            m_cascade_count);
+        result.IsError())
+    {
+        LogE("Error creating the cascaded shadow maps");
+        return result;
+    }
+
+    m_params_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_params_buffer->create(sizeof(CascadeParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, true); result.IsError())
+        return result;
+    // Nothing is lit by the sun before the first frame
+    m_params_buffer->write(&m_params, sizeof(CascadeParams));
+
+    // Linear filtering with a comparison: the hardware averages 2x2 depth tests
+    VkSamplerCreateInfo sampler_create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .compareEnable = VK_TRUE,
+        // Lit if the fragment is at least as close as the closest occluder
+        .compareOp = Project::DEPTH_REVERSED_Z ? VK_COMPARE_OP_GREATER_OR_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL,
+        .maxLod = 0.0f,
+    };
+    if (const auto result = vkCreateSampler(graphics_device, &sampler_create_info, nullptr, &m_sampler); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateSampler: error 0x%08x for the cascaded shadow maps", result);
+        return utils::VResult::Error((char*)"Cannot create the sampler of the cascaded shadow maps");
+    }
+
+    if (const auto result = createRenderPass(); result.IsError())
+        return result;
+
+    // With multiview, the framebuffer has a single layer: the views select the layers
+    VkImageView shadow_maps_view = m_shadow_maps->getImageView();
+    VkFramebufferCreateInfo framebuffer_create_info{
+        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .renderPass = m_render_pass,
+        .attachmentCount = 1,
+        .pAttachments = &shadow_maps_view,
+        .width = m_resolution,
+        .height = m_resolution,
+        .layers = 1,
+    };
+    if (const auto result = vkCreateFramebuffer(graphics_device, &framebuffer_create_info, nullptr, &m_framebuffer); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateFramebuffer: error 0x%08x for the cascaded shadow maps", result);
+        return utils::VResult::Error((char*)"Cannot create the framebuffer of the cascaded shadow maps");
+    }
+
+    return createPipeline();
+}
+
+utils::VResult app::graphics::CascadedShadowMaps::createRenderPass()
+{
+    VkAttachmentDescription depth_attachment{
+        .format = FORMAT,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+    VkAttachmentReference depth_attachment_reference{
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+    VkSubpassDescription subpass{
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 0,
+        .pDepthStencilAttachment = &depth_attachment_reference,
+    };
+    // The scene of the previous frame stops sampling the cascades before they are
+    // cleared, and the scene of this frame samples them once they are written
+    const VkSubpassDependency dependencies[2] = {
+        {
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        },
+        {
+            .srcSubpass = 0,
+            .dstSubpass = VK_SUBPASS_EXTERNAL,
+            .srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        },
+    };
+    // One view per cascade: the subpass is executed once per bit of the mask
+    const uint32_t view_mask = (1u << m_cascade_count) - 1;
+    VkRenderPassMultiviewCreateInfo multiview_create_info{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO,
+        .subpassCount = 1,
+        .pViewMasks = &view_mask,
+        .correlationMaskCount = 1,
+        .pCorrelationMasks = &view_mask,
+    };
+    VkRenderPassCreateInfo render_pass_create_info{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .pNext = &multiview_create_info,
+        .attachmentCount = 1,
+        .pAttachments = &depth_attachment,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        .dependencyCount = 2,
+        .pDependencies = dependencies,
+    };
+    if (const auto result = vkCreateRenderPass(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &render_pass_create_info, nullptr, &m_render_pass); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateRenderPass: error 0x%08x for the cascaded shadow maps", result);
+        return utils::VResult::Error((char*)"Cannot create the render pass of the cascaded shadow maps");
+    }
+    return utils::VResult::Ok();
+}
+
+utils::VResult app::graphics::CascadedShadowMaps::createPipeline()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+
+    const VkDescriptorSetLayoutBinding binding{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr};
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings = &binding,
+    };
+    if (const auto result = vkCreateDescriptorSetLayout(graphics_device, &descriptor_set_layout_create_info, nullptr, &m_descriptor_set_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateDescriptorSetLayout: error 0x%08x for the cascaded shadow maps", result);
+        return utils::VResult::Error((char*)"Cannot create the descriptor set layout of the cascaded shadow maps");
+    }
+    VkDescriptorSetAllocateInfo allocate_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = app::Engine::getInstance()->getDescriptorPool(),
+        .descriptorSetCount = 1,
+        .pSetLayouts = &m_descriptor_set_layout,
+    };
+    if (const auto result = vkAllocateDescriptorSets(graphics_device, &allocate_info, &m_descriptor_set); result != VK_SUCCESS)
+    {
+        m_descriptor_set = VK_NULL_HANDLE;
+        LogE("> vkAllocateDescriptorSets: error 0x%08x for the cascaded shadow maps", result);
+        return utils::VResult::Error((char*)"Cannot allocate the descriptor set of the cascaded shadow maps");
+    }
+    VkDescriptorBufferInfo buffer_info{
+        .buffer = m_params_buffer->getBuffer(),
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptor_set,
+        .dstBinding = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .pBufferInfo = &buffer_info,
+    };
+    vkUpdateDescriptorSets(graphics_device, 1, &write, 0, nullptr);
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_descriptor_set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+    if (const auto result = vkCreatePipelineLayout(graphics_device, &pipeline_layout_create_info, nullptr, &m_pipeline_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for the cascaded shadow maps", result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the cascaded shadow maps");
+    }
+
+    const char* shader_filepath = "shaders/cascade_shadow.vert.spv";
+    const auto shader_module_result = app::graphics::Pipeline::loadShaderModule(shader_filepath);
+    if (shader_module_result.IsError())
+        return utils::VResult::Error((char*)"Cannot create the shader module of the cascaded shadow maps");
+    const VkShaderModule shader_module = shader_module_result.GetValue();
+    VkPipelineShaderStageCreateInfo shader_stage{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+        .module = shader_module,
+        .pName = "main",
+    };
+
+    // Same vertex buffers as the scene, positions only
+    const auto vertex_binding_description = app::shaders::VertexUtils::getVertexBindingDescription();
+    const auto vertex_attribute_descriptions = app::shaders::VertexUtils::getVertexAttributeDescriptions();
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &vertex_binding_description,
+        .vertexAttributeDescriptionCount = 1,
+        .pVertexAttributeDescriptions = &vertex_attribute_descriptions[0],
+    };
+    VkPipelineInputAssemblyStateCreateInfo assembly_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    // No culling: the casters are seen from any side by the light. The bias pushes the
+    // stored depth away from the light, to avoid self-shadowing on the lit surfaces
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_TRUE,
+        .depthBiasConstantFactor = Project::DEPTH_REVERSED_Z ? -1.25f : 1.25f,
+        .depthBiasClamp = 0.0f,
+        .depthBiasSlopeFactor = Project::DEPTH_REVERSED_Z ? -1.75f : 1.75f,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+    };
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = app::graphics::Depth::getCompareOp(),
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 0,
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 1,
+        .pStages = &shader_stage,
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &assembly_state_create_info,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_pipeline_layout,
+        .renderPass = m_render_pass,
+        .subpass = 0,
+    };
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_pipeline);
+    // The module is not needed anymore once the pipeline is created
+    vkDestroyShaderModule(graphics_device, shader_module, nullptr);
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the cascaded shadow maps", pipeline_result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline of the cascaded shadow maps");
+    }
+    return utils::VResult::Ok();
+}
+
+void app::graphics::CascadedShadowMaps::setLight(const glm::vec3& direction, const glm::vec3& color, const float intensity) noexcept
+{
+    m_direction = glm::normalize(direction);
+    m_color = color;
+    m_intensity = intensity;
+}
+
+void app::graphics::CascadedShadowMaps::setSplitLambda(const float lambda) noexcept
+{
+    m_split_lambda = glm::clamp(lambda, 0.0f, 1.0f);
+}
+
+void app::graphics::CascadedShadowMaps::setShadowDistance(const float distance) noexcept
+{
+    m_shadow_distance = distance;
+}
+
+void app::graphics::CascadedShadowMaps::setCasterRecorder(CasterRecorder recorder)
+{
+    m_caster_recorder = recorder;
+}
+
+void app::graphics::CascadedShadowMaps::record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent)
+{
+    const float aspect = static_cast<float>(render_extent.width) / static_cast<float>(render_extent.height);
+    const float z_near = camera.getNear();
+    const float z_far = std::max(std::min(camera.getFar(), m_shadow_distance), z_near);
+    const glm::mat4& view = camera.getView();
+    const glm::mat4 inverse_view = glm::inverse(view);
+    // Half-diagonal of the frustum, per unit of depth
+    const float tan_half_fovy = glm::tan(camera.getFovY() / 2.0f);
+    const float diagonal_squared = tan_half_fovy * tan_half_fovy * (1.0f + aspect * aspect);
+
+    // The light space only rotates with the light: not with the camera
+    const glm::vec3 up = glm::abs(m_direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 light_rotation = glm::lookAtRH(glm::vec3(0.0f), m_direction, up);
+
+    float split_near = z_near;
+    for (uint32_t cascade = 0; cascade < m_cascade_count; ++cascade)
+    {
+        // Blend of the logarithmic and of the uniform distributions
+        const float ratio = static_cast<float>(cascade + 1) / static_cast<float>(m_cascade_count);
+        const float log_split = z_near * glm::pow(z_far / z_near, ratio);
+        const float uniform_split = z_near + (z_far - z_near) * ratio;
+        const float split_far = m_split_lambda * log_split + (1.0f - m_split_lambda) * uniform_split;
+
+        // Bounding sphere of the slice of the frustum, centered on the view axis: its
+        // radius does not depend on the orientation of the camera
+        float center_depth = 0.5f * (split_near + split_far) * (1.0f + diagonal_squared);
+        center_depth = std::min(center_depth, split_far);
+        float radius = glm::sqrt((split_far - center_depth) * (split_far - center_depth) + split_far * split_far * diagonal_squared);
+        radius = glm::ceil(radius / RADIUS_GRANULARITY) * RADIUS_GRANULARITY;
+        const glm::vec3 center = glm::vec3(inverse_view * glm::vec4(0.0f, 0.0f, -center_depth, 1.0f));
+
+        // Move the cascade by whole texels only
+        glm::vec3 light_center = glm::vec3(light_rotation * glm::vec4(center, 1.0f));
+        const float texel_size = 2.0f * radius / static_cast<float>(m_resolution);
+        light_center.x = glm::floor(light_center.x / texel_size) * texel_size;
+        light_center.y = glm::floor(light_center.y / texel_size) * texel_size;
+
+        // The casters up to the shadow distance towards the light are kept
+        const glm::mat4 projection = app::graphics::Depth::orthographic(
+            light_center.x - radius,
+            light_center.x + radius,
+            light_center.y - radius,
+            light_center.y + radius,
+            -light_center.z - radius - m_shadow_distance,
+            -light_center.z + radius);
+        m_params.m_world_to_clip[cascade] = projection * light_rotation;
+        m_params.m_view_to_clip[cascade] = m_params.m_world_to_clip[cascade] * inverse_view;
+        m_params.m_cull_scale[cascade] = glm::vec4(1.0f / radius, 1.0f / radius, 0.0f, 0.0f);
+        m_params.m_splits[cascade] = split_far;
+        split_near = split_far;
+    }
+    m_params.m_direction_count = glm::vec4(glm::normalize(glm::vec3(view * glm::vec4(-m_direction, 0.0f))), static_cast<float>(m_cascade_count));
+    m_params.m_color_intensity = glm::vec4(m_color, m_intensity);
+    m_params_buffer->write(&m_params, sizeof(CascadeParams));
+
+    // Cleared to the far plane: the cascades are rendered even without light or casters,
+    // to be in the layout the scene reads them in
+    const VkClearValue clear_value = app::graphics::Depth::getClearValue();
+    VkRenderPassBeginInfo render_pass_begin_info{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = m_render_pass,
+        .framebuffer = m_framebuffer,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = {m_resolution, m_resolution},
+        },
+        .clearValueCount = 1,
+        .pClearValues = &clear_value,
+    };
+    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    if (m_intensity > 0.0f && nullptr != m_caster_recorder)
+    {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &m_descriptor_set, 0, nullptr);
+        VkViewport viewport{
+            .x = 0.0f,
+            .y = 0.0f,
+            .width = static_cast<float>(m_resolution),
+            .height = static_cast<float>(m_resolution),
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        };
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        VkRect2D scissor{
+            .offset = {0, 0},
+            .extent = {m_resolution, m_resolution},
+        };
+        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+        m_caster_recorder(command_buffer);
+    }
+    vkCmdEndRenderPass(command_buffer);
+}
+
+std::shared_ptr<app::graphics::Attachment> app::graphics::CascadedShadowMaps::getShadowMaps() const
+{
+    return m_shadow_maps;
+}
+
+VkSampler app::graphics::CascadedShadowMaps::getSampler() const noexcept
+{
+    return m_sampler;
+}
+
+std::shared_ptr<app::graphics::Buffer> app::graphics::CascadedShadowMaps::getParamsBuffer() const
+{
+    return m_params_buffer;
+}
+
+VkPipelineLayout app::graphics::CascadedShadowMaps::getPipelineLayout() const noexcept
+{
+    return m_pipeline_layout;
+}
+
+uint32_t app::graphics::CascadedShadowMaps::getCascadeCount() const noexcept
+{
+    return m_cascade_count;
+}
+
+float app::graphics::CascadedShadowMaps::getSplit(const uint32_t cascade) const noexcept
+{
+    return cascade < m_cascade_count ? m_params.m_splits[cascade] : 0.0f;
+}
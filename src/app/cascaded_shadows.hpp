@@ -0,0 +1,163 @@
+//
+//  cascaded_shadows.hpp
+//
+
+#pragma once
+#ifndef cascaded_shadows_h
+#define cascaded_shadows_h
+
+#include "../utils/result.h"
+#include "attachment.hpp"
+#include "buffer.hpp"
+#include "camera.hpp"
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Cascaded shadow maps of the directional light (the sun).
+        /// The view frustum is split in depth, and each split gets its own orthographic
+        /// shadow map, as a layer of one array image.
+        ///
+        /// All the cascades are rendered in a single pass with multiview: each caster is
+        /// drawn once, and the vertex shader projects it in the cascade of `gl_ViewIndex`.
+        /// Casters outside of a cascade are culled there, from their bounding sphere.
+        /// The cascades are stabilized: their size only depends on the split distances,
+        /// and their origin moves by whole texels, so the shadows do not shimmer when
+        /// the camera moves or rotates.
+        class CascadedShadowMaps
+        {
+        public:
+            /// @brief The maximum number of cascades (size of the arrays of the shaders)
+            static constexpr uint32_t MAX_CASCADES = 4;
+            /// @brief Format of the shadow maps
+            static constexpr VkFormat FORMAT = VK_FORMAT_D32_SFLOAT;
+
+            /// @brief Push constants of the cascade pipeline (vertex stage), pushed by
+            /// the caster recorder for each draw
+            struct PushConstants
+            {
+                /// @brief From object space to world space
+                glm::mat4 m_model;
+                /// @brief Bounding sphere of the caster in world space (center, radius),
+                /// to cull it per cascade. A radius of 0 disables the culling.
+                glm::vec4 m_bounds;
+            };
+            /// @brief Records the draws of the shadow casters, once for all the cascades.
+            /// The cascade pipeline and its descriptor set are already bound; the recorder
+            /// binds its geometry and pushes `PushConstants` for each draw.
+            using CasterRecorder = std::function<void(VkCommandBuffer command_buffer)>;
+
+            /// @brief Public constructor
+            CascadedShadowMaps();
+            /// @brief Public destructor
+            ~CascadedShadowMaps();
+            /// @brief Creates the shadow maps, the multiview render pass and the pipeline
+            /// @param cascade_count The number of cascades, between 2 and MAX_CASCADES
+            /// @param resolution The width and the height of a cascade, in pixels
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t cascade_count, const uint32_t resolution);
+            /// @brief Sets the directional light
+            /// @param direction The direction the light travels to, in world space
+            /// @param color The color of the light
+            /// @param intensity The intensity of the light (0 to disable it)
+            void setLight(const glm::vec3& direction, const glm::vec3& color, const float intensity) noexcept;
+            /// @brief Sets the distribution of the splits: 0 for uniform splits, 1 for
+            /// logarithmic splits
+            void setSplitLambda(const float lambda) noexcept;
+            /// @brief Sets the distance from the camera after which there are no shadows
+            void setShadowDistance(const float distance) noexcept;
+            /// @brief Sets the function that draws the shadow casters
+            void setCasterRecorder(CasterRecorder recorder);
+            /// @brief Computes the splits and the cascades of the frame, uploads them, and
+            /// records the shadow pass. Should be recorded outside of any render pass,
+            /// before the scene.
+            /// @param command_buffer The command buffer being recorded
+            /// @param camera The point of view of the frame
+            /// @param render_extent The extent the scene will be rendered at
+            void record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent);
+            /// @brief Returns the shadow maps (one layer per cascade), in
+            /// SHADER_READ_ONLY_OPTIMAL layout after `record`
+            std::shared_ptr<app::graphics::Attachment> getShadowMaps() const;
+            /// @brief Returns the comparison sampler to read the shadow maps with
+            VkSampler getSampler() const noexcept;
+            /// @brief Returns the uniform buffer of the cascades and of the light
+            std::shared_ptr<app::graphics::Buffer> getParamsBuffer() const;
+            /// @brief Returns the layout of the cascade pipeline, to push the casters
+            VkPipelineLayout getPipelineLayout() const noexcept;
+            /// @brief Returns the number of cascades
+            uint32_t getCascadeCount() const noexcept;
+            /// @brief Returns the far distance of a cascade, computed by the last `record`
+            /// @param cascade The index of the cascade
+            float getSplit(const uint32_t cascade) const noexcept;
+
+        private:
+            /// @brief The cascades and the light (uniform buffer, std140)
+            struct CascadeParams
+            {
+                /// @brief From world space to the clip space of each cascade
+                glm::mat4 m_world_to_clip[MAX_CASCADES];
+                /// @brief From the view space of the camera to the clip space of each cascade
+                glm::mat4 m_view_to_clip[MAX_CASCADES];
+                /// @brief Clip units per world unit of each cascade, on X and Y (z, w unused)
+                glm::vec4 m_cull_scale[MAX_CASCADES];
+                /// @brief The far distance of each cascade, from the camera
+                glm::vec4 m_splits;
+                /// @brief Direction to the light, in view space, and the number of cascades (w)
+                glm::vec4 m_direction_count;
+                /// @brief Color, and intensity of the light
+                glm::vec4 m_color_intensity;
+            };
+            /// @brief CascadedShadowMaps should not be cloneable
+            CascadedShadowMaps(CascadedShadowMaps& other) = delete;
+            /// @brief CascadedShadowMaps should not be assignable
+            void operator=(const CascadedShadowMaps& other) = delete;
+            /// @brief Creates the multiview render pass: one view per cascade
+            utils::VResult createRenderPass();
+            /// @brief Creates the descriptor set of the cascades, and the depth-only pipeline
+            utils::VResult createPipeline();
+            /// @brief The shadow maps, one layer per cascade
+            std::shared_ptr<app::graphics::Attachment> m_shadow_maps = nullptr;
+            /// @brief The cascades and the light (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_params_buffer = nullptr;
+            /// @brief The parameters of the frame (staging for the upload)
+            CascadeParams m_params{};
+            /// @brief Multiview depth-only render pass
+            VkRenderPass m_render_pass = VK_NULL_HANDLE;
+            /// @brief Framebuffer of the shadow maps (all the layers)
+            VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
+            /// @brief Layout of the descriptor set of the cascades
+            VkDescriptorSetLayout m_descriptor_set_layout = VK_NULL_HANDLE;
+            /// @brief Descriptor set of the cascades, allocated from the engine descriptor pool
+            VkDescriptorSet m_descriptor_set = VK_NULL_HANDLE;
+            /// @brief Layout of the cascade pipeline
+            VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+            /// @brief Depth-only pipeline, with a slope-scaled depth bias
+            VkPipeline m_pipeline = VK_NULL_HANDLE;
+            /// @brief Comparison sampler of the shadow maps
+            VkSampler m_sampler = VK_NULL_HANDLE;
+            /// @brief Draws the shadow casters
+            CasterRecorder m_caster_recorder = nullptr;
+            /// @brief The direction the light travels to, in world space
+            glm::vec3 m_direction = glm::vec3(0.0f, -1.0f, 0.0f);
+            /// @brief The color of the light
+            glm::vec3 m_color = glm::vec3(1.0f);
+            /// @brief The intensity of the light
+            float m_intensity = 0.0f;
+            /// @brief The distribution of the splits, from uniform (0) to logarithmic (1)
+            float m_split_lambda = 0.75f;
+            /// @brief The distance after which there are no shadows
+            float m_shadow_distance = 50.0f;
+            /// @brief The number of cascades
+            uint32_t m_cascade_count = 0;
+            /// @brief The width and the height of a cascade, in pixels
+            uint32_t m_resolution = 0;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // cascaded_shadows_h
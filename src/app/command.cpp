@@ -5,6 +5,8 @@
 //
 
 #include "command.hpp"
+#include "../project.hpp"
+#include "depth.hpp"
 #include "engine.hpp"
 
 #ifdef IMGUI
@@ -16,6 +18,13 @@ app::graphics::Command::Command(){};
 
 app::graphics::Command::~Command()
 {
+    // Frees the command buffers allocated from them
+    for (auto& frame_pool : m_frame_pools)
+    {
+        if (VK_NULL_HANDLE != frame_pool.m_pool && nullptr != app::Engine::getInstance()->m_graphics_device.getLogicalDevice())
+            vkDestroyCommandPool(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), frame_pool.m_pool, nullptr);
+    }
+    m_frame_pools.clear();
     if (nullptr != m_pool)
     {
         if (nullptr != app::Engine::getInstance()->m_graphics_device.getLogicalDevice())
@@ -38,115 +47,602 @@ utils::VResult app::graphics::Command::createPool(const uint32_t family_index)
         nullptr,
         &m_pool);
     if (VK_SUCCESS == create_result)
+    {
+        m_family_index = family_index;
         return utils::VResult::Ok();
+    }
     return utils::VResult::Error((char*)"> Error creating the command pool in the command buffer object");
 }
 
-utils::VResult app::graphics::Command::createBuffer()
+utils::VResult app::graphics::Command::createFramePools(const uint32_t thread_count)
 {
     if (nullptr == m_pool)
-        return utils::VResult::Error((char*)"> Error creating the buffer: no memory pool");
-    VkCommandBufferAllocateInfo alloc_info{};
-    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    alloc_info.commandPool = (m_pool);
-    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    alloc_info.commandBufferCount = 1;
-
-    const auto create_result = vkAllocateCommandBuffers(
-        app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
-        &alloc_info,
-        &m_buffer);
-    if (create_result == VK_SUCCESS)
-        return utils::VResult::Ok();
-    return utils::VResult::Error((char*)"> Error creating the buffer in the command buffer object");
+        return utils::VResult::Error((char*)"> Error creating the frame pools: no memory pool");
+    // Transient: the command buffers are short-lived, and only reset with their pool
+    VkCommandPoolCreateInfo pool_create_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = m_family_index,
+    };
+    m_frame_pools.resize(Project::FRAMES_IN_FLIGHT * thread_count);
+    for (auto& frame_pool : m_frame_pools)
+    {
+        if (const auto create_result = vkCreateCommandPool(
+                app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+                &pool_create_info,
+                nullptr,
+                &frame_pool.m_pool);
+            create_result != VK_SUCCESS)
+        {
+            LogE("> vkCreateCommandPool: error 0x%08x for a frame pool", create_result);
+            return utils::VResult::Error((char*)"> Error creating the frame pools in the command buffer object");
+        }
+    }
+    m_thread_count = thread_count;
+    m_frame_slot = 0;
+    return utils::VResult::Ok();
+}
+
+utils::VResult app::graphics::Command::beginFrame()
+{
+    if (m_frame_pools.empty())
+        return utils::VResult::Error((char*)"> Error beginning the frame: no frame pools");
+    m_frame_slot = (m_frame_slot + 1) % Project::FRAMES_IN_FLIGHT;
+    for (uint32_t thread_index = 0; thread_index < m_thread_count; ++thread_index)
+    {
+        FramePool& frame_pool = m_frame_pools[m_frame_slot * m_thread_count + thread_index];
+        if (0 == frame_pool.m_used_primary_buffers && 0 == frame_pool.m_used_secondary_buffers)
+            continue;
+        // All the command buffers of the pool go back to the initial state at once
+        if (const auto result = vkResetCommandPool(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), frame_pool.m_pool, 0); result != VK_SUCCESS)
+        {
+            LogE("> vkResetCommandPool: error 0x%08x for the frame pool %d of the thread %d", result, m_frame_slot, thread_index);
+            return utils::VResult::Error((char*)"> Error resetting the frame pools");
+        }
+        frame_pool.m_used_primary_buffers = 0;
+        frame_pool.m_used_secondary_buffers = 0;
+    }
+    return utils::VResult::Ok();
+}
+
+utils::Result<VkCommandBuffer> app::graphics::Command::acquireBuffer(const VkCommandBufferLevel level, const uint32_t thread_index)
+{
+    if (thread_index >= m_thread_count)
+        return utils::Result<VkCommandBuffer>::Error((char*)"> Error acquiring a command buffer: no frame pool for this thread");
+    FramePool& frame_pool = m_frame_pools[m_frame_slot * m_thread_count + thread_index];
+    const bool primary = VK_COMMAND_BUFFER_LEVEL_PRIMARY == level;
+    std::vector<VkCommandBuffer>& buffers = primary ? frame_pool.m_primary_buffers : frame_pool.m_secondary_buffers;
+    size_t& used_buffers = primary ? frame_pool.m_used_primary_buffers : frame_pool.m_used_secondary_buffers;
+    if (used_buffers == buffers.size())
+    {
+        // First use of this many command buffers in the pool: they are recycled afterwards
+        VkCommandBufferAllocateInfo alloc_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = frame_pool.m_pool,
+            .level = level,
+            .commandBufferCount = 1,
+        };
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        if (const auto result = vkAllocateCommandBuffers(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &alloc_info, &command_buffer); result != VK_SUCCESS)
+        {
+            LogE("> vkAllocateCommandBuffers: error 0x%08x for the frame pool %d of the thread %d", result, m_frame_slot, thread_index);
+            return utils::Result<VkCommandBuffer>::Error((char*)"> Error allocating a command buffer in a frame pool");
+        }
+        buffers.push_back(command_buffer);
+    }
+    return utils::Result<VkCommandBuffer>::Ok(buffers[used_buffers++]);
 }
 
 utils::VResult app::graphics::Command::record()
 {
     const auto swapchain_index = app::Engine::getInstance()->m_render->getFrameIndex();
+    const auto gpu_timer = app::Engine::getInstance()->m_render->getGpuTimer();
+    const VkExtent2D swapchain_extent = app::Engine::getInstance()->m_swapchain->getExtent();
+
+    // The fence of the previous frame has been waited: its timings are available,
+    // and drive the resolution of this frame
+    gpu_timer->collect();
+    if (const auto frame_ms = gpu_timer->getTiming("frame"); frame_ms.has_value())
+        app::Engine::getInstance()->m_render->getDynamicResolution()->update(frame_ms.value());
+    const VkExtent2D render_extent = app::Engine::getInstance()->m_render->getRenderExtent();
+
+    // Same for the command buffers of the frame before: their pools can be reset
+    if (const auto result = beginFrame(); result.IsError())
+        return result;
+    const auto buffer_result = acquireBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    if (buffer_result.IsError())
+        return utils::VResult::Error((char*)"< Error acquiring the command buffer of the frame");
+    m_buffer = buffer_result.GetValue();
+
     VkCommandBufferBeginInfo begin_info{
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
     };
 
-    // Reset the command buffer before any operation on the current buffer
-    vkResetCommandBuffer(m_buffer, 0);
-
     if (const auto begin_result_code = vkBeginCommandBuffer(m_buffer, &begin_info); begin_result_code != VK_SUCCESS)
     {
         return utils::VResult::Error((char*)"< Error creating the command buffer");
     }
 
     const std::vector<VkFramebuffer> framebuffers = app::Engine::getInstance()->m_render->getFramebuffers();
-    if (swapchain_index >= framebuffers.size())
+    const std::vector<VkFramebuffer> ui_framebuffers = app::Engine::getInstance()->m_render->getUIFramebuffers();
+    if (swapchain_index >= framebuffers.size() || swapchain_index >= ui_framebuffers.size())
     {
         return utils::VResult::Error((char*)"< The swapchain_index parameter is incorrect: not enough framebuffers");
     }
 
-    VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+    // The sets of the compute passes are bound by their offset in the descriptor buffer
+    app::Engine::getInstance()->m_render->getDescriptorBuffer()->beginFrame(m_buffer);
+    app::Engine::getInstance()->m_render->getPipelineLibrary()->update();
+    gpu_timer->reset(m_buffer);
+    // Same for the occlusion results of the previous frame (if read back)
+    const auto occlusion_queries = app::Engine::getInstance()->m_render->getOcclusionQueries();
+    occlusion_queries->beginFrame(m_buffer);
+    // The sprite textures uploaded since the previous frame
+    const auto sprite_batcher = app::Engine::getInstance()->m_render->getSpriteBatcher();
+    sprite_batcher->prepare(m_buffer);
+    const uint32_t frame_scope = gpu_timer->begin(m_buffer, "frame");
+
+    // Skin the animated instances once: the shadows, the pre-pass and the main subpass
+    // all draw the same skinned vertices
+    const uint32_t skinning_scope = gpu_timer->begin(m_buffer, "skinning");
+    app::Engine::getInstance()->m_render->getSkinning()->record(m_buffer);
+    gpu_timer->end(m_buffer, skinning_scope);
+
+    // Refresh the shadow views picked for this frame, before the lights read them
+    const uint32_t shadows_scope = gpu_timer->begin(m_buffer, "shadows");
+    app::Engine::getInstance()->m_render->getShadowAtlas()->record(
+        m_buffer,
+        app::Engine::getInstance()->m_render->getClusteredLighting()->getLights(),
+        *app::Engine::getInstance()->m_render->getCamera());
+    // All the cascades of the directional light, in a single multiview pass
+    app::Engine::getInstance()->m_render->getCascadedShadows()->record(
+        m_buffer,
+        *app::Engine::getInstance()->m_render->getCamera(),
+        render_extent);
+    gpu_timer->end(m_buffer, shadows_scope);
+
+    // Bin the lights in the clusters of the view, at the resolution of this frame
+    const uint32_t light_binning_scope = gpu_timer->begin(m_buffer, "light binning");
+    app::Engine::getInstance()->m_render->getClusteredLighting()->record(
+        m_buffer,
+        *app::Engine::getInstance()->m_render->getCamera(),
+        render_extent);
+    gpu_timer->end(m_buffer, light_binning_scope);
+
+    // The levels of detail of the instances drawn indirectly, from their screen-space error
+    app::Engine::getInstance()->m_render->getLevelsOfDetail()->record(
+        m_buffer,
+        *app::Engine::getInstance()->m_render->getCamera(),
+        render_extent);
+    // The visible meshlets, as indirect draws (or only their instances, with mesh shaders)
+    const auto meshlet_culling = app::Engine::getInstance()->m_render->getMeshletCulling();
+    meshlet_culling->record(
+        m_buffer,
+        *app::Engine::getInstance()->m_render->getCamera(),
+        render_extent);
+
+    // One clear value per attachment: depth at index 1, the color targets
+    // (and the motion vectors: no motion) are cleared to black
+    std::vector<VkClearValue> clear_values(
+        app::Engine::getInstance()->m_render->getGraphicsPipeline()->getAttachmentCount(),
+        VkClearValue{{{0.0f, 0.0f, 0.0f, 1.0f}}});
+    clear_values[1] = app::graphics::Depth::getClearValue();
+    if (Project::DEFERRED_SHADING)
+    {
+        // No coverage in the G-buffer where nothing is drawn: the lighting leaves those pixels black
+        const uint32_t gbuffer_attachment = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getGBufferAttachment();
+        clear_values[gbuffer_attachment] = VkClearValue{{{0.0f, 0.0f, 0.0f, 0.0f}}};
+        clear_values[gbuffer_attachment + 1] = VkClearValue{{{0.0f, 0.0f, 0.0f, 0.0f}}};
+    }
+
+    // Same constants for the pre-pass and the main subpass (same pipeline layout)
+    const auto temporal_upscaler = app::Engine::getInstance()->m_render->getTemporalUpscaler();
+    const app::shaders::ScenePushConstants scene_push_constants{
+        .m_jitter = nullptr != temporal_upscaler ? temporal_upscaler->updateJitter(render_extent) : glm::vec2(0.0f),
+    };
+    // The draws of the main subpass are replayed from secondary command buffers if the
+    // scene is static: not while the projection is jittered every frame
+    const bool cached_subpass = Project::STATIC_COMMAND_CACHING && glm::vec2(0.0f) == scene_push_constants.m_jitter;
+    const VkSubpassContents main_subpass_contents = cached_subpass ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+
+    // The scene is only rendered in the top-left part of its target, at the dynamic resolution
     VkRenderPassBeginInfo render_pass_begin_info{
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
         .renderPass = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getRenderPass(),
         .framebuffer = framebuffers[swapchain_index],
         .renderArea = {
             .offset = {0, 0},
-            .extent = app::Engine::getInstance()->m_swapchain->getExtent(),
+            .extent = render_extent,
         },
-        .clearValueCount = 1,
-        .pClearValues = &clear_color,
+        .clearValueCount = static_cast<uint32_t>(clear_values.size()),
+        .pClearValues = clear_values.data(),
     };
 
-    vkCmdBeginRenderPass(m_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(m_buffer, &render_pass_begin_info, Project::DEPTH_PRE_PASS ? VK_SUBPASS_CONTENTS_INLINE : main_subpass_contents);
 
-    vkCmdBindPipeline(
+    if (Project::DEPTH_PRE_PASS)
+    {
+        // Depth-only subpass: the indexed and skinned draws of the main subpass, without their colors.
+        // The geometry drawn by its own pipeline (mesh shaders, vertex pulling) is disabled
+        // with the pre-pass, as the main subpass only shades the depth written here
+        recordSceneState(m_buffer, render_extent, scene_push_constants);
+        vkCmdBindPipeline(
+            m_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            app::Engine::getInstance()->m_render->getGraphicsPipeline()->getDepthPrePassPipeline());
+        recordIndexedDraws(m_buffer);
+        app::Engine::getInstance()->m_render->getSkinning()->draw(m_buffer);
+        vkCmdNextSubpass(m_buffer, main_subpass_contents);
+    }
+
+    if (cached_subpass)
+    {
+        if (const auto result = executeCachedSubpass(swapchain_index, framebuffers[swapchain_index], render_extent, scene_push_constants); result.IsError())
+            return result;
+    }
+    else
+    {
+        recordSceneState(m_buffer, render_extent, scene_push_constants);
+        recordStaticDraws(m_buffer, render_extent, scene_push_constants);
+        // The static draws may leave their own pipeline and sets bound
+        recordSceneState(m_buffer, render_extent, scene_push_constants);
+        recordDynamicDraws(m_buffer, render_extent, scene_push_constants);
+    }
+
+    if (Project::DEFERRED_SHADING)
+    {
+        // Shade each pixel once from its G-buffer, still in tile memory: the lights (set 0)
+        // stay bound, the viewport and the scissor are kept (set again after secondary
+        // command buffers, which do not leave their state to the primary one)
+        vkCmdNextSubpass(m_buffer, VK_SUBPASS_CONTENTS_INLINE);
+        if (cached_subpass)
+            recordSceneState(m_buffer, render_extent, scene_push_constants);
+        vkCmdBindPipeline(
+            m_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            app::Engine::getInstance()->m_render->getGraphicsPipeline()->getLightingPipeline());
+        const VkDescriptorSet gbuffer_set = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getGBufferDescriptorSet(swapchain_index);
+        vkCmdBindDescriptorSets(
+            m_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            app::Engine::getInstance()->m_render->getGraphicsPipeline()->getLightingLayout(),
+            1,
+            1,
+            &gbuffer_set,
+            0,
+            nullptr);
+        vkCmdDraw(m_buffer, 3, 1, 0, 0);
+
+        // The debug geometry of all the threads, over the shaded scene (debug builds only)
+        if (const auto debug_draw = app::Engine::getInstance()->m_render->getDebugDraw(); nullptr != debug_draw)
+        {
+            debug_draw->record(
+                m_buffer,
+                *app::Engine::getInstance()->m_render->getCamera(),
+                render_extent,
+                scene_push_constants.m_jitter);
+        }
+    }
+
+    vkCmdEndRenderPass(m_buffer);
+
+    // The draws of the next frame read the occlusion results of this one
+    occlusion_queries->resolve(m_buffer);
+
+    // Reconstruct the scene at the swapchain resolution, if enabled: the
+    // copy to the swapchain image is then 1:1
+    uint32_t post_processing_input = swapchain_index;
+    VkExtent2D upscale_source_extent = render_extent;
+    if (nullptr != temporal_upscaler)
+    {
+        temporal_upscaler->record(m_buffer, swapchain_index, render_extent);
+        post_processing_input = temporal_upscaler->getOutputIndex();
+        upscale_source_extent = swapchain_extent;
+    }
+
+    // Expose the HDR scene from its luminance histogram, map it to the display range,
+    // and post-process it (each stage has its own GPU timer scope)
+    const auto post_processing = app::Engine::getInstance()->m_render->getPostProcessing();
+    post_processing->record(m_buffer, post_processing_input, upscale_source_extent);
+    const VkImage upscale_source = post_processing->getOutput()->getImage();
+
+    // Upscale the scene to the swapchain image (and encode it in sRGB).
+    // The swapchain image is transitioned once the acquire semaphore has been
+    // signaled (waited at the color attachment output stage)
+    const VkImage swapchain_image = app::Engine::getInstance()->m_swapchain->getImages()[swapchain_index];
+    VkImageMemoryBarrier to_transfer_dst{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = swapchain_image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    vkCmdPipelineBarrier(
+        m_buffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &to_transfer_dst);
+
+    VkImageBlit upscale{
+        .srcSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .srcOffsets = {
+            {0, 0, 0},
+            {static_cast<int32_t>(upscale_source_extent.width), static_cast<int32_t>(upscale_source_extent.height), 1},
+        },
+        .dstSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .dstOffsets = {
+            {0, 0, 0},
+            {static_cast<int32_t>(swapchain_extent.width), static_cast<int32_t>(swapchain_extent.height), 1},
+        },
+    };
+    vkCmdBlitImage(
         m_buffer,
+        upscale_source,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        swapchain_image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &upscale,
+        VK_FILTER_LINEAR);
+
+    // The UI is drawn on top of the upscaled scene, at the native resolution
+    VkRenderPassBeginInfo ui_render_pass_begin_info{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getUIRenderPass(),
+        .framebuffer = ui_framebuffers[swapchain_index],
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = swapchain_extent,
+        },
+    };
+
+    vkCmdBeginRenderPass(m_buffer, &ui_render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+    // The sprites of the frame, in a single draw, below ImGui
+    sprite_batcher->record(m_buffer, swapchain_extent);
+
+#ifdef IMGUI
+    ImGui::Render();
+    ImDrawData* draw_data = ImGui::GetDrawData();
+    ImGui_ImplVulkan_RenderDrawData(draw_data, m_buffer);
+#endif
+
+    vkCmdEndRenderPass(m_buffer);
+
+    gpu_timer->end(m_buffer, frame_scope);
+
+    if (const auto end_command_buffer_result_code = vkEndCommandBuffer(m_buffer); end_command_buffer_result_code != VK_SUCCESS)
+    {
+        return utils::VResult::Error((char*)"< Error recording the command buffer");
+    }
+
+    return utils::VResult::Ok();
+}
+
+void app::graphics::Command::invalidateStatic() noexcept
+{
+    ++m_static_revision;
+}
+
+void app::graphics::Command::recordSceneState(VkCommandBuffer command_buffer, const VkExtent2D& render_extent, const app::shaders::ScenePushConstants& push_constants)
+{
+    vkCmdPushConstants(
+        command_buffer,
+        app::Engine::getInstance()->m_render->getGraphicsPipeline()->getLayout(),
+        VK_SHADER_STAGE_VERTEX_BIT,
+        0,
+        sizeof(push_constants),
+        &push_constants);
+    const VkDescriptorSet lighting_set = app::Engine::getInstance()->m_render->getClusteredLighting()->getDescriptorSet();
+    vkCmdBindDescriptorSets(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        app::Engine::getInstance()->m_render->getGraphicsPipeline()->getLayout(),
+        0,
+        1,
+        &lighting_set,
+        0,
+        nullptr);
+
+    // The current variant of the scene pipeline, linked from its parts
+    vkCmdBindPipeline(
+        command_buffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
-        app::Engine::getInstance()->m_render->getGraphicsPipeline()->getPipeline());
+        app::Engine::getInstance()->m_render->getScenePipeline());
 
     // Setup the viewport and scissor as dynamic
     // TODO: fix this in the fixed function
     VkViewport viewport{
         .x = 0.0f,
         .y = 0.0f,
-        .width = static_cast<float>(app::Engine::getInstance()->m_swapchain->getExtent().width),
-        .height = static_cast<float>(app::Engine::getInstance()->m_swapchain->getExtent().height),
+        .width = static_cast<float>(render_extent.width),
+        .height = static_cast<float>(render_extent.height),
         .minDepth = 0.0f,
         .maxDepth = 1.0f,
     };
-    vkCmdSetViewport(m_buffer, 0, 1, &viewport);
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
 
     VkRect2D scissor{
         .offset = {0, 0},
-        .extent = app::Engine::getInstance()->m_swapchain->getExtent(),
+        .extent = render_extent,
     };
-    vkCmdSetScissor(m_buffer, 0, 1, &scissor);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+}
 
-    // Bind the vertex buffer
-    // std::vector<VkBuffer> vertex_buffers = {app::Engine::getInstance()->m_render->getGraphicsPipeline()->getVertexBuffer()};
-    // // // TODO: check to include this information getting the vertex buffer
-    // std::vector<VkDeviceSize> memory_offsets(vertex_buffers.size());
-    // const VkBuffer& index_buffer = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getIndexBuffer();
-    // for (size_t i = 0; i < vertex_buffers.size(); ++i)
-    //     memory_offsets[i] = i;
-    // vkCmdBindVertexBuffers(m_buffer, 0, (uint32_t)vertex_buffers.size(), vertex_buffers.data(), memory_offsets.data());
-    // vkCmdBindIndexBuffer(m_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT32);
+void app::graphics::Command::recordStaticDraws(VkCommandBuffer command_buffer, const VkExtent2D& render_extent, const app::shaders::ScenePushConstants& push_constants)
+{
+    // The meshlets of the mesh instances culled by the compute pass, with the scene pipeline
+    recordIndexedDraws(command_buffer);
 
-    // TODO: fix
-    // uint32_t indices_size = 0;
+    // Or the task and mesh shaders (bind their own pipeline and sets)
+    app::Engine::getInstance()->m_render->getMeshletCulling()->drawMeshTasks(
+        command_buffer,
+        *app::Engine::getInstance()->m_render->getCamera(),
+        render_extent,
+        push_constants.m_jitter);
 
-    // vkCmdDrawIndexed(m_buffer, indices_size, 1, 0, 0, 0);
+    // The meshes of every vertex layout, merged in a single indirect draw (binds its own
+    // pipeline and the lights)
+    app::Engine::getInstance()->m_render->getVertexPulling()->drawAll(command_buffer, push_constants.m_jitter);
+}
 
-#ifdef IMGUI
-    ImGui::Render();
-    ImDrawData* draw_data = ImGui::GetDrawData();
-    ImGui_ImplVulkan_RenderDrawData(draw_data, m_buffer);
-#endif
+void app::graphics::Command::recordIndexedDraws(VkCommandBuffer command_buffer)
+{
+    const VkBuffer vertex_buffer = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getVertexBuffer();
+    const VkBuffer index_buffer = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getIndexBuffer();
+    if (VK_NULL_HANDLE == vertex_buffer || VK_NULL_HANDLE == index_buffer)
+        return;
+    const VkDeviceSize memory_offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, &memory_offset);
+    vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT32);
 
-    vkCmdEndRenderPass(m_buffer);
-    if (const auto end_command_buffer_result_code = vkEndCommandBuffer(m_buffer); end_command_buffer_result_code != VK_SUCCESS)
+    // The visible meshlets (nothing with mesh shaders), and the selected levels of detail of
+    // the instances: the first instance of a draw is the index of its instance
+    app::Engine::getInstance()->m_render->getMeshletCulling()->draw(command_buffer);
+    app::Engine::getInstance()->m_render->getLevelsOfDetail()->draw(command_buffer);
+}
+
+void app::graphics::Command::recordDynamicDraws(VkCommandBuffer command_buffer, const VkExtent2D& render_extent, const app::shaders::ScenePushConstants& push_constants)
+{
+    // The skinned instances, with the scene pipeline: their vertices are rewritten every frame
+    app::Engine::getInstance()->m_render->getSkinning()->draw(command_buffer);
+
+    // The expensive objects are drawn between occlusion_queries->beginDraw and endDraw,
+    // gated by their results of the previous frame. Their proxies are then tested against
+    // the depth of the occluders (the scene pipeline has to be bound again for more draws)
+    app::Engine::getInstance()->m_render->getOcclusionQueries()->record(
+        command_buffer,
+        *app::Engine::getInstance()->m_render->getCamera(),
+        render_extent,
+        push_constants.m_jitter);
+
+    // The debug geometry of all the threads, over the scene (debug builds only), drawn
+    // after the lighting subpass with the deferred shading
+    if (Project::DEFERRED_SHADING)
+        return;
+    if (const auto debug_draw = app::Engine::getInstance()->m_render->getDebugDraw(); nullptr != debug_draw)
     {
-        return utils::VResult::Error((char*)"< Error recording the command buffer");
+        debug_draw->record(
+            command_buffer,
+            *app::Engine::getInstance()->m_render->getCamera(),
+            render_extent,
+            push_constants.m_jitter);
     }
+}
+
+utils::VResult app::graphics::Command::executeCachedSubpass(
+    const uint32_t swapchain_index,
+    const VkFramebuffer framebuffer,
+    const VkExtent2D& render_extent,
+    const app::shaders::ScenePushConstants& push_constants)
+{
+    if (m_cached_subpasses.size() <= swapchain_index)
+        m_cached_subpasses.resize(swapchain_index + 1);
+    CachedSubpass& cached = m_cached_subpasses[swapchain_index];
+    if (VK_NULL_HANDLE == cached.m_static_buffer)
+    {
+        // Kept across frames: allocated from the command pool, not from a frame pool
+        VkCommandBufferAllocateInfo alloc_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = m_pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+            .commandBufferCount = 1,
+        };
+        if (const auto result = vkAllocateCommandBuffers(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &alloc_info, &cached.m_static_buffer); result != VK_SUCCESS)
+        {
+            LogE("> vkAllocateCommandBuffers: error 0x%08x for the cached subpass %d", result, swapchain_index);
+            return utils::VResult::Error((char*)"< Error allocating the secondary command buffer of the main subpass");
+        }
+    }
+
+    const auto camera = app::Engine::getInstance()->m_render->getCamera();
+    const float aspect = static_cast<float>(render_extent.width) / static_cast<float>(render_extent.height);
+    const glm::mat4 view_projection = camera->getProjection(aspect) * camera->getView();
+    const bool outdated = !cached.m_recorded ||
+                          cached.m_revision != m_static_revision ||
+                          cached.m_framebuffer != framebuffer ||
+                          cached.m_extent.width != render_extent.width ||
+                          cached.m_extent.height != render_extent.height ||
+                          cached.m_view_projection != view_projection;
+    if (outdated)
+    {
+        // The frames that executed it have completed: the primary command buffer that
+        // referenced it has just been reset
+        if (const auto result = beginSecondary(cached.m_static_buffer, framebuffer, VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT); result.IsError())
+            return result;
+        recordSceneState(cached.m_static_buffer, render_extent, push_constants);
+        recordStaticDraws(cached.m_static_buffer, render_extent, push_constants);
+        if (const auto end_result_code = vkEndCommandBuffer(cached.m_static_buffer); end_result_code != VK_SUCCESS)
+        {
+            cached.m_recorded = false;
+            return utils::VResult::Error((char*)"< Error recording the static draws of the main subpass");
+        }
+        cached.m_framebuffer = framebuffer;
+        cached.m_extent = render_extent;
+        cached.m_view_projection = view_projection;
+        cached.m_revision = m_static_revision;
+        cached.m_recorded = true;
+    }
+
+    // The draws that change every frame (skinned instances, occlusion proxies, debug geometry), in a
+    // command buffer of the frame
+    const auto dynamic_result = acquireBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    if (dynamic_result.IsError())
+        return utils::VResult::Error((char*)"< Error acquiring the secondary command buffer of the dynamic draws");
+    const VkCommandBuffer dynamic_buffer = dynamic_result.GetValue();
+    if (const auto result = beginSecondary(dynamic_buffer, framebuffer, VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT); result.IsError())
+        return result;
+    recordSceneState(dynamic_buffer, render_extent, push_constants);
+    recordDynamicDraws(dynamic_buffer, render_extent, push_constants);
+    if (const auto end_result_code = vkEndCommandBuffer(dynamic_buffer); end_result_code != VK_SUCCESS)
+        return utils::VResult::Error((char*)"< Error recording the dynamic draws of the main subpass");
 
+    const VkCommandBuffer secondary_buffers[2] = {cached.m_static_buffer, dynamic_buffer};
+    vkCmdExecuteCommands(m_buffer, 2, secondary_buffers);
+    return utils::VResult::Ok();
+}
+
+utils::VResult app::graphics::Command::beginSecondary(VkCommandBuffer command_buffer, const VkFramebuffer framebuffer, const VkCommandBufferUsageFlags flags)
+{
+    const VkCommandBufferInheritanceInfo inheritance_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .renderPass = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getRenderPass(),
+        .subpass = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getMainSubpass(),
+        .framebuffer = framebuffer,
+    };
+    const VkCommandBufferBeginInfo begin_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = flags,
+        .pInheritanceInfo = &inheritance_info,
+    };
+    // Implicitly resets a static command buffer (its pool allows it), the ones of the
+    // frame pools are in the initial state
+    if (const auto begin_result_code = vkBeginCommandBuffer(command_buffer, &begin_info); begin_result_code != VK_SUCCESS)
+        return utils::VResult::Error((char*)"< Error beginning a secondary command buffer of the main subpass");
     return utils::VResult::Ok();
 }
 
@@ -8,7 +8,11 @@
 #ifndef command_h
 #define command_h
 
+#include "../project.hpp"
 #include "../utils/result.h"
+#include "shaders.h"
+#include <glm/glm.hpp>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace app
@@ -16,6 +20,11 @@ namespace app
     namespace graphics
     {
         /// @brief Command
+        ///
+        /// The command buffers of a frame are allocated from transient pools, one per frame
+        /// in flight and per recording thread, and recycled: the pools of a frame are reset
+        /// as a whole (one vkResetCommandPool each) when the frame comes back, so that the
+        /// command buffers are never reset or freed one by one.
         class Command
         {
         public:
@@ -26,28 +35,116 @@ namespace app
             /// @brief Returns the VkCommandPool object
             /// @return the VkCommandPool object
             VkCommandPool* getPool();
-            /// @brief Returns the VkCommandBuffer object
+            /// @brief Returns the primary command buffer of the current frame
             /// @return the VkCommandBuffer object
             VkCommandBuffer* getBuffer();
-            /// @brief Creates the command pool
+            /// @brief Creates the command pool of the command buffers kept across frames
             /// @param family_index The queue family index to bind
             /// @return A VResult type
             utils::VResult createPool(const uint32_t family_index);
-            /// @brief Creates the command buffer
+            /// @brief Creates the transient pools of the frames, for the queue family of the
+            /// command pool
+            /// @param thread_count The number of threads recording command buffers
             /// @return A VResult type
-            utils::VResult createBuffer();
+            utils::VResult createFramePools(const uint32_t thread_count = 1);
+            /// @brief Moves to the pools of the next frame, and resets them: the command
+            /// buffers acquired FRAMES_IN_FLIGHT frames ago must have completed.
+            /// Should be called on the render thread, while no other thread records.
+            /// @return A VResult type
+            utils::VResult beginFrame();
+            /// @brief Returns a command buffer of the current frame, in the initial state
+            /// (recycled if possible), valid until the pools of the frame are reset
+            /// @param level Primary or secondary command buffer
+            /// @param thread_index The recording thread, lower than the thread count
+            /// @return The command buffer, or an error
+            utils::Result<VkCommandBuffer> acquireBuffer(const VkCommandBufferLevel level, const uint32_t thread_index = 0);
             /// @brief Writes the commands we want to execute into a command buffer
             utils::VResult record();
+            /// @brief Marks the cached draws of the main subpass as outdated, e.g. when
+            /// meshes or instances have been added, removed or moved, or when a pipeline
+            /// they bind has been recreated (see Project::STATIC_COMMAND_CACHING).
+            /// The camera, the render extent and the framebuffers are checked each frame.
+            void invalidateStatic() noexcept;
 
         private:
+            /// @brief The draws of the main subpass of the scene for a swapchain image, in
+            /// secondary command buffers
+            struct CachedSubpass
+            {
+                /// @brief The static draws (meshlets, vertex pulling), re-recorded only when
+                /// outdated (from the command pool, kept across frames)
+                VkCommandBuffer m_static_buffer = VK_NULL_HANDLE;
+                /// @brief The framebuffer the static draws were recorded for
+                VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
+                /// @brief The render extent the static draws were recorded at
+                VkExtent2D m_extent = {0, 0};
+                /// @brief The view projection the static draws were recorded with
+                glm::mat4 m_view_projection = glm::mat4(0.0f);
+                /// @brief The revision of the scene the static draws were recorded at
+                uint64_t m_revision = 0;
+                /// @brief If the static draws have been recorded
+                bool m_recorded = false;
+            };
+            /// @brief A transient pool of a frame and of a recording thread, and the command
+            /// buffers allocated from it
+            struct FramePool
+            {
+                /// @brief The transient command pool
+                VkCommandPool m_pool = VK_NULL_HANDLE;
+                /// @brief The primary command buffers allocated from the pool
+                std::vector<VkCommandBuffer> m_primary_buffers;
+                /// @brief The secondary command buffers allocated from the pool
+                std::vector<VkCommandBuffer> m_secondary_buffers;
+                /// @brief The number of primary command buffers acquired since the reset
+                size_t m_used_primary_buffers = 0;
+                /// @brief The number of secondary command buffers acquired since the reset
+                size_t m_used_secondary_buffers = 0;
+            };
             /// @brief Command should not be cloneable
             Command(Command& other) = delete;
             /// @brief Command should not be assignable
             void operator=(const Command& other) = delete;
-            /// @brief The command pool
-            VkCommandPool m_pool;
-            /// @brief The command buffer
-            VkCommandBuffer m_buffer;
+            /// @brief Records the state of the main subpass: push constants, lights, scene
+            /// pipeline, viewport and scissor
+            void recordSceneState(VkCommandBuffer command_buffer, const VkExtent2D& render_extent, const app::shaders::ScenePushConstants& push_constants);
+            /// @brief Records the draws of the main subpass that only change with the scene
+            /// and the camera
+            void recordStaticDraws(VkCommandBuffer command_buffer, const VkExtent2D& render_extent, const app::shaders::ScenePushConstants& push_constants);
+            /// @brief Records the indexed indirect draws of the meshes of the scene buffers,
+            /// with the bound pipeline: binds the vertex and the index buffers of the scene
+            void recordIndexedDraws(VkCommandBuffer command_buffer);
+            /// @brief Records the draws of the main subpass that change every frame
+            void recordDynamicDraws(VkCommandBuffer command_buffer, const VkExtent2D& render_extent, const app::shaders::ScenePushConstants& push_constants);
+            /// @brief Records the main subpass in the secondary command buffers of a
+            /// swapchain image, the static draws only if outdated, and executes them
+            /// @param swapchain_index The swapchain image of the frame
+            /// @param framebuffer The framebuffer of the scene render pass for this image
+            /// @param render_extent The extent of the scene for this frame
+            /// @param push_constants The push constants of the scene pipeline
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult executeCachedSubpass(
+                const uint32_t swapchain_index,
+                const VkFramebuffer framebuffer,
+                const VkExtent2D& render_extent,
+                const app::shaders::ScenePushConstants& push_constants);
+            /// @brief Begins a secondary command buffer of the main subpass
+            utils::VResult beginSecondary(VkCommandBuffer command_buffer, const VkFramebuffer framebuffer, const VkCommandBufferUsageFlags flags);
+            /// @brief The command pool of the command buffers kept across frames
+            VkCommandPool m_pool = VK_NULL_HANDLE;
+            /// @brief The queue family of the command pools
+            uint32_t m_family_index = 0;
+            /// @brief The primary command buffer of the current frame
+            VkCommandBuffer m_buffer = VK_NULL_HANDLE;
+            /// @brief The transient pools, FRAMES_IN_FLIGHT sets of one per recording thread
+            std::vector<FramePool> m_frame_pools;
+            /// @brief The number of threads recording command buffers
+            uint32_t m_thread_count = 0;
+            /// @brief The set of transient pools of the current frame
+            uint32_t m_frame_slot = 0;
+            /// @brief The cached draws of the main subpass, per swapchain image
+            std::vector<CachedSubpass> m_cached_subpasses;
+            /// @brief The revision of the scene, bumped by `invalidateStatic`
+            uint64_t m_static_revision = 1;
         };
     } // namespace graphics
 } // namespace app
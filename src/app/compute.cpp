@@ -0,0 +1,303 @@
+//
+//  compute.cpp
+//
+
+#include "compute.hpp"
+#include "../utils/debug_tools.h"
+#include "descriptor_buffer.hpp"
+#include "engine.hpp"
+#include "pipeline.hpp"
+
+app::graphics::ComputePass::ComputePass(){};
+
+app::graphics::ComputePass::~ComputePass()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    if (!m_descriptor_sets.empty())
+    {
+        vkFreeDescriptorSets(
+            graphics_device,
+            app::Engine::getInstance()->getDescriptorPool(),
+            static_cast<uint32_t>(m_descriptor_sets.size()),
+            m_descriptor_sets.data());
+        m_descriptor_sets.clear();
+    }
+    // The sets of the descriptor buffer are released with it
+    m_descriptor_offsets.clear();
+    if (VK_NULL_HANDLE != m_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_layout, nullptr);
+        m_layout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_descriptor_set_layout)
+    {
+        vkDestroyDescriptorSetLayout(graphics_device, m_descriptor_set_layout, nullptr);
+        m_descriptor_set_layout = VK_NULL_HANDLE;
+    }
+};
+
+utils::VResult app::graphics::ComputePass::create(
+    const char* shader_filepath,
+    const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+    const uint32_t push_constants_size,
+    const uint32_t nb_descriptor_sets,
+    const bool shared_descriptor_sets,
+    const bool frame_descriptor_set)
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    const auto descriptor_buffer = app::Engine::getInstance()->m_render->getDescriptorBuffer();
+    // The pipelines the sets are shared with bind them as sets of the pool
+    const bool use_descriptor_buffer = !shared_descriptor_sets && descriptor_buffer->isEnabled();
+
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+#ifdef VK_EXT_descriptor_buffer
+        .flags = use_descriptor_buffer ? static_cast<VkDescriptorSetLayoutCreateFlags>(VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT) : 0u,
+#endif
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data(),
+    };
+    if (const auto result = vkCreateDescriptorSetLayout(graphics_device, &descriptor_set_layout_create_info, nullptr, &m_descriptor_set_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateDescriptorSetLayout: error 0x%08x for '%s'", result, shader_filepath);
+        return utils::VResult::Error((char*)"Cannot create the descriptor set layout of the compute pass");
+    }
+
+    m_push_constants_size = push_constants_size;
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = m_push_constants_size,
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_descriptor_set_layout,
+        .pushConstantRangeCount = m_push_constants_size > 0 ? 1u : 0u,
+        .pPushConstantRanges = m_push_constants_size > 0 ? &push_constant_range : nullptr,
+    };
+    if (const auto result = vkCreatePipelineLayout(graphics_device, &pipeline_layout_create_info, nullptr, &m_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for '%s'", result, shader_filepath);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the compute pass");
+    }
+
+    // Read the SPIR-V code, and create the pipeline
+    const auto shader_module_result = app::graphics::Pipeline::loadShaderModule(shader_filepath);
+    if (shader_module_result.IsError())
+        return utils::VResult::Error((char*)"Cannot create the shader module of the compute pass");
+    const VkShaderModule shader_module = shader_module_result.GetValue();
+
+    VkComputePipelineCreateInfo pipeline_create_info{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+#ifdef VK_EXT_descriptor_buffer
+        .flags = use_descriptor_buffer ? static_cast<VkPipelineCreateFlags>(VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT) : 0u,
+#endif
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shader_module,
+            .pName = "main",
+        },
+        .layout = m_layout,
+    };
+    const auto pipeline_result = vkCreateComputePipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &m_pipeline);
+    // The module is not needed anymore once the pipeline is created
+    vkDestroyShaderModule(graphics_device, shader_module, nullptr);
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateComputePipelines: error 0x%08x for '%s'", pipeline_result, shader_filepath);
+        return utils::VResult::Error((char*)"Cannot create the compute pipeline");
+    }
+
+    m_frame_set_index = nb_descriptor_sets;
+    m_frame_descriptor_set = frame_descriptor_set;
+    if (use_descriptor_buffer)
+    {
+        m_descriptor_offsets.reserve(nb_descriptor_sets + 1);
+        for (uint32_t set_index = 0; set_index < nb_descriptor_sets; ++set_index)
+        {
+            const auto offset = descriptor_buffer->allocate(m_descriptor_set_layout);
+            if (offset.IsError())
+            {
+                LogE("> Cannot allocate the descriptor set %d of '%s' in the descriptor buffer", set_index, shader_filepath);
+                return utils::VResult::Error((char*)"Cannot allocate the descriptor sets of the compute pass");
+            }
+            m_descriptor_offsets.push_back(offset.GetValue());
+        }
+        // The offset of the set of the frame, replaced by each `allocateFrameSet`
+        if (m_frame_descriptor_set)
+            m_descriptor_offsets.push_back(0);
+        return utils::VResult::Ok();
+    }
+    // The sets of the frames in flight follow the persistent ones
+    const uint32_t nb_pool_sets = nb_descriptor_sets + (m_frame_descriptor_set ? Project::FRAMES_IN_FLIGHT : 0);
+    if (nb_pool_sets == 0)
+        return utils::VResult::Ok();
+    std::vector<VkDescriptorSetLayout> set_layouts(nb_pool_sets, m_descriptor_set_layout);
+    VkDescriptorSetAllocateInfo allocate_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = app::Engine::getInstance()->getDescriptorPool(),
+        .descriptorSetCount = nb_pool_sets,
+        .pSetLayouts = set_layouts.data(),
+    };
+    m_descriptor_sets.resize(nb_pool_sets);
+    if (const auto result = vkAllocateDescriptorSets(graphics_device, &allocate_info, m_descriptor_sets.data()); result != VK_SUCCESS)
+    {
+        m_descriptor_sets.clear();
+        LogE("> vkAllocateDescriptorSets: error 0x%08x for '%s'", result, shader_filepath);
+        return utils::VResult::Error((char*)"Cannot allocate the descriptor sets of the compute pass");
+    }
+    return utils::VResult::Ok();
+}
+
+utils::Result<uint32_t> app::graphics::ComputePass::allocateFrameSet()
+{
+    assert(m_frame_descriptor_set);
+    if (!m_descriptor_offsets.empty())
+    {
+        // Appended to the region of the frame, rewound FRAMES_IN_FLIGHT frames later
+        const auto offset = app::Engine::getInstance()->m_render->getDescriptorBuffer()->allocateFrame(m_descriptor_set_layout);
+        if (offset.IsError())
+            return utils::Result<uint32_t>::Error((char*)"Cannot allocate the descriptor set of the frame");
+        m_descriptor_offsets[m_frame_set_index] = offset.GetValue();
+        return utils::Result<uint32_t>::Ok(m_frame_set_index);
+    }
+    // The set of the frame before the previous one is not read anymore
+    m_frame_slot = (m_frame_slot + 1) % Project::FRAMES_IN_FLIGHT;
+    return utils::Result<uint32_t>::Ok(m_frame_set_index + m_frame_slot);
+}
+
+void app::graphics::ComputePass::writeImage(
+    const uint32_t set_index,
+    const uint32_t binding,
+    const VkDescriptorType type,
+    const VkImageView image_view,
+    const VkImageLayout layout,
+    const VkSampler sampler)
+{
+    if (!m_descriptor_offsets.empty())
+    {
+        assert(set_index < m_descriptor_offsets.size());
+        app::Engine::getInstance()->m_render->getDescriptorBuffer()->writeImage(
+            m_descriptor_offsets[set_index], m_descriptor_set_layout, binding, type, image_view, layout, sampler);
+        return;
+    }
+    assert(set_index < m_descriptor_sets.size());
+    VkDescriptorImageInfo image_info{
+        .sampler = sampler,
+        .imageView = image_view,
+        .imageLayout = layout,
+    };
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptor_sets[set_index],
+        .dstBinding = binding,
+        .descriptorCount = 1,
+        .descriptorType = type,
+        .pImageInfo = &image_info,
+    };
+    vkUpdateDescriptorSets(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), 1, &write, 0, nullptr);
+}
+
+void app::graphics::ComputePass::writeBuffer(
+    const uint32_t set_index,
+    const uint32_t binding,
+    const VkDescriptorType type,
+    const VkBuffer buffer,
+    const VkDeviceSize offset,
+    const VkDeviceSize range)
+{
+    if (!m_descriptor_offsets.empty())
+    {
+        assert(set_index < m_descriptor_offsets.size());
+        assert(VK_WHOLE_SIZE != range);
+        const VkBufferDeviceAddressInfo address_info{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+            .buffer = buffer,
+        };
+        const VkDeviceAddress address = vkGetBufferDeviceAddress(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &address_info);
+        app::Engine::getInstance()->m_render->getDescriptorBuffer()->writeBuffer(
+            m_descriptor_offsets[set_index], m_descriptor_set_layout, binding, type, address + offset, range);
+        return;
+    }
+    assert(set_index < m_descriptor_sets.size());
+    VkDescriptorBufferInfo buffer_info{
+        .buffer = buffer,
+        .offset = offset,
+        .range = range,
+    };
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptor_sets[set_index],
+        .dstBinding = binding,
+        .descriptorCount = 1,
+        .descriptorType = type,
+        .pBufferInfo = &buffer_info,
+    };
+    vkUpdateDescriptorSets(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), 1, &write, 0, nullptr);
+}
+
+void app::graphics::ComputePass::writeBuffer(
+    const uint32_t set_index,
+    const uint32_t binding,
+    const VkDescriptorType type,
+    const std::shared_ptr<app::graphics::Buffer>& buffer,
+    const VkDeviceSize offset,
+    const VkDeviceSize range)
+{
+    if (m_descriptor_offsets.empty())
+    {
+        writeBuffer(set_index, binding, type, buffer->getBuffer(), offset, range);
+        return;
+    }
+    // The descriptor buffer needs the actual size of the range
+    const VkDeviceSize bound_range = VK_WHOLE_SIZE == range ? buffer->getSize() - offset : range;
+    assert(set_index < m_descriptor_offsets.size());
+    app::Engine::getInstance()->m_render->getDescriptorBuffer()->writeBuffer(
+        m_descriptor_offsets[set_index], m_descriptor_set_layout, binding, type, buffer->getDeviceAddress() + offset, bound_range);
+}
+
+void app::graphics::ComputePass::dispatch(
+    VkCommandBuffer command_buffer,
+    const uint32_t set_index,
+    const void* push_constants,
+    const uint32_t group_count_x,
+    const uint32_t group_count_y,
+    const uint32_t group_count_z)
+{
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    if (set_index < m_descriptor_offsets.size())
+        app::Engine::getInstance()->m_render->getDescriptorBuffer()->bind(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, m_descriptor_offsets[set_index]);
+    else if (set_index < m_descriptor_sets.size())
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, 1, &m_descriptor_sets[set_index], 0, nullptr);
+    if (nullptr != push_constants && m_push_constants_size > 0)
+        vkCmdPushConstants(command_buffer, m_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, m_push_constants_size, push_constants);
+    vkCmdDispatch(command_buffer, group_count_x, group_count_y, group_count_z);
+}
+
+uint32_t app::graphics::ComputePass::getGroupCount(const uint32_t size, const uint32_t group_size) noexcept
+{
+    return (size + group_size - 1) / group_size;
+}
+
+VkPipelineLayout app::graphics::ComputePass::getLayout() const noexcept
+{
+    return m_layout;
+}
+
+VkDescriptorSetLayout app::graphics::ComputePass::getDescriptorSetLayout() const noexcept
+{
+    return m_descriptor_set_layout;
+}
+
+VkDescriptorSet app::graphics::ComputePass::getDescriptorSet(const uint32_t set_index) const
+{
+    return set_index < m_descriptor_sets.size() ? m_descriptor_sets[set_index] : VK_NULL_HANDLE;
+}
@@ -0,0 +1,159 @@
+//
+//  compute.hpp
+//
+
+#pragma once
+#ifndef compute_h
+#define compute_h
+
+#include "../project.hpp"
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief A compute shader, with its pipeline, a single descriptor set layout
+        /// and a pool of descriptor sets using this layout.
+        /// The push constants, if any, are visible from the compute stage only.
+        /// If the descriptor buffer is enabled, the sets are stored in it (see
+        /// DescriptorBuffer), unless they are shared with other pipelines.
+        /// The sets bound to resources that change every frame are allocated per frame
+        /// (`allocateFrameSet`), instead of one persistent set per combination.
+        class ComputePass
+        {
+        public:
+            /// @brief Public constructor
+            ComputePass();
+            /// @brief Public destructor
+            ~ComputePass();
+            /// @brief Creates the compute pipeline and allocates its descriptor sets
+            /// @param shader_filepath The SPIR-V compute shader to load
+            /// @param bindings The bindings of the descriptor set layout
+            /// @param push_constants_size The size of the push constants, in bytes (0 if none)
+            /// @param nb_descriptor_sets The number of descriptor sets to allocate (e.g. one per frame)
+            /// @param shared_descriptor_sets If the sets are bound to other pipelines with
+            /// vkCmdBindDescriptorSets (see `getDescriptorSet`): they are then always
+            /// allocated from the engine descriptor pool
+            /// @param frame_descriptor_set If a set is allocated each frame by `allocateFrameSet`,
+            /// after the persistent ones
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(
+                const char* shader_filepath,
+                const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                const uint32_t push_constants_size,
+                const uint32_t nb_descriptor_sets,
+                const bool shared_descriptor_sets = false,
+                const bool frame_descriptor_set = false);
+            /// @brief Allocates the descriptor set of the current frame, valid until the frame
+            /// has completed: in the frame region of the descriptor buffer, or else the next of
+            /// the FRAMES_IN_FLIGHT sets reserved in the descriptor pool.
+            /// Should be called once per frame (after DescriptorBuffer::beginFrame), then the
+            /// set written and dispatched like the persistent ones.
+            /// @return The index of the set of the frame, or an error if the region is full
+            utils::Result<uint32_t> allocateFrameSet();
+            /// @brief Writes an image in a descriptor set
+            /// @param set_index The index of the descriptor set
+            /// @param binding The binding to write
+            /// @param type The type of descriptor (sampled image, storage image, ...)
+            /// @param image_view The image view to bind
+            /// @param layout The layout of the image while the shader accesses it
+            /// @param sampler The sampler, for combined image samplers
+            void writeImage(
+                const uint32_t set_index,
+                const uint32_t binding,
+                const VkDescriptorType type,
+                const VkImageView image_view,
+                const VkImageLayout layout,
+                const VkSampler sampler = VK_NULL_HANDLE);
+            /// @brief Writes a buffer in a descriptor set
+            /// @param set_index The index of the descriptor set
+            /// @param binding The binding to write
+            /// @param type The type of descriptor (uniform buffer, storage buffer, ...)
+            /// @param buffer The buffer to bind
+            /// @param offset The offset in the buffer, in bytes
+            /// @param range The size of the bound range, in bytes (VK_WHOLE_SIZE is only
+            /// valid with the descriptor pool: the size of the buffer is unknown)
+            void writeBuffer(
+                const uint32_t set_index,
+                const uint32_t binding,
+                const VkDescriptorType type,
+                const VkBuffer buffer,
+                const VkDeviceSize offset = 0,
+                const VkDeviceSize range = VK_WHOLE_SIZE);
+            /// @brief Writes a buffer in a descriptor set
+            /// @param set_index The index of the descriptor set
+            /// @param binding The binding to write
+            /// @param type The type of descriptor (uniform buffer, storage buffer, ...)
+            /// @param buffer The buffer to bind
+            /// @param offset The offset in the buffer, in bytes
+            /// @param range The size of the bound range, in bytes (VK_WHOLE_SIZE: up to the end)
+            void writeBuffer(
+                const uint32_t set_index,
+                const uint32_t binding,
+                const VkDescriptorType type,
+                const std::shared_ptr<app::graphics::Buffer>& buffer,
+                const VkDeviceSize offset = 0,
+                const VkDeviceSize range = VK_WHOLE_SIZE);
+            /// @brief Records the dispatch of the compute shader
+            /// @param command_buffer The command buffer being recorded
+            /// @param set_index The descriptor set to bind
+            /// @param push_constants The push constants (`push_constants_size` bytes), or nullptr
+            /// @param group_count_x The number of workgroups on the X axis
+            /// @param group_count_y The number of workgroups on the Y axis
+            /// @param group_count_z The number of workgroups on the Z axis
+            void dispatch(
+                VkCommandBuffer command_buffer,
+                const uint32_t set_index,
+                const void* push_constants,
+                const uint32_t group_count_x,
+                const uint32_t group_count_y,
+                const uint32_t group_count_z = 1);
+            /// @brief Returns the number of workgroups to cover `size` invocations
+            /// @param size The number of invocations
+            /// @param group_size The size of a workgroup (local size of the shader)
+            static uint32_t getGroupCount(const uint32_t size, const uint32_t group_size) noexcept;
+            /// @brief Returns the layout of the pipeline
+            VkPipelineLayout getLayout() const noexcept;
+            /// @brief Returns the layout of the descriptor sets, to share them with
+            /// other pipelines (the bindings should then be visible from their stages)
+            VkDescriptorSetLayout getDescriptorSetLayout() const noexcept;
+            /// @brief Returns a descriptor set of the pass (VK_NULL_HANDLE if the sets are
+            /// stored in the descriptor buffer)
+            /// @param set_index The index of the descriptor set
+            VkDescriptorSet getDescriptorSet(const uint32_t set_index) const;
+
+        private:
+            /// @brief ComputePass should not be cloneable
+            ComputePass(ComputePass& other) = delete;
+            /// @brief ComputePass should not be assignable
+            void operator=(const ComputePass& other) = delete;
+            /// @brief The layout of the descriptor sets
+            VkDescriptorSetLayout m_descriptor_set_layout = VK_NULL_HANDLE;
+            /// @brief The descriptor sets, allocated from the engine descriptor pool
+            std::vector<VkDescriptorSet> m_descriptor_sets;
+            /// @brief The offsets of the descriptor sets in the descriptor buffer, if used
+            /// instead of the descriptor pool
+            std::vector<VkDeviceSize> m_descriptor_offsets;
+            /// @brief The layout of the pipeline
+            VkPipelineLayout m_layout = VK_NULL_HANDLE;
+            /// @brief The compute pipeline
+            VkPipeline m_pipeline = VK_NULL_HANDLE;
+            /// @brief The size of the push constants, in bytes
+            uint32_t m_push_constants_size = 0;
+            /// @brief The number of persistent descriptor sets: the index of the first set of
+            /// the frames, if any
+            uint32_t m_frame_set_index = 0;
+            /// @brief If a descriptor set is allocated each frame
+            bool m_frame_descriptor_set = false;
+            /// @brief The set of the current frame in the descriptor pool
+            uint32_t m_frame_slot = 0;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // compute_h
@@ -0,0 +1,609 @@
+//
+//  debug_draw.cpp
+//
+
+#include "debug_draw.hpp"
+#include "../project.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include "pipeline.hpp"
+#include <algorithm>
+#include <cctype>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+#include <thread>
+
+/// @brief The number of segments of each circle of a sphere
+constexpr uint32_t SPHERE_SEGMENTS = 32;
+
+/// @brief The segments of the font, in a cell of 1 by 2 units (x, y up): from (x0, y0) to (x1, y1)
+constexpr float FONT_SEGMENTS[16][4] = {
+    {0.0f, 2.0f, 0.5f, 2.0f}, // 0: top, left half
+    {0.5f, 2.0f, 1.0f, 2.0f}, // 1: top, right half
+    {1.0f, 2.0f, 1.0f, 1.0f}, // 2: right, upper half
+    {1.0f, 1.0f, 1.0f, 0.0f}, // 3: right, lower half
+    {1.0f, 0.0f, 0.5f, 0.0f}, // 4: bottom, right half
+    {0.5f, 0.0f, 0.0f, 0.0f}, // 5: bottom, left half
+    {0.0f, 0.0f, 0.0f, 1.0f}, // 6: left, lower half
+    {0.0f, 1.0f, 0.0f, 2.0f}, // 7: left, upper half
+    {0.0f, 1.0f, 0.5f, 1.0f}, // 8: middle, left half
+    {0.5f, 1.0f, 1.0f, 1.0f}, // 9: middle, right half
+    {0.0f, 2.0f, 0.5f, 1.0f}, // 10: diagonal, top-left
+    {0.5f, 2.0f, 0.5f, 1.0f}, // 11: center, upper half
+    {1.0f, 2.0f, 0.5f, 1.0f}, // 12: diagonal, top-right
+    {0.5f, 1.0f, 1.0f, 0.0f}, // 13: diagonal, bottom-right
+    {0.5f, 1.0f, 0.5f, 0.0f}, // 14: center, lower half
+    {0.5f, 1.0f, 0.0f, 0.0f}, // 15: diagonal, bottom-left
+};
+constexpr uint16_t SEGMENT_TOP = 0x0003;
+constexpr uint16_t SEGMENT_RIGHT = 0x000C;
+constexpr uint16_t SEGMENT_BOTTOM = 0x0030;
+constexpr uint16_t SEGMENT_LEFT = 0x00C0;
+constexpr uint16_t SEGMENT_MIDDLE = 0x0300;
+constexpr uint16_t SEGMENT_CENTER = 0x4800;
+constexpr uint16_t segment(const uint32_t index) { return static_cast<uint16_t>(1u << index); }
+
+/// @brief Returns the segments of a character (0 for the unknown characters and the space)
+static uint16_t fontSegments(const char character)
+{
+    switch (std::toupper(static_cast<unsigned char>(character)))
+    {
+    case '0': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_BOTTOM | SEGMENT_LEFT | segment(12) | segment(15);
+    case '1': return SEGMENT_RIGHT | segment(12);
+    case '2': return SEGMENT_TOP | segment(2) | SEGMENT_MIDDLE | segment(6) | SEGMENT_BOTTOM;
+    case '3': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_BOTTOM | segment(9);
+    case '4': return segment(7) | SEGMENT_MIDDLE | SEGMENT_RIGHT;
+    case '5': return SEGMENT_TOP | segment(7) | SEGMENT_MIDDLE | segment(3) | SEGMENT_BOTTOM;
+    case '6': return SEGMENT_TOP | SEGMENT_LEFT | SEGMENT_BOTTOM | segment(3) | SEGMENT_MIDDLE;
+    case '7': return SEGMENT_TOP | SEGMENT_RIGHT;
+    case '8': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_BOTTOM | SEGMENT_LEFT | SEGMENT_MIDDLE;
+    case '9': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_BOTTOM | segment(7) | SEGMENT_MIDDLE;
+    case 'A': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_LEFT | SEGMENT_MIDDLE;
+    case 'B': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_BOTTOM | SEGMENT_CENTER | segment(9);
+    case 'C': return SEGMENT_TOP | SEGMENT_LEFT | SEGMENT_BOTTOM;
+    case 'D': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_BOTTOM | SEGMENT_CENTER;
+    case 'E': return SEGMENT_TOP | SEGMENT_LEFT | SEGMENT_BOTTOM | segment(8);
+    case 'F': return SEGMENT_TOP | SEGMENT_LEFT | segment(8);
+    case 'G': return SEGMENT_TOP | SEGMENT_LEFT | SEGMENT_BOTTOM | segment(3) | segment(9);
+    case 'H': return SEGMENT_LEFT | SEGMENT_RIGHT | SEGMENT_MIDDLE;
+    case 'I': return SEGMENT_TOP | SEGMENT_BOTTOM | SEGMENT_CENTER;
+    case 'J': return SEGMENT_RIGHT | SEGMENT_BOTTOM | segment(6);
+    case 'K': return SEGMENT_LEFT | segment(8) | segment(12) | segment(13);
+    case 'L': return SEGMENT_LEFT | SEGMENT_BOTTOM;
+    case 'M': return SEGMENT_LEFT | SEGMENT_RIGHT | segment(10) | segment(12);
+    case 'N': return SEGMENT_LEFT | SEGMENT_RIGHT | segment(10) | segment(13);
+    case 'O': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_BOTTOM | SEGMENT_LEFT;
+    case 'P': return SEGMENT_TOP | SEGMENT_LEFT | segment(2) | SEGMENT_MIDDLE;
+    case 'Q': return SEGMENT_TOP | SEGMENT_RIGHT | SEGMENT_BOTTOM | SEGMENT_LEFT | segment(13);
+    case 'R': return SEGMENT_TOP | SEGMENT_LEFT | segment(2) | SEGMENT_MIDDLE | segment(13);
+    case 'S': return SEGMENT_TOP | segment(7) | SEGMENT_MIDDLE | segment(3) | SEGMENT_BOTTOM;
+    case 'T': return SEGMENT_TOP | SEGMENT_CENTER;
+    case 'U': return SEGMENT_LEFT | SEGMENT_RIGHT | SEGMENT_BOTTOM;
+    case 'V': return SEGMENT_LEFT | segment(12) | segment(15);
+    case 'W': return SEGMENT_LEFT | SEGMENT_RIGHT | segment(13) | segment(15);
+    case 'X': return segment(10) | segment(12) | segment(13) | segment(15);
+    case 'Y': return segment(10) | segment(12) | segment(14);
+    case 'Z': return SEGMENT_TOP | segment(12) | segment(15) | SEGMENT_BOTTOM;
+    case '-': return SEGMENT_MIDDLE;
+    case '+': return SEGMENT_MIDDLE | SEGMENT_CENTER;
+    case '=': return SEGMENT_MIDDLE | SEGMENT_BOTTOM;
+    case '_': return SEGMENT_BOTTOM;
+    case '/': return segment(12) | segment(15);
+    case '|': return SEGMENT_CENTER;
+    case '.': return segment(5);
+    case '(': return segment(12) | segment(13);
+    case ')': return segment(10) | segment(15);
+    default: return 0;
+    }
+}
+
+/// @brief Gives an identifier to each instance, so that the thread-local cache of a
+/// destroyed instance is never used by a new one at the same address
+static std::atomic<uint64_t> s_next_instance_id{1};
+
+/// @brief The buffers of the calling thread, for the instance that registered them
+struct ThreadBufferCache
+{
+    /// @brief The identifier of the instance
+    uint64_t m_instance_id = 0;
+    /// @brief The buffers of the calling thread, owned by the instance
+    void* m_buffer = nullptr;
+};
+static thread_local ThreadBufferCache t_thread_buffer_cache;
+
+app::graphics::DebugDraw::DebugDraw() : m_instance_id(s_next_instance_id.fetch_add(1)){};
+
+app::graphics::DebugDraw::~DebugDraw()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    if (VK_NULL_HANDLE != m_depth_tested_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_depth_tested_pipeline, nullptr);
+        m_depth_tested_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_overlay_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_overlay_pipeline, nullptr);
+        m_overlay_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_pipeline_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_pipeline_layout, nullptr);
+        m_pipeline_layout = VK_NULL_HANDLE;
+    }
+    for (uint32_t slot = 0; slot < Project::FRAMES_IN_FLIGHT; ++slot)
+        m_vertex_buffers[slot] = nullptr;
+    m_thread_buffers.clear();
+    m_persistent_lines.clear();
+    m_persistent_texts.clear();
+    m_frame_lines.clear();
+};
+
+utils::VResult app::graphics::DebugDraw::create(const uint32_t max_lines)
+{
+    Log("> Creating the debug draw (%d lines per frame)", max_lines);
+    m_max_lines = max_lines;
+    m_frame_lines.reserve(m_max_lines);
+    for (uint32_t slot = 0; slot < Project::FRAMES_IN_FLIGHT; ++slot)
+    {
+        m_vertex_buffers[slot] = std::make_shared<app::graphics::Buffer>();
+        if (const auto result = m_vertex_buffers[slot]->create(
+                static_cast<VkDeviceSize>(m_max_lines) * 2 * sizeof(Vertex),
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                true);
+            result.IsError())
+        {
+            LogE("Error creating the vertex buffers of the debug draw");
+            return result;
+        }
+    }
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 0,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+    if (const auto result = vkCreatePipelineLayout(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &pipeline_layout_create_info, nullptr, &m_pipeline_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for the debug draw", result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the debug draw");
+    }
+    if (const auto result = createPipeline(true, &m_depth_tested_pipeline); result.IsError())
+        return result;
+    return createPipeline(false, &m_overlay_pipeline);
+}
+
+utils::VResult app::graphics::DebugDraw::createPipeline(const bool depth_test, VkPipeline* pipeline)
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    const auto graphics_pipeline = app::Engine::getInstance()->m_render->getGraphicsPipeline();
+
+    const char* shader_filepaths[2] = {"shaders/debug_draw.vert.spv", "shaders/debug_draw.frag.spv"};
+    const VkShaderStageFlagBits shader_stages[2] = {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT};
+    VkShaderModule shader_modules[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkPipelineShaderStageCreateInfo shader_stage_create_infos[2];
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        const auto shader_module_result = app::graphics::Pipeline::loadShaderModule(shader_filepaths[i]);
+        if (shader_module_result.IsError())
+        {
+            if (VK_NULL_HANDLE != shader_modules[0])
+                vkDestroyShaderModule(graphics_device, shader_modules[0], nullptr);
+            return utils::VResult::Error((char*)"Cannot create the shader modules of the debug draw");
+        }
+        shader_modules[i] = shader_module_result.GetValue();
+        shader_stage_create_infos[i] = VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = shader_stages[i],
+            .module = shader_modules[i],
+            .pName = "main",
+        };
+    }
+
+    const VkVertexInputBindingDescription vertex_binding_description{
+        .binding = 0,
+        .stride = sizeof(Vertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+    const VkVertexInputAttributeDescription vertex_attribute_descriptions[2] = {
+        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, m_position)},
+        {1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Vertex, m_color)},
+    };
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &vertex_binding_description,
+        .vertexAttributeDescriptionCount = 2,
+        .pVertexAttributeDescriptions = vertex_attribute_descriptions,
+    };
+    VkPipelineInputAssemblyStateCreateInfo assembly_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    // Same viewport and scissor as the scene
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = app::Engine::getInstance()->m_render->getSampleCount(),
+        .sampleShadingEnable = VK_FALSE,
+    };
+    // The depth of the last subpass is read-only with the deferred shading: never written
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = static_cast<VkBool32>(depth_test ? VK_TRUE : VK_FALSE),
+        .depthWriteEnable = VK_FALSE,
+        .depthCompareOp = Project::DEPTH_REVERSED_Z ? VK_COMPARE_OP_GREATER_OR_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    // The scene color is blended; the motion vectors (if any) are not touched
+    std::vector<VkPipelineColorBlendAttachmentState> color_blend_attachments(
+        graphics_pipeline->getSceneColorAttachmentCount(),
+        VkPipelineColorBlendAttachmentState{
+            .blendEnable = VK_FALSE,
+            .colorWriteMask = 0,
+        });
+    color_blend_attachments[0] = VkPipelineColorBlendAttachmentState{
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+    };
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = static_cast<uint32_t>(color_blend_attachments.size()),
+        .pAttachments = color_blend_attachments.data(),
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 2,
+        .pStages = shader_stage_create_infos,
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &assembly_state_create_info,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_pipeline_layout,
+        .renderPass = graphics_pipeline->getRenderPass(),
+        .subpass = graphics_pipeline->getSceneSubpass(),
+    };
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, pipeline);
+    // The modules are not needed anymore once the pipeline is created
+    for (uint32_t i = 0; i < 2; ++i)
+        vkDestroyShaderModule(graphics_device, shader_modules[i], nullptr);
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the debug draw", pipeline_result);
+        return utils::VResult::Error((char*)"Cannot create the pipelines of the debug draw");
+    }
+    return utils::VResult::Ok();
+}
+
+app::graphics::DebugDraw::ThreadBuffer& app::graphics::DebugDraw::getThreadBuffer()
+{
+    if (t_thread_buffer_cache.m_instance_id != m_instance_id)
+    {
+        // First submission of this thread: the only lock of the writers
+        std::lock_guard<std::mutex> lock(m_thread_buffers_mutex);
+        m_thread_buffers.push_back(std::make_unique<ThreadBuffer>());
+        t_thread_buffer_cache.m_instance_id = m_instance_id;
+        t_thread_buffer_cache.m_buffer = m_thread_buffers.back().get();
+    }
+    return *static_cast<ThreadBuffer*>(t_thread_buffer_cache.m_buffer);
+}
+
+uint32_t app::graphics::DebugDraw::beginWrite(ThreadBuffer& buffer)
+{
+    // Flagged before reading the side: once `record` has flipped the side and seen the
+    // flag down, the writes go to the other side
+    buffer.m_writing.store(1, std::memory_order_seq_cst);
+    return m_epoch.load(std::memory_order_seq_cst) & 1;
+}
+
+void app::graphics::DebugDraw::endWrite(ThreadBuffer& buffer)
+{
+    buffer.m_writing.store(0, std::memory_order_release);
+}
+
+void app::graphics::DebugDraw::line(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color, const float duration, const bool depth_test)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+    const uint32_t side = beginWrite(buffer);
+    buffer.m_lines[side].push_back(Line{
+        .m_from = from,
+        .m_to = to,
+        .m_color = glm::packUnorm4x8(color),
+        .m_duration = duration,
+        .m_depth_test = depth_test,
+    });
+    endWrite(buffer);
+}
+
+void app::graphics::DebugDraw::aabb(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color, const float duration, const bool depth_test)
+{
+    glm::vec3 corners[8];
+    for (uint32_t i = 0; i < 8; ++i)
+        corners[i] = glm::vec3(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+    // Each edge joins two corners that differ on one axis
+    const uint32_t packed_color = glm::packUnorm4x8(color);
+    ThreadBuffer& buffer = getThreadBuffer();
+    const uint32_t side = beginWrite(buffer);
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        for (uint32_t axis = 1; axis < 8; axis <<= 1)
+        {
+            if (i & axis)
+                continue;
+            buffer.m_lines[side].push_back(Line{
+                .m_from = corners[i],
+                .m_to = corners[i | axis],
+                .m_color = packed_color,
+                .m_duration = duration,
+                .m_depth_test = depth_test,
+            });
+        }
+    }
+    endWrite(buffer);
+}
+
+void app::graphics::DebugDraw::sphere(const glm::vec3& center, const float radius, const glm::vec4& color, const float duration, const bool depth_test)
+{
+    const uint32_t packed_color = glm::packUnorm4x8(color);
+    ThreadBuffer& buffer = getThreadBuffer();
+    const uint32_t side = beginWrite(buffer);
+    for (uint32_t i = 0; i < SPHERE_SEGMENTS; ++i)
+    {
+        const float angle_from = glm::two_pi<float>() * static_cast<float>(i) / SPHERE_SEGMENTS;
+        const float angle_to = glm::two_pi<float>() * static_cast<float>(i + 1) / SPHERE_SEGMENTS;
+        const glm::vec2 from = radius * glm::vec2(glm::cos(angle_from), glm::sin(angle_from));
+        const glm::vec2 to = radius * glm::vec2(glm::cos(angle_to), glm::sin(angle_to));
+        // One circle per plane: XY, YZ, ZX
+        const std::pair<glm::vec3, glm::vec3> segments[3] = {
+            {glm::vec3(from.x, from.y, 0.0f), glm::vec3(to.x, to.y, 0.0f)},
+            {glm::vec3(0.0f, from.x, from.y), glm::vec3(0.0f, to.x, to.y)},
+            {glm::vec3(from.y, 0.0f, from.x), glm::vec3(to.y, 0.0f, to.x)},
+        };
+        for (const auto& segment : segments)
+        {
+            buffer.m_lines[side].push_back(Line{
+                .m_from = center + segment.first,
+                .m_to = center + segment.second,
+                .m_color = packed_color,
+                .m_duration = duration,
+                .m_depth_test = depth_test,
+            });
+        }
+    }
+    endWrite(buffer);
+}
+
+void app::graphics::DebugDraw::frustum(const glm::mat4& world_to_clip, const glm::vec4& color, const float duration, const bool depth_test)
+{
+    // The corners of the clip volume (Vulkan depth range: 0 to 1), back to world space
+    const glm::mat4 clip_to_world = glm::inverse(world_to_clip);
+    glm::vec3 corners[8];
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        const glm::vec4 corner = clip_to_world * glm::vec4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : 0.0f, 1.0f);
+        corners[i] = glm::vec3(corner) / corner.w;
+    }
+    const uint32_t packed_color = glm::packUnorm4x8(color);
+    ThreadBuffer& buffer = getThreadBuffer();
+    const uint32_t side = beginWrite(buffer);
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        for (uint32_t axis = 1; axis < 8; axis <<= 1)
+        {
+            if (i & axis)
+                continue;
+            buffer.m_lines[side].push_back(Line{
+                .m_from = corners[i],
+                .m_to = corners[i | axis],
+                .m_color = packed_color,
+                .m_duration = duration,
+                .m_depth_test = depth_test,
+            });
+        }
+    }
+    endWrite(buffer);
+}
+
+void app::graphics::DebugDraw::text3d(const glm::vec3& position, const char* text, const glm::vec4& color, const float height, const float duration, const bool depth_test)
+{
+    if (nullptr == text)
+        return;
+    ThreadBuffer& buffer = getThreadBuffer();
+    const uint32_t side = beginWrite(buffer);
+    buffer.m_texts[side].push_back(Text{
+        .m_position = position,
+        .m_text = text,
+        .m_color = glm::packUnorm4x8(color),
+        .m_height = height,
+        .m_duration = duration,
+        .m_depth_test = depth_test,
+    });
+    endWrite(buffer);
+}
+
+void app::graphics::DebugDraw::expandText(const Text& text, const glm::vec3& right, const glm::vec3& up, std::vector<Line>& lines) const
+{
+    // The cell is 1 by 2 units, with half a unit between the characters
+    const float unit = 0.5f * text.m_height;
+    glm::vec3 origin = text.m_position;
+    for (const char character : text.m_text)
+    {
+        const uint16_t segments = fontSegments(character);
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            if (0 == (segments & segment(i)))
+                continue;
+            const float* ends = FONT_SEGMENTS[i];
+            lines.push_back(Line{
+                .m_from = origin + unit * (ends[0] * right + ends[1] * up),
+                .m_to = origin + unit * (ends[2] * right + ends[3] * up),
+                .m_color = text.m_color,
+                .m_duration = 0.0f,
+                .m_depth_test = text.m_depth_test,
+            });
+        }
+        origin += 1.5f * unit * right;
+    }
+}
+
+void app::graphics::DebugDraw::record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent, const glm::vec2& jitter)
+{
+    const auto now = std::chrono::steady_clock::now();
+    // Drop the expired primitives, keep the others for this frame
+    m_frame_lines.clear();
+    m_persistent_lines.erase(
+        std::remove_if(m_persistent_lines.begin(), m_persistent_lines.end(), [now](const auto& line) { return line.second < now; }),
+        m_persistent_lines.end());
+    m_persistent_texts.erase(
+        std::remove_if(m_persistent_texts.begin(), m_persistent_texts.end(), [now](const auto& text) { return text.second < now; }),
+        m_persistent_texts.end());
+    for (const auto& line : m_persistent_lines)
+        m_frame_lines.push_back(line.first);
+
+    // The texts face the camera: expanded along its right and up axes
+    const glm::mat4& view = camera.getView();
+    const glm::vec3 right(view[0][0], view[1][0], view[2][0]);
+    const glm::vec3 up(view[0][1], view[1][1], view[2][1]);
+    for (const auto& text : m_persistent_texts)
+        expandText(text.first, right, up, m_frame_lines);
+
+    // Flip the side of the threads, then collect the side they wrote to
+    const uint32_t side = m_epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+    {
+        std::lock_guard<std::mutex> lock(m_thread_buffers_mutex);
+        for (auto& buffer : m_thread_buffers)
+        {
+            // A thread may still be appending a primitive to this side
+            while (0 != buffer->m_writing.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            for (const Line& line : buffer->m_lines[side])
+            {
+                m_frame_lines.push_back(line);
+                if (line.m_duration > 0.0f)
+                    m_persistent_lines.emplace_back(line, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(line.m_duration)));
+            }
+            for (const Text& text : buffer->m_texts[side])
+            {
+                expandText(text, right, up, m_frame_lines);
+                if (text.m_duration > 0.0f)
+                    m_persistent_texts.emplace_back(text, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(text.m_duration)));
+            }
+            buffer->m_lines[side].clear();
+            buffer->m_texts[side].clear();
+        }
+    }
+    if (m_frame_lines.empty() || VK_NULL_HANDLE == m_depth_tested_pipeline)
+        return;
+
+    // The depth-tested lines first, then the overlay: one range per pipeline
+    const auto overlay_begin = std::stable_partition(m_frame_lines.begin(), m_frame_lines.end(), [](const Line& line) { return line.m_depth_test; });
+    const uint32_t line_count = std::min(static_cast<uint32_t>(m_frame_lines.size()), m_max_lines);
+    const uint32_t depth_tested_count = std::min(static_cast<uint32_t>(overlay_begin - m_frame_lines.begin()), line_count);
+    const auto vertex_buffer = m_vertex_buffers[m_slot];
+    Vertex* vertices = static_cast<Vertex*>(vertex_buffer->getMappedData());
+    for (uint32_t i = 0; i < line_count; ++i)
+    {
+        *vertices++ = Vertex{m_frame_lines[i].m_from, m_frame_lines[i].m_color};
+        *vertices++ = Vertex{m_frame_lines[i].m_to, m_frame_lines[i].m_color};
+    }
+    vertex_buffer->flush(static_cast<VkDeviceSize>(line_count) * 2 * sizeof(Vertex));
+
+    // Jittered like the scene, to be tested against its depth
+    const float aspect = static_cast<float>(render_extent.width) / static_cast<float>(render_extent.height);
+    glm::mat4 jitter_matrix(1.0f);
+    jitter_matrix[3][0] = jitter.x;
+    jitter_matrix[3][1] = jitter.y;
+    const PushConstants push_constants{
+        .m_view_projection = jitter_matrix * camera.getProjection(aspect) * view,
+    };
+    const VkBuffer vertex_buffer_handle = vertex_buffer->getBuffer();
+    const VkDeviceSize vertex_offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer_handle, &vertex_offset);
+    if (depth_tested_count > 0)
+    {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_depth_tested_pipeline);
+        vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &push_constants);
+        vkCmdDraw(command_buffer, 2 * depth_tested_count, 1, 0, 0);
+    }
+    if (line_count > depth_tested_count)
+    {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_overlay_pipeline);
+        vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &push_constants);
+        vkCmdDraw(command_buffer, 2 * (line_count - depth_tested_count), 1, 2 * depth_tested_count, 0);
+    }
+    m_slot = (m_slot + 1) % Project::FRAMES_IN_FLIGHT;
+}
+
+#ifdef DEBUG
+void app::debug::line(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color, const float duration, const bool depth_test)
+{
+    if (const auto debug_draw = app::Engine::getInstance()->m_render->getDebugDraw(); nullptr != debug_draw)
+        debug_draw->line(from, to, color, duration, depth_test);
+}
+
+void app::debug::aabb(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color, const float duration, const bool depth_test)
+{
+    if (const auto debug_draw = app::Engine::getInstance()->m_render->getDebugDraw(); nullptr != debug_draw)
+        debug_draw->aabb(min, max, color, duration, depth_test);
+}
+
+void app::debug::sphere(const glm::vec3& center, const float radius, const glm::vec4& color, const float duration, const bool depth_test)
+{
+    if (const auto debug_draw = app::Engine::getInstance()->m_render->getDebugDraw(); nullptr != debug_draw)
+        debug_draw->sphere(center, radius, color, duration, depth_test);
+}
+
+void app::debug::frustum(const glm::mat4& world_to_clip, const glm::vec4& color, const float duration, const bool depth_test)
+{
+    if (const auto debug_draw = app::Engine::getInstance()->m_render->getDebugDraw(); nullptr != debug_draw)
+        debug_draw->frustum(world_to_clip, color, duration, depth_test);
+}
+
+void app::debug::text3d(const glm::vec3& position, const char* text, const glm::vec4& color, const float height, const float duration, const bool depth_test)
+{
+    if (const auto debug_draw = app::Engine::getInstance()->m_render->getDebugDraw(); nullptr != debug_draw)
+        debug_draw->text3d(position, text, color, height, duration, depth_test);
+}
+#endif
@@ -0,0 +1,205 @@
+//
+//  debug_draw.hpp
+//
+
+#pragma once
+#ifndef debug_draw_h
+#define debug_draw_h
+
+#include "../project.hpp"
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include "camera.hpp"
+#include <atomic>
+#include <chrono>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Immediate-mode debug geometry (lines, boxes, spheres, frusta, text),
+        /// drawn in world space over the scene, in the last subpass of the scene render pass.
+        ///
+        /// The primitives can be submitted from any thread: each thread appends to its own
+        /// buffers, without any lock. The buffers are double-buffered: `record` flips the
+        /// side the threads write to, waits for the writes in progress on the other side
+        /// (a few primitives at most), then reads it.
+        /// A primitive lives for one frame, or for a duration in seconds. All of them are
+        /// expanded to lines, and drawn with a single line-list draw per depth mode (tested
+        /// against the depth of the scene, or always visible).
+        ///
+        /// Use the functions of `app::debug`, which compile to nothing without DEBUG.
+        class DebugDraw
+        {
+        public:
+            /// @brief Public constructor
+            DebugDraw();
+            /// @brief Public destructor
+            ~DebugDraw();
+            /// @brief Creates the vertex buffers and the pipelines.
+            /// Should be called once the graphics pipeline is created: the lines are drawn
+            /// in the last subpass of its render pass.
+            /// @param max_lines The maximum number of lines drawn per frame
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t max_lines);
+            /// @brief Submits a line
+            /// @param from The first end, in world space
+            /// @param to The second end, in world space
+            /// @param color The color of the line (scene-referred: it is exposed and tonemapped)
+            /// @param duration The time to keep it, in seconds (0: this frame only)
+            /// @param depth_test If the scene hides it
+            void line(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color, const float duration, const bool depth_test);
+            /// @brief Submits the 12 edges of an axis-aligned box
+            void aabb(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color, const float duration, const bool depth_test);
+            /// @brief Submits a sphere, as three orthogonal circles
+            void sphere(const glm::vec3& center, const float radius, const glm::vec4& color, const float duration, const bool depth_test);
+            /// @brief Submits the 12 edges of a frustum
+            /// @param world_to_clip The projection and view of the frustum (Vulkan clip space)
+            void frustum(const glm::mat4& world_to_clip, const glm::vec4& color, const float duration, const bool depth_test);
+            /// @brief Submits a text, facing the camera, with a segment font (letters,
+            /// digits and a few symbols)
+            /// @param position The bottom-left corner of the text, in world space
+            /// @param text The text: the lowercase letters are drawn as uppercase
+            /// @param height The height of the characters, in world units
+            void text3d(const glm::vec3& position, const char* text, const glm::vec4& color, const float height, const float duration, const bool depth_test);
+            /// @brief Collects the primitives of all the threads, writes them in the vertex
+            /// buffer of the frame and records their draws.
+            /// Should be recorded in the last subpass of the scene render pass.
+            /// @param command_buffer The command buffer being recorded
+            /// @param camera The point of view of the scene
+            /// @param render_extent The extent the scene is rendered at
+            /// @param jitter The sub-pixel offset of the projection of the scene, in NDC units
+            void record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent, const glm::vec2& jitter);
+
+        private:
+            /// @brief A vertex of a line, as read by the vertex shader
+            struct Vertex
+            {
+                /// @brief In world space
+                glm::vec3 m_position;
+                /// @brief RGBA8
+                uint32_t m_color;
+            };
+            /// @brief A submitted line
+            struct Line
+            {
+                /// @brief The first end, in world space
+                glm::vec3 m_from;
+                /// @brief The second end, in world space
+                glm::vec3 m_to;
+                /// @brief RGBA8
+                uint32_t m_color;
+                /// @brief The time to keep it, in seconds
+                float m_duration;
+                /// @brief If the scene hides it
+                bool m_depth_test;
+            };
+            /// @brief A submitted text, expanded to lines when recorded (it faces the camera)
+            struct Text
+            {
+                /// @brief The bottom-left corner, in world space
+                glm::vec3 m_position;
+                /// @brief The characters
+                std::string m_text;
+                /// @brief RGBA8
+                uint32_t m_color;
+                /// @brief The height of the characters, in world units
+                float m_height;
+                /// @brief The time to keep it, in seconds
+                float m_duration;
+                /// @brief If the scene hides it
+                bool m_depth_test;
+            };
+            /// @brief The primitives submitted by a thread, on two sides
+            struct ThreadBuffer
+            {
+                /// @brief Set while the thread appends to a side
+                std::atomic<uint32_t> m_writing{0};
+                /// @brief The lines, per side
+                std::vector<Line> m_lines[2];
+                /// @brief The texts, per side
+                std::vector<Text> m_texts[2];
+            };
+            /// @brief The push constants of the line pipelines (vertex stage)
+            struct PushConstants
+            {
+                /// @brief From world space to clip space (jittered like the scene)
+                glm::mat4 m_view_projection;
+            };
+            /// @brief DebugDraw should not be cloneable
+            DebugDraw(DebugDraw& other) = delete;
+            /// @brief DebugDraw should not be assignable
+            void operator=(const DebugDraw& other) = delete;
+            /// @brief Creates the pipeline of a depth mode
+            utils::VResult createPipeline(const bool depth_test, VkPipeline* pipeline);
+            /// @brief Returns the buffers of the calling thread, registering them on its
+            /// first submission
+            ThreadBuffer& getThreadBuffer();
+            /// @brief Starts appending to the buffers of the calling thread
+            /// @return The side to append to
+            uint32_t beginWrite(ThreadBuffer& buffer);
+            /// @brief Stops appending to the buffers of the calling thread
+            void endWrite(ThreadBuffer& buffer);
+            /// @brief Appends the lines of a text, facing the camera
+            void expandText(const Text& text, const glm::vec3& right, const glm::vec3& up, std::vector<Line>& lines) const;
+            /// @brief Identifies the instance in the thread-local cache of the buffers
+            const uint64_t m_instance_id;
+            /// @brief The buffers of all the threads that submitted primitives
+            std::vector<std::unique_ptr<ThreadBuffer>> m_thread_buffers;
+            /// @brief Guards `m_thread_buffers` (registration and collection only)
+            std::mutex m_thread_buffers_mutex;
+            /// @brief Its parity is the side the threads append to
+            std::atomic<uint32_t> m_epoch{0};
+            /// @brief The lines kept for more than one frame, and when they expire
+            std::vector<std::pair<Line, std::chrono::steady_clock::time_point>> m_persistent_lines;
+            /// @brief The texts kept for more than one frame, and when they expire
+            std::vector<std::pair<Text, std::chrono::steady_clock::time_point>> m_persistent_texts;
+            /// @brief The lines of the frame being recorded
+            std::vector<Line> m_frame_lines;
+            /// @brief The vertex buffers of the frames (host-visible): 2 vertices per line
+            std::shared_ptr<app::graphics::Buffer> m_vertex_buffers[Project::FRAMES_IN_FLIGHT] = {};
+            /// @brief The layout of the line pipelines
+            VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+            /// @brief Draws the lines hidden by the scene
+            VkPipeline m_depth_tested_pipeline = VK_NULL_HANDLE;
+            /// @brief Draws the lines always visible
+            VkPipeline m_overlay_pipeline = VK_NULL_HANDLE;
+            /// @brief The maximum number of lines per frame
+            uint32_t m_max_lines = 0;
+            /// @brief The slot of the vertex ring written by this frame
+            uint32_t m_slot = 0;
+        };
+    } // namespace graphics
+
+    /// @brief The debug draw API: callable from any thread, and compiled to nothing
+    /// without DEBUG. The primitives are drawn by the DebugDraw of the renderer.
+    namespace debug
+    {
+#ifdef DEBUG
+        /// @brief Draws a line (see DebugDraw::line)
+        void line(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color, const float duration = 0.0f, const bool depth_test = true);
+        /// @brief Draws an axis-aligned box (see DebugDraw::aabb)
+        void aabb(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color, const float duration = 0.0f, const bool depth_test = true);
+        /// @brief Draws a sphere (see DebugDraw::sphere)
+        void sphere(const glm::vec3& center, const float radius, const glm::vec4& color, const float duration = 0.0f, const bool depth_test = true);
+        /// @brief Draws a frustum (see DebugDraw::frustum)
+        void frustum(const glm::mat4& world_to_clip, const glm::vec4& color, const float duration = 0.0f, const bool depth_test = true);
+        /// @brief Draws a text facing the camera (see DebugDraw::text3d)
+        void text3d(const glm::vec3& position, const char* text, const glm::vec4& color, const float height = 0.25f, const float duration = 0.0f, const bool depth_test = false);
+#else
+        inline void line(const glm::vec3&, const glm::vec3&, const glm::vec4&, const float = 0.0f, const bool = true) {}
+        inline void aabb(const glm::vec3&, const glm::vec3&, const glm::vec4&, const float = 0.0f, const bool = true) {}
+        inline void sphere(const glm::vec3&, const float, const glm::vec4&, const float = 0.0f, const bool = true) {}
+        inline void frustum(const glm::mat4&, const glm::vec4&, const float = 0.0f, const bool = true) {}
+        inline void text3d(const glm::vec3&, const char*, const glm::vec4&, const float = 0.25f, const float = 0.0f, const bool = false) {}
+#endif
+    } // namespace debug
+} // namespace app
+
+#endif // debug_draw_h
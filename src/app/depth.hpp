@@ -0,0 +1,121 @@
+//
+//  depth.hpp
+//
+
+#pragma once
+#ifndef depth_h
+#define depth_h
+
+#include "../project.hpp"
+#include <array>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        namespace Depth
+        {
+            /// @brief The depth formats we can use, from the best to the worst one.
+            /// Float formats come first, as those are the ones that benefit from a
+            /// reversed depth range.
+            constexpr std::array<VkFormat, 4> FORMAT_CANDIDATES = {
+                VK_FORMAT_D32_SFLOAT,
+                VK_FORMAT_D32_SFLOAT_S8_UINT,
+                VK_FORMAT_D24_UNORM_S8_UINT,
+                VK_FORMAT_D16_UNORM,
+            };
+
+            /// @brief Returns if the depth format contains a stencil component
+            [[maybe_unused]] static bool hasStencil(const VkFormat format) noexcept
+            {
+                return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+            }
+
+            /// @brief Returns the aspect(s) to use for an image view on a depth format
+            [[maybe_unused]] static VkImageAspectFlags getAspect(const VkFormat format) noexcept
+            {
+                return hasStencil(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+            }
+
+            /// @brief Returns the compare operation that keeps the closest fragment
+            [[maybe_unused]] static VkCompareOp getCompareOp() noexcept
+            {
+                return Project::DEPTH_REVERSED_Z ? VK_COMPARE_OP_GREATER : VK_COMPARE_OP_LESS;
+            }
+
+            /// @brief Returns the clear value of the depth attachment: the far plane
+            [[maybe_unused]] static VkClearValue getClearValue() noexcept
+            {
+                VkClearValue clear_value{};
+                clear_value.depthStencil = {
+                    .depth = Project::DEPTH_REVERSED_Z ? 0.0f : 1.0f,
+                    .stencil = 0,
+                };
+                return clear_value;
+            }
+
+            /// @brief Builds a right-handed perspective projection, in the Vulkan
+            /// clip space (Y pointing down, depth in [0, 1]).
+            /// If DEPTH_REVERSED_Z is set, the near plane is mapped to 1 and the far plane to 0.
+            /// @param fovy The vertical field of view, in radians
+            /// @param aspect The aspect ratio (width / height) of the viewport
+            /// @param z_near The distance of the near plane
+            /// @param z_far The distance of the far plane
+            /// @return A projection matrix
+            [[maybe_unused]] static glm::mat4 perspective(const float fovy, const float aspect, const float z_near, const float z_far) noexcept
+            {
+                const float focal_length = 1.0f / glm::tan(fovy / 2.0f);
+                glm::mat4 projection(0.0f);
+                projection[0][0] = focal_length / aspect;
+                projection[1][1] = -focal_length;
+                projection[2][3] = -1.0f;
+                if (Project::DEPTH_REVERSED_Z)
+                {
+                    projection[2][2] = z_near / (z_far - z_near);
+                    projection[3][2] = (z_far * z_near) / (z_far - z_near);
+                }
+                else
+                {
+                    projection[2][2] = z_far / (z_near - z_far);
+                    projection[3][2] = (z_far * z_near) / (z_near - z_far);
+                }
+                return projection;
+            }
+
+            /// @brief Builds a right-handed orthographic projection, in the Vulkan
+            /// clip space (Y pointing down, depth in [0, 1]).
+            /// If DEPTH_REVERSED_Z is set, the near plane is mapped to 1 and the far plane to 0.
+            /// @param left The left plane, in view space
+            /// @param right The right plane, in view space
+            /// @param bottom The bottom plane, in view space
+            /// @param top The top plane, in view space
+            /// @param z_near The distance of the near plane
+            /// @param z_far The distance of the far plane
+            /// @return A projection matrix
+            [[maybe_unused]] static glm::mat4 orthographic(const float left, const float right, const float bottom, const float top, const float z_near, const float z_far) noexcept
+            {
+                glm::mat4 projection(1.0f);
+                projection[0][0] = 2.0f / (right - left);
+                projection[1][1] = -2.0f / (top - bottom);
+                projection[3][0] = -(right + left) / (right - left);
+                projection[3][1] = (top + bottom) / (top - bottom);
+                if (Project::DEPTH_REVERSED_Z)
+                {
+                    projection[2][2] = 1.0f / (z_far - z_near);
+                    projection[3][2] = z_far / (z_far - z_near);
+                }
+                else
+                {
+                    projection[2][2] = -1.0f / (z_far - z_near);
+                    projection[3][2] = -z_near / (z_far - z_near);
+                }
+                return projection;
+            }
+        } // namespace Depth
+    } // namespace graphics
+} // namespace app
+
+#endif // depth_h
@@ -0,0 +1,261 @@
+//
+//  descriptor_buffer.cpp
+//
+
+#include "descriptor_buffer.hpp"
+#include "../project.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+
+app::graphics::DescriptorBuffer::DescriptorBuffer(){};
+
+app::graphics::DescriptorBuffer::~DescriptorBuffer()
+{
+    m_buffer = nullptr;
+    m_address = 0;
+};
+
+utils::VResult app::graphics::DescriptorBuffer::create(const uint32_t persistent_size, const uint32_t frame_size)
+{
+    if (!app::Engine::getInstance()->m_graphics_device.supportsDescriptorBuffers())
+    {
+        if (Project::DESCRIPTOR_BUFFERS)
+            LogW("> Descriptor buffers are not supported: the descriptors are allocated from the descriptor pool");
+        return utils::VResult::Ok();
+    }
+#ifdef VK_EXT_descriptor_buffer
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    m_get_layout_size = reinterpret_cast<PFN_vkGetDescriptorSetLayoutSizeEXT>(
+        vkGetDeviceProcAddr(graphics_device, "vkGetDescriptorSetLayoutSizeEXT"));
+    m_get_binding_offset = reinterpret_cast<PFN_vkGetDescriptorSetLayoutBindingOffsetEXT>(
+        vkGetDeviceProcAddr(graphics_device, "vkGetDescriptorSetLayoutBindingOffsetEXT"));
+    m_get_descriptor = reinterpret_cast<PFN_vkGetDescriptorEXT>(
+        vkGetDeviceProcAddr(graphics_device, "vkGetDescriptorEXT"));
+    m_bind_buffers = reinterpret_cast<PFN_vkCmdBindDescriptorBuffersEXT>(
+        vkGetDeviceProcAddr(graphics_device, "vkCmdBindDescriptorBuffersEXT"));
+    m_set_offsets = reinterpret_cast<PFN_vkCmdSetDescriptorBufferOffsetsEXT>(
+        vkGetDeviceProcAddr(graphics_device, "vkCmdSetDescriptorBufferOffsetsEXT"));
+    if (nullptr == m_get_layout_size || nullptr == m_get_binding_offset || nullptr == m_get_descriptor ||
+        nullptr == m_bind_buffers || nullptr == m_set_offsets)
+    {
+        LogW("> VK_EXT_descriptor_buffer functions not found: the descriptors are allocated from the descriptor pool");
+        return utils::VResult::Ok();
+    }
+
+    const auto& properties = app::Engine::getInstance()->m_graphics_device.getDescriptorBufferProperties();
+    m_offset_alignment = std::max(properties.descriptorBufferOffsetAlignment, VkDeviceSize{1});
+    // Both of the regions start on a set boundary
+    m_persistent_size = (persistent_size + m_offset_alignment - 1) / m_offset_alignment * m_offset_alignment;
+    m_frame_size = (frame_size + m_offset_alignment - 1) / m_offset_alignment * m_offset_alignment;
+    Log("> Creating the descriptor buffer (%llu persistent bytes, %llu bytes per frame)", m_persistent_size, m_frame_size);
+
+    // The combined image samplers live in a buffer with the sampler usage too
+    m_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_buffer->create(
+            std::max(m_persistent_size + Project::FRAMES_IN_FLIGHT * m_frame_size, m_offset_alignment),
+            VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT |
+                VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            true);
+        result.IsError())
+    {
+        m_buffer = nullptr;
+        return result;
+    }
+    m_address = m_buffer->getDeviceAddress();
+#endif
+    return utils::VResult::Ok();
+}
+
+bool app::graphics::DescriptorBuffer::isEnabled() const noexcept
+{
+    return nullptr != m_buffer;
+}
+
+utils::Result<VkDeviceSize> app::graphics::DescriptorBuffer::allocate(const VkDescriptorSetLayout layout)
+{
+    assert(isEnabled());
+    const VkDeviceSize size = getLayoutSize(layout);
+    if (m_persistent_used + size > m_persistent_size)
+    {
+        LogE("> The persistent region of the descriptor buffer is full (%llu bytes)", m_persistent_size);
+        return utils::Result<VkDeviceSize>::Error((char*)"The persistent region of the descriptor buffer is full");
+    }
+    const VkDeviceSize offset = m_persistent_used;
+    m_persistent_used += size;
+    return utils::Result<VkDeviceSize>::Ok(offset);
+}
+
+void app::graphics::DescriptorBuffer::beginFrame(VkCommandBuffer command_buffer)
+{
+    if (!isEnabled())
+        return;
+    // The sets of this region have been read by the frame FRAMES_IN_FLIGHT frames ago, whose
+    // fence has been waited
+    m_slot = (m_slot + 1) % Project::FRAMES_IN_FLIGHT;
+    m_frame_used = 0;
+#ifdef VK_EXT_descriptor_buffer
+    const VkDescriptorBufferBindingInfoEXT binding_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+        .address = m_address,
+        .usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT,
+    };
+    m_bind_buffers(command_buffer, 1, &binding_info);
+#endif
+}
+
+utils::Result<VkDeviceSize> app::graphics::DescriptorBuffer::allocateFrame(const VkDescriptorSetLayout layout)
+{
+    assert(isEnabled());
+    const VkDeviceSize size = getLayoutSize(layout);
+    if (m_frame_used + size > m_frame_size)
+    {
+        LogE("> The frame region of the descriptor buffer is full (%llu bytes)", m_frame_size);
+        return utils::Result<VkDeviceSize>::Error((char*)"The frame region of the descriptor buffer is full");
+    }
+    const VkDeviceSize offset = m_persistent_size + m_slot * m_frame_size + m_frame_used;
+    m_frame_used += size;
+    return utils::Result<VkDeviceSize>::Ok(offset);
+}
+
+void app::graphics::DescriptorBuffer::writeBuffer(
+    const VkDeviceSize set_offset,
+    const VkDescriptorSetLayout layout,
+    const uint32_t binding,
+    const VkDescriptorType type,
+    const VkDeviceAddress address,
+    const VkDeviceSize range)
+{
+    assert(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER == type || VK_DESCRIPTOR_TYPE_STORAGE_BUFFER == type);
+#ifdef VK_EXT_descriptor_buffer
+    const VkDescriptorAddressInfoEXT address_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
+        .address = address,
+        .range = range,
+        .format = VK_FORMAT_UNDEFINED,
+    };
+    VkDescriptorGetInfoEXT get_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .type = type,
+    };
+    if (VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER == type)
+        get_info.data.pUniformBuffer = &address_info;
+    else
+        get_info.data.pStorageBuffer = &address_info;
+    write(set_offset, layout, binding, get_info);
+#endif
+}
+
+void app::graphics::DescriptorBuffer::writeImage(
+    const VkDeviceSize set_offset,
+    const VkDescriptorSetLayout layout,
+    const uint32_t binding,
+    const VkDescriptorType type,
+    const VkImageView image_view,
+    const VkImageLayout image_layout,
+    const VkSampler sampler)
+{
+#ifdef VK_EXT_descriptor_buffer
+    const VkDescriptorImageInfo image_info{
+        .sampler = sampler,
+        .imageView = image_view,
+        .imageLayout = image_layout,
+    };
+    VkDescriptorGetInfoEXT get_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .type = type,
+    };
+    switch (type)
+    {
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            get_info.data.pCombinedImageSampler = &image_info;
+            break;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            get_info.data.pSampledImage = &image_info;
+            break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            get_info.data.pStorageImage = &image_info;
+            break;
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            get_info.data.pInputAttachmentImage = &image_info;
+            break;
+        default:
+            LogE("> Unsupported image descriptor type %d in the descriptor buffer", type);
+            return;
+    }
+    write(set_offset, layout, binding, get_info);
+#endif
+}
+
+void app::graphics::DescriptorBuffer::bind(
+    VkCommandBuffer command_buffer,
+    const VkPipelineBindPoint bind_point,
+    const VkPipelineLayout pipeline_layout,
+    const uint32_t set,
+    const VkDeviceSize set_offset) const
+{
+    assert(isEnabled());
+    // The single descriptor buffer bound by beginFrame
+#ifdef VK_EXT_descriptor_buffer
+    const uint32_t buffer_index = 0;
+    m_set_offsets(command_buffer, bind_point, pipeline_layout, set, 1, &buffer_index, &set_offset);
+#endif
+}
+
+VkDeviceSize app::graphics::DescriptorBuffer::getLayoutSize(const VkDescriptorSetLayout layout) const
+{
+    VkDeviceSize size = 0;
+#ifdef VK_EXT_descriptor_buffer
+    m_get_layout_size(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), layout, &size);
+#endif
+    return (size + m_offset_alignment - 1) / m_offset_alignment * m_offset_alignment;
+}
+
+size_t app::graphics::DescriptorBuffer::getDescriptorSize(const VkDescriptorType type) const
+{
+#ifdef VK_EXT_descriptor_buffer
+    const auto& properties = app::Engine::getInstance()->m_graphics_device.getDescriptorBufferProperties();
+    switch (type)
+    {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            return properties.samplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            return properties.combinedImageSamplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            return properties.sampledImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            return properties.storageImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            return properties.uniformBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            return properties.storageBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            return properties.inputAttachmentDescriptorSize;
+        default:
+            return 0;
+    }
+#else
+    return 0;
+#endif
+}
+
+#ifdef VK_EXT_descriptor_buffer
+
+void app::graphics::DescriptorBuffer::write(
+    const VkDeviceSize set_offset,
+    const VkDescriptorSetLayout layout,
+    const uint32_t binding,
+    const VkDescriptorGetInfoEXT& get_info)
+{
+    assert(isEnabled());
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    VkDeviceSize binding_offset = 0;
+    m_get_binding_offset(graphics_device, layout, binding, &binding_offset);
+    const size_t descriptor_size = getDescriptorSize(get_info.type);
+    const VkDeviceSize offset = set_offset + binding_offset;
+    assert(offset + descriptor_size <= m_buffer->getSize());
+    // The descriptor is written in place: no staging, no vkUpdateDescriptorSets
+    m_get_descriptor(graphics_device, &get_info, descriptor_size, static_cast<char*>(m_buffer->getMappedData()) + offset);
+    m_buffer->flush(descriptor_size, offset);
+}
+#endif
@@ -0,0 +1,154 @@
+//
+//  descriptor_buffer.hpp
+//
+
+#pragma once
+#ifndef descriptor_buffer_h
+#define descriptor_buffer_h
+
+#include "../project.hpp"
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include <memory>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Stores descriptors in a host-visible buffer (VK_EXT_descriptor_buffer), as
+        /// an alternative to the sets of the engine descriptor pool.
+        ///
+        /// A descriptor is written with vkGetDescriptorEXT straight in the mapped memory, at
+        /// the offset of its set plus the offset of its binding in the set layout, and a set
+        /// is bound by its offset in the buffer. The buffer is split in two regions: the
+        /// persistent one, for the descriptors written once at the creation of the passes,
+        /// and a ring of FRAMES_IN_FLIGHT regions for the descriptors written each frame, where
+        /// the sets are appended linearly and rewound when the region is reused.
+        /// The layouts and the pipelines using this buffer should be created with the
+        /// DESCRIPTOR_BUFFER flags, and their sets cannot be bound with vkCmdBindDescriptorSets.
+        /// Compiled out with the headers that do not declare the extension (never enabled).
+        class DescriptorBuffer
+        {
+        public:
+            /// @brief Public constructor
+            DescriptorBuffer();
+            /// @brief Public destructor
+            ~DescriptorBuffer();
+            /// @brief Creates the descriptor buffer and loads the functions of the extension.
+            /// Nothing is created if the device does not support descriptor buffers: the
+            /// descriptors are then allocated from the descriptor pool.
+            /// @param persistent_size The size of the persistent region, in bytes
+            /// @param frame_size The size of the region of a frame, in bytes
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t persistent_size, const uint32_t frame_size);
+            /// @brief Returns if the descriptors are stored in the descriptor buffer
+            bool isEnabled() const noexcept;
+            /// @brief Allocates a set in the persistent region
+            /// @param layout The layout of the set (created with the DESCRIPTOR_BUFFER flag)
+            /// @return The offset of the set in the buffer, or an error if the region is full
+            utils::Result<VkDeviceSize> allocate(const VkDescriptorSetLayout layout);
+            /// @brief Switches to the next region of the ring, rewinds it, and binds the
+            /// descriptor buffer. Should be called once per frame, at the beginning of the
+            /// command buffer, before any set of the buffer is bound.
+            /// @param command_buffer The command buffer being recorded
+            void beginFrame(VkCommandBuffer command_buffer);
+            /// @brief Appends a set in the region of the current frame. The set is valid until
+            /// the region is reused, FRAMES_IN_FLIGHT frames later.
+            /// @param layout The layout of the set (created with the DESCRIPTOR_BUFFER flag)
+            /// @return The offset of the set in the buffer, or an error if the region is full
+            utils::Result<VkDeviceSize> allocateFrame(const VkDescriptorSetLayout layout);
+            /// @brief Writes a buffer descriptor in a set
+            /// @param set_offset The offset of the set, returned by `allocate` or `allocateFrame`
+            /// @param layout The layout of the set
+            /// @param binding The binding to write
+            /// @param type The type of descriptor (uniform buffer or storage buffer)
+            /// @param address The device address of the bound range
+            /// @param range The size of the bound range, in bytes
+            void writeBuffer(
+                const VkDeviceSize set_offset,
+                const VkDescriptorSetLayout layout,
+                const uint32_t binding,
+                const VkDescriptorType type,
+                const VkDeviceAddress address,
+                const VkDeviceSize range);
+            /// @brief Writes an image descriptor in a set
+            /// @param set_offset The offset of the set, returned by `allocate` or `allocateFrame`
+            /// @param layout The layout of the set
+            /// @param binding The binding to write
+            /// @param type The type of descriptor (sampled image, storage image, ...)
+            /// @param image_view The image view to bind
+            /// @param image_layout The layout of the image while the shader accesses it
+            /// @param sampler The sampler, for combined image samplers
+            void writeImage(
+                const VkDeviceSize set_offset,
+                const VkDescriptorSetLayout layout,
+                const uint32_t binding,
+                const VkDescriptorType type,
+                const VkImageView image_view,
+                const VkImageLayout image_layout,
+                const VkSampler sampler = VK_NULL_HANDLE);
+            /// @brief Binds a set of the buffer to a pipeline layout (the buffer should have
+            /// been bound by `beginFrame` on this command buffer)
+            /// @param command_buffer The command buffer being recorded
+            /// @param bind_point The type of pipeline using the set
+            /// @param pipeline_layout The layout of the pipeline
+            /// @param set The index of the set in the pipeline layout
+            /// @param set_offset The offset of the set, returned by `allocate` or `allocateFrame`
+            void bind(
+                VkCommandBuffer command_buffer,
+                const VkPipelineBindPoint bind_point,
+                const VkPipelineLayout pipeline_layout,
+                const uint32_t set,
+                const VkDeviceSize set_offset) const;
+
+        private:
+            /// @brief DescriptorBuffer should not be cloneable
+            DescriptorBuffer(DescriptorBuffer& other) = delete;
+            /// @brief DescriptorBuffer should not be assignable
+            void operator=(const DescriptorBuffer& other) = delete;
+            /// @brief Returns the size of a set of the layout, aligned for the set offsets
+            VkDeviceSize getLayoutSize(const VkDescriptorSetLayout layout) const;
+            /// @brief Returns the size of a descriptor of the type, in bytes
+            size_t getDescriptorSize(const VkDescriptorType type) const;
+#ifdef VK_EXT_descriptor_buffer
+            /// @brief Writes a descriptor at its binding in a set
+            void write(
+                const VkDeviceSize set_offset,
+                const VkDescriptorSetLayout layout,
+                const uint32_t binding,
+                const VkDescriptorGetInfoEXT& get_info);
+#endif
+            /// @brief The descriptors (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_buffer = nullptr;
+            /// @brief The device address of the descriptors
+            VkDeviceAddress m_address = 0;
+            /// @brief The alignment of the offset of a set
+            VkDeviceSize m_offset_alignment = 1;
+            /// @brief The size of the persistent region, in bytes
+            VkDeviceSize m_persistent_size = 0;
+            /// @brief The size of the persistent region in use, in bytes
+            VkDeviceSize m_persistent_used = 0;
+            /// @brief The size of the region of a frame, in bytes
+            VkDeviceSize m_frame_size = 0;
+            /// @brief The size of the region of the current frame in use, in bytes
+            VkDeviceSize m_frame_used = 0;
+            /// @brief The region of the ring of the current frame
+            uint32_t m_slot = 0;
+#ifdef VK_EXT_descriptor_buffer
+            /// @brief vkGetDescriptorSetLayoutSizeEXT
+            PFN_vkGetDescriptorSetLayoutSizeEXT m_get_layout_size = nullptr;
+            /// @brief vkGetDescriptorSetLayoutBindingOffsetEXT
+            PFN_vkGetDescriptorSetLayoutBindingOffsetEXT m_get_binding_offset = nullptr;
+            /// @brief vkGetDescriptorEXT
+            PFN_vkGetDescriptorEXT m_get_descriptor = nullptr;
+            /// @brief vkCmdBindDescriptorBuffersEXT
+            PFN_vkCmdBindDescriptorBuffersEXT m_bind_buffers = nullptr;
+            /// @brief vkCmdSetDescriptorBufferOffsetsEXT
+            PFN_vkCmdSetDescriptorBufferOffsetsEXT m_set_offsets = nullptr;
+#endif
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // descriptor_buffer_h
@@ -7,6 +7,8 @@
 #include "device.hpp"
 #include "../utils/debug_tools.h"
 #include "../utils/result.h"
+#include "../project.hpp"
+#include "depth.hpp"
 #include "engine.hpp"
 #include "render.hpp"
 #include <vector>
@@ -117,6 +119,21 @@ static void listAvailableExtensions(const VkPhysicalDevice& physical_device)
     }
 }
 
+/// @brief Returns if the physical device supports an extension
+static bool isExtensionSupported(const VkPhysicalDevice& physical_device, const char* extension_name)
+{
+    uint32_t available_extensions_count;
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &available_extensions_count, nullptr);
+    std::vector<VkExtensionProperties> available_extensions(available_extensions_count);
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &available_extensions_count, available_extensions.data());
+    for (const auto& available_extension : available_extensions)
+    {
+        if (strcmp(available_extension.extensionName, extension_name) == 0)
+            return true;
+    }
+    return false;
+}
+
 void app::graphics::Device::Destroy()
 {
     if (VK_NULL_HANDLE != m_logical_device)
@@ -317,13 +334,200 @@ utils::VResult app::graphics::Device::createLogicalDevice()
     // to VK_FALSE for the moment
     VkPhysicalDeviceFeatures device_features{};
 
+    // Vulkan 1.1 features: multiview renders the shadow cascades in a single pass.
+    // It is mandatory since Vulkan 1.1, the check only catches broken drivers.
+    // Vulkan 1.2 features: the meshlet draws are compacted on the GPU, and drawn with
+    // an indirect count if supported. The vertex pulling reads the meshes through
+    // their buffer device address.
+    // Vulkan 1.3 features: the submissions are batched with vkQueueSubmit2 (synchronization2
+    // is mandatory since Vulkan 1.3, the check only catches broken drivers)
+    VkPhysicalDeviceVulkan13Features supported_features_13{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+    };
+    VkPhysicalDeviceVulkan12Features supported_features_12{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .pNext = &supported_features_13,
+    };
+    VkPhysicalDeviceVulkan11Features supported_features_11{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+        .pNext = &supported_features_12,
+    };
+    VkPhysicalDeviceFeatures2 supported_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &supported_features_11,
+    };
+    // Optional: conditional rendering skips the draws of the occluded objects on the GPU,
+    // without reading the occlusion queries back
+    std::vector<const char*> enabled_extensions = REQUIRED_EXTENSIONS;
+    void** supported_features_tail = &supported_features_13.pNext;
+    const bool has_conditional_rendering = Project::OCCLUSION_CONDITIONAL_RENDERING && isExtensionSupported(m_physical_device, VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+    VkPhysicalDeviceConditionalRenderingFeaturesEXT supported_conditional_rendering{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT,
+    };
+    if (has_conditional_rendering)
+    {
+        *supported_features_tail = &supported_conditional_rendering;
+        supported_features_tail = &supported_conditional_rendering.pNext;
+    }
+    // Optional: mesh shaders cull and draw the meshlets without a compute pass (not in
+    // the headers of the pinned SDK: compiled out with them)
+#ifdef VK_EXT_mesh_shader
+    const bool has_mesh_shader = Project::MESHLET_MESH_SHADERS && isExtensionSupported(m_physical_device, VK_EXT_MESH_SHADER_EXTENSION_NAME);
+    VkPhysicalDeviceMeshShaderFeaturesEXT supported_mesh_shader{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+    };
+    if (has_mesh_shader)
+    {
+        *supported_features_tail = &supported_mesh_shader;
+        supported_features_tail = &supported_mesh_shader.pNext;
+    }
+#endif
+    // Optional: descriptor buffers write the descriptors of the compute passes directly in
+    // host-visible memory, rather than updating sets allocated from the descriptor pool (not
+    // in the headers of the pinned SDK: compiled out with them)
+#ifdef VK_EXT_descriptor_buffer
+    const bool has_descriptor_buffer = Project::DESCRIPTOR_BUFFERS && isExtensionSupported(m_physical_device, VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT supported_descriptor_buffer{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+    };
+    if (has_descriptor_buffer)
+    {
+        *supported_features_tail = &supported_descriptor_buffer;
+        supported_features_tail = &supported_descriptor_buffer.pNext;
+    }
+#endif
+    // Optional: graphics pipeline libraries link the new pipeline variants from precompiled
+    // parts, without a full compilation on the render thread (not in the headers of the
+    // pinned SDK: compiled out with them)
+#ifdef VK_EXT_graphics_pipeline_library
+    const bool has_pipeline_library = Project::GRAPHICS_PIPELINE_LIBRARY &&
+                                      isExtensionSupported(m_physical_device, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+                                      isExtensionSupported(m_physical_device, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supported_pipeline_library{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+    };
+    if (has_pipeline_library)
+    {
+        *supported_features_tail = &supported_pipeline_library;
+        supported_features_tail = &supported_pipeline_library.pNext;
+    }
+#endif
+    vkGetPhysicalDeviceFeatures2(m_physical_device, &supported_features);
+    if (!supported_features_11.multiview)
+        return utils::VResult::Error((char*)"the physical device does not support multiview");
+    if (!supported_features_13.synchronization2)
+        return utils::VResult::Error((char*)"the physical device does not support synchronization2");
+    m_draw_indirect_count = VK_TRUE == supported_features_12.drawIndirectCount;
+    Log("> Draw indirect count supported? %s", m_draw_indirect_count ? "true!" : "false...");
+    m_multi_draw_indirect = VK_TRUE == supported_features.features.multiDrawIndirect;
+    device_features.multiDrawIndirect = m_multi_draw_indirect ? VK_TRUE : VK_FALSE;
+    Log("> Multi draw indirect supported? %s", m_multi_draw_indirect ? "true!" : "false...");
+    m_buffer_device_address = VK_TRUE == supported_features_12.bufferDeviceAddress;
+    Log("> Buffer device address supported? %s", m_buffer_device_address ? "true!" : "false...");
+
+    void* device_features_chain = nullptr;
+    VkPhysicalDeviceConditionalRenderingFeaturesEXT device_conditional_rendering{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT,
+        .conditionalRendering = VK_TRUE,
+    };
+    m_conditional_rendering = has_conditional_rendering && supported_conditional_rendering.conditionalRendering;
+    if (m_conditional_rendering)
+    {
+        enabled_extensions.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+        device_conditional_rendering.pNext = device_features_chain;
+        device_features_chain = &device_conditional_rendering;
+    }
+    Log("> Conditional rendering supported? %s", m_conditional_rendering ? "true!" : "false...");
+#ifdef VK_EXT_mesh_shader
+    VkPhysicalDeviceMeshShaderFeaturesEXT device_mesh_shader{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+        .taskShader = VK_TRUE,
+        .meshShader = VK_TRUE,
+    };
+    m_mesh_shader = has_mesh_shader && supported_mesh_shader.taskShader && supported_mesh_shader.meshShader;
+    if (m_mesh_shader)
+    {
+        enabled_extensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+        device_mesh_shader.pNext = device_features_chain;
+        device_features_chain = &device_mesh_shader;
+    }
+#endif
+    Log("> Mesh shaders supported? %s", m_mesh_shader ? "true!" : "false...");
+#ifdef VK_EXT_descriptor_buffer
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT device_descriptor_buffer{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+        .descriptorBuffer = VK_TRUE,
+    };
+    // The descriptors of the buffers and the descriptor buffers themselves are addressed
+    // by their device address
+    m_descriptor_buffer = has_descriptor_buffer && supported_descriptor_buffer.descriptorBuffer && m_buffer_device_address;
+    if (m_descriptor_buffer)
+    {
+        enabled_extensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+        device_descriptor_buffer.pNext = device_features_chain;
+        device_features_chain = &device_descriptor_buffer;
+        m_descriptor_buffer_properties = VkPhysicalDeviceDescriptorBufferPropertiesEXT{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT,
+        };
+        VkPhysicalDeviceProperties2 properties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &m_descriptor_buffer_properties,
+        };
+        vkGetPhysicalDeviceProperties2(m_physical_device, &properties);
+    }
+#endif
+    Log("> Descriptor buffers supported? %s", m_descriptor_buffer ? "true!" : "false...");
+#ifdef VK_EXT_graphics_pipeline_library
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT device_pipeline_library{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+        .graphicsPipelineLibrary = VK_TRUE,
+    };
+    m_pipeline_library = has_pipeline_library && supported_pipeline_library.graphicsPipelineLibrary;
+    if (m_pipeline_library)
+    {
+        enabled_extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        enabled_extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        device_pipeline_library.pNext = device_features_chain;
+        device_features_chain = &device_pipeline_library;
+        VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT pipeline_library_properties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT,
+        };
+        VkPhysicalDeviceProperties2 properties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &pipeline_library_properties,
+        };
+        vkGetPhysicalDeviceProperties2(m_physical_device, &properties);
+        m_pipeline_library_fast_linking = VK_TRUE == pipeline_library_properties.graphicsPipelineLibraryFastLinking;
+    }
+#endif
+    Log("> Graphics pipeline libraries supported? %s (fast linking? %s)",
+        m_pipeline_library ? "true!" : "false...",
+        m_pipeline_library_fast_linking ? "true!" : "false...");
+    VkPhysicalDeviceVulkan13Features device_features_13{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .pNext = device_features_chain,
+        .synchronization2 = VK_TRUE,
+    };
+    VkPhysicalDeviceVulkan12Features device_features_12{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .pNext = &device_features_13,
+        .drawIndirectCount = m_draw_indirect_count ? VK_TRUE : VK_FALSE,
+        .bufferDeviceAddress = m_buffer_device_address ? VK_TRUE : VK_FALSE,
+    };
+    VkPhysicalDeviceVulkan11Features device_features_11{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+        .pNext = &device_features_12,
+        .multiview = VK_TRUE,
+    };
+
     // Initializes the logical device
     VkDeviceCreateInfo logical_device_create_info{
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &device_features_11,
         .queueCreateInfoCount = static_cast<uint32_t>(queues.size()),
         .pQueueCreateInfos = queues.data(),
-        .enabledExtensionCount = static_cast<uint32_t>(REQUIRED_EXTENSIONS.size()),
-        .ppEnabledExtensionNames = REQUIRED_EXTENSIONS.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size()),
+        .ppEnabledExtensionNames = enabled_extensions.data(),
         .pEnabledFeatures = &device_features,
     };
     if (const auto result_status = vkCreateDevice(m_physical_device, &logical_device_create_info, nullptr, &m_logical_device); result_status != VK_SUCCESS)
@@ -401,3 +605,112 @@ VkQueue& app::graphics::Device::getTransfertQueue()
 {
     return m_transfert_queue;
 }
+
+utils::Result<VkFormat> app::graphics::Device::findDepthFormat() const
+{
+    for (const VkFormat format : app::graphics::Depth::FORMAT_CANDIDATES)
+    {
+        // The deferred lighting subpass reads the depth as an input attachment, through
+        // a view that can only have the depth aspect
+        if (Project::DEFERRED_SHADING && app::graphics::Depth::hasStencil(format))
+            continue;
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(m_physical_device, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+        {
+            Log("> Using depth format with id %d", format);
+            return utils::Result<VkFormat>::Ok(format);
+        }
+    }
+    return utils::Result<VkFormat>::Error((char*)"did not found any supported depth format");
+}
+
+utils::Result<VkFormat> app::graphics::Device::findHdrFormat() const
+{
+    // 32 bits per pixel first (no alpha, no sign), then the format every device supports
+    const VkFormat candidates[] = {
+        VK_FORMAT_B10G11R11_UFLOAT_PACK32,
+        VK_FORMAT_R16G16B16A16_SFLOAT,
+    };
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    for (const VkFormat format : candidates)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(m_physical_device, format, &properties);
+        if ((properties.optimalTilingFeatures & features) == features)
+        {
+            Log("> Using HDR format with id %d", format);
+            return utils::Result<VkFormat>::Ok(format);
+        }
+    }
+    return utils::Result<VkFormat>::Error((char*)"did not found any supported HDR format");
+}
+
+bool app::graphics::Device::supportsConditionalRendering() const noexcept
+{
+    return m_conditional_rendering;
+}
+
+bool app::graphics::Device::supportsMeshShaders() const noexcept
+{
+    return m_mesh_shader;
+}
+
+bool app::graphics::Device::supportsDrawIndirectCount() const noexcept
+{
+    return m_draw_indirect_count;
+}
+
+bool app::graphics::Device::supportsMultiDrawIndirect() const noexcept
+{
+    return m_multi_draw_indirect;
+}
+
+bool app::graphics::Device::supportsBufferDeviceAddress() const noexcept
+{
+    return m_buffer_device_address;
+}
+
+bool app::graphics::Device::supportsDescriptorBuffers() const noexcept
+{
+    return m_descriptor_buffer;
+}
+
+#ifdef VK_EXT_descriptor_buffer
+const VkPhysicalDeviceDescriptorBufferPropertiesEXT& app::graphics::Device::getDescriptorBufferProperties() const noexcept
+{
+    return m_descriptor_buffer_properties;
+}
+#endif
+
+bool app::graphics::Device::supportsGraphicsPipelineLibrary() const noexcept
+{
+    return m_pipeline_library;
+}
+
+bool app::graphics::Device::supportsFastLinking() const noexcept
+{
+    return m_pipeline_library_fast_linking;
+}
+
+VkSampleCountFlagBits app::graphics::Device::getUsableSampleCount() const
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_physical_device, &properties);
+    const VkSampleCountFlags supported_counts = properties.limits.framebufferColorSampleCounts &
+                                                properties.limits.framebufferDepthSampleCounts;
+    const VkSampleCountFlagBits candidates[] = {
+        VK_SAMPLE_COUNT_8_BIT,
+        VK_SAMPLE_COUNT_4_BIT,
+        VK_SAMPLE_COUNT_2_BIT,
+    };
+    for (const VkSampleCountFlagBits candidate : candidates)
+    {
+        if (candidate <= Project::MSAA_SAMPLES && (supported_counts & candidate))
+        {
+            Log("> Using %d samples per pixel (%d requested)", candidate, Project::MSAA_SAMPLES);
+            return candidate;
+        }
+    }
+    return VK_SAMPLE_COUNT_1_BIT;
+}
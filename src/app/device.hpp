@@ -81,6 +81,47 @@ namespace app
             /// @brief Returns the Transfert queue of the logical device
             /// @return The Transfert queue of the logical device
             VkQueue& getTransfertQueue();
+            /// @brief Returns the best depth format supported by the physical device,
+            /// as an optimal-tiling depth / stencil attachment
+            /// @return The depth format, or an error if no candidate is supported
+            utils::Result<VkFormat> findDepthFormat() const;
+            /// @brief Returns the most compact HDR color format supported by the physical
+            /// device as a blendable color attachment, sampled with linear filtering
+            /// @return The HDR format, or an error if no candidate is supported
+            utils::Result<VkFormat> findHdrFormat() const;
+            /// @brief Returns the number of samples to use for the color and depth
+            /// attachments: MSAA_SAMPLES, clamped to the maximum sample count
+            /// supported by both of the color and depth framebuffers
+            VkSampleCountFlagBits getUsableSampleCount() const;
+            /// @brief Returns if VK_EXT_conditional_rendering has been enabled on the logical
+            /// device (OCCLUSION_CONDITIONAL_RENDERING set, and supported by the physical device)
+            bool supportsConditionalRendering() const noexcept;
+            /// @brief Returns if VK_EXT_mesh_shader (task and mesh shaders) has been enabled on
+            /// the logical device (MESHLET_MESH_SHADERS set, and supported by the physical device)
+            bool supportsMeshShaders() const noexcept;
+            /// @brief Returns if the indirect draws can read their count from a buffer
+            /// (drawIndirectCount, Vulkan 1.2)
+            bool supportsDrawIndirectCount() const noexcept;
+            /// @brief Returns if an indirect draw call can read several draws (multiDrawIndirect)
+            bool supportsMultiDrawIndirect() const noexcept;
+            /// @brief Returns if the shaders can read buffers through their device address
+            /// (bufferDeviceAddress, Vulkan 1.2)
+            bool supportsBufferDeviceAddress() const noexcept;
+            /// @brief Returns if VK_EXT_descriptor_buffer has been enabled on the logical device
+            /// (DESCRIPTOR_BUFFERS set, and supported by the physical device with buffer
+            /// device addresses)
+            bool supportsDescriptorBuffers() const noexcept;
+#ifdef VK_EXT_descriptor_buffer
+            /// @brief Returns the sizes and the alignments of the descriptors in a descriptor
+            /// buffer (only filled if the descriptor buffers are supported)
+            const VkPhysicalDeviceDescriptorBufferPropertiesEXT& getDescriptorBufferProperties() const noexcept;
+#endif
+            /// @brief Returns if VK_EXT_graphics_pipeline_library has been enabled on the logical
+            /// device (GRAPHICS_PIPELINE_LIBRARY set, and supported by the physical device)
+            bool supportsGraphicsPipelineLibrary() const noexcept;
+            /// @brief Returns if linking pipeline libraries without link-time optimization is
+            /// fast enough to be done on the render thread (graphicsPipelineLibraryFastLinking)
+            bool supportsFastLinking() const noexcept;
 
         private:
             /// @brief The physical device that has been picked
@@ -102,6 +143,26 @@ namespace app
             /// The transfert queue can be the same queue than
             /// the presents / graphics one
             VkQueue m_transfert_queue = VK_NULL_HANDLE;
+            /// @brief If VK_EXT_conditional_rendering is enabled
+            bool m_conditional_rendering = false;
+            /// @brief If VK_EXT_mesh_shader is enabled
+            bool m_mesh_shader = false;
+            /// @brief If drawIndirectCount is enabled
+            bool m_draw_indirect_count = false;
+            /// @brief If multiDrawIndirect is enabled
+            bool m_multi_draw_indirect = false;
+            /// @brief If bufferDeviceAddress is enabled
+            bool m_buffer_device_address = false;
+            /// @brief If VK_EXT_descriptor_buffer is enabled
+            bool m_descriptor_buffer = false;
+#ifdef VK_EXT_descriptor_buffer
+            /// @brief The properties of the descriptor buffers of the physical device
+            VkPhysicalDeviceDescriptorBufferPropertiesEXT m_descriptor_buffer_properties{};
+#endif
+            /// @brief If VK_EXT_graphics_pipeline_library is enabled
+            bool m_pipeline_library = false;
+            /// @brief If the pipeline libraries are linked fast without link-time optimization
+            bool m_pipeline_library_fast_linking = false;
         };
     } // namespace graphics
 } // namespace app
@@ -0,0 +1,95 @@
+//
+//  dynamic_resolution.cpp
+//
+
+#include "dynamic_resolution.hpp"
+#include "../utils/debug_tools.h"
+#include <algorithm>
+#include <cmath>
+
+/// @brief Weight of the last frame in the smoothed GPU frame time
+constexpr double FRAME_TIME_SMOOTHING = 0.1;
+
+/// @brief Above this ratio of the budget, the frame is over budget
+constexpr double OVER_BUDGET_RATIO = 1.0;
+
+/// @brief Below this ratio of the budget, there is room to increase the scale
+constexpr double UNDER_BUDGET_RATIO = 0.85;
+
+/// @brief Number of consecutive frames over budget before decreasing the scale.
+/// Kept low: missing the budget is what we want to avoid
+constexpr uint32_t FRAMES_BEFORE_DECREASE = 3;
+
+/// @brief Number of consecutive frames under budget before increasing the scale.
+/// Kept high, to not oscillate between two scales
+constexpr uint32_t FRAMES_BEFORE_INCREASE = 30;
+
+/// @brief Maximal change of the scale for a single update
+constexpr float MAX_SCALE_STEP = 0.1f;
+
+app::graphics::DynamicResolution::DynamicResolution(const float min_scale, const float max_scale, const double budget_ms)
+{
+    m_min_scale = min_scale;
+    m_max_scale = max_scale;
+    m_budget_ms = budget_ms;
+    m_scale = max_scale;
+}
+
+void app::graphics::DynamicResolution::update(const double gpu_frame_ms)
+{
+    if (gpu_frame_ms <= 0.0)
+        return;
+    m_frame_ms = m_frame_ms <= 0.0 ? gpu_frame_ms : (1.0 - FRAME_TIME_SMOOTHING) * m_frame_ms + FRAME_TIME_SMOOTHING * gpu_frame_ms;
+
+    if (m_frame_ms > m_budget_ms * OVER_BUDGET_RATIO)
+    {
+        m_frames_under_budget = 0;
+        ++m_frames_over_budget;
+    }
+    else if (m_frame_ms < m_budget_ms * UNDER_BUDGET_RATIO)
+    {
+        m_frames_over_budget = 0;
+        ++m_frames_under_budget;
+    }
+    else
+    {
+        // In the hysteresis band: keep the current scale
+        m_frames_over_budget = 0;
+        m_frames_under_budget = 0;
+        return;
+    }
+
+    if (m_frames_over_budget < FRAMES_BEFORE_DECREASE && m_frames_under_budget < FRAMES_BEFORE_INCREASE)
+        return;
+
+    // The pixel cost grows with the square of the scale: aim at the scale that
+    // would fit exactly in the budget
+    const float ideal_scale = m_scale * static_cast<float>(std::sqrt(m_budget_ms / m_frame_ms));
+    const float new_scale = std::clamp(
+        std::clamp(ideal_scale, m_scale - MAX_SCALE_STEP, m_scale + MAX_SCALE_STEP),
+        m_min_scale,
+        m_max_scale);
+    if (new_scale != m_scale)
+        Log("> Dynamic resolution: scale from %.2f to %.2f (GPU frame time of %.2fms)", m_scale, new_scale, m_frame_ms);
+    m_scale = new_scale;
+    m_frames_over_budget = 0;
+    m_frames_under_budget = 0;
+}
+
+float app::graphics::DynamicResolution::getScale() const noexcept
+{
+    return m_scale;
+}
+
+double app::graphics::DynamicResolution::getFrameTime() const noexcept
+{
+    return m_frame_ms;
+}
+
+VkExtent2D app::graphics::DynamicResolution::getRenderExtent(const VkExtent2D& full_extent) const noexcept
+{
+    return VkExtent2D{
+        std::clamp(static_cast<uint32_t>(static_cast<float>(full_extent.width) * m_scale), 1u, full_extent.width),
+        std::clamp(static_cast<uint32_t>(static_cast<float>(full_extent.height) * m_scale), 1u, full_extent.height),
+    };
+}
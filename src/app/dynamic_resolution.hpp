@@ -0,0 +1,61 @@
+//
+//  dynamic_resolution.hpp
+//
+
+#pragma once
+#ifndef dynamic_resolution_h
+#define dynamic_resolution_h
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Controls the resolution of the scene, in order to keep
+        /// the GPU frame time under a budget.
+        /// The scale applies to each axis of the swapchain extent: the pixel cost
+        /// of the scene is expected to grow with the square of the scale.
+        class DynamicResolution
+        {
+        public:
+            /// @brief Public constructor
+            /// @param min_scale The minimal scale, for each axis (in ]0, 1])
+            /// @param max_scale The maximal scale, for each axis (in ]0, 1])
+            /// @param budget_ms The GPU frame time budget, in ms
+            DynamicResolution(const float min_scale, const float max_scale, const double budget_ms);
+            /// @brief Feeds the controller with the GPU time of the last frame,
+            /// and updates the scale if the budget has been missed (or is largely
+            /// respected) for several frames in a row
+            /// @param gpu_frame_ms The GPU time of the last frame, in ms
+            void update(const double gpu_frame_ms);
+            /// @brief Returns the current scale, for each axis
+            float getScale() const noexcept;
+            /// @brief Returns the smoothed GPU frame time, in ms
+            double getFrameTime() const noexcept;
+            /// @brief Returns the extent to render the scene at
+            /// @param full_extent The extent of the final image (the swapchain extent)
+            /// @return The scaled extent, never bigger than `full_extent`
+            VkExtent2D getRenderExtent(const VkExtent2D& full_extent) const noexcept;
+
+        private:
+            /// @brief The minimal scale
+            float m_min_scale;
+            /// @brief The maximal scale
+            float m_max_scale;
+            /// @brief The GPU frame time budget, in ms
+            double m_budget_ms;
+            /// @brief The current scale
+            float m_scale;
+            /// @brief The smoothed GPU frame time, in ms
+            double m_frame_ms = 0.0;
+            /// @brief The number of consecutive frames over the budget
+            uint32_t m_frames_over_budget = 0;
+            /// @brief The number of consecutive frames largely under the budget
+            uint32_t m_frames_under_budget = 0;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // dynamic_resolution_h
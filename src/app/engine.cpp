@@ -73,6 +73,8 @@ app::Engine::~Engine()
     Log("< Closing the Engine object...");
     m_swapchain = nullptr;
     m_render = nullptr;
+    m_resources = nullptr;
+    m_sync_pool = nullptr;
     if (m_descriptor_pool)
         vkDestroyDescriptorPool(m_graphics_device.getLogicalDevice(), m_descriptor_pool, nullptr);
     if (VK_NULL_HANDLE != m_allocator)
@@ -118,6 +120,13 @@ void app::Engine::initialize()
         m_state = State::ERROR;
         return;
     }
+    if (const auto result = m_render->createSubmitBatchers(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    m_resources = std::unique_ptr<app::graphics::Resources>(new app::graphics::Resources());
+    m_sync_pool = std::unique_ptr<app::graphics::SyncPool>(new app::graphics::SyncPool());
     if (const auto result = createDescriptorPool(); result.IsError())
     {
         m_state = State::ERROR;
@@ -133,16 +142,116 @@ void app::Engine::initialize()
         m_state = State::ERROR;
         return;
     }
+    if (const auto result = m_render->createDescriptorBuffer(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createSceneResources(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createColorResources(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createDepthResources(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createGBufferResources(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createShadowAtlas(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createCascadedShadows(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createClusteredLighting(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createSkinning(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createAnimation(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createLevelsOfDetail(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
     if (const auto result = m_render->createGraphicsPipeline(); result.IsError())
     {
         m_state = State::ERROR;
         return;
     }
+    if (const auto result = m_render->createPipelineLibrary(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createOcclusionQueries(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createMeshletCulling(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createVertexPulling(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createSpriteBatcher(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createDebugDraw(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
     if (const auto result = m_render->createFramebuffers(); result.IsError())
     {
         m_state = State::ERROR;
         return;
     }
+    if (const auto result = m_render->createGpuTimer(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createTemporalUpscaler(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
+    if (const auto result = m_render->createPostProcessing(); result.IsError())
+    {
+        m_state = State::ERROR;
+        return;
+    }
     assert(m_graphics_device.isInitialized());
     m_state = State::INITIALIZED;
 }
@@ -177,6 +286,10 @@ utils::VResult app::Engine::createAllocator()
     allocator_create_info.physicalDevice = m_graphics_device.getPhysicalDevice();
     allocator_create_info.device = m_graphics_device.getLogicalDevice();
     allocator_create_info.instance = m_graphics_instance;
+    // The buffers created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT need memory
+    // allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
+    if (m_graphics_device.supportsBufferDeviceAddress())
+        allocator_create_info.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
     if (const auto result = vmaCreateAllocator(&allocator_create_info, &m_allocator); result == VK_SUCCESS)
         return utils::VResult::Ok();
     return utils::VResult::Error((char*)"Failed to initialize the internal allocator");
@@ -12,7 +12,9 @@
 #include "device.hpp"
 #include "pipeline.hpp"
 #include "render.hpp"
+#include "resources.hpp"
 #include "swapchain.hpp"
+#include "sync_pool.hpp"
 #include <cstdlib>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
@@ -83,6 +85,10 @@ namespace app
         VkInstance m_graphics_instance = VK_NULL_HANDLE;
         /// @brief The physical device
         app::graphics::Device m_graphics_device = app::graphics::Device();
+        /// @brief The buffers and images behind handles, destroyed after the renderer
+        std::unique_ptr<app::graphics::Resources> m_resources;
+        /// @brief The recycled fences and semaphores, destroyed after the renderer
+        std::unique_ptr<app::graphics::SyncPool> m_sync_pool;
         /// @brief The renderer of the engine
         std::unique_ptr<app::graphics::Render> m_render;
         /// @brief The swapchain of the engine
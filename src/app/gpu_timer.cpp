@@ -0,0 +1,128 @@
+//
+//  gpu_timer.cpp
+//
+
+#include "gpu_timer.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include <cstring>
+
+app::graphics::GpuTimer::GpuTimer(){};
+
+app::graphics::GpuTimer::~GpuTimer()
+{
+    if (VK_NULL_HANDLE != m_query_pool)
+    {
+        vkDestroyQueryPool(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), m_query_pool, nullptr);
+        m_query_pool = VK_NULL_HANDLE;
+    }
+    m_scope_names.clear();
+    m_timings.clear();
+};
+
+utils::VResult app::graphics::GpuTimer::create(const uint32_t max_scopes)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(app::Engine::getInstance()->m_graphics_device.getPhysicalDevice(), &properties);
+    if (!properties.limits.timestampComputeAndGraphics)
+    {
+        LogW("> Timestamps are not supported on the graphics queue: the GPU timings are disabled");
+        return utils::VResult::Ok();
+    }
+    m_timestamp_period = static_cast<double>(properties.limits.timestampPeriod);
+    m_max_scopes = max_scopes;
+
+    VkQueryPoolCreateInfo query_pool_create_info{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2 * m_max_scopes,
+    };
+    if (const auto result = vkCreateQueryPool(
+            app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+            &query_pool_create_info,
+            nullptr,
+            &m_query_pool);
+        result != VK_SUCCESS)
+    {
+        return utils::VResult::Error((char*)"Cannot create the timestamp query pool");
+    }
+    m_scope_names.reserve(m_max_scopes);
+    m_timings.reserve(m_max_scopes);
+    return utils::VResult::Ok();
+}
+
+bool app::graphics::GpuTimer::isSupported() const noexcept
+{
+    return VK_NULL_HANDLE != m_query_pool;
+}
+
+void app::graphics::GpuTimer::collect()
+{
+    if (!isSupported() || m_scope_names.empty())
+        return;
+    const uint32_t nb_queries = 2 * static_cast<uint32_t>(m_scope_names.size());
+    std::vector<uint64_t> timestamps(nb_queries);
+    const auto result = vkGetQueryPoolResults(
+        app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+        m_query_pool,
+        0,
+        nb_queries,
+        timestamps.size() * sizeof(uint64_t),
+        timestamps.data(),
+        sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT);
+    // VK_NOT_READY: keep the previous timings instead of waiting for the GPU
+    if (result != VK_SUCCESS)
+        return;
+    m_timings.clear();
+    for (size_t i = 0; i < m_scope_names.size(); ++i)
+    {
+        const uint64_t begin_ticks = timestamps[2 * i];
+        const uint64_t end_ticks = timestamps[2 * i + 1];
+        const double ms = end_ticks > begin_ticks ? static_cast<double>(end_ticks - begin_ticks) * m_timestamp_period / 1e6 : 0.0;
+        m_timings.push_back(Timing{
+            .m_name = m_scope_names[i],
+            .m_ms = ms,
+        });
+    }
+}
+
+void app::graphics::GpuTimer::reset(VkCommandBuffer command_buffer)
+{
+    m_scope_names.clear();
+    if (!isSupported())
+        return;
+    vkCmdResetQueryPool(command_buffer, m_query_pool, 0, 2 * m_max_scopes);
+}
+
+uint32_t app::graphics::GpuTimer::begin(VkCommandBuffer command_buffer, const char* name)
+{
+    const uint32_t scope_id = static_cast<uint32_t>(m_scope_names.size());
+    if (!isSupported() || scope_id >= m_max_scopes)
+        return UINT32_MAX;
+    m_scope_names.push_back(name);
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_query_pool, 2 * scope_id);
+    return scope_id;
+}
+
+void app::graphics::GpuTimer::end(VkCommandBuffer command_buffer, const uint32_t scope_id)
+{
+    if (!isSupported() || scope_id >= m_scope_names.size())
+        return;
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_query_pool, 2 * scope_id + 1);
+}
+
+std::optional<double> app::graphics::GpuTimer::getTiming(const char* name) const
+{
+    for (const auto& timing : m_timings)
+    {
+        if (strcmp(timing.m_name, name) == 0)
+            return timing.m_ms;
+    }
+    return std::nullopt;
+}
+
+const std::vector<app::graphics::GpuTimer::Timing>& app::graphics::GpuTimer::getTimings() const noexcept
+{
+    return m_timings;
+}
@@ -0,0 +1,86 @@
+//
+//  gpu_timer.hpp
+//
+
+#pragma once
+#ifndef gpu_timer_h
+#define gpu_timer_h
+
+#include "../utils/result.h"
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Measures the GPU time spent in scopes of a command buffer, using
+        /// timestamp queries.
+        /// The results of a recording are read back when the next recording starts,
+        /// once the fence of the previous frame has been waited: this never stalls
+        /// the CPU.
+        class GpuTimer
+        {
+        public:
+            /// @brief The GPU time spent in a scope
+            struct Timing
+            {
+                /// @brief The name of the scope
+                const char* m_name;
+                /// @brief The GPU time spent in the scope, in ms
+                double m_ms;
+            };
+            /// @brief Public constructor
+            GpuTimer();
+            /// @brief Public destructor
+            ~GpuTimer();
+            /// @brief Creates the timestamp query pool
+            /// @param max_scopes The maximum number of scopes per recording
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t max_scopes);
+            /// @brief Returns if the graphics queue supports timestamps
+            bool isSupported() const noexcept;
+            /// @brief Reads back the timings of the previous recording, if available.
+            /// Should be called before `reset`.
+            void collect();
+            /// @brief Resets the queries, and forgets the scopes of the previous recording.
+            /// Should be recorded outside of any render pass.
+            /// @param command_buffer The command buffer being recorded
+            void reset(VkCommandBuffer command_buffer);
+            /// @brief Writes the timestamp that starts a scope
+            /// @param command_buffer The command buffer being recorded
+            /// @param name The name of the scope - should be a static string
+            /// @return The identifier of the scope, to pass to `end`
+            uint32_t begin(VkCommandBuffer command_buffer, const char* name);
+            /// @brief Writes the timestamp that ends a scope
+            /// @param command_buffer The command buffer being recorded
+            /// @param scope_id The identifier returned by `begin`
+            void end(VkCommandBuffer command_buffer, const uint32_t scope_id);
+            /// @brief Returns the timing of a scope, from the last collected recording
+            /// @param name The name of the scope
+            /// @return The GPU time spent in the scope, in ms, or `nullopt` if unknown
+            std::optional<double> getTiming(const char* name) const;
+            /// @brief Returns all the timings of the last collected recording
+            const std::vector<Timing>& getTimings() const noexcept;
+
+        private:
+            /// @brief GpuTimer should not be cloneable
+            GpuTimer(GpuTimer& other) = delete;
+            /// @brief GpuTimer should not be assignable
+            void operator=(const GpuTimer& other) = delete;
+            /// @brief The query pool: two timestamps per scope
+            VkQueryPool m_query_pool = VK_NULL_HANDLE;
+            /// @brief The maximum number of scopes per recording
+            uint32_t m_max_scopes = 0;
+            /// @brief The number of nanoseconds per timestamp tick
+            double m_timestamp_period = 0.0;
+            /// @brief The names of the scopes that are being recorded
+            std::vector<const char*> m_scope_names;
+            /// @brief The timings of the last collected recording
+            std::vector<Timing> m_timings;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // gpu_timer_h
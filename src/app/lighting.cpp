@@ -0,0 +1,208 @@
+//
+//  lighting.cpp
+//
+
+#include "lighting.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include <algorithm>
+
+/// @brief Local size of the binning compute shader: one invocation per cluster
+constexpr uint32_t GROUP_SIZE = 64;
+
+app::graphics::ClusteredLighting::ClusteredLighting(){};
+
+app::graphics::ClusteredLighting::~ClusteredLighting()
+{
+    m_pass = nullptr;
+    m_shadow_atlas = nullptr;
+    m_params_buffer = nullptr;
+    m_lights_buffer = nullptr;
+    m_grid_buffer = nullptr;
+    m_indices_buffer = nullptr;
+    m_counter_buffer = nullptr;
+    m_lights.clear();
+    m_gpu_lights.clear();
+};
+
+utils::VResult app::graphics::ClusteredLighting::create(
+    const uint32_t max_lights,
+    std::shared_ptr<app::graphics::ShadowAtlas> shadow_atlas,
+    std::shared_ptr<app::graphics::CascadedShadowMaps> cascaded_shadows)
+{
+    Log("> Creating the clustered lighting (%dx%dx%d clusters, up to %d lights)", GRID_SIZE_X, GRID_SIZE_Y, GRID_SIZE_Z, max_lights);
+    m_max_lights = max_lights;
+    m_shadow_atlas = shadow_atlas;
+    m_gpu_lights.reserve(m_max_lights);
+
+    m_params_buffer = std::make_shared<app::graphics::Buffer>();
+    m_lights_buffer = std::make_shared<app::graphics::Buffer>();
+    m_grid_buffer = std::make_shared<app::graphics::Buffer>();
+    m_indices_buffer = std::make_shared<app::graphics::Buffer>();
+    m_counter_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_params_buffer->create(sizeof(ClusterParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, true); result.IsError())
+        return result;
+    // Never empty, even without lights
+    if (const auto result = m_lights_buffer->create(std::max(m_max_lights, 1u) * sizeof(GpuLight), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    if (const auto result = m_grid_buffer->create(CLUSTER_COUNT * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false); result.IsError())
+        return result;
+    if (const auto result = m_indices_buffer->create(CLUSTER_COUNT * AVERAGE_LIGHTS_PER_CLUSTER * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false); result.IsError())
+        return result;
+    if (const auto result = m_counter_buffer->create(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false); result.IsError())
+        return result;
+
+    // The same set is bound by the binning pass and by the fragment shaders
+    constexpr VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, stages, nullptr}, // Cluster parameters
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr}, // Lights
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr}, // Light grid
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr}, // Light indices
+        {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Index counter
+        {5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // Shadow atlas
+        {6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // Shadow views
+        {7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // Shadow cascades
+        {8, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // Directional light
+    };
+    m_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_pass->create("shaders/cluster_lights.comp.spv", bindings, 0, 1, true); result.IsError())
+    {
+        LogE("Error creating the light binning pass");
+        return result;
+    }
+    m_pass->writeBuffer(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_params_buffer->getBuffer());
+    m_pass->writeBuffer(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_lights_buffer->getBuffer());
+    m_pass->writeBuffer(0, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_grid_buffer->getBuffer());
+    m_pass->writeBuffer(0, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_indices_buffer->getBuffer());
+    m_pass->writeBuffer(0, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_counter_buffer->getBuffer());
+    m_pass->writeImage(
+        0,
+        5,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        m_shadow_atlas->getAtlas()->getImageView(),
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        m_shadow_atlas->getSampler());
+    m_pass->writeBuffer(0, 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_shadow_atlas->getViewsBuffer()->getBuffer());
+    m_pass->writeImage(
+        0,
+        7,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        cascaded_shadows->getShadowMaps()->getImageView(),
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        cascaded_shadows->getSampler());
+    m_pass->writeBuffer(0, 8, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, cascaded_shadows->getParamsBuffer()->getBuffer());
+    return utils::VResult::Ok();
+}
+
+uint32_t app::graphics::ClusteredLighting::addLight(const Light& light)
+{
+    if (m_lights.size() >= m_max_lights)
+        LogW("> More lights than the maximum of %d: the extra ones are ignored", m_max_lights);
+    m_lights.push_back(light);
+    return static_cast<uint32_t>(m_lights.size() - 1);
+}
+
+app::graphics::Light& app::graphics::ClusteredLighting::getLight(const uint32_t index)
+{
+    assert(index < m_lights.size());
+    return m_lights[index];
+}
+
+uint32_t app::graphics::ClusteredLighting::getLightCount() const noexcept
+{
+    return static_cast<uint32_t>(m_lights.size());
+}
+
+const std::vector<app::graphics::Light>& app::graphics::ClusteredLighting::getLights() const noexcept
+{
+    return m_lights;
+}
+
+void app::graphics::ClusteredLighting::clearLights() noexcept
+{
+    m_lights.clear();
+}
+
+void app::graphics::ClusteredLighting::setAmbient(const glm::vec3& ambient) noexcept
+{
+    m_ambient = ambient;
+}
+
+void app::graphics::ClusteredLighting::record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent)
+{
+    // Lights are moved to view space once on the CPU, instead of once per
+    // cluster and once per fragment on the GPU
+    const glm::mat4& view = camera.getView();
+    const uint32_t light_count = std::min(static_cast<uint32_t>(m_lights.size()), m_max_lights);
+    m_gpu_lights.clear();
+    for (uint32_t i = 0; i < light_count; ++i)
+    {
+        const Light& light = m_lights[i];
+        const glm::vec3 position = glm::vec3(view * glm::vec4(light.m_position, 1.0f));
+        const glm::vec3 direction = glm::normalize(glm::vec3(view * glm::vec4(light.m_direction, 0.0f)));
+        const glm::uvec2 shadow_views = m_shadow_atlas->getLightViews(i);
+        const float first_shadow_view = shadow_views.y > 0 ? static_cast<float>(shadow_views.x) : -1.0f;
+        m_gpu_lights.push_back(GpuLight{
+            .m_position_radius = glm::vec4(position, light.m_radius),
+            .m_color_intensity = glm::vec4(light.m_color, light.m_intensity),
+            .m_direction_cos_outer = glm::vec4(direction, glm::cos(light.m_outer_angle)),
+            .m_cos_inner_type = glm::vec4(glm::cos(light.m_inner_angle), static_cast<float>(light.m_type), first_shadow_view, static_cast<float>(shadow_views.y)),
+        });
+    }
+    if (!m_gpu_lights.empty())
+        m_lights_buffer->write(m_gpu_lights.data(), m_gpu_lights.size() * sizeof(GpuLight));
+
+    const float aspect = static_cast<float>(render_extent.width) / static_cast<float>(render_extent.height);
+    const ClusterParams params{
+        .m_inverse_projection = glm::inverse(camera.getProjection(aspect)),
+        .m_screen = glm::vec4(render_extent.width, render_extent.height, camera.getNear(), camera.getFar()),
+        .m_ambient = glm::vec4(m_ambient, 0.0f),
+        .m_grid = glm::uvec4(GRID_SIZE_X, GRID_SIZE_Y, GRID_SIZE_Z, light_count),
+        .m_limits = glm::uvec4(CLUSTER_COUNT * AVERAGE_LIGHTS_PER_CLUSTER, 0, 0, 0),
+    };
+    m_params_buffer->write(&params, sizeof(ClusterParams));
+
+    vkCmdFillBuffer(command_buffer, m_counter_buffer->getBuffer(), 0, sizeof(uint32_t), 0);
+    // The reset of the counter, and the reads of the lists by the fragment shaders
+    // of the previous frame, happen before the binning
+    VkMemoryBarrier before_binning{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &before_binning,
+        0, nullptr,
+        0, nullptr);
+
+    m_pass->dispatch(command_buffer, 0, nullptr, app::graphics::ComputePass::getGroupCount(CLUSTER_COUNT, GROUP_SIZE), 1);
+
+    VkMemoryBarrier after_binning{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        1, &after_binning,
+        0, nullptr,
+        0, nullptr);
+}
+
+VkDescriptorSetLayout app::graphics::ClusteredLighting::getDescriptorSetLayout() const noexcept
+{
+    return m_pass->getDescriptorSetLayout();
+}
+
+VkDescriptorSet app::graphics::ClusteredLighting::getDescriptorSet() const
+{
+    return m_pass->getDescriptorSet(0);
+}
@@ -0,0 +1,171 @@
+//
+//  lighting.hpp
+//
+
+#pragma once
+#ifndef lighting_h
+#define lighting_h
+
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include "camera.hpp"
+#include "cascaded_shadows.hpp"
+#include "compute.hpp"
+#include "shadow_atlas.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief The kind of a dynamic light
+        enum struct LightType : uint32_t
+        {
+            POINT = 0,
+            SPOT = 1,
+        };
+
+        /// @brief A dynamic light, in world space
+        struct Light
+        {
+            /// @brief The kind of light
+            LightType m_type = LightType::POINT;
+            /// @brief The position of the light
+            glm::vec3 m_position = glm::vec3(0.0f);
+            /// @brief The distance at which the light has no influence anymore
+            float m_radius = 1.0f;
+            /// @brief The color of the light
+            glm::vec3 m_color = glm::vec3(1.0f);
+            /// @brief The intensity of the light
+            float m_intensity = 1.0f;
+            /// @brief The direction of a spot light
+            glm::vec3 m_direction = glm::vec3(0.0f, 0.0f, -1.0f);
+            /// @brief The angle, from the direction, where a spot light starts to fade out, in radians
+            float m_inner_angle = 0.0f;
+            /// @brief The angle, from the direction, where a spot light has no influence anymore, in radians
+            float m_outer_angle = 0.0f;
+            /// @brief If the light gets shadow maps in the shadow atlas
+            bool m_casts_shadows = false;
+        };
+
+        /// @brief Clustered forward lighting: the view frustum is divided in a grid of
+        /// clusters (tiles on screen, exponential slices in depth), and a compute pass
+        /// bins the lights in the clusters they touch.
+        /// The fragment shaders then only loop over the lights of their cluster, read
+        /// from compact index lists.
+        class ClusteredLighting
+        {
+        public:
+            /// @brief Size of the cluster grid on X (screen tiles)
+            static constexpr uint32_t GRID_SIZE_X = 16;
+            /// @brief Size of the cluster grid on Y (screen tiles)
+            static constexpr uint32_t GRID_SIZE_Y = 9;
+            /// @brief Size of the cluster grid on Z (depth slices)
+            static constexpr uint32_t GRID_SIZE_Z = 24;
+            /// @brief Number of clusters
+            static constexpr uint32_t CLUSTER_COUNT = GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z;
+            /// @brief Average number of lights per cluster the index lists are sized for
+            static constexpr uint32_t AVERAGE_LIGHTS_PER_CLUSTER = 64;
+
+            /// @brief Public constructor
+            ClusteredLighting();
+            /// @brief Public destructor
+            ~ClusteredLighting();
+            /// @brief Creates the buffers and the binning compute pass
+            /// @param max_lights The maximum number of lights uploaded each frame
+            /// @param shadow_atlas The shadow maps of the lights, read by the fragment shaders
+            /// @param cascaded_shadows The directional light and its shadows, read by the fragment shaders
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(
+                const uint32_t max_lights,
+                std::shared_ptr<app::graphics::ShadowAtlas> shadow_atlas,
+                std::shared_ptr<app::graphics::CascadedShadowMaps> cascaded_shadows);
+            /// @brief Adds a light
+            /// @return The index of the light, to update it later
+            uint32_t addLight(const Light& light);
+            /// @brief Returns a light, to update it
+            /// @param index The index returned by `addLight`
+            Light& getLight(const uint32_t index);
+            /// @brief Returns the number of lights
+            uint32_t getLightCount() const noexcept;
+            /// @brief Returns the lights, in world space
+            const std::vector<Light>& getLights() const noexcept;
+            /// @brief Removes all the lights
+            void clearLights() noexcept;
+            /// @brief Sets the ambient light, added to every fragment
+            void setAmbient(const glm::vec3& ambient) noexcept;
+            /// @brief Uploads the lights (in view space) and records the binning pass.
+            /// Should be recorded outside of any render pass, before the scene, once
+            /// the shadow atlas has assigned its tiles for the frame.
+            /// @param command_buffer The command buffer being recorded
+            /// @param camera The point of view of the frame
+            /// @param render_extent The extent the scene will be rendered at
+            void record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent);
+            /// @brief Returns the layout of the descriptor set the fragment shaders read
+            /// the lights from
+            VkDescriptorSetLayout getDescriptorSetLayout() const noexcept;
+            /// @brief Returns the descriptor set the fragment shaders read the lights from
+            VkDescriptorSet getDescriptorSet() const;
+
+        private:
+            /// @brief The parameters of the clusters (uniform buffer, std140)
+            struct ClusterParams
+            {
+                /// @brief From clip space to view space
+                glm::mat4 m_inverse_projection;
+                /// @brief Render width, render height, near plane, far plane
+                glm::vec4 m_screen;
+                /// @brief Ambient color (w unused)
+                glm::vec4 m_ambient;
+                /// @brief Grid size on X, Y, Z, and the number of lights
+                glm::uvec4 m_grid;
+                /// @brief Capacity of the light index list (y, z, w unused)
+                glm::uvec4 m_limits;
+            };
+            /// @brief A light, as read by the shaders (std430), in view space
+            struct GpuLight
+            {
+                /// @brief Position, and radius
+                glm::vec4 m_position_radius;
+                /// @brief Color, and intensity
+                glm::vec4 m_color_intensity;
+                /// @brief Direction of a spot light, and cosine of its outer angle
+                glm::vec4 m_direction_cos_outer;
+                /// @brief Cosine of the inner angle of a spot light, type (y), first shadow
+                /// view (z, -1 if none) and number of shadow views (w)
+                glm::vec4 m_cos_inner_type;
+            };
+            /// @brief ClusteredLighting should not be cloneable
+            ClusteredLighting(ClusteredLighting& other) = delete;
+            /// @brief ClusteredLighting should not be assignable
+            void operator=(const ClusteredLighting& other) = delete;
+            /// @brief The lights, in world space
+            std::vector<Light> m_lights;
+            /// @brief The lights of the frame, in view space (staging for the upload)
+            std::vector<GpuLight> m_gpu_lights;
+            /// @brief The maximum number of lights uploaded each frame
+            uint32_t m_max_lights = 0;
+            /// @brief The ambient color
+            glm::vec3 m_ambient = glm::vec3(1.0f);
+            /// @brief The parameters of the clusters (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_params_buffer = nullptr;
+            /// @brief The lights, in view space (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_lights_buffer = nullptr;
+            /// @brief For each cluster, the offset and the number of its lights in the index list
+            std::shared_ptr<app::graphics::Buffer> m_grid_buffer = nullptr;
+            /// @brief The compact light index lists of all the clusters
+            std::shared_ptr<app::graphics::Buffer> m_indices_buffer = nullptr;
+            /// @brief The allocation counter of the index list
+            std::shared_ptr<app::graphics::Buffer> m_counter_buffer = nullptr;
+            /// @brief The shadow maps of the lights
+            std::shared_ptr<app::graphics::ShadowAtlas> m_shadow_atlas = nullptr;
+            /// @brief The binning pass. Its descriptor set is shared with the fragment shaders.
+            std::shared_ptr<app::graphics::ComputePass> m_pass = nullptr;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // lighting_h
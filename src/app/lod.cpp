@@ -0,0 +1,542 @@
+//
+//  lod.cpp
+//
+
+#include "lod.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include <algorithm>
+#include <cmath>
+
+/// @brief A level is kept only if it has less indices than this fraction of the previous one
+constexpr float MIN_LEVEL_REDUCTION = 0.9f;
+
+/// @brief A symmetric 4x4 matrix accumulating the squared distances to planes
+/// (Garland and Heckbert), with the total weight of the planes
+struct Quadric
+{
+    /// @brief xx, xy, xz, xw, yy, yz, yw, zz, zw, ww
+    double m_terms[10] = {};
+    /// @brief The sum of the weights of the planes
+    double m_weight = 0.0;
+};
+
+/// @brief Adds the plane `dot(normal, p) + distance = 0` to a quadric
+static void addPlane(Quadric& quadric, const glm::dvec3& normal, const double distance, const double weight)
+{
+    const double plane[4] = {normal.x, normal.y, normal.z, distance};
+    uint32_t term = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+        for (uint32_t j = i; j < 4; ++j)
+            quadric.m_terms[term++] += weight * plane[i] * plane[j];
+    quadric.m_weight += weight;
+}
+
+/// @brief Adds a quadric to another
+static void addQuadric(Quadric& quadric, const Quadric& other)
+{
+    for (uint32_t i = 0; i < 10; ++i)
+        quadric.m_terms[i] += other.m_terms[i];
+    quadric.m_weight += other.m_weight;
+}
+
+/// @brief Returns the weighted mean of the squared distances from a point to the planes of a quadric
+static double evaluateQuadric(const Quadric& quadric, const glm::vec3& position)
+{
+    if (quadric.m_weight <= 0.0)
+        return 0.0;
+    const double point[4] = {position.x, position.y, position.z, 1.0};
+    double sum = 0.0;
+    uint32_t term = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        for (uint32_t j = i; j < 4; ++j)
+        {
+            // The terms off the diagonal stand for both halves of the matrix
+            const double factor = i == j ? 1.0 : 2.0;
+            sum += factor * quadric.m_terms[term++] * point[i] * point[j];
+        }
+    }
+    return std::max(sum, 0.0) / quadric.m_weight;
+}
+
+/// @brief Returns the (unnormalized) normal of a triangle
+static glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    return glm::cross(b - a, c - a);
+}
+
+utils::Result<app::graphics::LodChain> app::graphics::LodGenerator::generate(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const LodSettings& settings)
+{
+    if (indices.empty() || indices.size() % 3 != 0)
+        return utils::Result<LodChain>::Error((char*)"The mesh is not a triangle list");
+    const uint32_t vertex_count = static_cast<uint32_t>(positions.size());
+    for (const uint32_t index : indices)
+    {
+        if (index >= vertex_count)
+            return utils::Result<LodChain>::Error((char*)"The mesh has indices out of its vertices");
+    }
+
+    LodChain chain;
+    // Bounding sphere: the center of the box of the referenced vertices
+    glm::vec3 box_min(positions[indices[0]]);
+    glm::vec3 box_max(positions[indices[0]]);
+    for (const uint32_t index : indices)
+    {
+        box_min = glm::min(box_min, positions[index]);
+        box_max = glm::max(box_max, positions[index]);
+    }
+    chain.m_center = 0.5f * (box_min + box_max);
+    for (const uint32_t index : indices)
+        chain.m_radius = std::max(chain.m_radius, glm::length(positions[index] - chain.m_center));
+    chain.m_indices = indices;
+    chain.m_levels.push_back(LodLevel{
+        .m_index_offset = 0,
+        .m_index_count = static_cast<uint32_t>(indices.size()),
+        .m_error = 0.0f,
+    });
+    if (settings.m_max_levels <= 1)
+        return utils::Result<LodChain>::Ok(chain);
+
+    // The vertices sharing a position (attribute seams) are welded to find the borders,
+    // and locked: moving one of them would tear the mesh apart
+    std::vector<uint32_t> order(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&positions](const uint32_t a, const uint32_t b) {
+        const glm::vec3& pa = positions[a];
+        const glm::vec3& pb = positions[b];
+        return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+    });
+    std::vector<uint32_t> welded(vertex_count);
+    std::vector<uint8_t> locked(vertex_count, 0);
+    for (uint32_t begin = 0; begin < vertex_count;)
+    {
+        uint32_t end = begin + 1;
+        while (end < vertex_count && positions[order[end]] == positions[order[begin]])
+            ++end;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            welded[order[i]] = order[begin];
+            locked[order[i]] = end - begin > 1 ? 1 : 0;
+        }
+        begin = end;
+    }
+
+    // The borders: the welded edges used by a single triangle
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t a = welded[indices[i + corner]];
+            const uint32_t b = welded[indices[i + (corner + 1) % 3]];
+            edges.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<uint8_t> on_border(vertex_count, 0);
+    for (size_t begin = 0; begin < edges.size();)
+    {
+        size_t end = begin + 1;
+        while (end < edges.size() && edges[end] == edges[begin])
+            ++end;
+        if (end - begin == 1)
+        {
+            on_border[static_cast<uint32_t>(edges[begin] >> 32)] = 1;
+            on_border[static_cast<uint32_t>(edges[begin] & 0xFFFFFFFF)] = 1;
+        }
+        begin = end;
+    }
+    // All the vertices at the positions of the borders
+    for (uint32_t v = 0; v < vertex_count; ++v)
+        locked[v] |= on_border[welded[v]];
+
+    // The quadrics of the original planes around each vertex, weighted by the areas
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::dvec3 a(positions[indices[i]]);
+        const glm::dvec3 b(positions[indices[i + 1]]);
+        const glm::dvec3 c(positions[indices[i + 2]]);
+        const glm::dvec3 normal = glm::cross(b - a, c - a);
+        const double double_area = glm::length(normal);
+        if (double_area <= 0.0)
+            continue;
+        const glm::dvec3 unit_normal = normal / double_area;
+        const double distance = -glm::dot(unit_normal, a);
+        for (uint32_t corner = 0; corner < 3; ++corner)
+            addPlane(quadrics[indices[i + corner]], unit_normal, distance, 0.5 * double_area);
+    }
+
+    const double max_error = static_cast<double>(settings.m_max_error) * chain.m_radius;
+    const double max_cost = max_error * max_error;
+    double level_cost = 0.0;
+    std::vector<uint32_t> current = indices;
+    std::vector<uint32_t> triangle_offsets(vertex_count + 1);
+    std::vector<uint32_t> vertex_triangles;
+    std::vector<uint8_t> touched(vertex_count);
+    std::vector<std::pair<double, uint64_t>> collapses;
+    for (uint32_t level = 1; level < settings.m_max_levels; ++level)
+    {
+        const size_t previous_count = current.size();
+        const size_t target_count = 3 * static_cast<size_t>(static_cast<float>(previous_count / 3) * settings.m_index_ratio);
+        bool stuck = false;
+        while (current.size() > target_count)
+        {
+            // The collapses of the edges, from the cheapest: a vertex moves onto a neighbour
+            collapses.clear();
+            for (size_t i = 0; i < current.size(); i += 3)
+            {
+                for (uint32_t corner = 0; corner < 3; ++corner)
+                {
+                    const uint32_t a = current[i + corner];
+                    const uint32_t b = current[i + (corner + 1) % 3];
+                    for (const auto& [from, to] : {std::make_pair(a, b), std::make_pair(b, a)})
+                    {
+                        if (locked[from])
+                            continue;
+                        const double cost = evaluateQuadric(quadrics[from], positions[to]);
+                        if (cost <= max_cost)
+                            collapses.emplace_back(cost, (static_cast<uint64_t>(from) << 32) | to);
+                    }
+                }
+            }
+            if (collapses.empty())
+            {
+                stuck = true;
+                break;
+            }
+            std::sort(collapses.begin(), collapses.end());
+
+            // The triangles around each vertex
+            std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+            for (const uint32_t index : current)
+                ++triangle_offsets[index + 1];
+            for (uint32_t v = 0; v < vertex_count; ++v)
+                triangle_offsets[v + 1] += triangle_offsets[v];
+            vertex_triangles.resize(current.size());
+            {
+                std::vector<uint32_t> cursors(triangle_offsets.begin(), triangle_offsets.end() - 1);
+                for (size_t i = 0; i < current.size(); ++i)
+                    vertex_triangles[cursors[current[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+
+            // Each pass collapses independent edges: the vertices around a collapse are
+            // left alone until the next pass, which sees the updated triangles
+            std::fill(touched.begin(), touched.end(), 0);
+            const size_t triangles_to_remove = (current.size() - target_count) / 3;
+            size_t removed_triangles = 0;
+            for (const auto& [cost, edge] : collapses)
+            {
+                const uint32_t from = static_cast<uint32_t>(edge >> 32);
+                const uint32_t to = static_cast<uint32_t>(edge & 0xFFFFFFFF);
+                if (touched[from] || touched[to])
+                    continue;
+                // Rejected if a remaining triangle around `from` would flip or degenerate
+                bool flips = false;
+                size_t collapsed = 0;
+                for (uint32_t t = triangle_offsets[from]; t < triangle_offsets[from + 1] && !flips; ++t)
+                {
+                    const uint32_t* triangle = &current[3 * vertex_triangles[t]];
+                    if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                    {
+                        ++collapsed;
+                        continue;
+                    }
+                    glm::vec3 corners[3];
+                    for (uint32_t corner = 0; corner < 3; ++corner)
+                        corners[corner] = positions[triangle[corner] == from ? to : triangle[corner]];
+                    const glm::vec3 before = triangleNormal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]);
+                    const glm::vec3 after = triangleNormal(corners[0], corners[1], corners[2]);
+                    flips = glm::dot(before, after) <= 0.0f;
+                }
+                if (flips)
+                    continue;
+                for (uint32_t t = triangle_offsets[from]; t < triangle_offsets[from + 1]; ++t)
+                {
+                    uint32_t* triangle = &current[3 * vertex_triangles[t]];
+                    for (uint32_t corner = 0; corner < 3; ++corner)
+                    {
+                        touched[triangle[corner]] = 1;
+                        if (triangle[corner] == from)
+                            triangle[corner] = to;
+                    }
+                }
+                addQuadric(quadrics[to], quadrics[from]);
+                level_cost = std::max(level_cost, cost);
+                removed_triangles += collapsed;
+                if (removed_triangles >= triangles_to_remove)
+                    break;
+            }
+
+            // The collapsed triangles have two identical corners
+            size_t kept = 0;
+            for (size_t i = 0; i < current.size(); i += 3)
+            {
+                if (current[i] == current[i + 1] || current[i + 1] == current[i + 2] || current[i + 2] == current[i])
+                    continue;
+                current[kept++] = current[i];
+                current[kept++] = current[i + 1];
+                current[kept++] = current[i + 2];
+            }
+            current.resize(kept);
+            if (0 == removed_triangles)
+            {
+                stuck = true;
+                break;
+            }
+        }
+        if (static_cast<float>(current.size()) > MIN_LEVEL_REDUCTION * static_cast<float>(previous_count))
+            break;
+        chain.m_levels.push_back(LodLevel{
+            .m_index_offset = static_cast<uint32_t>(chain.m_indices.size()),
+            .m_index_count = static_cast<uint32_t>(current.size()),
+            .m_error = static_cast<float>(std::sqrt(level_cost)),
+        });
+        chain.m_indices.insert(chain.m_indices.end(), current.begin(), current.end());
+        if (stuck)
+            break;
+    }
+    return utils::Result<LodChain>::Ok(chain);
+}
+
+app::graphics::LevelsOfDetail::LevelsOfDetail(){};
+
+app::graphics::LevelsOfDetail::~LevelsOfDetail()
+{
+    m_pass = nullptr;
+    m_level_buffer = nullptr;
+    m_mesh_buffer = nullptr;
+    m_instance_buffer = nullptr;
+    m_selection_buffer = nullptr;
+    m_draw_buffer = nullptr;
+    m_levels.clear();
+    m_meshes.clear();
+    m_instances.clear();
+};
+
+utils::VResult app::graphics::LevelsOfDetail::create(const uint32_t max_meshes, const uint32_t max_levels, const uint32_t max_instances)
+{
+    Log("> Creating the levels of detail (%d meshes, %d levels, %d GPU instances)", max_meshes, max_levels, max_instances);
+    m_max_meshes = max_meshes;
+    m_max_levels = max_levels;
+    m_max_instances = max_instances;
+    m_levels.reserve(m_max_levels);
+    m_meshes.reserve(m_max_meshes);
+    m_instances.reserve(m_max_instances);
+
+    m_level_buffer = std::make_shared<app::graphics::Buffer>();
+    m_mesh_buffer = std::make_shared<app::graphics::Buffer>();
+    m_instance_buffer = std::make_shared<app::graphics::Buffer>();
+    m_selection_buffer = std::make_shared<app::graphics::Buffer>();
+    m_draw_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_level_buffer->create(std::max(m_max_levels, 1u) * sizeof(GpuLevel), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    if (const auto result = m_mesh_buffer->create(std::max(m_max_meshes, 1u) * sizeof(GpuMesh), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    if (const auto result = m_instance_buffer->create(std::max(m_max_instances, 1u) * sizeof(GpuInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    if (const auto result = m_selection_buffer->create(std::max(m_max_instances, 1u) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false); result.IsError())
+        return result;
+    if (const auto result = m_draw_buffer->create(std::max(m_max_instances, 1u) * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, false); result.IsError())
+        return result;
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Levels
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Meshes
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Instances
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Selected levels
+        {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Indirect draws
+    };
+    m_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_pass->create("shaders/lod_select.comp.spv", bindings, sizeof(PushConstants), 1); result.IsError())
+    {
+        LogE("Error creating the LOD selection pass");
+        return result;
+    }
+    m_pass->writeBuffer(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_level_buffer);
+    m_pass->writeBuffer(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_mesh_buffer);
+    m_pass->writeBuffer(0, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_instance_buffer);
+    m_pass->writeBuffer(0, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_selection_buffer);
+    m_pass->writeBuffer(0, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_draw_buffer);
+    return utils::VResult::Ok();
+}
+
+utils::Result<uint32_t> app::graphics::LevelsOfDetail::addMesh(const LodChain& chain, const uint32_t first_index, const int32_t vertex_offset)
+{
+    if (m_meshes.size() >= m_max_meshes || m_levels.size() + chain.m_levels.size() > m_max_levels)
+    {
+        LogE("> The LOD tables are full (%d meshes, %d levels)", m_max_meshes, m_max_levels);
+        return utils::Result<uint32_t>::Error((char*)"Too many meshes for the LOD tables");
+    }
+    const uint32_t first_level = static_cast<uint32_t>(m_levels.size());
+    std::vector<GpuLevel> gpu_levels;
+    gpu_levels.reserve(chain.m_levels.size());
+    for (const LodLevel& level : chain.m_levels)
+    {
+        m_levels.push_back(LodLevel{
+            .m_index_offset = first_index + level.m_index_offset,
+            .m_index_count = level.m_index_count,
+            .m_error = level.m_error,
+        });
+        gpu_levels.push_back(GpuLevel{
+            .m_first_index = first_index + level.m_index_offset,
+            .m_index_count = level.m_index_count,
+            .m_error = level.m_error,
+            .m_padding = 0.0f,
+        });
+    }
+    m_meshes.push_back(GpuMesh{
+        .m_sphere = glm::vec4(chain.m_center, chain.m_radius),
+        .m_first_level = first_level,
+        .m_level_count = static_cast<uint32_t>(chain.m_levels.size()),
+        .m_vertex_offset = vertex_offset,
+        .m_padding = 0,
+    });
+    // Meshes are added at load time: no GPU pass reads the tables yet
+    if (!gpu_levels.empty())
+        m_level_buffer->write(gpu_levels.data(), gpu_levels.size() * sizeof(GpuLevel), first_level * sizeof(GpuLevel));
+    m_mesh_buffer->write(&m_meshes.back(), sizeof(GpuMesh), (m_meshes.size() - 1) * sizeof(GpuMesh));
+    return utils::Result<uint32_t>::Ok(static_cast<uint32_t>(m_meshes.size() - 1));
+}
+
+const app::graphics::LodLevel* app::graphics::LevelsOfDetail::getLevels(const uint32_t mesh, uint32_t* level_count) const
+{
+    assert(mesh < m_meshes.size());
+    *level_count = m_meshes[mesh].m_level_count;
+    return &m_levels[m_meshes[mesh].m_first_level];
+}
+
+void app::graphics::LevelsOfDetail::setErrorThreshold(const float pixel_error, const float hysteresis) noexcept
+{
+    m_pixel_error = pixel_error;
+    m_hysteresis = glm::clamp(hysteresis, 0.0f, 1.0f);
+}
+
+float app::graphics::LevelsOfDetail::getPixelsPerUnit(const app::graphics::Camera& camera, const VkExtent2D& render_extent) noexcept
+{
+    return static_cast<float>(render_extent.height) / (2.0f * glm::tan(0.5f * camera.getFovY()));
+}
+
+uint32_t app::graphics::LevelsOfDetail::select(const uint32_t mesh, const glm::mat4& transform, const app::graphics::Camera& camera, const VkExtent2D& render_extent, const uint32_t previous_level) const
+{
+    // Must match selectLod (shaders/lod.glsl)
+    assert(mesh < m_meshes.size());
+    const GpuMesh& gpu_mesh = m_meshes[mesh];
+    const glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(gpu_mesh.m_sphere), 1.0f));
+    const float scale = glm::sqrt(std::max({
+        glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+        glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+        glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])),
+    }));
+    const glm::vec3 eye = glm::vec3(glm::inverse(camera.getView())[3]);
+    // The closest point of the bounding sphere, never closer than the near plane
+    const float distance = std::max(glm::length(center - eye) - scale * gpu_mesh.m_sphere.w, camera.getNear());
+    const float pixels_per_error = scale * getPixelsPerUnit(camera, render_extent) / distance;
+    // The errors grow with the levels: the first one under its threshold is the coarsest
+    for (uint32_t level = gpu_mesh.m_level_count - 1; level > 0; --level)
+    {
+        const float threshold = level > previous_level ? m_pixel_error * (1.0f - m_hysteresis) : m_pixel_error;
+        if (m_levels[gpu_mesh.m_first_level + level].m_error * pixels_per_error <= threshold)
+            return level;
+    }
+    return 0;
+}
+
+void app::graphics::LevelsOfDetail::setInstances(const std::vector<LodInstance>& instances)
+{
+    if (instances.size() > m_max_instances)
+        LogW("> More LOD instances than the maximum of %d: the extra ones are ignored", m_max_instances);
+    const size_t instance_count = std::min(instances.size(), static_cast<size_t>(m_max_instances));
+    const size_t previous_instance_count = m_instances.size();
+    m_instances.clear();
+    for (size_t i = 0; i < instance_count; ++i)
+    {
+        assert(instances[i].m_mesh < m_meshes.size());
+        m_instances.push_back(GpuInstance{
+            .m_transform = instances[i].m_transform,
+            .m_mesh = glm::uvec4(instances[i].m_mesh, 0, 0, 0),
+        });
+    }
+    // The cached draws of the scene read the previous number of indirect draws
+    if (m_instances.size() != previous_instance_count)
+        app::Engine::getInstance()->m_render->getGraphicsCommand()->invalidateStatic();
+}
+
+void app::graphics::LevelsOfDetail::record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent)
+{
+    if (!m_selection_initialized)
+    {
+        // The finest level, until the first selection
+        vkCmdFillBuffer(command_buffer, m_selection_buffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+        m_selection_initialized = true;
+    }
+    if (m_instances.empty())
+        return;
+    m_instance_buffer->write(m_instances.data(), m_instances.size() * sizeof(GpuInstance));
+
+    // The draws of the previous frame are done reading their commands, and the
+    // selection buffer is cleared
+    VkMemoryBarrier before_selection{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &before_selection,
+        0, nullptr,
+        0, nullptr);
+
+    const PushConstants push_constants{
+        .m_eye = glm::vec4(glm::vec3(glm::inverse(camera.getView())[3]), camera.getNear()),
+        .m_params = glm::vec4(getPixelsPerUnit(camera, render_extent), m_pixel_error, m_hysteresis, static_cast<float>(m_instances.size())),
+    };
+    m_pass->dispatch(command_buffer, 0, &push_constants, app::graphics::ComputePass::getGroupCount(static_cast<uint32_t>(m_instances.size()), GROUP_SIZE), 1);
+
+    VkMemoryBarrier after_selection{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0,
+        1, &after_selection,
+        0, nullptr,
+        0, nullptr);
+}
+
+void app::graphics::LevelsOfDetail::draw(VkCommandBuffer command_buffer)
+{
+    if (m_instances.empty())
+        return;
+    const VkBuffer draw_buffer = m_draw_buffer->getBuffer();
+    const uint32_t draw_count = static_cast<uint32_t>(m_instances.size());
+    if (app::Engine::getInstance()->m_graphics_device.supportsMultiDrawIndirect())
+    {
+        vkCmdDrawIndexedIndirect(command_buffer, draw_buffer, 0, draw_count, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else
+    {
+        for (uint32_t i = 0; i < draw_count; ++i)
+            vkCmdDrawIndexedIndirect(command_buffer, draw_buffer, i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+std::shared_ptr<app::graphics::Buffer> app::graphics::LevelsOfDetail::getDrawBuffer() const noexcept
+{
+    return m_draw_buffer;
+}
+
+uint32_t app::graphics::LevelsOfDetail::getInstanceCount() const noexcept
+{
+    return static_cast<uint32_t>(m_instances.size());
+}
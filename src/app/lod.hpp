@@ -0,0 +1,246 @@
+//
+//  lod.hpp
+//
+
+#pragma once
+#ifndef lod_h
+#define lod_h
+
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include "camera.hpp"
+#include "compute.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief A level of detail of a mesh: a range of its LOD chain indices
+        struct LodLevel
+        {
+            /// @brief The first index of the level, in the indices of the chain
+            uint32_t m_index_offset = 0;
+            /// @brief The number of indices of the level
+            uint32_t m_index_count = 0;
+            /// @brief The geometric error of the level: the distance to the base mesh it
+            /// is estimated to deviate by, in mesh units (0 for the base mesh)
+            float m_error = 0.0f;
+        };
+
+        /// @brief The levels of detail of a mesh, from the finest (the base mesh) to the
+        /// coarsest. All the levels index the vertices of the base mesh: the chain is
+        /// stored alongside it as a single index buffer, the vertex buffer is unchanged.
+        struct LodChain
+        {
+            /// @brief The indices of all the levels, one after the other
+            std::vector<uint32_t> m_indices;
+            /// @brief The levels, from the finest to the coarsest
+            std::vector<LodLevel> m_levels;
+            /// @brief The center of the bounding sphere of the mesh, in mesh units
+            glm::vec3 m_center = glm::vec3(0.0f);
+            /// @brief The radius of the bounding sphere of the mesh, in mesh units
+            float m_radius = 0.0f;
+        };
+
+        /// @brief The parameters of the generation of a LOD chain
+        struct LodSettings
+        {
+            /// @brief The maximum number of levels, the base mesh included
+            uint32_t m_max_levels = 1;
+            /// @brief The number of indices of a level, relative to the previous level
+            float m_index_ratio = 0.5f;
+            /// @brief The maximum error of the coarsest level, relative to the radius of the mesh
+            float m_max_error = 0.1f;
+        };
+
+        /// @brief Generates the LOD chains of the meshes, at import or cook time.
+        ///
+        /// The meshes are simplified with edge collapses, ordered by their quadric error
+        /// (the sum of the squared distances to the planes of the original triangles
+        /// around a vertex). A collapse moves a vertex onto one of its neighbours, so that
+        /// the levels keep indexing the vertices of the base mesh.
+        /// The vertices of the borders and of the attribute seams (several vertices at the
+        /// same position) never move: the silhouette of open meshes and the UV islands
+        /// are preserved.
+        class LodGenerator
+        {
+        public:
+            /// @brief Generates the LOD chain of a triangle list
+            /// @param positions The positions of the vertices of the base mesh
+            /// @param indices The indices of the triangles of the base mesh
+            /// @param settings The parameters of the generation
+            /// @return The chain, with at least the base mesh, or an error if the mesh is invalid
+            static utils::Result<LodChain> generate(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const LodSettings& settings);
+        };
+
+        /// @brief A mesh instance, for the LOD selection on the GPU
+        struct LodInstance
+        {
+            /// @brief The mesh returned by `LevelsOfDetail::addMesh`
+            uint32_t m_mesh = 0;
+            /// @brief From mesh units to world space
+            glm::mat4 m_transform = glm::mat4(1.0f);
+        };
+
+        /// @brief Selects the levels of detail of the mesh instances, from their projected
+        /// screen-space error: the coarsest level whose error projects below a number
+        /// of pixels is drawn.
+        ///
+        /// A switch to a coarser level requires its error to project below a lower
+        /// threshold (hysteresis), so that an instance at the boundary does not alternate
+        /// between two levels.
+        /// The selection is available on the CPU (`select`, for the draws recorded by the
+        /// CPU) and on the GPU (`record`: one indirect draw per instance). Both follow the
+        /// same rules (`shaders/lod.glsl`), and read the same level table.
+        class LevelsOfDetail
+        {
+        public:
+            /// @brief The number of invocations of a workgroup of the selection pass
+            static constexpr uint32_t GROUP_SIZE = 64;
+
+            /// @brief Public constructor
+            LevelsOfDetail();
+            /// @brief Public destructor
+            ~LevelsOfDetail();
+            /// @brief Creates the level tables and the selection pass
+            /// @param max_meshes The maximum number of meshes
+            /// @param max_levels The maximum number of levels of all the meshes
+            /// @param max_instances The maximum number of instances selected on the GPU
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t max_meshes, const uint32_t max_levels, const uint32_t max_instances);
+            /// @brief Registers the LOD chain of a mesh
+            /// @param chain The chain generated by LodGenerator
+            /// @param first_index The position of the chain indices in the index buffer
+            /// @param vertex_offset The position of the base mesh vertices in the vertex buffer
+            /// @return The identifier of the mesh, or an error if the tables are full
+            utils::Result<uint32_t> addMesh(const LodChain& chain, const uint32_t first_index, const int32_t vertex_offset);
+            /// @brief Returns the levels of a mesh, with their offsets in the index buffer
+            /// (`first_index` added)
+            /// @param mesh The identifier returned by `addMesh`
+            /// @param level_count Receives the number of levels
+            const LodLevel* getLevels(const uint32_t mesh, uint32_t* level_count) const;
+            /// @brief Sets the screen-space error tolerated, and the hysteresis
+            /// @param pixel_error The maximum projected error of the drawn levels, in pixels
+            /// of the render extent
+            /// @param hysteresis The fraction of `pixel_error` removed from the threshold of the
+            /// levels coarser than the current one
+            void setErrorThreshold(const float pixel_error, const float hysteresis) noexcept;
+            /// @brief Selects the level of detail of an instance (CPU)
+            /// @param mesh The identifier returned by `addMesh`
+            /// @param transform From mesh units to world space
+            /// @param camera The point of view of the frame
+            /// @param render_extent The extent the scene is rendered at
+            /// @param previous_level The level selected for this instance at the previous
+            /// frame (0 the first time)
+            /// @return The level to draw
+            uint32_t select(const uint32_t mesh, const glm::mat4& transform, const app::graphics::Camera& camera, const VkExtent2D& render_extent, const uint32_t previous_level) const;
+            /// @brief Sets the instances selected on the GPU, each frame. The selected
+            /// levels of the previous frame are kept for the instances at the same position.
+            /// A new number of instances invalidates the cached draws of the scene.
+            void setInstances(const std::vector<LodInstance>& instances);
+            /// @brief Selects the levels of the instances on the GPU, and writes their indexed
+            /// indirect draws (one per instance, in the order of `setInstances`).
+            /// Should be recorded outside of any render pass, before the draws.
+            /// @param command_buffer The command buffer being recorded
+            /// @param camera The point of view of the frame
+            /// @param render_extent The extent the scene is rendered at
+            void record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent);
+            /// @brief Records the indirect draws of the levels selected by `record`.
+            /// The pipeline, the vertex and the index buffers of the meshes should be bound:
+            /// the first instance of a draw is the index of its instance.
+            /// @param command_buffer The command buffer being recorded
+            void draw(VkCommandBuffer command_buffer);
+            /// @brief Returns the indirect draws written by `record` (VkDrawIndexedIndirectCommand)
+            std::shared_ptr<app::graphics::Buffer> getDrawBuffer() const noexcept;
+            /// @brief Returns the number of instances selected on the GPU
+            uint32_t getInstanceCount() const noexcept;
+
+        private:
+            /// @brief A level, as read by the shaders (std430)
+            struct GpuLevel
+            {
+                /// @brief The first index of the level, relative to the index buffer
+                uint32_t m_first_index;
+                /// @brief The number of indices of the level
+                uint32_t m_index_count;
+                /// @brief The geometric error of the level, in mesh units
+                float m_error;
+                /// @brief Unused
+                float m_padding;
+            };
+            /// @brief A mesh, as read by the shaders (std430)
+            struct GpuMesh
+            {
+                /// @brief The center (xyz) and the radius (w) of the bounding sphere, in mesh units
+                glm::vec4 m_sphere;
+                /// @brief The first level of the mesh in the level table
+                uint32_t m_first_level;
+                /// @brief The number of levels of the mesh
+                uint32_t m_level_count;
+                /// @brief The position of the vertices in the vertex buffer
+                int32_t m_vertex_offset;
+                /// @brief Unused
+                uint32_t m_padding;
+            };
+            /// @brief An instance, as read by the selection pass (std430)
+            struct GpuInstance
+            {
+                /// @brief From mesh units to world space
+                glm::mat4 m_transform;
+                /// @brief The mesh (x), yzw unused
+                glm::uvec4 m_mesh;
+            };
+            /// @brief The push constants of the selection pass
+            struct PushConstants
+            {
+                /// @brief The position of the camera, in world space, and its near plane (w)
+                glm::vec4 m_eye;
+                /// @brief The number of pixels per world unit at a distance of 1, the pixel
+                /// error threshold, the hysteresis, and the number of instances
+                glm::vec4 m_params;
+            };
+            /// @brief LevelsOfDetail should not be cloneable
+            LevelsOfDetail(LevelsOfDetail& other) = delete;
+            /// @brief LevelsOfDetail should not be assignable
+            void operator=(const LevelsOfDetail& other) = delete;
+            /// @brief Returns the number of pixels per world unit, at a distance of 1
+            static float getPixelsPerUnit(const app::graphics::Camera& camera, const VkExtent2D& render_extent) noexcept;
+            /// @brief The levels of all the meshes, with offsets in the index buffer
+            std::vector<LodLevel> m_levels;
+            /// @brief The meshes
+            std::vector<GpuMesh> m_meshes;
+            /// @brief The instances selected on the GPU
+            std::vector<GpuInstance> m_instances;
+            /// @brief The maximum number of meshes
+            uint32_t m_max_meshes = 0;
+            /// @brief The maximum number of levels of all the meshes
+            uint32_t m_max_levels = 0;
+            /// @brief The maximum number of instances selected on the GPU
+            uint32_t m_max_instances = 0;
+            /// @brief The maximum projected error of the drawn levels, in pixels
+            float m_pixel_error = 1.0f;
+            /// @brief The fraction of `m_pixel_error` removed from the threshold of the coarser levels
+            float m_hysteresis = 0.0f;
+            /// @brief The level table (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_level_buffer = nullptr;
+            /// @brief The mesh table (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_mesh_buffer = nullptr;
+            /// @brief The instances (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_instance_buffer = nullptr;
+            /// @brief The level selected for each instance, kept from frame to frame
+            std::shared_ptr<app::graphics::Buffer> m_selection_buffer = nullptr;
+            /// @brief The indexed indirect draws of the instances
+            std::shared_ptr<app::graphics::Buffer> m_draw_buffer = nullptr;
+            /// @brief The selection pass
+            std::shared_ptr<app::graphics::ComputePass> m_pass = nullptr;
+            /// @brief If the selected levels have been cleared (finest level for all)
+            bool m_selection_initialized = false;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // lod_h
@@ -9,6 +9,8 @@
 #define memory_h
 
 #include "../utils/result.h"
+#include "command.hpp"
+#include "submit.hpp"
 #include <assert.h>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
@@ -44,6 +46,8 @@ namespace app
             /// @param buffer The buffer to allocate
             /// @param buffer_usage Usage flag(s) for the buffer
             /// @param buffer_sharing_mode Sharing mode for the buffer
+            /// @param allocation_flags VMA allocation flags: host-writable by default,
+            /// 0 for a buffer only accessed by the GPU
             /// @return A VResult type to know if the initialization succeeded or not
             static utils::VResult initBuffer(
                 VmaAllocator& resources_allocator,
@@ -52,7 +56,8 @@ namespace app
                 const size_t buffer_size,
                 VkBuffer& buffer,
                 const VkBufferUsageFlags buffer_usage,
-                const VkSharingMode buffer_sharing_mode = VK_SHARING_MODE_EXCLUSIVE) noexcept
+                const VkSharingMode buffer_sharing_mode = VK_SHARING_MODE_EXCLUSIVE,
+                const VmaAllocationCreateFlags allocation_flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT) noexcept
             {
                 VkBufferCreateInfo buffer_create_info{
                     .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -62,7 +67,7 @@ namespace app
                 };
 
                 VmaAllocationCreateInfo alloc_info = {
-                    .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                    .flags = allocation_flags,
                     .usage = VMA_MEMORY_USAGE_AUTO,
                 };
 
@@ -73,36 +78,103 @@ namespace app
                 }
                 return utils::VResult::Ok();
             }
-            /// @brief Copy the data from the source buffer to the destination buffer
-            /// @param graphics_device The graphics (or logical) device
+            /// @brief Initialize a given 2D image (or 2D array image, or 3D image), with a single mip level.
+            /// Transient attachments are allocated in lazily allocated memory, if
+            /// the device exposes such a memory type (tile-based GPUs): the memory
+            /// is then only committed if the content of the image has to leave
+            /// the tile memory.
+            /// @param resources_allocator The custom allocator (VMA)
+            /// @param allocation The allocation object of the image
+            /// @param image The image to allocate
+            /// @param extent The size of the image, in pixels
+            /// @param format The format of the image
+            /// @param image_usage Usage flag(s) for the image
+            /// @param samples The number of samples per pixel
+            /// @param memory_usage The VMA memory usage to allocate the image with,
+            /// if the image is not transient or if no lazily allocated memory exists
+            /// @param array_layers The number of layers of the image
+            /// @param depth The depth of the image, in pixels: the image is a 3D image if more than one
+            /// @return A VResult type to know if the initialization succeeded or not
+            static utils::VResult initImage(
+                VmaAllocator& resources_allocator,
+                VmaAllocation* allocation,
+                VkImage& image,
+                const VkExtent2D& extent,
+                const VkFormat format,
+                const VkImageUsageFlags image_usage,
+                const VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT,
+                const VmaMemoryUsage memory_usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+                const uint32_t array_layers = 1,
+                const uint32_t depth = 1) noexcept
+            {
+                VkImageCreateInfo image_create_info{
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                    .imageType = depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D,
+                    .format = format,
+                    .extent = {
+                        .width = extent.width,
+                        .height = extent.height,
+                        .depth = depth,
+                    },
+                    .mipLevels = 1,
+                    .arrayLayers = array_layers,
+                    .samples = samples,
+                    .tiling = VK_IMAGE_TILING_OPTIMAL,
+                    .usage = image_usage,
+                    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                };
+
+                VmaAllocationCreateInfo alloc_info = {
+                    .usage = memory_usage,
+                };
+
+                if (image_usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+                {
+                    VmaAllocationCreateInfo lazy_alloc_info = {
+                        .usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED,
+                    };
+                    uint32_t memory_type_index = 0;
+                    if (vmaFindMemoryTypeIndexForImageInfo(resources_allocator, &image_create_info, &lazy_alloc_info, &memory_type_index) == VK_SUCCESS)
+                        alloc_info = lazy_alloc_info;
+                }
+
+                if (vmaCreateImage(resources_allocator, &image_create_info, &alloc_info, &image, allocation, nullptr) != VK_SUCCESS)
+                {
+                    LogE("vmaCreateImage: cannot initiate the image of %dx%d pixels", extent.width, extent.height);
+                    return utils::VResult::Error((char*)"vmaCreateImage: cannot initiate the image");
+                }
+                return utils::VResult::Ok();
+            }
+            /// @brief Records the copy of the data from the source buffer to the destination buffer,
+            /// submitted with the next frame (no wait).
+            /// The source must be kept, and the destination not read by the CPU, until the fence
+            /// of that frame has been waited for
             /// @param src The source buffer to copy from
             /// @param dst The destination buffer to copy to
-            /// @param transfert_command_pool The Transfert command pool
+            /// @param transfert_command The Transfert command object, that recycles the command buffer
+            /// @param transfert_batcher The submit batcher of the Transfert queue
             /// @param size The size of the buffer to copy
             /// @return A VResult type to know if the operation performed well or not
             static utils::VResult copyBuffer(
-                const VkDevice& graphics_device,
                 VkBuffer& src,
                 VkBuffer& dst,
-                const VkCommandPool* transfert_command_pool,
-                const VkQueue& transfert_queue,
+                Command& transfert_command,
+                SubmitBatcher& transfert_batcher,
                 const VkDeviceSize size)
             {
-                VkCommandBufferAllocateInfo alloc_info{
-                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-                    .commandPool = *(transfert_command_pool),
-                    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-                    .commandBufferCount = 1};
-                VkCommandBuffer command_buffer;
-                const auto operation_result = vkAllocateCommandBuffers(graphics_device, &alloc_info, &command_buffer);
-                if (operation_result != VK_SUCCESS)
-                    return utils::VResult::Error((char*)"vkAllocateCommandBuffers failed: cannot allocate memory for the dst buffer");
+                // The command buffer comes from the pools of the current frame (reset by the
+                // pipeline once the frame that used them has completed)
+                const auto buffer_result = transfert_command.acquireBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+                if (buffer_result.IsError())
+                    return utils::VResult::Error((char*)"acquireBuffer failed: cannot get a command buffer for the copy");
+                const VkCommandBuffer command_buffer = buffer_result.GetValue();
 
                 // Build the packet
                 {
                     VkCommandBufferBeginInfo command_buffer_begin_info{
                         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-                        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // Wait before submit
+                        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, // Submitted once, then recycled with the frame pools
                     };
                     vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
 
@@ -114,21 +186,27 @@ namespace app
                     };
                     vkCmdCopyBuffer(command_buffer, src, dst, 1, &copy_region);
 
+                    // On a queue shared with the frame, the commands submitted after the copy
+                    // see its result (otherwise the frame waits for a semaphore)
+                    const VkMemoryBarrier2 barrier{
+                        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                        .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                        .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                        .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                        .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+                    };
+                    const VkDependencyInfo dependency_info{
+                        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                        .memoryBarrierCount = 1,
+                        .pMemoryBarriers = &barrier,
+                    };
+                    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+
                     vkEndCommandBuffer(command_buffer);
                 }
 
-                // Execute the command buffer to complete the transfert
-                VkSubmitInfo submit_info{
-                    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                    .commandBufferCount = 1,
-                    .pCommandBuffers = &command_buffer,
-                };
-                vkQueueSubmit(transfert_queue, 1, &submit_info, VK_NULL_HANDLE);
-                // Wait operation
-                // TODO: use fences next time for opti & multi-sync
-                vkQueueWaitIdle(transfert_queue);
-                // Clean the command buffer used for the transfert operation
-                vkFreeCommandBuffers(graphics_device, *transfert_command_pool, 1, &command_buffer);
+                // Submitted at the frame sync point, with the frame
+                transfert_batcher.add(command_buffer);
                 return utils::VResult::Ok();
             }
         };
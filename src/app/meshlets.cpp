@@ -0,0 +1,788 @@
+//
+//  meshlets.cpp
+//
+
+#include "meshlets.hpp"
+#include "../project.hpp"
+#include "../utils/debug_tools.h"
+#include "depth.hpp"
+#include "engine.hpp"
+#include "pipeline.hpp"
+#include <algorithm>
+#include <limits>
+
+/// @brief Below this cosine between the axis of a normal cone and its farthest normal,
+/// the normals are too spread out for the cone to cull anything
+constexpr float MIN_CONE_COSINE = 0.1f;
+/// @brief The relative difference of the scales (and the cosine between the axes) of a
+/// transform under which the normal cones are kept as they are
+constexpr float CONFORMAL_TOLERANCE = 0.01f;
+
+/// @brief Computes the bounding sphere and the normal cone of a meshlet, from its vertices
+/// and its triangles in the meshlet mesh
+static void computeBounds(app::graphics::Meshlet& meshlet, const app::graphics::MeshletMesh& meshlet_mesh, const std::vector<glm::vec3>& positions)
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i < meshlet.m_vertex_count; ++i)
+    {
+        const glm::vec3& position = positions[meshlet_mesh.m_vertices[meshlet.m_vertex_offset + i]];
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    meshlet.m_center = 0.5f * (min + max);
+    meshlet.m_radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.m_vertex_count; ++i)
+        meshlet.m_radius = std::max(meshlet.m_radius, glm::length(positions[meshlet_mesh.m_vertices[meshlet.m_vertex_offset + i]] - meshlet.m_center));
+
+    // The front faces are clockwise on screen (pipeline.cpp), with a Y-down clip space
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.m_triangle_count);
+    glm::vec3 normal_sum = glm::vec3(0.0f);
+    for (uint32_t i = 0; i < meshlet.m_triangle_count; ++i)
+    {
+        const uint32_t* triangle = &meshlet_mesh.m_indices[meshlet.m_triangle_offset + 3 * i];
+        const glm::vec3 normal = glm::cross(positions[triangle[2]] - positions[triangle[0]], positions[triangle[1]] - positions[triangle[0]]);
+        const float length = glm::length(normal);
+        // Degenerate triangles are never drawn: they do not constrain the cone
+        if (length <= std::numeric_limits<float>::epsilon())
+            continue;
+        normals.push_back(normal / length);
+        normal_sum += normals.back();
+    }
+    meshlet.m_cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.m_cone_cutoff = 1.0f;
+    const float sum_length = glm::length(normal_sum);
+    if (normals.empty() || sum_length <= std::numeric_limits<float>::epsilon())
+        return;
+    const glm::vec3 axis = normal_sum / sum_length;
+    float min_cosine = 1.0f;
+    for (const glm::vec3& normal : normals)
+        min_cosine = std::min(min_cosine, glm::dot(normal, axis));
+    if (min_cosine <= MIN_CONE_COSINE)
+        return;
+    // The back-facing region is the cone of the normals widened by 90 degrees on each
+    // side: cos(angle + 90) = -sin(angle)
+    meshlet.m_cone_axis = axis;
+    meshlet.m_cone_cutoff = std::sqrt(1.0f - min_cosine * min_cosine);
+}
+
+utils::Result<app::graphics::MeshletMesh> app::graphics::MeshletBuilder::build(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<uint32_t>& indices,
+    const uint32_t max_vertices,
+    const uint32_t max_triangles)
+{
+    if (indices.size() % 3 != 0)
+        return utils::Result<MeshletMesh>::Error((char*)"The indices of the mesh are not a triangle list");
+    // The triangles of a meshlet index its vertices with 8 bits
+    if (max_vertices < 3 || max_vertices > 256 || max_triangles < 1)
+        return utils::Result<MeshletMesh>::Error((char*)"Invalid meshlet limits");
+    const uint32_t vertex_count = static_cast<uint32_t>(positions.size());
+    for (const uint32_t index : indices)
+    {
+        if (index >= vertex_count)
+            return utils::Result<MeshletMesh>::Error((char*)"An index of the mesh is out of its vertices");
+    }
+    const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+    // The triangles around each vertex
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (const uint32_t index : indices)
+        ++adjacency_offsets[index + 1];
+    for (uint32_t vertex = 0; vertex < vertex_count; ++vertex)
+        adjacency_offsets[vertex + 1] += adjacency_offsets[vertex];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacency_fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (uint32_t triangle = 0; triangle < triangle_count; ++triangle)
+    {
+        for (uint32_t corner = 0; corner < 3; ++corner)
+            adjacency[adjacency_fill[indices[3 * triangle + corner]]++] = triangle;
+    }
+
+    MeshletMesh meshlet_mesh;
+    std::vector<bool> emitted(triangle_count, false);
+    uint32_t emitted_count = 0;
+    uint32_t seed_cursor = 0;
+    // The position of the vertices in the meshlet being built, UINT32_MAX if not in it
+    std::vector<uint32_t> local_vertices(vertex_count, UINT32_MAX);
+    std::vector<uint32_t> meshlet_vertices;
+    std::vector<uint32_t> meshlet_triangles;
+    meshlet_vertices.reserve(max_vertices);
+    meshlet_triangles.reserve(max_triangles);
+    glm::vec3 position_sum = glm::vec3(0.0f);
+
+    const auto add_triangle = [&](const uint32_t triangle) {
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t vertex = indices[3 * triangle + corner];
+            if (UINT32_MAX != local_vertices[vertex])
+                continue;
+            local_vertices[vertex] = static_cast<uint32_t>(meshlet_vertices.size());
+            meshlet_vertices.push_back(vertex);
+            position_sum += positions[vertex];
+        }
+        meshlet_triangles.push_back(triangle);
+        emitted[triangle] = true;
+        ++emitted_count;
+    };
+    const auto count_new_vertices = [&](const uint32_t triangle) {
+        uint32_t new_vertices = 0;
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            if (UINT32_MAX == local_vertices[indices[3 * triangle + corner]])
+                ++new_vertices;
+        }
+        return new_vertices;
+    };
+
+    while (emitted_count < triangle_count)
+    {
+        // Starts next to the previous meshlet if possible, for the locality of the vertices
+        uint32_t seed = UINT32_MAX;
+        for (const uint32_t vertex : meshlet_vertices)
+        {
+            for (uint32_t i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1] && UINT32_MAX == seed; ++i)
+            {
+                if (!emitted[adjacency[i]])
+                    seed = adjacency[i];
+            }
+            if (UINT32_MAX != seed)
+                break;
+        }
+        if (UINT32_MAX == seed)
+        {
+            while (emitted[seed_cursor])
+                ++seed_cursor;
+            seed = seed_cursor;
+        }
+        for (const uint32_t vertex : meshlet_vertices)
+            local_vertices[vertex] = UINT32_MAX;
+        meshlet_vertices.clear();
+        meshlet_triangles.clear();
+        position_sum = glm::vec3(0.0f);
+        add_triangle(seed);
+
+        // Grows through the neighbours: the fewest new vertices first, then the closest
+        while (meshlet_triangles.size() < max_triangles)
+        {
+            const glm::vec3 center = position_sum / static_cast<float>(meshlet_vertices.size());
+            uint32_t best_triangle = UINT32_MAX;
+            uint32_t best_new_vertices = 4;
+            float best_distance = std::numeric_limits<float>::max();
+            for (const uint32_t vertex : meshlet_vertices)
+            {
+                for (uint32_t i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; ++i)
+                {
+                    const uint32_t triangle = adjacency[i];
+                    if (emitted[triangle])
+                        continue;
+                    const uint32_t new_vertices = count_new_vertices(triangle);
+                    if (meshlet_vertices.size() + new_vertices > max_vertices || new_vertices > best_new_vertices)
+                        continue;
+                    const glm::vec3 centroid = (positions[indices[3 * triangle]] + positions[indices[3 * triangle + 1]] + positions[indices[3 * triangle + 2]]) / 3.0f;
+                    const float distance = glm::dot(centroid - center, centroid - center);
+                    if (new_vertices < best_new_vertices || distance < best_distance)
+                    {
+                        best_triangle = triangle;
+                        best_new_vertices = new_vertices;
+                        best_distance = distance;
+                    }
+                }
+            }
+            // No neighbour left, or none fits
+            if (UINT32_MAX == best_triangle)
+                break;
+            add_triangle(best_triangle);
+        }
+
+        Meshlet meshlet{
+            .m_vertex_offset = static_cast<uint32_t>(meshlet_mesh.m_vertices.size()),
+            .m_triangle_offset = static_cast<uint32_t>(meshlet_mesh.m_triangles.size()),
+            .m_vertex_count = static_cast<uint32_t>(meshlet_vertices.size()),
+            .m_triangle_count = static_cast<uint32_t>(meshlet_triangles.size()),
+        };
+        meshlet_mesh.m_vertices.insert(meshlet_mesh.m_vertices.end(), meshlet_vertices.begin(), meshlet_vertices.end());
+        for (const uint32_t triangle : meshlet_triangles)
+        {
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                const uint32_t vertex = indices[3 * triangle + corner];
+                meshlet_mesh.m_triangles.push_back(static_cast<uint8_t>(local_vertices[vertex]));
+                meshlet_mesh.m_indices.push_back(vertex);
+            }
+        }
+        computeBounds(meshlet, meshlet_mesh, positions);
+        meshlet_mesh.m_meshlets.push_back(meshlet);
+    }
+    return utils::Result<MeshletMesh>::Ok(meshlet_mesh);
+}
+
+app::graphics::MeshletCulling::MeshletCulling(){};
+
+app::graphics::MeshletCulling::~MeshletCulling()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    if (VK_NULL_HANDLE != m_mesh_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_mesh_pipeline, nullptr);
+        m_mesh_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_mesh_pipeline_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_mesh_pipeline_layout, nullptr);
+        m_mesh_pipeline_layout = VK_NULL_HANDLE;
+    }
+    m_pass = nullptr;
+    m_meshlet_buffer = nullptr;
+    m_instance_buffer = nullptr;
+    m_cluster_buffer = nullptr;
+    m_draw_buffer = nullptr;
+    m_no_occlusion_buffer = nullptr;
+    m_vertex_buffer = nullptr;
+    m_triangle_buffer = nullptr;
+    m_position_buffer = nullptr;
+    m_occlusion_queries = nullptr;
+    m_meshes.clear();
+    m_meshlets.clear();
+    m_instances.clear();
+    m_clusters.clear();
+};
+
+utils::VResult app::graphics::MeshletCulling::create(
+    const uint32_t max_meshlets,
+    const uint32_t max_vertices,
+    const uint32_t max_instances,
+    const uint32_t max_clusters,
+    std::shared_ptr<app::graphics::OcclusionQueries> occlusion_queries)
+{
+    // The mesh shaders replace the main subpass draws: they would need a depth-only
+    // variant for the pre-pass
+    const bool mesh_shaders = Project::MESHLET_MESH_SHADERS &&
+                              !Project::DEPTH_PRE_PASS &&
+                              app::Engine::getInstance()->m_graphics_device.supportsMeshShaders();
+    Log("> Creating the meshlet culling (%d meshlets, %d instances, %d clusters, %s)",
+        max_meshlets,
+        max_instances,
+        max_clusters,
+        mesh_shaders ? "mesh shaders" : "compute pass");
+    m_max_meshlets = max_meshlets;
+    m_max_vertices = max_vertices;
+    m_max_instances = max_instances;
+    m_max_clusters = max_clusters;
+    m_occlusion_queries = occlusion_queries;
+    m_meshlets.reserve(m_max_meshlets);
+    m_instances.reserve(m_max_instances);
+    m_clusters.reserve(m_max_clusters);
+
+    m_meshlet_buffer = std::make_shared<app::graphics::Buffer>();
+    m_instance_buffer = std::make_shared<app::graphics::Buffer>();
+    m_cluster_buffer = std::make_shared<app::graphics::Buffer>();
+    m_draw_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_meshlet_buffer->create(std::max(m_max_meshlets, 1u) * sizeof(GpuMeshlet), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    if (const auto result = m_instance_buffer->create(std::max(m_max_instances, 1u) * sizeof(GpuInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    if (const auto result = m_cluster_buffer->create(std::max(m_max_clusters, 1u) * sizeof(GpuCluster), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    // The count, then the draws (none with mesh shaders)
+    const uint32_t draw_capacity = mesh_shaders ? 1u : std::max(m_max_clusters, 1u);
+    if (const auto result = m_draw_buffer->create(
+            DRAW_OFFSET + draw_capacity * sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            false);
+        result.IsError())
+        return result;
+    VkBuffer occlusion_results = VK_NULL_HANDLE;
+    if (nullptr != m_occlusion_queries && nullptr != m_occlusion_queries->getResultBuffer())
+    {
+        occlusion_results = m_occlusion_queries->getResultBuffer()->getBuffer();
+    }
+    else
+    {
+        // Never read: no result is in range without conditional rendering
+        m_no_occlusion_buffer = std::make_shared<app::graphics::Buffer>();
+        if (const auto result = m_no_occlusion_buffer->create(4 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false); result.IsError())
+            return result;
+        occlusion_results = m_no_occlusion_buffer->getBuffer();
+    }
+
+    // The tables are also read by the task and mesh shaders
+    VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT;
+#ifdef VK_EXT_mesh_shader
+    if (mesh_shaders)
+        stages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+#endif
+    std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr},                      // Meshlets
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr},                      // Instances
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr},                      // Clusters
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr},                      // Occlusion results
+        {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Indirect draws
+    };
+#ifdef VK_EXT_mesh_shader
+    if (mesh_shaders)
+    {
+        m_vertex_buffer = std::make_shared<app::graphics::Buffer>();
+        m_triangle_buffer = std::make_shared<app::graphics::Buffer>();
+        m_position_buffer = std::make_shared<app::graphics::Buffer>();
+        if (const auto result = m_vertex_buffer->create(std::max(m_max_vertices, 1u) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+            return result;
+        if (const auto result = m_triangle_buffer->create(2 * std::max(m_max_vertices, 1u) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+            return result;
+        if (const auto result = m_position_buffer->create(std::max(m_max_vertices, 1u) * sizeof(glm::vec4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+            return result;
+        bindings.push_back({5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_MESH_BIT_EXT, nullptr}); // Meshlet vertices
+        bindings.push_back({6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_MESH_BIT_EXT, nullptr}); // Meshlet triangles
+        bindings.push_back({7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_MESH_BIT_EXT, nullptr}); // Positions
+    }
+#endif
+    m_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_pass->create("shaders/meshlet_cull.comp.spv", bindings, sizeof(PushConstants), 1, true); result.IsError())
+    {
+        LogE("Error creating the meshlet culling pass");
+        return result;
+    }
+    m_pass->writeBuffer(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_meshlet_buffer->getBuffer());
+    m_pass->writeBuffer(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_instance_buffer->getBuffer());
+    m_pass->writeBuffer(0, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_cluster_buffer->getBuffer());
+    m_pass->writeBuffer(0, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, occlusion_results);
+    m_pass->writeBuffer(0, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_draw_buffer->getBuffer());
+    if (!mesh_shaders)
+        return utils::VResult::Ok();
+
+#ifdef VK_EXT_mesh_shader
+    m_pass->writeBuffer(0, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_vertex_buffer->getBuffer());
+    m_pass->writeBuffer(0, 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_triangle_buffer->getBuffer());
+    m_pass->writeBuffer(0, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_position_buffer->getBuffer());
+    m_draw_mesh_tasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(
+        vkGetDeviceProcAddr(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), "vkCmdDrawMeshTasksEXT"));
+    if (nullptr == m_draw_mesh_tasks)
+    {
+        LogW("> vkCmdDrawMeshTasksEXT not found: the meshlets are culled by the compute pass");
+        return utils::VResult::Ok();
+    }
+    return createMeshPipeline();
+#else
+    return utils::VResult::Ok();
+#endif
+}
+
+#ifdef VK_EXT_mesh_shader
+utils::VResult app::graphics::MeshletCulling::createMeshPipeline()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    const auto graphics_pipeline = app::Engine::getInstance()->m_render->getGraphicsPipeline();
+
+    // Set 0 is the lights of the scene fragment shader, as in the scene pipeline layout
+    const VkDescriptorSetLayout set_layouts[2] = {
+        app::Engine::getInstance()->m_render->getClusteredLighting()->getDescriptorSetLayout(),
+        m_pass->getDescriptorSetLayout(),
+    };
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 2,
+        .pSetLayouts = set_layouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+    if (const auto result = vkCreatePipelineLayout(graphics_device, &pipeline_layout_create_info, nullptr, &m_mesh_pipeline_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for the meshlets", result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the meshlets");
+    }
+
+    // The fragment shader of the scene: same inputs as from its vertex shader
+    const char* shader_filepaths[3] = {
+        "shaders/meshlet.task.spv",
+        "shaders/meshlet.mesh.spv",
+        Project::DEFERRED_SHADING ? "shaders/gbuffer.frag.spv" : "shaders/basic_triangle.frag.spv",
+    };
+    const VkShaderStageFlagBits shader_stages[3] = {VK_SHADER_STAGE_TASK_BIT_EXT, VK_SHADER_STAGE_MESH_BIT_EXT, VK_SHADER_STAGE_FRAGMENT_BIT};
+    VkShaderModule shader_modules[3] = {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkPipelineShaderStageCreateInfo shader_stage_create_infos[3];
+    const auto destroy_shader_modules = [&]() {
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            if (VK_NULL_HANDLE != shader_modules[i])
+                vkDestroyShaderModule(graphics_device, shader_modules[i], nullptr);
+        }
+    };
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const auto shader_module_result = app::graphics::Pipeline::loadShaderModule(shader_filepaths[i]);
+        if (shader_module_result.IsError())
+        {
+            destroy_shader_modules();
+            return utils::VResult::Error((char*)"Cannot create the shader modules of the meshlets");
+        }
+        shader_modules[i] = shader_module_result.GetValue();
+        shader_stage_create_infos[i] = VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = shader_stages[i],
+            .module = shader_modules[i],
+            .pName = "main",
+        };
+    }
+
+    // No vertex input nor input assembly: the mesh shaders output the triangles.
+    // Same viewport and scissor as the scene
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    // Same rasterization as the scene pipeline: the cones cull whole meshlets, the
+    // rasterizer the remaining back faces
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_BACK_BIT,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = app::Engine::getInstance()->m_render->getSampleCount(),
+        .sampleShadingEnable = VK_FALSE,
+    };
+    // Never with the depth pre-pass (see create)
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = app::graphics::Depth::getCompareOp(),
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    // The color (or the G-buffer) and the motion vectors, written unmodified
+    const std::vector<VkPipelineColorBlendAttachmentState> color_blend_attachments(
+        graphics_pipeline->getMainColorAttachmentCount(),
+        VkPipelineColorBlendAttachmentState{
+            .blendEnable = VK_FALSE,
+            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        });
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = static_cast<uint32_t>(color_blend_attachments.size()),
+        .pAttachments = color_blend_attachments.data(),
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 3,
+        .pStages = shader_stage_create_infos,
+        .pVertexInputState = nullptr,
+        .pInputAssemblyState = nullptr,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_mesh_pipeline_layout,
+        .renderPass = graphics_pipeline->getRenderPass(),
+        .subpass = graphics_pipeline->getMainSubpass(),
+    };
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_mesh_pipeline);
+    // The modules are not needed anymore once the pipeline is created
+    destroy_shader_modules();
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the meshlets", pipeline_result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline of the meshlets");
+    }
+    return utils::VResult::Ok();
+}
+#endif
+
+bool app::graphics::MeshletCulling::usesMeshShaders() const noexcept
+{
+    return VK_NULL_HANDLE != m_mesh_pipeline;
+}
+
+utils::Result<uint32_t> app::graphics::MeshletCulling::addMesh(
+    const MeshletMesh& meshlet_mesh,
+    const std::vector<glm::vec3>& positions,
+    const uint32_t first_index,
+    const int32_t vertex_offset)
+{
+    const bool mesh_shaders = usesMeshShaders();
+    const size_t triangle_count = meshlet_mesh.m_triangles.size() / 3;
+    if (m_meshlets.size() + meshlet_mesh.m_meshlets.size() > m_max_meshlets ||
+        (mesh_shaders && (m_vertex_count + meshlet_mesh.m_vertices.size() > m_max_vertices ||
+                          m_triangle_count + triangle_count > 2 * static_cast<size_t>(m_max_vertices) ||
+                          m_position_count + positions.size() > m_max_vertices)))
+    {
+        LogE("> The meshlet tables are full (%d meshlets, %d vertices)", m_max_meshlets, m_max_vertices);
+        return utils::Result<uint32_t>::Error((char*)"Too many meshlets for the meshlet tables");
+    }
+    if (mesh_shaders)
+    {
+        for (const Meshlet& meshlet : meshlet_mesh.m_meshlets)
+        {
+            // The outputs declared by the mesh shader
+            if (meshlet.m_vertex_count > Project::MESHLET_MAX_VERTICES || meshlet.m_triangle_count > Project::MESHLET_MAX_TRIANGLES)
+            {
+                LogE("> A meshlet of %d vertices and %d triangles exceeds the mesh shader outputs", meshlet.m_vertex_count, meshlet.m_triangle_count);
+                return utils::Result<uint32_t>::Error((char*)"A meshlet is too large for the mesh shaders");
+            }
+        }
+    }
+
+    const uint32_t first_meshlet = static_cast<uint32_t>(m_meshlets.size());
+    for (const Meshlet& meshlet : meshlet_mesh.m_meshlets)
+    {
+        m_meshlets.push_back(GpuMeshlet{
+            .m_sphere = glm::vec4(meshlet.m_center, meshlet.m_radius),
+            .m_cone = glm::vec4(meshlet.m_cone_axis, meshlet.m_cone_cutoff),
+            .m_first_index = first_index + meshlet.m_triangle_offset,
+            .m_triangle_count = meshlet.m_triangle_count,
+            .m_first_vertex = m_vertex_count + meshlet.m_vertex_offset,
+            .m_vertex_count = meshlet.m_vertex_count,
+            .m_first_triangle = m_triangle_count + meshlet.m_triangle_offset / 3,
+            .m_vertex_offset = vertex_offset,
+            .m_padding = {0, 0},
+        });
+    }
+    m_meshes.push_back(Mesh{
+        .m_first_meshlet = first_meshlet,
+        .m_meshlet_count = static_cast<uint32_t>(meshlet_mesh.m_meshlets.size()),
+    });
+    // Meshes are added at load time: no GPU pass reads the tables yet
+    if (!meshlet_mesh.m_meshlets.empty())
+        m_meshlet_buffer->write(&m_meshlets[first_meshlet], meshlet_mesh.m_meshlets.size() * sizeof(GpuMeshlet), first_meshlet * sizeof(GpuMeshlet));
+
+    if (mesh_shaders)
+    {
+        // The vertices of the meshlets index the positions of all the meshes
+        std::vector<uint32_t> vertices(meshlet_mesh.m_vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i)
+            vertices[i] = m_position_count + meshlet_mesh.m_vertices[i];
+        std::vector<uint32_t> triangles(triangle_count);
+        for (size_t i = 0; i < triangles.size(); ++i)
+        {
+            triangles[i] = static_cast<uint32_t>(meshlet_mesh.m_triangles[3 * i]) |
+                           static_cast<uint32_t>(meshlet_mesh.m_triangles[3 * i + 1]) << 8 |
+                           static_cast<uint32_t>(meshlet_mesh.m_triangles[3 * i + 2]) << 16;
+        }
+        std::vector<glm::vec4> padded_positions(positions.size());
+        for (size_t i = 0; i < positions.size(); ++i)
+            padded_positions[i] = glm::vec4(positions[i], 1.0f);
+        if (!vertices.empty())
+            m_vertex_buffer->write(vertices.data(), vertices.size() * sizeof(uint32_t), m_vertex_count * sizeof(uint32_t));
+        if (!triangles.empty())
+            m_triangle_buffer->write(triangles.data(), triangles.size() * sizeof(uint32_t), m_triangle_count * sizeof(uint32_t));
+        if (!padded_positions.empty())
+            m_position_buffer->write(padded_positions.data(), padded_positions.size() * sizeof(glm::vec4), m_position_count * sizeof(glm::vec4));
+        m_vertex_count += static_cast<uint32_t>(vertices.size());
+        m_triangle_count += static_cast<uint32_t>(triangles.size());
+        m_position_count += static_cast<uint32_t>(positions.size());
+    }
+    return utils::Result<uint32_t>::Ok(static_cast<uint32_t>(m_meshes.size() - 1));
+}
+
+void app::graphics::MeshletCulling::setInstances(const std::vector<MeshletInstance>& instances)
+{
+    if (instances.size() > m_max_instances)
+        LogW("> More meshlet instances than the maximum of %d: the extra ones are ignored", m_max_instances);
+    const size_t instance_count = std::min(instances.size(), static_cast<size_t>(m_max_instances));
+    const size_t previous_cluster_count = m_clusters.size();
+    m_instances.clear();
+    m_clusters.clear();
+    bool clusters_full = false;
+    for (size_t i = 0; i < instance_count; ++i)
+    {
+        const MeshletInstance& instance = instances[i];
+        assert(instance.m_mesh < m_meshes.size());
+        // The cones are rotated with the meshlets: the transform must keep the angles
+        // and the orientation of the normals
+        const glm::mat3 linear = glm::mat3(instance.m_transform);
+        const glm::vec3 scales = glm::vec3(glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]));
+        const float max_scale = std::max({scales.x, scales.y, scales.z});
+        const float min_scale = std::min({scales.x, scales.y, scales.z});
+        const float max_dot = CONFORMAL_TOLERANCE * max_scale * max_scale;
+        const bool cone_test = glm::determinant(linear) > 0.0f &&
+                               min_scale >= (1.0f - CONFORMAL_TOLERANCE) * max_scale &&
+                               std::abs(glm::dot(linear[0], linear[1])) <= max_dot &&
+                               std::abs(glm::dot(linear[0], linear[2])) <= max_dot &&
+                               std::abs(glm::dot(linear[1], linear[2])) <= max_dot;
+        m_instances.push_back(GpuInstance{
+            .m_transform = instance.m_transform,
+            .m_scale = glm::vec4(max_scale, cone_test ? 1.0f : 0.0f, 0.0f, 0.0f),
+            .m_occlusion = glm::uvec4(instance.m_occlusion_object, 0, 0, 0),
+        });
+        // Hidden in the readback of the previous frame (always visible with conditional
+        // rendering: the culling reads the results on the GPU)
+        if (UINT32_MAX != instance.m_occlusion_object && nullptr != m_occlusion_queries && !m_occlusion_queries->isVisible(instance.m_occlusion_object))
+            continue;
+        const Mesh& mesh = m_meshes[instance.m_mesh];
+        if (m_clusters.size() + mesh.m_meshlet_count > m_max_clusters)
+        {
+            clusters_full = true;
+            continue;
+        }
+        for (uint32_t meshlet = 0; meshlet < mesh.m_meshlet_count; ++meshlet)
+        {
+            m_clusters.push_back(GpuCluster{
+                .m_instance = static_cast<uint32_t>(i),
+                .m_meshlet = mesh.m_first_meshlet + meshlet,
+            });
+        }
+    }
+    if (clusters_full)
+        LogW("> More meshlets than the maximum of %d: some instances are not drawn", m_max_clusters);
+    // The cached draws of the scene read the previous number of meshlets: the maximum count
+    // of the indirect draws, or the task workgroups launched with mesh shaders
+    if (m_clusters.size() != previous_cluster_count)
+        app::Engine::getInstance()->m_render->getGraphicsCommand()->invalidateStatic();
+}
+
+app::graphics::MeshletCulling::PushConstants app::graphics::MeshletCulling::getPushConstants(const app::graphics::Camera& camera, const VkExtent2D& render_extent, const glm::vec2& jitter) const
+{
+    const float aspect = static_cast<float>(render_extent.width) / static_cast<float>(render_extent.height);
+    const auto result_buffer = nullptr != m_occlusion_queries ? m_occlusion_queries->getResultBuffer() : nullptr;
+    return PushConstants{
+        .m_view_projection = camera.getProjection(aspect) * camera.getView(),
+        .m_eye = glm::vec4(glm::vec3(glm::inverse(camera.getView())[3]), 1.0f),
+        .m_jitter = glm::vec4(jitter, 0.0f, 0.0f),
+        .m_counts = glm::uvec4(
+            static_cast<uint32_t>(m_clusters.size()),
+            nullptr != result_buffer ? m_occlusion_queries->getPreviousFirstResult() : 0,
+            nullptr != result_buffer ? m_occlusion_queries->getPreviousResultCount() : 0,
+            0),
+    };
+}
+
+void app::graphics::MeshletCulling::record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent)
+{
+    if (m_clusters.empty())
+        return;
+    m_instance_buffer->write(m_instances.data(), m_instances.size() * sizeof(GpuInstance));
+    m_cluster_buffer->write(m_clusters.data(), m_clusters.size() * sizeof(GpuCluster));
+
+#ifdef VK_EXT_mesh_shader
+    if (usesMeshShaders())
+    {
+        // The occlusion results of the previous frame, copied by its resolve, are read
+        // by the task shaders
+        VkMemoryBarrier before_task_shaders{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        };
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT,
+            0,
+            1, &before_task_shaders,
+            0, nullptr,
+            0, nullptr);
+        return;
+    }
+#endif
+
+    // The draws of the previous frame are done reading the buffer before it is cleared
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        0, nullptr);
+    vkCmdFillBuffer(command_buffer, m_draw_buffer->getBuffer(), 0, sizeof(uint32_t), 0);
+    // Without an indirect count all the draws are read: the culled ones draw nothing
+    if (!app::Engine::getInstance()->m_graphics_device.supportsDrawIndirectCount())
+        vkCmdFillBuffer(command_buffer, m_draw_buffer->getBuffer(), DRAW_OFFSET, m_clusters.size() * sizeof(VkDrawIndexedIndirectCommand), 0);
+
+    // The draw buffer is cleared, and the occlusion results of the previous frame are copied
+    VkMemoryBarrier before_culling{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &before_culling,
+        0, nullptr,
+        0, nullptr);
+
+    const PushConstants push_constants = getPushConstants(camera, render_extent, glm::vec2(0.0f));
+    m_pass->dispatch(command_buffer, 0, &push_constants, app::graphics::ComputePass::getGroupCount(static_cast<uint32_t>(m_clusters.size()), GROUP_SIZE), 1);
+
+    VkMemoryBarrier after_culling{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0,
+        1, &after_culling,
+        0, nullptr,
+        0, nullptr);
+}
+
+void app::graphics::MeshletCulling::draw(VkCommandBuffer command_buffer)
+{
+    if (usesMeshShaders() || m_clusters.empty())
+        return;
+    const VkBuffer draw_buffer = m_draw_buffer->getBuffer();
+    const uint32_t max_draw_count = static_cast<uint32_t>(m_clusters.size());
+    const auto& graphics_device = app::Engine::getInstance()->m_graphics_device;
+    if (graphics_device.supportsDrawIndirectCount())
+    {
+        vkCmdDrawIndexedIndirectCount(command_buffer, draw_buffer, DRAW_OFFSET, draw_buffer, 0, max_draw_count, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else if (graphics_device.supportsMultiDrawIndirect())
+    {
+        vkCmdDrawIndexedIndirect(command_buffer, draw_buffer, DRAW_OFFSET, max_draw_count, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else
+    {
+        for (uint32_t i = 0; i < max_draw_count; ++i)
+            vkCmdDrawIndexedIndirect(command_buffer, draw_buffer, DRAW_OFFSET + i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+void app::graphics::MeshletCulling::drawMeshTasks(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent, const glm::vec2& jitter)
+{
+#ifdef VK_EXT_mesh_shader
+    if (!usesMeshShaders() || m_clusters.empty())
+        return;
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_mesh_pipeline);
+    const VkDescriptorSet descriptor_sets[2] = {
+        app::Engine::getInstance()->m_render->getClusteredLighting()->getDescriptorSet(),
+        m_pass->getDescriptorSet(0),
+    };
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_mesh_pipeline_layout, 0, 2, descriptor_sets, 0, nullptr);
+    const PushConstants push_constants = getPushConstants(camera, render_extent, jitter);
+    vkCmdPushConstants(command_buffer, m_mesh_pipeline_layout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, 0, sizeof(PushConstants), &push_constants);
+    // A task workgroup per GROUP_SIZE meshlets, a mesh workgroup per visible meshlet
+    m_draw_mesh_tasks(command_buffer, app::graphics::ComputePass::getGroupCount(static_cast<uint32_t>(m_clusters.size()), GROUP_SIZE), 1, 1);
+#endif
+}
@@ -0,0 +1,305 @@
+//
+//  meshlets.hpp
+//
+
+#pragma once
+#ifndef meshlets_h
+#define meshlets_h
+
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include "camera.hpp"
+#include "compute.hpp"
+#include "occlusion.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief A cluster of neighbouring triangles of a mesh, culled as a whole
+        struct Meshlet
+        {
+            /// @brief The first vertex of the meshlet, in the vertices of the MeshletMesh
+            uint32_t m_vertex_offset = 0;
+            /// @brief The first local index of the meshlet, in the triangles of the MeshletMesh
+            /// (3 per triangle) - also its first index, in its indices
+            uint32_t m_triangle_offset = 0;
+            /// @brief The number of vertices of the meshlet
+            uint32_t m_vertex_count = 0;
+            /// @brief The number of triangles of the meshlet
+            uint32_t m_triangle_count = 0;
+            /// @brief The center of the bounding sphere, in mesh units
+            glm::vec3 m_center = glm::vec3(0.0f);
+            /// @brief The radius of the bounding sphere, in mesh units
+            float m_radius = 0.0f;
+            /// @brief The mean direction of the normals of the triangles
+            glm::vec3 m_cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+            /// @brief The sine of the half-angle of the cone of the normals, around the axis:
+            /// the meshlet faces away from the points where the cone test passes.
+            /// 1 if the normals are too spread out to cull the meshlet.
+            float m_cone_cutoff = 1.0f;
+        };
+
+        /// @brief The meshlets of a mesh, built at cook time
+        struct MeshletMesh
+        {
+            /// @brief The meshlets
+            std::vector<Meshlet> m_meshlets;
+            /// @brief The vertices of the meshlets: the indices of the mesh vertices they use
+            std::vector<uint32_t> m_vertices;
+            /// @brief The triangles of the meshlets: 3 indices in the vertices of their meshlet
+            std::vector<uint8_t> m_triangles;
+            /// @brief The triangles of the meshlets as mesh indices (3 per triangle), in the
+            /// order of `m_triangles`: an index buffer drawn one meshlet at a time
+            std::vector<uint32_t> m_indices;
+        };
+
+        /// @brief Splits the meshes in meshlets, at import or cook time.
+        ///
+        /// A meshlet grows from a triangle through its neighbours, preferring the ones that
+        /// add the fewest vertices, until it reaches its maximum number of vertices or of
+        /// triangles. Its bounding sphere and its normal cone are then computed for culling.
+        class MeshletBuilder
+        {
+        public:
+            /// @brief Builds the meshlets of a triangle list
+            /// @param positions The positions of the vertices of the mesh
+            /// @param indices The indices of the triangles of the mesh
+            /// @param max_vertices The maximum number of vertices of a meshlet (up to 256)
+            /// @param max_triangles The maximum number of triangles of a meshlet
+            /// @return The meshlets, or an error if the mesh is invalid
+            static utils::Result<MeshletMesh> build(
+                const std::vector<glm::vec3>& positions,
+                const std::vector<uint32_t>& indices,
+                const uint32_t max_vertices,
+                const uint32_t max_triangles);
+        };
+
+        /// @brief A mesh instance drawn by meshlets
+        struct MeshletInstance
+        {
+            /// @brief The mesh returned by `MeshletCulling::addMesh`
+            uint32_t m_mesh = 0;
+            /// @brief From mesh units to world space
+            glm::mat4 m_transform = glm::mat4(1.0f);
+            /// @brief The object of the instance in the occlusion queries, or UINT32_MAX
+            uint32_t m_occlusion_object = UINT32_MAX;
+        };
+
+        /// @brief Culls the meshlets of the mesh instances on the GPU: a meshlet outside of
+        /// the view frustum, facing away from the camera (normal cone), or of an instance
+        /// hidden in the previous frame (occlusion queries) is not drawn.
+        ///
+        /// Two paths:
+        /// - a compute pass tests each meshlet of each instance, and appends the visible
+        ///   ones to a compacted list of indexed indirect draws (one per meshlet, the
+        ///   instance as first instance), drawn with an indirect count if supported;
+        /// - with VK_EXT_mesh_shader, the task shaders run the same tests and launch
+        ///   a mesh shader workgroup per visible meshlet, which reads its vertices and its
+        ///   triangles from storage buffers: no compute pass, no indirect draws.
+        /// The tests are shared by both paths (`shaders/meshlet_culling.glsl`).
+        class MeshletCulling
+        {
+        public:
+            /// @brief The number of meshlets tested by a workgroup (compute or task shader)
+            static constexpr uint32_t GROUP_SIZE = 32;
+            /// @brief The position of the indirect draws in the draw buffer, after their count
+            static constexpr VkDeviceSize DRAW_OFFSET = 4 * sizeof(uint32_t);
+
+            /// @brief Public constructor
+            MeshletCulling();
+            /// @brief Public destructor
+            ~MeshletCulling();
+            /// @brief Creates the meshlet tables, the culling pass, and the mesh shader
+            /// pipeline if mesh shaders are enabled.
+            /// Should be called once the graphics pipeline and the occlusion queries are created.
+            /// @param max_meshlets The maximum number of meshlets of all the meshes
+            /// @param max_vertices The maximum number of meshlet vertices, and of mesh vertices,
+            /// of all the meshes (mesh shader path)
+            /// @param max_instances The maximum number of instances
+            /// @param max_clusters The maximum number of meshlets of all the instances
+            /// @param occlusion_queries The occlusion queries the instances refer to
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(
+                const uint32_t max_meshlets,
+                const uint32_t max_vertices,
+                const uint32_t max_instances,
+                const uint32_t max_clusters,
+                std::shared_ptr<app::graphics::OcclusionQueries> occlusion_queries);
+            /// @brief Returns if the meshlets are drawn with mesh shaders (`drawMeshTasks`),
+            /// rather than with the indirect draws of the culling pass (`draw`)
+            bool usesMeshShaders() const noexcept;
+            /// @brief Registers the meshlets of a mesh
+            /// @param meshlet_mesh The meshlets built by MeshletBuilder
+            /// @param positions The positions of the mesh vertices, read by the mesh shaders
+            /// (ignored without mesh shaders)
+            /// @param first_index The position of the meshlet indices in the index buffer of the
+            /// indirect draws
+            /// @param vertex_offset The position of the mesh vertices in the vertex buffer of the
+            /// indirect draws
+            /// @return The identifier of the mesh, or an error if the tables are full
+            utils::Result<uint32_t> addMesh(
+                const MeshletMesh& meshlet_mesh,
+                const std::vector<glm::vec3>& positions,
+                const uint32_t first_index,
+                const int32_t vertex_offset);
+            /// @brief Sets the instances to draw, each frame (the first instance of their draws
+            /// is their index here). Without conditional rendering, the meshlets of the
+            /// instances hidden in the readback of the previous frame are not even tested.
+            void setInstances(const std::vector<MeshletInstance>& instances);
+            /// @brief Culls the meshlets with the compute pass, and writes the indirect draws.
+            /// With mesh shaders, only uploads the instances (the task shaders cull).
+            /// Should be recorded outside of any render pass, before the scene.
+            /// @param command_buffer The command buffer being recorded
+            /// @param camera The point of view of the frame
+            /// @param render_extent The extent the scene is rendered at
+            void record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent);
+            /// @brief Records the indirect draws of the visible meshlets (compute path).
+            /// The pipeline, the vertex and the index buffers of the meshes should be bound:
+            /// the first instance of a draw is the index of its instance.
+            /// @param command_buffer The command buffer being recorded
+            void draw(VkCommandBuffer command_buffer);
+            /// @brief Culls and draws the meshlets with the task and mesh shaders, in the main
+            /// subpass of the scene (mesh shader path). Binds its own pipeline and the lights
+            /// (set 0): the scene pipeline and its sets have to be bound again afterwards.
+            /// @param command_buffer The command buffer being recorded
+            /// @param camera The point of view of the frame
+            /// @param render_extent The extent the scene is rendered at
+            /// @param jitter The sub-pixel offset of the projection of the scene, in NDC units
+            void drawMeshTasks(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent, const glm::vec2& jitter);
+
+        private:
+            /// @brief A meshlet, as read by the shaders (std430)
+            struct GpuMeshlet
+            {
+                /// @brief The center (xyz) and the radius (w) of the bounding sphere, in mesh units
+                glm::vec4 m_sphere;
+                /// @brief The axis (xyz) and the cutoff (w) of the normal cone
+                glm::vec4 m_cone;
+                /// @brief The first index of the meshlet in the index buffer of the indirect draws
+                uint32_t m_first_index;
+                /// @brief The number of triangles of the meshlet
+                uint32_t m_triangle_count;
+                /// @brief The first vertex of the meshlet in the meshlet vertex buffer
+                uint32_t m_first_vertex;
+                /// @brief The number of vertices of the meshlet
+                uint32_t m_vertex_count;
+                /// @brief The first triangle of the meshlet in the meshlet triangle buffer
+                uint32_t m_first_triangle;
+                /// @brief The position of the mesh vertices in the vertex buffer of the indirect draws
+                int32_t m_vertex_offset;
+                /// @brief Unused
+                uint32_t m_padding[2];
+            };
+            /// @brief An instance, as read by the shaders (std430)
+            struct GpuInstance
+            {
+                /// @brief From mesh units to world space
+                glm::mat4 m_transform;
+                /// @brief The largest scale of the transform (x), 1 if the normal cones can be
+                /// tested (y: no mirroring, nor non-uniform scale), zw unused
+                glm::vec4 m_scale;
+                /// @brief The object of the instance in the occlusion queries (x, UINT32_MAX
+                /// if none), yzw unused
+                glm::uvec4 m_occlusion;
+            };
+            /// @brief A meshlet of an instance to test
+            struct GpuCluster
+            {
+                /// @brief The instance
+                uint32_t m_instance;
+                /// @brief The meshlet, in the meshlet table
+                uint32_t m_meshlet;
+            };
+            /// @brief The push constants of the culling and of the mesh shaders (112 bytes, under
+            /// the 128 bytes guaranteed: the frustum planes are extracted by the shaders)
+            struct PushConstants
+            {
+                /// @brief From world space to clip space, unjittered
+                glm::mat4 m_view_projection;
+                /// @brief The position of the camera, in world space (w unused)
+                glm::vec4 m_eye;
+                /// @brief The jitter of the projection (xy), in NDC units, zw unused
+                glm::vec4 m_jitter;
+                /// @brief The number of clusters, the first occlusion result of the previous
+                /// frame, the number of occlusion results, w unused
+                glm::uvec4 m_counts;
+            };
+            /// @brief A mesh: its range of meshlets in the meshlet table
+            struct Mesh
+            {
+                /// @brief The first meshlet of the mesh
+                uint32_t m_first_meshlet;
+                /// @brief The number of meshlets of the mesh
+                uint32_t m_meshlet_count;
+            };
+            /// @brief MeshletCulling should not be cloneable
+            MeshletCulling(MeshletCulling& other) = delete;
+            /// @brief MeshletCulling should not be assignable
+            void operator=(const MeshletCulling& other) = delete;
+#ifdef VK_EXT_mesh_shader
+            /// @brief Creates the task and mesh shader pipeline, in the main subpass of the scene
+            utils::VResult createMeshPipeline();
+#endif
+            /// @brief Returns the push constants of the culling, for a frame
+            PushConstants getPushConstants(const app::graphics::Camera& camera, const VkExtent2D& render_extent, const glm::vec2& jitter) const;
+            /// @brief The meshes
+            std::vector<Mesh> m_meshes;
+            /// @brief The meshlets of all the meshes
+            std::vector<GpuMeshlet> m_meshlets;
+            /// @brief The instances of the frame
+            std::vector<GpuInstance> m_instances;
+            /// @brief The meshlets of the instances of the frame, to test
+            std::vector<GpuCluster> m_clusters;
+            /// @brief The number of meshlet vertices of all the meshes
+            uint32_t m_vertex_count = 0;
+            /// @brief The number of meshlet triangles of all the meshes
+            uint32_t m_triangle_count = 0;
+            /// @brief The number of mesh vertices read by the mesh shaders
+            uint32_t m_position_count = 0;
+            /// @brief The maximum number of meshlets of all the meshes
+            uint32_t m_max_meshlets = 0;
+            /// @brief The maximum number of meshlet vertices, and of mesh vertices, of all the meshes
+            uint32_t m_max_vertices = 0;
+            /// @brief The maximum number of instances
+            uint32_t m_max_instances = 0;
+            /// @brief The maximum number of meshlets of all the instances
+            uint32_t m_max_clusters = 0;
+            /// @brief The occlusion queries the instances refer to
+            std::shared_ptr<app::graphics::OcclusionQueries> m_occlusion_queries = nullptr;
+            /// @brief The meshlet table (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_meshlet_buffer = nullptr;
+            /// @brief The instances (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_instance_buffer = nullptr;
+            /// @brief The meshlets of the instances to test (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_cluster_buffer = nullptr;
+            /// @brief The compacted indirect draws, then their count (compute path)
+            std::shared_ptr<app::graphics::Buffer> m_draw_buffer = nullptr;
+            /// @brief Bound in place of the occlusion results without conditional rendering
+            std::shared_ptr<app::graphics::Buffer> m_no_occlusion_buffer = nullptr;
+            /// @brief The vertices of the meshlets, as mesh vertex indices (mesh shader path)
+            std::shared_ptr<app::graphics::Buffer> m_vertex_buffer = nullptr;
+            /// @brief The triangles of the meshlets, packed in a uint32 each (mesh shader path)
+            std::shared_ptr<app::graphics::Buffer> m_triangle_buffer = nullptr;
+            /// @brief The positions of the mesh vertices (mesh shader path)
+            std::shared_ptr<app::graphics::Buffer> m_position_buffer = nullptr;
+            /// @brief The culling pass (compute path). Its descriptor set is also bound by the
+            /// task and mesh shaders.
+            std::shared_ptr<app::graphics::ComputePass> m_pass = nullptr;
+            /// @brief The layout of the mesh shader pipeline: the lights (set 0), the meshlets (set 1)
+            VkPipelineLayout m_mesh_pipeline_layout = VK_NULL_HANDLE;
+            /// @brief Culls and draws the meshlets with task and mesh shaders
+            VkPipeline m_mesh_pipeline = VK_NULL_HANDLE;
+#ifdef VK_EXT_mesh_shader
+            /// @brief Loaded from the device if mesh shaders are enabled
+            PFN_vkCmdDrawMeshTasksEXT m_draw_mesh_tasks = nullptr;
+#endif
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // meshlets_h
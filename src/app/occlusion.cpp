@@ -0,0 +1,455 @@
+//
+//  occlusion.cpp
+//
+
+#include "occlusion.hpp"
+#include "../project.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include "pipeline.hpp"
+
+/// @brief The number of vertices of the proxy: a cube as a single triangle strip
+constexpr uint32_t PROXY_VERTEX_COUNT = 14;
+
+app::graphics::OcclusionQueries::OcclusionQueries(){};
+
+app::graphics::OcclusionQueries::~OcclusionQueries()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    if (VK_NULL_HANDLE != m_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_pipeline_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_pipeline_layout, nullptr);
+        m_pipeline_layout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_query_pool)
+    {
+        vkDestroyQueryPool(graphics_device, m_query_pool, nullptr);
+        m_query_pool = VK_NULL_HANDLE;
+    }
+    m_result_buffer = nullptr;
+    m_objects.clear();
+    m_queried.clear();
+    m_visible.clear();
+};
+
+utils::VResult app::graphics::OcclusionQueries::create(const uint32_t max_objects)
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    m_max_objects = max_objects;
+    m_objects.reserve(m_max_objects);
+    m_queried.assign(Project::FRAMES_IN_FLIGHT * m_max_objects, false);
+    m_visible.assign(m_max_objects, true);
+
+    VkQueryPoolCreateInfo query_pool_create_info{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_OCCLUSION,
+        .queryCount = Project::FRAMES_IN_FLIGHT * m_max_objects,
+    };
+    if (const auto result = vkCreateQueryPool(graphics_device, &query_pool_create_info, nullptr, &m_query_pool); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateQueryPool: error 0x%08x for the occlusion queries", result);
+        return utils::VResult::Error((char*)"Cannot create the occlusion query pool");
+    }
+
+    if (app::Engine::getInstance()->m_graphics_device.supportsConditionalRendering())
+    {
+        m_begin_conditional_rendering = reinterpret_cast<PFN_vkCmdBeginConditionalRenderingEXT>(
+            vkGetDeviceProcAddr(graphics_device, "vkCmdBeginConditionalRenderingEXT"));
+        m_end_conditional_rendering = reinterpret_cast<PFN_vkCmdEndConditionalRenderingEXT>(
+            vkGetDeviceProcAddr(graphics_device, "vkCmdEndConditionalRenderingEXT"));
+    }
+    if (nullptr != m_begin_conditional_rendering && nullptr != m_end_conditional_rendering)
+    {
+        m_result_buffer = std::make_shared<app::graphics::Buffer>();
+        if (const auto result = m_result_buffer->create(
+                Project::FRAMES_IN_FLIGHT * m_max_objects * sizeof(uint32_t),
+                VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                false);
+            result.IsError())
+        {
+            LogE("Error creating the result buffer of the occlusion queries");
+            return result;
+        }
+    }
+    Log("> Occlusion queries: %d objects, results %s", m_max_objects, isConditional() ? "on the GPU (conditional rendering)" : "read back one frame later");
+
+    return createPipeline();
+}
+
+utils::VResult app::graphics::OcclusionQueries::createPipeline()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    const auto graphics_pipeline = app::Engine::getInstance()->m_render->getGraphicsPipeline();
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 0,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+    if (const auto result = vkCreatePipelineLayout(graphics_device, &pipeline_layout_create_info, nullptr, &m_pipeline_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for the occlusion proxies", result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the occlusion proxies");
+    }
+
+    const char* shader_filepath = "shaders/occlusion_proxy.vert.spv";
+    const auto shader_module_result = app::graphics::Pipeline::loadShaderModule(shader_filepath);
+    if (shader_module_result.IsError())
+        return utils::VResult::Error((char*)"Cannot create the shader module of the occlusion proxies");
+    const VkShaderModule shader_module = shader_module_result.GetValue();
+    // No fragment shader: only the depth test matters
+    VkPipelineShaderStageCreateInfo shader_stage{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+        .module = shader_module,
+        .pName = "main",
+    };
+
+    // The corners of the box are generated from gl_VertexIndex
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    };
+    VkPipelineInputAssemblyStateCreateInfo assembly_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    // Same viewport and scissor as the scene
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    // No culling: the back faces count when the front faces are clipped
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = app::Engine::getInstance()->m_render->getSampleCount(),
+        .sampleShadingEnable = VK_FALSE,
+    };
+    // A box that touches the surface it lies on still counts as visible
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_FALSE,
+        .depthCompareOp = Project::DEPTH_REVERSED_Z ? VK_COMPARE_OP_GREATER_OR_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    // The subpass writes color (or G-buffer) and motion vectors: none of them is touched
+    VkPipelineColorBlendAttachmentState color_blend_attachment{
+        .blendEnable = VK_FALSE,
+        .colorWriteMask = 0,
+    };
+    const std::vector<VkPipelineColorBlendAttachmentState> color_blend_attachments(
+        graphics_pipeline->getMainColorAttachmentCount(),
+        color_blend_attachment);
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = static_cast<uint32_t>(color_blend_attachments.size()),
+        .pAttachments = color_blend_attachments.data(),
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 1,
+        .pStages = &shader_stage,
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &assembly_state_create_info,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_pipeline_layout,
+        .renderPass = graphics_pipeline->getRenderPass(),
+        .subpass = graphics_pipeline->getMainSubpass(),
+    };
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_pipeline);
+    // The module is not needed anymore once the pipeline is created
+    vkDestroyShaderModule(graphics_device, shader_module, nullptr);
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the occlusion proxies", pipeline_result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline of the occlusion proxies");
+    }
+    return utils::VResult::Ok();
+}
+
+bool app::graphics::OcclusionQueries::isConditional() const noexcept
+{
+    return nullptr != m_result_buffer;
+}
+
+uint32_t app::graphics::OcclusionQueries::addObject(const glm::vec3& min, const glm::vec3& max)
+{
+    if (m_objects.size() >= m_max_objects)
+        return UINT32_MAX;
+    m_objects.push_back(Object{
+        .m_min = min,
+        .m_max = max,
+    });
+    return static_cast<uint32_t>(m_objects.size() - 1);
+}
+
+void app::graphics::OcclusionQueries::setBounds(const uint32_t object_id, const glm::vec3& min, const glm::vec3& max)
+{
+    if (object_id >= m_objects.size())
+        return;
+    m_objects[object_id].m_min = min;
+    m_objects[object_id].m_max = max;
+}
+
+void app::graphics::OcclusionQueries::clearObjects() noexcept
+{
+    m_objects.clear();
+    // The results of the forgotten objects must not gate the next ones
+    for (uint32_t slot = 0; slot < Project::FRAMES_IN_FLIGHT; ++slot)
+        m_recorded_counts[slot] = 0;
+}
+
+uint32_t app::graphics::OcclusionQueries::getObjectCount() const noexcept
+{
+    return static_cast<uint32_t>(m_objects.size());
+}
+
+uint32_t app::graphics::OcclusionQueries::getFirstQuery(const uint32_t slot) const noexcept
+{
+    return slot * m_max_objects;
+}
+
+uint32_t app::graphics::OcclusionQueries::getPreviousSlot() const noexcept
+{
+    return (m_slot + Project::FRAMES_IN_FLIGHT - 1) % Project::FRAMES_IN_FLIGHT;
+}
+
+void app::graphics::OcclusionQueries::beginFrame(VkCommandBuffer command_buffer)
+{
+    if (VK_NULL_HANDLE == m_query_pool)
+        return;
+    // The slot recorded by the previous frame is complete: read it back, one run of
+    // tested objects at a time (the others were never begun, and have no result)
+    const uint32_t first_query = getFirstQuery(m_slot);
+    const uint32_t recorded_count = m_recorded_counts[m_slot];
+    if (!isConditional())
+    {
+        std::vector<uint32_t> results;
+        uint32_t object_id = 0;
+        while (object_id < recorded_count)
+        {
+            const bool queried = m_queried[first_query + object_id];
+            uint32_t run_end = object_id + 1;
+            while (run_end < recorded_count && m_queried[first_query + run_end] == queried)
+                ++run_end;
+            if (queried)
+            {
+                // A result and its availability per query: no wait, an unavailable
+                // result keeps the object visible
+                const uint32_t run_count = run_end - object_id;
+                results.resize(2 * run_count);
+                const auto result = vkGetQueryPoolResults(
+                    app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+                    m_query_pool,
+                    first_query + object_id,
+                    run_count,
+                    results.size() * sizeof(uint32_t),
+                    results.data(),
+                    2 * sizeof(uint32_t),
+                    VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+                for (uint32_t i = 0; i < run_count; ++i)
+                {
+                    const bool available = (result == VK_SUCCESS || result == VK_NOT_READY) && 0 != results[2 * i + 1];
+                    m_visible[object_id + i] = !available || 0 != results[2 * i];
+                }
+            }
+            else
+            {
+                for (uint32_t i = object_id; i < run_end; ++i)
+                    m_visible[i] = true;
+            }
+            object_id = run_end;
+        }
+    }
+
+    // This frame writes the other slot, whose results have been consumed by the previous frame
+    m_slot = (m_slot + 1) % Project::FRAMES_IN_FLIGHT;
+    m_recorded_counts[m_slot] = 0;
+    vkCmdResetQueryPool(command_buffer, m_query_pool, getFirstQuery(m_slot), m_max_objects);
+}
+
+void app::graphics::OcclusionQueries::record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent, const glm::vec2& jitter)
+{
+    if (VK_NULL_HANDLE == m_pipeline || m_objects.empty())
+        return;
+    const float aspect = static_cast<float>(render_extent.width) / static_cast<float>(render_extent.height);
+    // The proxies are offset by the same sub-pixel jitter as the scene, to test against its depth
+    glm::mat4 jitter_matrix(1.0f);
+    jitter_matrix[3][0] = jitter.x;
+    jitter_matrix[3][1] = jitter.y;
+    PushConstants push_constants{
+        .m_view_projection = jitter_matrix * camera.getProjection(aspect) * camera.getView(),
+    };
+    // A box the near plane cuts is partly clipped, and could be reported hidden while
+    // the camera is inside it: such an object is not tested, and drawn
+    const glm::vec3 eye = glm::vec3(glm::inverse(camera.getView())[3]);
+    const float near_half_height = camera.getNear() * glm::tan(0.5f * camera.getFovY());
+    const float near_margin = glm::length(glm::vec3(near_half_height * aspect, near_half_height, camera.getNear()));
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    const uint32_t first_query = getFirstQuery(m_slot);
+    const uint32_t object_count = static_cast<uint32_t>(m_objects.size());
+    for (uint32_t object_id = 0; object_id < object_count; ++object_id)
+    {
+        const Object& object = m_objects[object_id];
+        const bool near_camera = glm::all(glm::greaterThanEqual(eye, object.m_min - near_margin)) &&
+                                 glm::all(glm::lessThanEqual(eye, object.m_max + near_margin));
+        m_queried[first_query + object_id] = !near_camera;
+        if (near_camera)
+            continue;
+        push_constants.m_min = glm::vec4(object.m_min, 0.0f);
+        push_constants.m_max = glm::vec4(object.m_max, 0.0f);
+        vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &push_constants);
+        // Not precise: any non-zero count means visible
+        vkCmdBeginQuery(command_buffer, m_query_pool, first_query + object_id, 0);
+        vkCmdDraw(command_buffer, PROXY_VERTEX_COUNT, 1, 0, 0);
+        vkCmdEndQuery(command_buffer, m_query_pool, first_query + object_id);
+    }
+    m_recorded_counts[m_slot] = object_count;
+}
+
+void app::graphics::OcclusionQueries::resolve(VkCommandBuffer command_buffer)
+{
+    if (!isConditional() || 0 == m_recorded_counts[m_slot])
+        return;
+    // The tested objects get their sample count, the others are always drawn.
+    // The previous reads of this slot were by the frame before the previous one,
+    // which has completed
+    const uint32_t first_query = getFirstQuery(m_slot);
+    const uint32_t recorded_count = m_recorded_counts[m_slot];
+    uint32_t object_id = 0;
+    while (object_id < recorded_count)
+    {
+        const bool queried = m_queried[first_query + object_id];
+        uint32_t run_end = object_id + 1;
+        while (run_end < recorded_count && m_queried[first_query + run_end] == queried)
+            ++run_end;
+        const VkDeviceSize offset = (first_query + object_id) * sizeof(uint32_t);
+        const VkDeviceSize size = (run_end - object_id) * sizeof(uint32_t);
+        if (queried)
+        {
+            vkCmdCopyQueryPoolResults(
+                command_buffer,
+                m_query_pool,
+                first_query + object_id,
+                run_end - object_id,
+                m_result_buffer->getBuffer(),
+                offset,
+                sizeof(uint32_t),
+                VK_QUERY_RESULT_WAIT_BIT);
+        }
+        else
+        {
+            vkCmdFillBuffer(command_buffer, m_result_buffer->getBuffer(), offset, size, 1);
+        }
+        object_id = run_end;
+    }
+    // The draws of the next frame read the results
+    VkBufferMemoryBarrier to_conditional_rendering{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = m_result_buffer->getBuffer(),
+        .offset = first_query * sizeof(uint32_t),
+        .size = recorded_count * sizeof(uint32_t),
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT,
+        0,
+        0, nullptr,
+        1, &to_conditional_rendering,
+        0, nullptr);
+}
+
+bool app::graphics::OcclusionQueries::beginDraw(VkCommandBuffer command_buffer, const uint32_t object_id)
+{
+    m_conditional_active = false;
+    // Not tested by the previous frame (new object, or first frame): always drawn
+    const uint32_t previous_slot = getPreviousSlot();
+    if (object_id >= m_recorded_counts[previous_slot])
+        return true;
+    if (!isConditional())
+        return m_visible[object_id];
+    VkConditionalRenderingBeginInfoEXT conditional_rendering_begin_info{
+        .sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT,
+        .buffer = m_result_buffer->getBuffer(),
+        .offset = (getFirstQuery(previous_slot) + object_id) * sizeof(uint32_t),
+        .flags = 0,
+    };
+    m_begin_conditional_rendering(command_buffer, &conditional_rendering_begin_info);
+    m_conditional_active = true;
+    return true;
+}
+
+void app::graphics::OcclusionQueries::endDraw(VkCommandBuffer command_buffer)
+{
+    if (!m_conditional_active)
+        return;
+    m_end_conditional_rendering(command_buffer);
+    m_conditional_active = false;
+}
+
+bool app::graphics::OcclusionQueries::isVisible(const uint32_t object_id) const
+{
+    if (isConditional() || object_id >= m_recorded_counts[getPreviousSlot()])
+        return true;
+    return m_visible[object_id];
+}
+
+std::shared_ptr<app::graphics::Buffer> app::graphics::OcclusionQueries::getResultBuffer() const noexcept
+{
+    return m_result_buffer;
+}
+
+uint32_t app::graphics::OcclusionQueries::getPreviousFirstResult() const noexcept
+{
+    return getFirstQuery(getPreviousSlot());
+}
+
+uint32_t app::graphics::OcclusionQueries::getPreviousResultCount() const noexcept
+{
+    return m_recorded_counts[getPreviousSlot()];
+}
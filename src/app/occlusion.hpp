@@ -0,0 +1,167 @@
+//
+//  occlusion.hpp
+//
+
+#pragma once
+#ifndef occlusion_h
+#define occlusion_h
+
+#include "../project.hpp"
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include "camera.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Skips the draws of the expensive objects that were hidden in the previous
+        /// frame, with occlusion queries.
+        ///
+        /// Each object is tested with its bounding box (a proxy of 14 vertices, generated
+        /// in the vertex shader): the box is rasterized against the depth of the scene,
+        /// without writing anything, and the query counts the samples that pass.
+        /// The results of a frame gate the draws of the next frame, in one of two ways:
+        /// - with VK_EXT_conditional_rendering, the results are copied to a buffer on the
+        ///   GPU, and the draws are discarded there: the CPU never waits for them;
+        /// - otherwise, the results are read back by the CPU at the start of the next
+        ///   frame (its fence has been waited), which then does not record the draws.
+        /// The queries and the results live in a ring of FRAMES_IN_FLIGHT slots: a frame writes
+        /// its slot while its draws read the slot of the previous frame.
+        class OcclusionQueries
+        {
+        public:
+            /// @brief Push constants of the proxy pipeline (vertex stage)
+            struct PushConstants
+            {
+                /// @brief From world space to clip space (jittered like the scene)
+                glm::mat4 m_view_projection;
+                /// @brief The minimum corner of the box, in world space (w unused)
+                glm::vec4 m_min;
+                /// @brief The maximum corner of the box, in world space (w unused)
+                glm::vec4 m_max;
+            };
+
+            /// @brief Public constructor
+            OcclusionQueries();
+            /// @brief Public destructor
+            ~OcclusionQueries();
+            /// @brief Creates the query pool, the result buffer and the proxy pipeline.
+            /// Should be called once the graphics pipeline is created: the proxies are drawn
+            /// in its main subpass.
+            /// @param max_objects The maximum number of objects tested each frame
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t max_objects);
+            /// @brief Returns if the draws are discarded on the GPU (conditional rendering),
+            /// rather than from a readback
+            bool isConditional() const noexcept;
+            /// @brief Registers an object to test, visible until its first result
+            /// @param min The minimum corner of its bounding box, in world space
+            /// @param max The maximum corner of its bounding box, in world space
+            /// @return The identifier of the object, or UINT32_MAX if there is no room left
+            uint32_t addObject(const glm::vec3& min, const glm::vec3& max);
+            /// @brief Updates the bounding box of an object (for the next `record`)
+            void setBounds(const uint32_t object_id, const glm::vec3& min, const glm::vec3& max);
+            /// @brief Forgets all the objects
+            void clearObjects() noexcept;
+            /// @brief Returns the number of objects
+            uint32_t getObjectCount() const noexcept;
+            /// @brief Reads back the results of the previous frame if there is no conditional
+            /// rendering, then resets the queries of this frame.
+            /// Should be recorded outside of any render pass, once the fence of the previous
+            /// frame has been waited.
+            /// @param command_buffer The command buffer being recorded
+            void beginFrame(VkCommandBuffer command_buffer);
+            /// @brief Records the queries of all the objects, in the main subpass of the scene,
+            /// once the occluders have written the depth.
+            /// Binds the proxy pipeline: the scene pipeline has to be bound again afterwards.
+            /// @param command_buffer The command buffer being recorded
+            /// @param camera The point of view of the scene
+            /// @param render_extent The extent the scene is rendered at
+            /// @param jitter The sub-pixel offset of the projection of the scene, in NDC units
+            void record(VkCommandBuffer command_buffer, const app::graphics::Camera& camera, const VkExtent2D& render_extent, const glm::vec2& jitter);
+            /// @brief Copies the results of this frame to the result buffer, when there is
+            /// conditional rendering. Should be recorded after the scene render pass.
+            /// @param command_buffer The command buffer being recorded
+            void resolve(VkCommandBuffer command_buffer);
+            /// @brief Starts the draw of an object, gated by its result of the previous frame.
+            /// With conditional rendering, the draws recorded until `endDraw` are discarded
+            /// on the GPU if the object was hidden.
+            /// @param command_buffer The command buffer being recorded
+            /// @param object_id The identifier returned by `addObject`
+            /// @return If the draws of the object have to be recorded (false if the readback
+            /// knows the object was hidden) - `endDraw` has to be called either way
+            bool beginDraw(VkCommandBuffer command_buffer, const uint32_t object_id);
+            /// @brief Ends the draw of an object started by `beginDraw`
+            /// @param command_buffer The command buffer being recorded
+            void endDraw(VkCommandBuffer command_buffer);
+            /// @brief Returns if an object was visible in the readback of the previous frame
+            /// (always true with conditional rendering, or if the object was not tested)
+            /// @param object_id The identifier returned by `addObject`
+            bool isVisible(const uint32_t object_id) const;
+            /// @brief Returns the results read by the conditional rendering, for the shaders
+            /// that gate their own work (one uint32 per object, 0 if hidden), or nullptr
+            /// without conditional rendering
+            std::shared_ptr<app::graphics::Buffer> getResultBuffer() const noexcept;
+            /// @brief Returns the first result of the previous frame, in the result buffer
+            uint32_t getPreviousFirstResult() const noexcept;
+            /// @brief Returns the number of objects tested by the previous frame: the others
+            /// have no result, and are visible
+            uint32_t getPreviousResultCount() const noexcept;
+
+        private:
+            /// @brief The bounding box of an object
+            struct Object
+            {
+                /// @brief The minimum corner, in world space
+                glm::vec3 m_min;
+                /// @brief The maximum corner, in world space
+                glm::vec3 m_max;
+            };
+            /// @brief OcclusionQueries should not be cloneable
+            OcclusionQueries(OcclusionQueries& other) = delete;
+            /// @brief OcclusionQueries should not be assignable
+            void operator=(const OcclusionQueries& other) = delete;
+            /// @brief Creates the proxy pipeline, in the main subpass of the scene
+            utils::VResult createPipeline();
+            /// @brief Returns the first query (and result) of a slot
+            uint32_t getFirstQuery(const uint32_t slot) const noexcept;
+            /// @brief Returns the slot of the previous frame
+            uint32_t getPreviousSlot() const noexcept;
+            /// @brief The query pool: max_objects queries per slot
+            VkQueryPool m_query_pool = VK_NULL_HANDLE;
+            /// @brief The results read by the conditional rendering: one uint32 per query
+            /// (device-local). Null without conditional rendering.
+            std::shared_ptr<app::graphics::Buffer> m_result_buffer = nullptr;
+            /// @brief The layout of the proxy pipeline (push constants only)
+            VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+            /// @brief Rasterizes the bounding boxes, without writing any attachment
+            VkPipeline m_pipeline = VK_NULL_HANDLE;
+            /// @brief Loaded from the device if conditional rendering is enabled
+            PFN_vkCmdBeginConditionalRenderingEXT m_begin_conditional_rendering = nullptr;
+            /// @brief Loaded from the device if conditional rendering is enabled
+            PFN_vkCmdEndConditionalRenderingEXT m_end_conditional_rendering = nullptr;
+            /// @brief The objects to test
+            std::vector<Object> m_objects;
+            /// @brief If an object has been tested, per slot (max_objects entries per slot):
+            /// objects too close to the camera are not, and are considered visible
+            std::vector<bool> m_queried;
+            /// @brief The number of objects recorded in each slot
+            uint32_t m_recorded_counts[Project::FRAMES_IN_FLIGHT] = {};
+            /// @brief The visibility of each object from the readback of the previous frame
+            std::vector<bool> m_visible;
+            /// @brief The maximum number of objects tested each frame
+            uint32_t m_max_objects = 0;
+            /// @brief The slot written by this frame
+            uint32_t m_slot = 0;
+            /// @brief If `beginDraw` started a conditional rendering
+            bool m_conditional_active = false;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // occlusion_h
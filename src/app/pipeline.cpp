@@ -7,6 +7,8 @@
 #include "pipeline.hpp"
 #include "../utils/debug_tools.h"
 #include "../utils/result.h"
+#include "../project.hpp"
+#include "depth.hpp"
 #include "engine.hpp"
 #include "memory.hpp"
 #include "shaders.h"
@@ -22,7 +24,6 @@ app::graphics::Pipeline::Pipeline()
 app::graphics::Pipeline::~Pipeline()
 {
     const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
-    const auto resource_allocator = app::Engine::getInstance()->m_allocator;
     if (m_shader_modules.size() > 0)
     {
         Log("< Destroying the shader modules...");
@@ -38,25 +39,29 @@ app::graphics::Pipeline::~Pipeline()
         vkDestroyRenderPass(graphics_device, m_render_pass, nullptr);
         m_render_pass = VK_NULL_HANDLE;
     }
+    if (VK_NULL_HANDLE != m_ui_render_pass)
+    {
+        Log("< Destroying the UI render pass...");
+        vkDestroyRenderPass(graphics_device, m_ui_render_pass, nullptr);
+        m_ui_render_pass = VK_NULL_HANDLE;
+    }
     if (VK_NULL_HANDLE != m_layout)
     {
         Log("< Destroying the pipeline layout...");
         vkDestroyPipelineLayout(graphics_device, m_layout, nullptr);
         m_layout = VK_NULL_HANDLE;
     }
-    if (VK_NULL_HANDLE != m_vertex_buffer)
+    if (!m_vertex_buffer.isNull())
     {
         Log("< Destroying the vertex buffer...");
-        vmaDestroyBuffer(resource_allocator, m_vertex_buffer, m_vertex_buffer_allocation);
-        m_vertex_buffer = VK_NULL_HANDLE;
-        m_vertex_buffer_allocation = VK_NULL_HANDLE;
+        app::Engine::getInstance()->m_resources->destroy(m_vertex_buffer);
+        m_vertex_buffer = app::graphics::BufferHandle();
     }
-    if (VK_NULL_HANDLE != m_index_buffer)
+    if (!m_index_buffer.isNull())
     {
         Log("< Destroying the index buffer...");
-        vmaDestroyBuffer(resource_allocator, m_index_buffer, m_index_buffer_allocation);
-        m_index_buffer = VK_NULL_HANDLE;
-        m_index_buffer_allocation = VK_NULL_HANDLE;
+        app::Engine::getInstance()->m_resources->destroy(m_index_buffer);
+        m_index_buffer = app::graphics::BufferHandle();
     }
     if (VK_NULL_HANDLE != m_pipeline)
     {
@@ -64,23 +69,61 @@ app::graphics::Pipeline::~Pipeline()
         vkDestroyPipeline(graphics_device, m_pipeline, nullptr);
         m_pipeline = VK_NULL_HANDLE;
     }
-    if (nullptr != m_sync_image_ready)
+    if (VK_NULL_HANDLE != m_depth_prepass_pipeline)
+    {
+        Log("< Destroying the depth pre-pass pipeline object...");
+        vkDestroyPipeline(graphics_device, m_depth_prepass_pipeline, nullptr);
+        m_depth_prepass_pipeline = VK_NULL_HANDLE;
+    }
+    if (!m_gbuffer_sets.empty())
+    {
+        vkFreeDescriptorSets(
+            graphics_device,
+            app::Engine::getInstance()->getDescriptorPool(),
+            static_cast<uint32_t>(m_gbuffer_sets.size()),
+            m_gbuffer_sets.data());
+        m_gbuffer_sets.clear();
+    }
+    if (VK_NULL_HANDLE != m_lighting_pipeline)
+    {
+        Log("< Destroying the deferred lighting pipeline object...");
+        vkDestroyPipeline(graphics_device, m_lighting_pipeline, nullptr);
+        m_lighting_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_lighting_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_lighting_layout, nullptr);
+        m_lighting_layout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_gbuffer_set_layout)
+    {
+        vkDestroyDescriptorSetLayout(graphics_device, m_gbuffer_set_layout, nullptr);
+        m_gbuffer_set_layout = VK_NULL_HANDLE;
+    }
+    // The device is idle: the fence and the semaphores can be recycled
+    if (VK_NULL_HANDLE != m_sync_image_ready)
+    {
+        Log("< Releasing the image ready signal semaphore...");
+        app::Engine::getInstance()->m_sync_pool->releaseSemaphore(m_sync_image_ready);
+        m_sync_image_ready = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_sync_present_done)
     {
-        Log("< Destroying the image ready signal semaphore...");
-        vkDestroySemaphore(graphics_device, *m_sync_image_ready, nullptr);
-        m_sync_image_ready = nullptr;
+        Log("< Releasing the present done signal semaphore...");
+        app::Engine::getInstance()->m_sync_pool->releaseSemaphore(m_sync_present_done);
+        m_sync_present_done = VK_NULL_HANDLE;
     }
-    if (nullptr != m_sync_present_done)
+    if (VK_NULL_HANDLE != m_sync_uploads_done)
     {
-        Log("< Destroying the present done signal semaphore...");
-        vkDestroySemaphore(graphics_device, *m_sync_present_done, nullptr);
-        m_sync_present_done = nullptr;
+        Log("< Releasing the uploads done signal semaphore...");
+        app::Engine::getInstance()->m_sync_pool->releaseSemaphore(m_sync_uploads_done);
+        m_sync_uploads_done = VK_NULL_HANDLE;
     }
-    if (nullptr != m_sync_cpu_gpu)
+    if (VK_NULL_HANDLE != m_sync_cpu_gpu)
     {
-        Log("< Destroying the fence...");
-        vkDestroyFence(graphics_device, *m_sync_cpu_gpu, nullptr);
-        m_sync_cpu_gpu = nullptr;
+        Log("< Releasing the fence...");
+        app::Engine::getInstance()->m_sync_pool->releaseFence(m_sync_cpu_gpu);
+        m_sync_cpu_gpu = VK_NULL_HANDLE;
     }
 }
 
@@ -126,6 +169,39 @@ std::optional<uint64_t> app::graphics::Pipeline::readFile(const char* filepath,
     return std::nullopt;
 }
 
+utils::Result<VkShaderModule> app::graphics::Pipeline::loadShaderModule(const char* filepath)
+{
+    const auto file_size_opt = fileSize(filepath);
+    if (file_size_opt == std::nullopt)
+    {
+        LogE("< Cannot read the shader '%s'", filepath);
+        return utils::Result<VkShaderModule>::Error((char*)"Cannot read the shader");
+    }
+    const auto file_size = file_size_opt.value();
+    std::vector<char> code(file_size);
+    char* code_buffer = code.data();
+    readFile(filepath, &code_buffer, file_size);
+    Log("> For file '%s', read file ok (%d bytes)", filepath, static_cast<uint32_t>(file_size));
+
+    VkShaderModuleCreateInfo shader_module_create_info{
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = code.size(),
+        .pCode = reinterpret_cast<const uint32_t*>(code.data()),
+    };
+    VkShaderModule shader_module = VK_NULL_HANDLE;
+    if (const auto result = vkCreateShaderModule(
+            app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+            &shader_module_create_info,
+            nullptr,
+            &shader_module);
+        result != VK_SUCCESS)
+    {
+        LogE("> vkCreateShaderModule: error 0x%08x for '%s'", result, filepath);
+        return utils::Result<VkShaderModule>::Error((char*)"Cannot create the shader module");
+    }
+    return utils::Result<VkShaderModule>::Ok(shader_module);
+}
+
 utils::Result<std::vector<app::graphics::Shader::Module>> app::graphics::Pipeline::createGraphicsApplication(const char* vertex_shader_filepath,
                                                                                                              const char* fragment_shader_filepath)
 {
@@ -205,53 +281,289 @@ utils::VResult app::graphics::Pipeline::setupRenderPass()
 {
     Log("> Setting up the render pass object of the graphics pipeline");
 
-    const auto NB_ATTACHMENTS = 1;
-    // Setup the color attachment format & samples
-    VkAttachmentDescription attachments[NB_ATTACHMENTS] = {
-        VkAttachmentDescription{
-            .format = app::Engine::getInstance()->m_swapchain->getImageFormat().format,
+    const VkSampleCountFlagBits sample_count = app::Engine::getInstance()->m_render->getSampleCount();
+    const bool is_multisampled = sample_count != VK_SAMPLE_COUNT_1_BIT;
+    const VkFormat color_format = app::Engine::getInstance()->m_render->getSceneFormat();
+    // The scene target is sampled by the temporal upscaler, or directly by the tonemapper
+    const VkImageLayout scene_final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    // Setup the color & depth attachments format & samples
+    std::vector<VkAttachmentDescription> attachments;
+    if (is_multisampled)
+    {
+        // Multisampled color: resolved at the end of the subpass, never stored
+        attachments.push_back(VkAttachmentDescription{
+            .format = color_format,
+            .samples = sample_count,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        });
+    }
+    else
+    {
+        attachments.push_back(VkAttachmentDescription{
+            .format = color_format,
             .samples = VK_SAMPLE_COUNT_1_BIT,        // No multi-sampling: 1 sample
             .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,   // Before rendering: clear the framebuffer to black before drawing
             .storeOp = VK_ATTACHMENT_STORE_OP_STORE, // After rendering: store in memory to read it again later
             .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,     // Don't care what previous layout the image was in
-            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, // Images will be transitioned to the SwapChain for presentation
-        },
-    };
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED, // Don't care what previous layout the image was in
+            .finalLayout = scene_final_layout,          // The scene is then tonemapped and upscaled to the swapchain image
+        });
+    }
+    attachments.push_back(VkAttachmentDescription{
+        .format = app::Engine::getInstance()->m_render->getDepthFormat(),
+        .samples = sample_count,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,       // Before rendering: clear to the far plane
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE, // The depth is not used after the render pass
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    });
+    if (is_multisampled)
+    {
+        // The scene target receives the resolved samples
+        attachments.push_back(VkAttachmentDescription{
+            .format = color_format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE, // Fully overwritten by the resolve
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = scene_final_layout,
+        });
+    }
+    if (Project::TEMPORAL_UPSCALING)
+    {
+        const VkFormat motion_format = app::Engine::getInstance()->m_render->getMotionFormat();
+        // Motion vectors: cleared to "no motion", then sampled by the temporal upscaler
+        attachments.push_back(VkAttachmentDescription{
+            .format = motion_format,
+            .samples = sample_count,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = is_multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = is_multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        });
+        if (is_multisampled)
+        {
+            attachments.push_back(VkAttachmentDescription{
+                .format = motion_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE, // Fully overwritten by the resolve
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            });
+        }
+    }
+    if (Project::DEFERRED_SHADING)
+    {
+        // The G-buffer: cleared (no coverage), written by the G-buffer subpass, read by the
+        // lighting subpass, and never stored
+        m_gbuffer_attachment = static_cast<uint32_t>(attachments.size());
+        for (const VkFormat gbuffer_format : {app::Engine::getInstance()->m_render->getAlbedoFormat(), app::Engine::getInstance()->m_render->getNormalFormat()})
+        {
+            attachments.push_back(VkAttachmentDescription{
+                .format = gbuffer_format,
+                .samples = sample_count,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            });
+        }
+    }
+    m_attachment_count = static_cast<uint32_t>(attachments.size());
 
     // Subpasses and attachment references, as a render pass
     // can consist of multiple subpasses
-    VkAttachmentReference color_attachment_reference{};
-    color_attachment_reference.attachment = 0; // Index 0
-    color_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    std::vector<VkAttachmentReference> color_attachment_references = {
+        {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}, // Index 0
+    };
+
+    VkAttachmentReference depth_attachment_reference{};
+    depth_attachment_reference.attachment = 1; // Index 1
+    depth_attachment_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-    const auto NB_SUBPASSES = 1;
-    VkSubpassDescription subpasses[NB_SUBPASSES] = {
-        VkSubpassDescription{
+    // With the pre-pass, the main subpass only tests the depth written by the
+    // pre-pass subpass, so it can use the read-only layout
+    VkAttachmentReference depth_read_only_attachment_reference{};
+    depth_read_only_attachment_reference.attachment = 1; // Index 1
+    depth_read_only_attachment_reference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    // Multisampled color is resolved in the same subpass, into the scene target
+    std::vector<VkAttachmentReference> resolve_attachment_references = {
+        {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}, // Index 2
+    };
+
+    // The motion vectors are the second output of the main subpass (and resolved, if multisampled)
+    if (Project::TEMPORAL_UPSCALING)
+    {
+        color_attachment_references.push_back({is_multisampled ? 3u : 2u, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+        resolve_attachment_references.push_back({4, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+    }
+
+    // Deferred shading: the G-buffer subpass writes the surface attributes (and the motion
+    // vectors), then the lighting subpass reads them back from the same pixel, with the
+    // depth to rebuild the position, and writes the scene color
+    std::vector<VkAttachmentReference> gbuffer_attachment_references = {
+        {m_gbuffer_attachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+        {m_gbuffer_attachment + 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+    };
+    if (Project::TEMPORAL_UPSCALING)
+        gbuffer_attachment_references.push_back(color_attachment_references[1]);
+    const std::vector<VkAttachmentReference> input_attachment_references = {
+        {m_gbuffer_attachment, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {m_gbuffer_attachment + 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+    };
+    // The motion vectors are not touched by the lighting subpass, but stored at the end
+    // of the render pass
+    const uint32_t preserved_motion_attachment = 2;
+
+    std::vector<VkSubpassDescription> subpasses;
+    if (Project::DEPTH_PRE_PASS)
+    {
+        // Depth-only subpass
+        subpasses.push_back(VkSubpassDescription{
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .colorAttachmentCount = 0,
+            .pDepthStencilAttachment = &depth_attachment_reference,
+        });
+    }
+    if (Project::DEFERRED_SHADING)
+    {
+        // G-buffer subpass
+        subpasses.push_back(VkSubpassDescription{
             .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .colorAttachmentCount = static_cast<uint32_t>(gbuffer_attachment_references.size()),
+            .pColorAttachments = gbuffer_attachment_references.data(),
+            .pDepthStencilAttachment = Project::DEPTH_PRE_PASS ? &depth_read_only_attachment_reference : &depth_attachment_reference,
+        });
+        m_main_subpass = static_cast<uint32_t>(subpasses.size() - 1);
+        // Lighting subpass (the deferred shading disables multisampling: no resolve)
+        subpasses.push_back(VkSubpassDescription{
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .inputAttachmentCount = static_cast<uint32_t>(input_attachment_references.size()),
+            .pInputAttachments = input_attachment_references.data(),
             .colorAttachmentCount = 1,
-            .pColorAttachments = &color_attachment_reference,
+            .pColorAttachments = color_attachment_references.data(),
+            // Also bound read-only, for the draws depth-tested against the scene (debug geometry)
+            .pDepthStencilAttachment = &depth_read_only_attachment_reference,
+            .preserveAttachmentCount = Project::TEMPORAL_UPSCALING ? 1u : 0u,
+            .pPreserveAttachments = &preserved_motion_attachment,
+        });
+    }
+    else
+    {
+        subpasses.push_back(VkSubpassDescription{
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .colorAttachmentCount = static_cast<uint32_t>(color_attachment_references.size()),
+            .pColorAttachments = color_attachment_references.data(),
+            .pResolveAttachments = is_multisampled ? resolve_attachment_references.data() : nullptr,
+            .pDepthStencilAttachment = Project::DEPTH_PRE_PASS ? &depth_read_only_attachment_reference : &depth_attachment_reference,
+        });
+        m_main_subpass = static_cast<uint32_t>(subpasses.size() - 1);
+    }
+    m_main_color_attachment_count = subpasses[m_main_subpass].colorAttachmentCount;
+    // The subpass that writes the scene color
+    const uint32_t scene_subpass = static_cast<uint32_t>(subpasses.size() - 1);
+    m_scene_subpass = scene_subpass;
+    m_scene_color_attachment_count = subpasses[scene_subpass].colorAttachmentCount;
+
+    std::vector<VkSubpassDependency> dependencies = {
+        VkSubpassDependency{
+            .srcSubpass = VK_SUBPASS_EXTERNAL, // Implicit subpass before or after the render pass
+            .dstSubpass = 0,                   // our (first) subpass
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
         },
     };
-
-    VkSubpassDependency dependency{
-        .srcSubpass = VK_SUBPASS_EXTERNAL, // Implicit subpass before or after the render pass
-        .dstSubpass = 0,                   // our subpass
+    if (Project::DEPTH_PRE_PASS)
+    {
+        // The main subpass tests against the depth written by the pre-pass
+        dependencies.push_back(VkSubpassDependency{
+            .srcSubpass = 0,
+            .dstSubpass = m_main_subpass,
+            .srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+            .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+        });
+    }
+    if (scene_subpass != 0)
+    {
+        // The color attachments are only written after the first subpass
+        dependencies.push_back(VkSubpassDependency{
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = scene_subpass,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        });
+    }
+    if (Project::DEFERRED_SHADING)
+    {
+        // The lighting subpass reads the G-buffer and the depth at the pixel they have
+        // been written to: a by-region dependency, that keeps them in tile memory
+        dependencies.push_back(VkSubpassDependency{
+            .srcSubpass = m_main_subpass,
+            .dstSubpass = scene_subpass,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+            .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+        });
+        if (Project::TEMPORAL_UPSCALING)
+        {
+            // The motion vectors are written by the G-buffer subpass
+            dependencies.push_back(VkSubpassDependency{
+                .srcSubpass = m_main_subpass,
+                .dstSubpass = VK_SUBPASS_EXTERNAL,
+                .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            });
+        }
+    }
+    // The scene targets are read by the compute passes (temporal upscaler or tonemapper), once
+    // the render pass is done
+    dependencies.push_back(VkSubpassDependency{
+        .srcSubpass = scene_subpass,
+        .dstSubpass = VK_SUBPASS_EXTERNAL,
         .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .srcAccessMask = 0,
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-    };
+        .dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+    });
 
     VkRenderPassCreateInfo render_pass_info{
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-        .attachmentCount = NB_ATTACHMENTS,
-        .pAttachments = attachments,
-        .subpassCount = NB_SUBPASSES,
-        .pSubpasses = subpasses,
-        .dependencyCount = 1,
-        .pDependencies = &dependency,
+        .attachmentCount = static_cast<uint32_t>(attachments.size()),
+        .pAttachments = attachments.data(),
+        .subpassCount = static_cast<uint32_t>(subpasses.size()),
+        .pSubpasses = subpasses.data(),
+        .dependencyCount = static_cast<uint32_t>(dependencies.size()),
+        .pDependencies = dependencies.data(),
     };
 
     const auto create_result_code = vkCreateRenderPass(
@@ -267,12 +579,114 @@ utils::VResult app::graphics::Pipeline::setupRenderPass()
     return utils::VResult::Ok();
 }
 
+uint32_t app::graphics::Pipeline::getMainSubpass() const noexcept
+{
+    return m_main_subpass;
+}
+
+uint32_t app::graphics::Pipeline::getAttachmentCount() const noexcept
+{
+    return m_attachment_count;
+}
+
+uint32_t app::graphics::Pipeline::getSceneSubpass() const noexcept
+{
+    return m_scene_subpass;
+}
+
+uint32_t app::graphics::Pipeline::getSceneColorAttachmentCount() const noexcept
+{
+    return m_scene_color_attachment_count;
+}
+
+uint32_t app::graphics::Pipeline::getMainColorAttachmentCount() const noexcept
+{
+    return m_main_color_attachment_count;
+}
+
+utils::VResult app::graphics::Pipeline::setupUIRenderPass()
+{
+    Log("> Setting up the UI render pass object of the graphics pipeline");
+
+    // The swapchain image already contains the upscaled scene: load it, and
+    // draw the UI on top of it at the native resolution
+    VkAttachmentDescription attachment{
+        .format = app::Engine::getInstance()->m_swapchain->getImageFormat().format,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, // Left by the upscale
+        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,        // Images will be transitioned to the SwapChain for presentation
+    };
+
+    VkAttachmentReference color_attachment_reference{};
+    color_attachment_reference.attachment = 0; // Index 0
+    color_attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_attachment_reference,
+    };
+
+    VkSubpassDependency dependency{
+        .srcSubpass = VK_SUBPASS_EXTERNAL,
+        .dstSubpass = 0,
+        .srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+    };
+
+    VkRenderPassCreateInfo render_pass_info{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &attachment,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        .dependencyCount = 1,
+        .pDependencies = &dependency,
+    };
+
+    if (const auto create_result_code = vkCreateRenderPass(
+            app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+            &render_pass_info,
+            nullptr,
+            &m_ui_render_pass);
+        create_result_code != VK_SUCCESS)
+    {
+        return utils::VResult::Error((char*)"Failed to create the UI render pass");
+    }
+    return utils::VResult::Ok();
+}
+
+VkRenderPass& app::graphics::Pipeline::getUIRenderPass()
+{
+    return m_ui_render_pass;
+}
+
 utils::VResult app::graphics::Pipeline::preconfigure()
 {
     Log("> Preconfiguring the graphics pipeline");
 
+    // The scene constants (projection jitter) are pushed for each frame
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(app::shaders::ScenePushConstants),
+    };
+
+    // Set 0: the lights binned in clusters, read by the fragment shader
+    const VkDescriptorSetLayout lighting_set_layout = app::Engine::getInstance()->m_render->getClusteredLighting()->getDescriptorSetLayout();
+
     VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
     pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = 1;
+    pipeline_layout_create_info.pSetLayouts = &lighting_set_layout;
+    pipeline_layout_create_info.pushConstantRangeCount = 1;
+    pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
 
     const auto create_result_code = vkCreatePipelineLayout(
         app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
@@ -363,17 +777,20 @@ utils::VResult app::graphics::Pipeline::create()
         .lineWidth = 1,
     };
 
-    // TODO: Check if needs another GPU feature
+    // Must match the number of samples of the render pass attachments
     VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .rasterizationSamples = app::Engine::getInstance()->m_render->getSampleCount(),
         .sampleShadingEnable = VK_FALSE,
     };
 
-    // TODO: Check if needed
+    // If the depth pre-pass is enabled, the depth buffer already contains the closest
+    // fragments: only shade the ones that are EQUAL, without writing the depth again
     VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-        .depthTestEnable = VK_FALSE,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = Project::DEPTH_PRE_PASS ? VK_FALSE : VK_TRUE,
+        .depthCompareOp = Project::DEPTH_PRE_PASS ? VK_COMPARE_OP_EQUAL : app::graphics::Depth::getCompareOp(),
         .depthBoundsTestEnable = VK_FALSE,
         .stencilTestEnable = VK_FALSE,
     };
@@ -388,12 +805,19 @@ utils::VResult app::graphics::Pipeline::create()
                                             VK_COLOR_COMPONENT_B_BIT |
                                             VK_COLOR_COMPONENT_A_BIT;
     color_blend_attachment.blendEnable = VK_FALSE;
+    // Same for the motion vectors, if any, and for the G-buffer (albedo, normal) which
+    // replaces the color with the deferred shading
+    const VkPipelineColorBlendAttachmentState color_blend_attachments[3] = {
+        color_blend_attachment,
+        color_blend_attachment,
+        color_blend_attachment,
+    };
 
     VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
         .logicOpEnable = VK_FALSE,
-        .attachmentCount = 1,
-        .pAttachments = &color_blend_attachment,
+        .attachmentCount = m_main_color_attachment_count,
+        .pAttachments = color_blend_attachments,
     };
 
     VkGraphicsPipelineCreateInfo pipeline_info{
@@ -410,7 +834,7 @@ utils::VResult app::graphics::Pipeline::create()
         .pDynamicState = &dynamic_state_create_info,
         .layout = m_layout,
         .renderPass = m_render_pass,
-        .subpass = 0, // index of the subpass
+        .subpass = m_main_subpass, // index of the subpass
     };
 
     const auto create_result_code = vkCreateGraphicsPipelines(
@@ -425,161 +849,77 @@ utils::VResult app::graphics::Pipeline::create()
     {
         return utils::VResult::Error((char*)"Failed to create the main graphics pipeline");
     }
+
+    if (Project::DEFERRED_SHADING)
+    {
+        if (const auto result = createLightingPipeline(); result.IsError())
+            return result;
+    }
+
+    if (!Project::DEPTH_PRE_PASS)
+        return utils::VResult::Ok();
+
+    // Depth pre-pass pipeline: same geometry, vertex stage only, no color output
+    std::vector<VkPipelineShaderStageCreateInfo> depth_shader_stages;
+    for (const auto& shader_stage : m_shader_stages)
+    {
+        if (shader_stage.stage == VK_SHADER_STAGE_VERTEX_BIT)
+            depth_shader_stages.push_back(shader_stage);
+    }
+    VkPipelineDepthStencilStateCreateInfo depth_prepass_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = app::graphics::Depth::getCompareOp(),
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    VkPipelineColorBlendStateCreateInfo depth_prepass_color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 0,
+    };
+    pipeline_info.stageCount = (uint32_t)depth_shader_stages.size();
+    pipeline_info.pStages = depth_shader_stages.data();
+    pipeline_info.pDepthStencilState = &depth_prepass_stencil_state_create_info;
+    pipeline_info.pColorBlendState = &depth_prepass_color_blend_state_create_info;
+    pipeline_info.subpass = 0;
+
+    if (const auto depth_create_result_code = vkCreateGraphicsPipelines(
+            app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+            VK_NULL_HANDLE,
+            1,
+            &pipeline_info,
+            nullptr,
+            &m_depth_prepass_pipeline);
+        depth_create_result_code != VK_SUCCESS)
+    {
+        return utils::VResult::Error((char*)"Failed to create the depth pre-pass pipeline");
+    }
     return utils::VResult::Ok();
 }
 
 utils::VResult app::graphics::Pipeline::createVertexBuffer() noexcept
 {
-    VkDevice graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
-    VmaAllocator resource_allocator = app::Engine::getInstance()->m_allocator;
-    if (VK_NULL_HANDLE != m_vertex_buffer)
+    if (!m_vertex_buffer.isNull())
     {
         Log("< Destroying the vertex buffer...");
-        vmaDestroyBuffer(resource_allocator, m_vertex_buffer, m_vertex_buffer_allocation);
-        m_vertex_buffer = VK_NULL_HANDLE;
-        m_vertex_buffer_allocation = VK_NULL_HANDLE;
-    }
-    VkQueue transfert_queue = app::Engine::getInstance()->m_graphics_device.getTransfertQueue();
-    VkCommandPool* transfert_command_pool = app::Engine::getInstance()->m_render->getTransfertCommand()->getPool();
-    const size_t buffer_size = 0;
-    assert(transfert_command_pool != nullptr);
-
-    // Use staging buffer (or temporary buffer) to transfer next from CPU to GPU
-    // This buffer can be used as source in a memory transfer operation
-    VkBuffer staging_buffer{};
-    VmaAllocation staging_buffer_allocation{};
-    // if (const auto result = app::graphics::Memory::initBuffer(
-    //         resource_allocator,
-    //         &staging_buffer_allocation,
-    //         graphics_device,
-    //         buffer_size,
-    //         staging_buffer,
-    //         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    //     result.IsError())
-    //     return result;
-
-    // // Now, fill the staging buffer with the actual data
-    // void* data;
-    // vmaMapMemory(resource_allocator, staging_buffer_allocation, &data);
-    // // TODO: fix the memcpy
-    // memcpy(data, nullptr, (size_t)buffer_size);
-    // vmaUnmapMemory(resource_allocator, staging_buffer_allocation);
-
-    // // Initialize the actual vertex buffer
-    // // This buffer can be used as destination in a memory transfert operation
-    // if (m_vertex_buffer != VK_NULL_HANDLE)
-    // {
-    //     LogW("the vertex buffer has already been intialized - resetting it...");
-    //     vmaDestroyBuffer(resource_allocator, m_vertex_buffer, m_index_buffer_allocation);
-    //     m_index_buffer_allocation = VK_NULL_HANDLE;
-    // }
-    // m_vertex_buffer = VkBuffer();
-    // if (const auto result = app::graphics::Memory::initBuffer(
-    //         resource_allocator,
-    //         &m_vertex_buffer_allocation,
-    //         graphics_device,
-    //         buffer_size,
-    //         m_vertex_buffer,
-    //         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-    //     result.IsError())
-    //     return result;
-
-    // // Now, copy the data
-    // if (const auto operation_result = app::graphics::Memory::copyBuffer(
-    //         graphics_device,
-    //         staging_buffer,
-    //         m_vertex_buffer,
-    //         transfert_command_pool,
-    //         transfert_queue,
-    //         buffer_size);
-    //     operation_result.IsError())
-    // {
-    //     vmaDestroyBuffer(resource_allocator, staging_buffer, staging_buffer_allocation);
-    //     staging_buffer_allocation = VK_NULL_HANDLE;
-    //     return operation_result;
-    // }
-
-    // vmaDestroyBuffer(resource_allocator, staging_buffer, staging_buffer_allocation);
-    // staging_buffer_allocation = VK_NULL_HANDLE;
-
+        app::Engine::getInstance()->m_resources->destroy(m_vertex_buffer);
+        m_vertex_buffer = app::graphics::BufferHandle();
+    }
+    // No scene geometry is uploaded yet: the buffer stays null, and the indexed draws are skipped
     return utils::VResult::Ok();
 }
 
 utils::VResult app::graphics::Pipeline::createIndexBuffer() noexcept
 {
-    VkDevice graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
-    VmaAllocator resource_allocator = app::Engine::getInstance()->m_allocator;
-    if (VK_NULL_HANDLE != m_index_buffer)
+    if (!m_index_buffer.isNull())
     {
         Log("< Destroying the index buffer...");
-        vmaDestroyBuffer(resource_allocator, m_index_buffer, m_index_buffer_allocation);
-        m_index_buffer = VK_NULL_HANDLE;
-        m_index_buffer_allocation = VK_NULL_HANDLE;
-    }
-    VkQueue transfert_queue = app::Engine::getInstance()->m_graphics_device.getTransfertQueue();
-    VkCommandPool* transfert_command_pool = app::Engine::getInstance()->m_render->getTransfertCommand()->getPool();
-    const size_t buffer_size = 0;
-    assert(transfert_command_pool != nullptr);
-
-    // Use staging buffer (or temporary buffer) to transfer next from CPU to GPU
-    // This buffer can be used as source in a memory transfer operation
-    VkBuffer staging_buffer{};
-    VmaAllocation staging_buffer_allocation{};
-    // if (const auto result = app::graphics::Memory::initBuffer(
-    //         resource_allocator,
-    //         &staging_buffer_allocation,
-    //         graphics_device,
-    //         buffer_size,
-    //         staging_buffer,
-    //         VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    //     result.IsError())
-    //     return result;
-
-    // // Now, fill the staging buffer with the actual data
-    // void* data;
-    // vmaMapMemory(resource_allocator, staging_buffer_allocation, &data);
-    // // TODO: fix the memcpy
-    // memcpy(data, nullptr, (size_t)buffer_size);
-    // vmaUnmapMemory(resource_allocator, staging_buffer_allocation);
-
-    // // Initialize the actual vertex buffer
-    // // This buffer can be used as destination in a memory transfert operation
-    // if (m_index_buffer != VK_NULL_HANDLE)
-    // {
-    //     LogW("the index buffer has already been intialized - resetting it...");
-    //     vmaDestroyBuffer(resource_allocator, m_index_buffer, m_index_buffer_allocation);
-    //     m_index_buffer_allocation = VK_NULL_HANDLE;
-    // }
-    // m_index_buffer = VkBuffer();
-    // m_index_buffer_allocation = {};
-    // if (const auto result = app::graphics::Memory::initBuffer(
-    //         resource_allocator,
-    //         &m_index_buffer_allocation,
-    //         graphics_device,
-    //         buffer_size,
-    //         m_index_buffer,
-    //         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-    //     result.IsError())
-    //     return result;
-
-    // // Now, copy the data
-    // if (const auto operation_result = app::graphics::Memory::copyBuffer(
-    //         graphics_device,
-    //         staging_buffer,
-    //         m_index_buffer,
-    //         transfert_command_pool,
-    //         transfert_queue,
-    //         buffer_size);
-    //     operation_result.IsError())
-    // {
-    //     vmaDestroyBuffer(resource_allocator, staging_buffer, staging_buffer_allocation);
-    //     staging_buffer_allocation = VK_NULL_HANDLE;
-    //     return operation_result;
-    // }
-
-    // vmaDestroyBuffer(resource_allocator, staging_buffer, staging_buffer_allocation);
-    // staging_buffer_allocation = VK_NULL_HANDLE;
-
+        app::Engine::getInstance()->m_resources->destroy(m_index_buffer);
+        m_index_buffer = app::graphics::BufferHandle();
+    }
+    // No scene geometry is uploaded yet: the buffer stays null, and the indexed draws are skipped
     return utils::VResult::Ok();
 }
 
@@ -588,66 +928,301 @@ VkPipeline app::graphics::Pipeline::getPipeline()
     return m_pipeline;
 }
 
+VkPipelineLayout app::graphics::Pipeline::getLayout()
+{
+    return m_layout;
+}
+
+VkPipeline app::graphics::Pipeline::getDepthPrePassPipeline()
+{
+    return m_depth_prepass_pipeline;
+}
+
+utils::VResult app::graphics::Pipeline::createLightingPipeline()
+{
+    Log("> Creating the deferred lighting pipeline");
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+
+    // Set 1: the G-buffer of the framebuffer, read at the pixel being shaded
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // Albedo
+        {1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // Normal
+        {2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}, // Depth
+    };
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data(),
+    };
+    if (const auto result = vkCreateDescriptorSetLayout(graphics_device, &descriptor_set_layout_create_info, nullptr, &m_gbuffer_set_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateDescriptorSetLayout: error 0x%08x for the G-buffer", result);
+        return utils::VResult::Error((char*)"Cannot create the descriptor set layout of the G-buffer");
+    }
+
+    const uint32_t nb_gbuffer_sets = static_cast<uint32_t>(app::Engine::getInstance()->m_swapchain->getImages().size());
+    std::vector<VkDescriptorSetLayout> set_layouts(nb_gbuffer_sets, m_gbuffer_set_layout);
+    VkDescriptorSetAllocateInfo allocate_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = app::Engine::getInstance()->getDescriptorPool(),
+        .descriptorSetCount = nb_gbuffer_sets,
+        .pSetLayouts = set_layouts.data(),
+    };
+    m_gbuffer_sets.resize(nb_gbuffer_sets);
+    if (const auto result = vkAllocateDescriptorSets(graphics_device, &allocate_info, m_gbuffer_sets.data()); result != VK_SUCCESS)
+    {
+        m_gbuffer_sets.clear();
+        LogE("> vkAllocateDescriptorSets: error 0x%08x for the G-buffer", result);
+        return utils::VResult::Error((char*)"Cannot allocate the descriptor sets of the G-buffer");
+    }
+
+    // Same set 0 and push constants as the main pipeline layout: the lights stay bound
+    // when switching to the lighting subpass
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(app::shaders::ScenePushConstants),
+    };
+    const VkDescriptorSetLayout lighting_set_layouts[2] = {
+        app::Engine::getInstance()->m_render->getClusteredLighting()->getDescriptorSetLayout(),
+        m_gbuffer_set_layout,
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 2,
+        .pSetLayouts = lighting_set_layouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+    if (const auto result = vkCreatePipelineLayout(graphics_device, &pipeline_layout_create_info, nullptr, &m_lighting_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for the deferred lighting", result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the deferred lighting");
+    }
+
+    const auto vertex_shader_result = loadShaderModule("shaders/fullscreen.vert.spv");
+    if (vertex_shader_result.IsError())
+        return utils::VResult::Error((char*)"Cannot load the vertex shader of the deferred lighting");
+    const VkShaderModule vertex_shader_module = vertex_shader_result.GetValue();
+    const auto fragment_shader_result = loadShaderModule("shaders/deferred_lighting.frag.spv");
+    if (fragment_shader_result.IsError())
+    {
+        vkDestroyShaderModule(graphics_device, vertex_shader_module, nullptr);
+        return utils::VResult::Error((char*)"Cannot load the fragment shader of the deferred lighting");
+    }
+    const VkShaderModule fragment_shader_module = fragment_shader_result.GetValue();
+    const VkPipelineShaderStageCreateInfo shader_stages[2] = {
+        VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vertex_shader_module,
+            .pName = "main",
+        },
+        VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = fragment_shader_module,
+            .pName = "main",
+        },
+    };
+
+    // A single triangle covering the render area, generated from the vertex index
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    };
+    VkPipelineInputAssemblyStateCreateInfo assembly_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+    };
+    VkPipelineColorBlendAttachmentState color_blend_attachment{
+        .blendEnable = VK_FALSE,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+    };
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 1,
+        .pAttachments = &color_blend_attachment,
+    };
+    // The depth is an input: the fullscreen triangle does not test it
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_FALSE,
+        .depthWriteEnable = VK_FALSE,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 2,
+        .pStages = shader_stages,
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &assembly_state_create_info,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_lighting_layout,
+        .renderPass = m_render_pass,
+        .subpass = m_main_subpass + 1,
+    };
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_lighting_pipeline);
+    // The modules are not needed anymore once the pipeline is created
+    vkDestroyShaderModule(graphics_device, vertex_shader_module, nullptr);
+    vkDestroyShaderModule(graphics_device, fragment_shader_module, nullptr);
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the deferred lighting", pipeline_result);
+        return utils::VResult::Error((char*)"Cannot create the deferred lighting pipeline");
+    }
+    return utils::VResult::Ok();
+}
+
+VkPipeline app::graphics::Pipeline::getLightingPipeline()
+{
+    return m_lighting_pipeline;
+}
+
+VkPipelineLayout app::graphics::Pipeline::getLightingLayout()
+{
+    return m_lighting_layout;
+}
+
+VkDescriptorSet app::graphics::Pipeline::getGBufferDescriptorSet(const uint32_t index) const
+{
+    assert(index < m_gbuffer_sets.size());
+    return m_gbuffer_sets[index];
+}
+
+void app::graphics::Pipeline::writeGBufferInputs(
+    const uint32_t index,
+    const VkImageView albedo_view,
+    const VkImageView normal_view,
+    const VkImageView depth_view)
+{
+    assert(index < m_gbuffer_sets.size());
+    // Same layouts as the input attachment references of the lighting subpass
+    const VkDescriptorImageInfo image_infos[3] = {
+        {VK_NULL_HANDLE, albedo_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {VK_NULL_HANDLE, normal_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {VK_NULL_HANDLE, depth_view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+    };
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_gbuffer_sets[index],
+        .dstBinding = 0,
+        .descriptorCount = 3,
+        .descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+        .pImageInfo = image_infos,
+    };
+    vkUpdateDescriptorSets(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), 1, &write, 0, nullptr);
+}
+
+uint32_t app::graphics::Pipeline::getGBufferAttachment() const noexcept
+{
+    return m_gbuffer_attachment;
+}
+
 utils::VResult app::graphics::Pipeline::createSyncObjects()
 {
     Log("> Creating the sync objects");
-    auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
-    if (nullptr == m_sync_image_ready)
+    auto& sync_pool = app::Engine::getInstance()->m_sync_pool;
+    if (VK_NULL_HANDLE == m_sync_image_ready)
     {
-        m_sync_image_ready = new VkSemaphore();
-        VkSemaphoreCreateInfo create_info{};
-        create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        if (VK_SUCCESS != vkCreateSemaphore(graphics_device, &create_info, nullptr, m_sync_image_ready))
+        const auto result = sync_pool->acquireSemaphore();
+        if (result.IsError())
             return utils::VResult::Error((char*)"< Failed to create the semaphore to signal image ready");
+        m_sync_image_ready = result.GetValue();
     }
-    if (nullptr == m_sync_present_done)
+    if (VK_NULL_HANDLE == m_sync_present_done)
     {
-        m_sync_present_done = new VkSemaphore();
-        VkSemaphoreCreateInfo create_info{};
-        create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        if (VK_SUCCESS != vkCreateSemaphore(graphics_device, &create_info, nullptr, m_sync_present_done))
+        const auto result = sync_pool->acquireSemaphore();
+        if (result.IsError())
             return utils::VResult::Error((char*)"< Failed to create the semaphore to signal present is done");
+        m_sync_present_done = result.GetValue();
     }
-    if (nullptr == m_sync_cpu_gpu)
+    if (VK_NULL_HANDLE == m_sync_uploads_done)
     {
-        m_sync_cpu_gpu = new VkFence();
-        VkFenceCreateInfo create_info{};
-        create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT; // This allows to not wait for the first wait
-        if (VK_SUCCESS != vkCreateFence(graphics_device, &create_info, nullptr, m_sync_cpu_gpu))
+        const auto result = sync_pool->acquireSemaphore();
+        if (result.IsError())
+            return utils::VResult::Error((char*)"< Failed to create the semaphore to signal uploads are done");
+        m_sync_uploads_done = result.GetValue();
+    }
+    if (VK_NULL_HANDLE == m_sync_cpu_gpu)
+    {
+        // Unsignaled: the first frame does not wait for it (see m_frame_in_flight)
+        const auto result = sync_pool->acquireFence();
+        if (result.IsError())
             return utils::VResult::Error((char*)"< Failed to create the fence");
+        m_sync_cpu_gpu = result.GetValue();
     }
     return utils::VResult::Ok();
 }
 
 void app::graphics::Pipeline::acquireImage()
 {
-    // Wait that all fences are sync...
-    vkWaitForFences(
-        app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
-        1,
-        m_sync_cpu_gpu,
-        VK_TRUE,
-        UINT64_MAX);
-    // ... and reset them
-    vkResetFences(
-        app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
-        1,
-        m_sync_cpu_gpu);
+    if (m_frame_in_flight)
+    {
+        // Wait that all fences are sync...
+        vkWaitForFences(
+            app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+            1,
+            &m_sync_cpu_gpu,
+            VK_TRUE,
+            UINT64_MAX);
+        // ... and reset them
+        vkResetFences(
+            app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+            1,
+            &m_sync_cpu_gpu);
+        m_frame_in_flight = false;
+    }
 
     // Acquire the new frame
     vkAcquireNextImageKHR(
         app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
         app::Engine::getInstance()->m_swapchain->getSwapchainDevice(),
         UINT64_MAX,
-        *m_sync_image_ready,
+        m_sync_image_ready,
         VK_NULL_HANDLE,
         &app::Engine::getInstance()->m_render->getFrameIndex());
 }
 
 void app::graphics::Pipeline::present()
 {
-    VkSemaphore signal[] = {*m_sync_present_done};
+    VkSemaphore signal[] = {m_sync_present_done};
     VkSwapchainKHR swapchains[] = {
         app::Engine::getInstance()->m_swapchain->getSwapchainDevice()};
     VkPresentInfoKHR present_info{
@@ -658,56 +1233,69 @@ void app::graphics::Pipeline::present()
         .pSwapchains = swapchains,
         .pImageIndices = &app::Engine::getInstance()->m_render->getFrameIndex(),
     };
-    vkQueuePresentKHR(
-        app::Engine::getInstance()->m_graphics_device.getPresentsQueue(),
-        &present_info);
+    // Flushes the submissions pending on the present queue first
+    app::Engine::getInstance()->m_render->getSubmitBatcher(app::Engine::getInstance()->m_graphics_device.getPresentsQueue())->present(present_info);
 }
 
 utils::Result<int> app::graphics::Pipeline::draw()
 {
-    // Reset the command buffer
     auto command_buffer = app::Engine::getInstance()->m_render->getGraphicsCommand();
     if (command_buffer == nullptr)
         return utils::Result<int>::Error((char*)"Cannot get the command buffer in the draw call");
-    vkResetCommandBuffer(
-        *(command_buffer.get()->getBuffer()),
-        0);
-    // Record the current command
-    app::Engine::getInstance()->m_render->getGraphicsCommand()->record();
-    // Submit
-    VkSemaphore wait_semaphores[] = {*m_sync_image_ready};
-    VkSemaphore signal_semaphores[] = {*m_sync_present_done};
-    VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    VkSubmitInfo submit_info{
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .waitSemaphoreCount = 1, // TODO: to change for something more idiomatic / maintainable
-        .pWaitSemaphores = wait_semaphores,
-        .pWaitDstStageMask = wait_stages,
-        .commandBufferCount = 1,
-        .pCommandBuffers = command_buffer->getBuffer(),
-        .signalSemaphoreCount = 1, // TODO: to change for something more idiomatic / maintainable
-        .pSignalSemaphores = signal_semaphores,
-    };
-
-    if (const auto submit_result_code = vkQueueSubmit(
-            app::Engine::getInstance()->m_graphics_device.getGraphicsQueue(),
-            1,
-            &submit_info,
-            *m_sync_cpu_gpu);
-        submit_result_code != VK_SUCCESS)
+    // Record the current command, in a command buffer of the frame (its pool has been
+    // reset as a whole, no need to reset the buffer)
+    if (const auto result = command_buffer->record(); result.IsError())
+        return utils::Result<int>::Error((char*)"Error recording the command buffer in Draw call");
+    auto submit_batcher = app::Engine::getInstance()->m_render->getSubmitBatcher(app::Engine::getInstance()->m_graphics_device.getGraphicsQueue());
+    std::vector<VkSemaphoreSubmitInfo> waits{VkSemaphoreSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = m_sync_image_ready,
+        .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+    }};
+    // The uploads recorded since the last frame are submitted with it: on the graphics queue
+    // they are already in its batches, on another queue they are flushed there and waited for
+    auto transfert_batcher = app::Engine::getInstance()->m_render->getSubmitBatcher(app::Engine::getInstance()->m_graphics_device.getTransfertQueue());
+    if (transfert_batcher != submit_batcher && transfert_batcher->hasPending())
     {
-        return utils::Result<int>::Error((char*)"Error submitting the queue in Draw call");
+        const VkSemaphoreSubmitInfo uploads_done{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = m_sync_uploads_done,
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        };
+        if (const auto result = transfert_batcher->flush(VK_NULL_HANDLE, {uploads_done}); result.IsError())
+            return utils::Result<int>::Error((char*)"Error submitting the uploads in Draw call");
+        waits.push_back(uploads_done);
     }
+    // Submit: the frame is the last batch of the graphics queue, the fence is signaled
+    // once all of its batches have completed
+    submit_batcher->add(
+        *command_buffer->getBuffer(),
+        waits,
+        {VkSemaphoreSubmitInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = m_sync_present_done,
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        }});
+    if (const auto result = submit_batcher->flush(m_sync_cpu_gpu); result.IsError())
+        return utils::Result<int>::Error((char*)"Error submitting the queue in Draw call");
+    m_frame_in_flight = true;
+    // The next uploads are recorded in the pools of the next frame
+    if (const auto result = app::Engine::getInstance()->m_render->getTransfertCommand()->beginFrame(); result.IsError())
+        return utils::Result<int>::Error((char*)"Error beginning the frame of the uploads in Draw call");
 
     return utils::Result<int>::Ok(0);
 }
 
-const VkBuffer& app::graphics::Pipeline::getVertexBuffer() noexcept
+VkBuffer app::graphics::Pipeline::getVertexBuffer() const noexcept
 {
-    return m_vertex_buffer;
+    if (m_vertex_buffer.isNull())
+        return VK_NULL_HANDLE;
+    return app::Engine::getInstance()->m_resources->getBuffer(m_vertex_buffer).m_buffer;
 }
 
-const VkBuffer& app::graphics::Pipeline::getIndexBuffer() noexcept
+VkBuffer app::graphics::Pipeline::getIndexBuffer() const noexcept
 {
-    return m_index_buffer;
+    if (m_index_buffer.isNull())
+        return VK_NULL_HANDLE;
+    return app::Engine::getInstance()->m_resources->getBuffer(m_index_buffer).m_buffer;
 }
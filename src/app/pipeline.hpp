@@ -9,6 +9,7 @@
 #define pipeline_hpp
 
 #include "../utils/result.h"
+#include "resources.hpp"
 #include "shaders.h"
 #include <cstdlib>
 #include <optional>
@@ -86,15 +87,73 @@ namespace app
             /// @brief Returns the registered render pass object
             /// @return A VkRenderPass object
             VkRenderPass& getRenderPass();
-            /// @brief Returns a reference to the current vertex buffer
-            /// @return A reference to the current vertex buffer
-            const VkBuffer& getVertexBuffer() noexcept;
-            /// @brief Returns a reference to the current index buffer
-            /// @return A reference to the current index buffer
-            const VkBuffer& getIndexBuffer() noexcept;
+            /// @brief Setup the render pass that draws the UI on top of the
+            /// upscaled scene, directly in the swapchain image
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult setupUIRenderPass();
+            /// @brief Returns the registered UI render pass object
+            /// @return A VkRenderPass object
+            VkRenderPass& getUIRenderPass();
+            /// @brief Returns the current vertex buffer
+            /// @return The current vertex buffer, or VK_NULL_HANDLE if none
+            VkBuffer getVertexBuffer() const noexcept;
+            /// @brief Returns the current index buffer
+            /// @return The current index buffer, or VK_NULL_HANDLE if none
+            VkBuffer getIndexBuffer() const noexcept;
             /// @brief Returns the pipeline of this object
             /// @return A VkPipeline object
             VkPipeline getPipeline();
+            /// @brief Returns the layout of the pipeline, to push the
+            /// constants of the scene
+            /// @return A VkPipelineLayout object
+            VkPipelineLayout getLayout();
+            /// @brief Returns the depth-only pipeline of the pre-pass, if
+            /// DEPTH_PRE_PASS is enabled
+            /// @return A VkPipeline object, or VK_NULL_HANDLE
+            VkPipeline getDepthPrePassPipeline();
+            /// @brief Returns the index of the subpass that draws the geometry (0, or 1 if the
+            /// depth pre-pass is enabled): it shades the fragments, or writes the G-buffer
+            /// if DEFERRED_SHADING is enabled
+            uint32_t getMainSubpass() const noexcept;
+            /// @brief Returns the full-screen pipeline of the deferred lighting subpass, if
+            /// DEFERRED_SHADING is enabled
+            /// @return A VkPipeline object, or VK_NULL_HANDLE
+            VkPipeline getLightingPipeline();
+            /// @brief Returns the layout of the deferred lighting pipeline: the set 0 (lights)
+            /// and the push constants are compatible with the main pipeline layout, the
+            /// set 1 holds the G-buffer input attachments
+            /// @return A VkPipelineLayout object, or VK_NULL_HANDLE
+            VkPipelineLayout getLightingLayout();
+            /// @brief Returns the descriptor set of the G-buffer input attachments of a framebuffer
+            /// @param index The swapchain image index
+            VkDescriptorSet getGBufferDescriptorSet(const uint32_t index) const;
+            /// @brief Writes the G-buffer input attachments of a framebuffer, read by the
+            /// deferred lighting subpass
+            /// @param index The swapchain image index
+            /// @param albedo_view The albedo attachment of the framebuffer
+            /// @param normal_view The normal attachment of the framebuffer
+            /// @param depth_view The depth attachment of the framebuffer (depth aspect only)
+            void writeGBufferInputs(
+                const uint32_t index,
+                const VkImageView albedo_view,
+                const VkImageView normal_view,
+                const VkImageView depth_view);
+            /// @brief Returns the index of the first G-buffer attachment (albedo, then normal)
+            /// of the scene render pass, or 0 if DEFERRED_SHADING is disabled
+            uint32_t getGBufferAttachment() const noexcept;
+            /// @brief Returns the number of color attachments of the main subpass (color or
+            /// G-buffer, then motion vectors), for the pipelines drawn in it
+            uint32_t getMainColorAttachmentCount() const noexcept;
+            /// @brief Returns the index of the last subpass of the scene render pass, which
+            /// writes the scene color (the main subpass, or the deferred lighting subpass).
+            /// Its depth attachment can be tested, but is read-only with the deferred shading.
+            uint32_t getSceneSubpass() const noexcept;
+            /// @brief Returns the number of color attachments of the last subpass
+            uint32_t getSceneColorAttachmentCount() const noexcept;
+            /// @brief Returns the number of attachments of the scene render pass
+            /// (one clear value per attachment when beginning it)
+            uint32_t getAttachmentCount() const noexcept;
             /// @brief Creates a Vertex Buffer object to use for our shaders
             /// @return A VResult type to know if the function succeeded or not.
             utils::VResult createVertexBuffer() noexcept;
@@ -111,22 +170,32 @@ namespace app
             /// TODO: should return a VResult
             void present();
 
-        private:
             /// @brief Returns the size, as a `uint64_t` type, of a file located at `filepath`.
             /// If the file does not exists, or can't be read, return a `nullopt` value.
             /// **Warning**: this function is **not** data-race conditons bullet-proof.
-            std::optional<uint64_t> fileSize(const char* filepath);
+            static std::optional<uint64_t> fileSize(const char* filepath);
             /// @brief Read the content of a file, located at `filepath`, and put the content of it
             /// in `buffer`.
             /// If `buffer_length` is greater than the real file size, there is a cap on the real file size.
             /// Returns the length that is read, or `nullopt` if an error happened.
             /// **Warning**: this function is **not** data-race conditons bullet-proof.
-            std::optional<uint64_t> readFile(const char* filepath, char** buffer, uint64_t buffer_length);
+            static std::optional<uint64_t> readFile(const char* filepath, char** buffer, uint64_t buffer_length);
+            /// @brief Reads the SPIR-V code of a shader, located at `filepath`, and creates its
+            /// module on the logical device.
+            /// Returns the module, to destroy by the caller once its pipelines are created,
+            /// or an error if the file can't be read or the module can't be created.
+            static utils::Result<VkShaderModule> loadShaderModule(const char* filepath);
+
+        private:
             /// @brief Create all the sync objects (semaphores / fences) to use
             /// in our pipeline / renderer
             /// @return A VResult type to know if the creation has been successfuly
             /// executed or not
             utils::VResult createSyncObjects();
+            /// @brief Creates the full-screen pipeline of the deferred lighting subpass,
+            /// its layout, and one G-buffer descriptor set per swapchain image
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult createLightingPipeline();
             /// @brief The shader stages in the pipeline
             std::vector<VkPipelineShaderStageCreateInfo> m_shader_stages;
             /// @brief Stores the shader modules to create the pipeline object later
@@ -135,24 +204,49 @@ namespace app
             VkPipelineLayout m_layout = VK_NULL_HANDLE;
             /// @brief The render pass object
             VkRenderPass m_render_pass = VK_NULL_HANDLE;
+            /// @brief The UI render pass object
+            VkRenderPass m_ui_render_pass = VK_NULL_HANDLE;
             /// @brief The pipeline object
             VkPipeline m_pipeline = VK_NULL_HANDLE;
-            /// @brief The vertex buffer
-            VkBuffer m_vertex_buffer = VK_NULL_HANDLE;
-            /// @brief The vertex buffer allocation object
-            VmaAllocation m_vertex_buffer_allocation = {};
-            /// @brief The index buffer
-            VkBuffer m_index_buffer = VK_NULL_HANDLE;
-            /// @brief The index buffer allocation object
-            VmaAllocation m_index_buffer_allocation = {};
+            /// @brief The depth-only pipeline object, for the pre-pass
+            VkPipeline m_depth_prepass_pipeline = VK_NULL_HANDLE;
+            /// @brief The index of the subpass that draws the geometry
+            uint32_t m_main_subpass = 0;
+            /// @brief The full-screen pipeline of the deferred lighting subpass
+            VkPipeline m_lighting_pipeline = VK_NULL_HANDLE;
+            /// @brief The layout of the deferred lighting pipeline
+            VkPipelineLayout m_lighting_layout = VK_NULL_HANDLE;
+            /// @brief The layout of the G-buffer input attachments set
+            VkDescriptorSetLayout m_gbuffer_set_layout = VK_NULL_HANDLE;
+            /// @brief The G-buffer input attachments, one set per swapchain image
+            std::vector<VkDescriptorSet> m_gbuffer_sets;
+            /// @brief The index of the first G-buffer attachment of the scene render pass
+            uint32_t m_gbuffer_attachment = 0;
+            /// @brief The number of attachments of the scene render pass
+            uint32_t m_attachment_count = 0;
+            /// @brief The number of color attachments of the main subpass
+            uint32_t m_main_color_attachment_count = 0;
+            /// @brief The index of the last subpass, which writes the scene color
+            uint32_t m_scene_subpass = 0;
+            /// @brief The number of color attachments of the last subpass
+            uint32_t m_scene_color_attachment_count = 0;
+            /// @brief The vertex buffer, in the resource pools
+            app::graphics::BufferHandle m_vertex_buffer;
+            /// @brief The index buffer, in the resource pools
+            app::graphics::BufferHandle m_index_buffer;
             /// @brief Sync object to signal that an image is ready to
-            /// be displayed
-            VkSemaphore* m_sync_image_ready = nullptr;
+            /// be displayed (from the sync pool)
+            VkSemaphore m_sync_image_ready = VK_NULL_HANDLE;
             /// @brief Sync object to signal that the rendering
-            /// is done for the current frame
-            VkSemaphore* m_sync_present_done = nullptr;
-            /// @brief Sync object for CPU / GPU
-            VkFence* m_sync_cpu_gpu = nullptr;
+            /// is done for the current frame (from the sync pool)
+            VkSemaphore m_sync_present_done = VK_NULL_HANDLE;
+            /// @brief Sync object to signal that the uploads of the frame are done, when they
+            /// are submitted to another queue (from the sync pool)
+            VkSemaphore m_sync_uploads_done = VK_NULL_HANDLE;
+            /// @brief Sync object for CPU / GPU (from the sync pool)
+            VkFence m_sync_cpu_gpu = VK_NULL_HANDLE;
+            /// @brief If a frame has been submitted with the fence, and not waited for yet
+            bool m_frame_in_flight = false;
         };
     } // namespace graphics
 } // namespace app
@@ -0,0 +1,406 @@
+//
+//  pipeline_library.cpp
+//
+
+#include "pipeline_library.hpp"
+#include "../project.hpp"
+#include "../utils/debug_tools.h"
+#include "depth.hpp"
+#include "engine.hpp"
+#include "pipeline.hpp"
+#include "shaders.h"
+
+#ifdef VK_EXT_graphics_pipeline_library
+/// @brief The stages of each part (VkGraphicsPipelineLibraryFlagsEXT), in the order of the parts
+static constexpr uint32_t PART_FLAGS[] = {
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+};
+#else
+/// @brief The stages of each part, in the order of the parts. The headers do not declare
+/// VK_EXT_graphics_pipeline_library: only complete pipelines are created, with all of them
+static constexpr uint32_t PART_FLAGS[] = {0x1, 0x2, 0x4, 0x8};
+#endif
+
+/// @brief All the parts: a complete pipeline
+static constexpr uint32_t ALL_PARTS = PART_FLAGS[0] | PART_FLAGS[1] | PART_FLAGS[2] | PART_FLAGS[3];
+
+app::graphics::PipelineLibrary::PipelineLibrary(){};
+
+app::graphics::PipelineLibrary::~PipelineLibrary()
+{
+    if (m_worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        // Waits for the link in progress, if any
+        m_worker.join();
+    }
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    for (const auto& [key, pipeline] : m_results)
+    {
+        if (VK_NULL_HANDLE != pipeline)
+            vkDestroyPipeline(graphics_device, pipeline, nullptr);
+    }
+    m_results.clear();
+    m_jobs.clear();
+    for (const auto& retired : m_retired)
+        vkDestroyPipeline(graphics_device, retired.m_pipeline, nullptr);
+    m_retired.clear();
+    for (const auto& [key, entry] : m_entries)
+    {
+        if (VK_NULL_HANDLE != entry.m_pipeline)
+            vkDestroyPipeline(graphics_device, entry.m_pipeline, nullptr);
+    }
+    m_entries.clear();
+    // The linked pipelines do not need their parts anymore
+    for (const auto& [key, part] : m_parts)
+        vkDestroyPipeline(graphics_device, part, nullptr);
+    m_parts.clear();
+};
+
+utils::VResult app::graphics::PipelineLibrary::create(const char* vertex_shader, const char* fragment_shader)
+{
+    m_use_libraries = app::Engine::getInstance()->m_graphics_device.supportsGraphicsPipelineLibrary();
+    if (!m_use_libraries)
+        LogW("> Graphics pipeline libraries are not supported: the pipeline variants are compiled in the background");
+    else if (!app::Engine::getInstance()->m_graphics_device.supportsFastLinking())
+        LogW("> The pipeline libraries are not linked fast: the first use of a variant may be slow");
+    Log("> Creating the pipeline library (%s)", m_use_libraries ? "fast link" : "background compilation");
+    m_worker = std::thread(&PipelineLibrary::workerLoop, this);
+    return precompile(Variant{
+        .m_vertex_shader = vertex_shader,
+        .m_fragment_shader = fragment_shader,
+    });
+}
+
+utils::VResult app::graphics::PipelineLibrary::precompile(const Variant& variant)
+{
+    if (!m_use_libraries)
+        return utils::VResult::Ok();
+    for (uint32_t part = 0; part < PART_COUNT; ++part)
+    {
+        if (const auto result = getPart(static_cast<Part>(part), variant); result.IsError())
+            return utils::VResult::Error((char*)"Cannot compile the parts of the pipeline variant");
+    }
+    return utils::VResult::Ok();
+}
+
+utils::Result<VkPipeline> app::graphics::PipelineLibrary::getPipeline(const Variant& variant)
+{
+    const VariantKey key = getVariantKey(variant);
+    if (const auto it = m_entries.find(key); it != m_entries.end())
+    {
+        if (VK_NULL_HANDLE == it->second.m_pipeline)
+            return utils::Result<VkPipeline>::Error((char*)"The pipeline variant is not ready");
+        return utils::Result<VkPipeline>::Ok(it->second.m_pipeline);
+    }
+
+    Job job{
+        .m_key = key,
+        .m_variant = variant,
+    };
+    Entry entry{};
+    if (m_use_libraries)
+    {
+        // Only the parts of the new state are compiled: usually none, or a single one
+        for (uint32_t part = 0; part < PART_COUNT; ++part)
+        {
+            const auto result = getPart(static_cast<Part>(part), variant);
+            if (result.IsError())
+                return utils::Result<VkPipeline>::Error((char*)"Cannot compile the parts of the pipeline variant");
+            job.m_parts[part] = result.GetValue();
+        }
+        const auto fast_link = link(job.m_parts, false);
+        if (fast_link.IsError())
+            return fast_link;
+        entry.m_pipeline = fast_link.GetValue();
+    }
+    entry.m_pending = true;
+    m_entries.emplace(key, entry);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+    if (VK_NULL_HANDLE == entry.m_pipeline)
+        return utils::Result<VkPipeline>::Error((char*)"The pipeline variant is not ready");
+    return utils::Result<VkPipeline>::Ok(entry.m_pipeline);
+}
+
+void app::graphics::PipelineLibrary::update()
+{
+    ++m_frame;
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    std::vector<std::pair<VariantKey, VkPipeline>> results;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        results.swap(m_results);
+    }
+    for (const auto& [key, pipeline] : results)
+    {
+        Entry& entry = m_entries[key];
+        entry.m_pending = false;
+        // Keeps the fast-linked pipeline if the optimized link failed
+        if (VK_NULL_HANDLE == pipeline)
+            continue;
+        // The command buffers of the previous frames may still bind the fast-linked one
+        if (VK_NULL_HANDLE != entry.m_pipeline)
+            m_retired.push_back(RetiredPipeline{entry.m_pipeline, m_frame});
+        entry.m_pipeline = pipeline;
+        // The cached draws of the main subpass bind the replaced pipeline
+        app::Engine::getInstance()->m_render->getGraphicsCommand()->invalidateStatic();
+    }
+    size_t kept = 0;
+    for (const auto& retired : m_retired)
+    {
+        if (m_frame >= retired.m_frame + Project::FRAMES_IN_FLIGHT)
+            vkDestroyPipeline(graphics_device, retired.m_pipeline, nullptr);
+        else
+            m_retired[kept++] = retired;
+    }
+    m_retired.resize(kept);
+}
+
+app::graphics::PipelineLibrary::VariantKey app::graphics::PipelineLibrary::getVariantKey(const Variant& variant)
+{
+    return VariantKey(
+        variant.m_vertex_shader,
+        variant.m_fragment_shader,
+        variant.m_topology,
+        variant.m_polygon_mode,
+        variant.m_cull_mode,
+        variant.m_depth_write,
+        variant.m_alpha_blending);
+}
+
+app::graphics::PipelineLibrary::PartKey app::graphics::PipelineLibrary::getPartKey(const Part part, const Variant& variant)
+{
+    switch (part)
+    {
+        case VERTEX_INPUT:
+            return PartKey(part, std::string(), variant.m_topology, 0, 0);
+        case PRE_RASTERIZATION:
+            return PartKey(part, variant.m_vertex_shader, variant.m_polygon_mode, 0, variant.m_cull_mode);
+        case FRAGMENT_SHADER:
+            return PartKey(part, variant.m_fragment_shader, variant.m_depth_write ? 1 : 0, 0, 0);
+        case FRAGMENT_OUTPUT:
+        default:
+            return PartKey(part, std::string(), variant.m_alpha_blending ? 1 : 0, 0, 0);
+    }
+}
+
+utils::Result<VkPipeline> app::graphics::PipelineLibrary::getPart(const Part part, const Variant& variant)
+{
+    const PartKey key = getPartKey(part, variant);
+    if (const auto it = m_parts.find(key); it != m_parts.end())
+        return utils::Result<VkPipeline>::Ok(it->second);
+    const auto result = createPipeline(variant, PART_FLAGS[part], true);
+    if (result.IsError())
+        return result;
+    m_parts.emplace(key, result.GetValue());
+    return result;
+}
+
+utils::Result<VkPipeline> app::graphics::PipelineLibrary::createPipeline(const Variant& variant, const uint32_t parts, const bool library) const
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    const auto scene_pipeline = app::Engine::getInstance()->m_render->getGraphicsPipeline();
+
+    // The shaders of the parts, destroyed once the pipeline is created
+    std::vector<VkShaderModule> shader_modules;
+    std::vector<VkPipelineShaderStageCreateInfo> shader_stages;
+    const auto add_stage = [&](const VkShaderStageFlagBits stage, const std::string& filepath) -> bool {
+        const auto shader_module = app::graphics::Pipeline::loadShaderModule(filepath.c_str());
+        if (shader_module.IsError())
+            return false;
+        shader_modules.push_back(shader_module.GetValue());
+        shader_stages.push_back(VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = stage,
+            .module = shader_module.GetValue(),
+            .pName = "main",
+        });
+        return true;
+    };
+    bool shaders_created = true;
+    if (parts & PART_FLAGS[PRE_RASTERIZATION])
+        shaders_created = add_stage(VK_SHADER_STAGE_VERTEX_BIT, variant.m_vertex_shader);
+    if (shaders_created && (parts & PART_FLAGS[FRAGMENT_SHADER]))
+        shaders_created = add_stage(VK_SHADER_STAGE_FRAGMENT_BIT, variant.m_fragment_shader);
+    if (!shaders_created)
+    {
+        for (const VkShaderModule shader_module : shader_modules)
+            vkDestroyShaderModule(graphics_device, shader_module, nullptr);
+        return utils::Result<VkPipeline>::Error((char*)"Cannot create the shaders of the pipeline variant");
+    }
+
+    // Same fixed functions as the scene pipeline (Pipeline::create), the variant state apart.
+    // The states outside of the created parts are ignored.
+    const auto vertex_binding_description = app::shaders::VertexUtils::getVertexBindingDescription();
+    const auto vertex_attribute_descriptions = app::shaders::VertexUtils::getVertexAttributeDescriptions();
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &vertex_binding_description,
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_attribute_descriptions.size()),
+        .pVertexAttributeDescriptions = vertex_attribute_descriptions.data(),
+    };
+    VkPipelineInputAssemblyStateCreateInfo assembly_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = variant.m_topology,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = variant.m_polygon_mode,
+        .cullMode = variant.m_cull_mode,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = app::Engine::getInstance()->m_render->getSampleCount(),
+        .sampleShadingEnable = VK_FALSE,
+    };
+    // The depth pre-pass already wrote the closest fragments
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = !Project::DEPTH_PRE_PASS && variant.m_depth_write ? VK_TRUE : VK_FALSE,
+        .depthCompareOp = Project::DEPTH_PRE_PASS ? VK_COMPARE_OP_EQUAL : app::graphics::Depth::getCompareOp(),
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    // The blending only applies to the color (or the albedo), not to the other attachments
+    VkPipelineColorBlendAttachmentState color_blend_attachments[3] = {};
+    for (auto& color_blend_attachment : color_blend_attachments)
+    {
+        color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
+                                                VK_COLOR_COMPONENT_G_BIT |
+                                                VK_COLOR_COMPONENT_B_BIT |
+                                                VK_COLOR_COMPONENT_A_BIT;
+        color_blend_attachment.blendEnable = VK_FALSE;
+    }
+    if (variant.m_alpha_blending)
+    {
+        color_blend_attachments[0].blendEnable = VK_TRUE;
+        color_blend_attachments[0].srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        color_blend_attachments[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        color_blend_attachments[0].colorBlendOp = VK_BLEND_OP_ADD;
+        color_blend_attachments[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_blend_attachments[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        color_blend_attachments[0].alphaBlendOp = VK_BLEND_OP_ADD;
+    }
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = scene_pipeline->getMainColorAttachmentCount(),
+        .pAttachments = color_blend_attachments,
+    };
+
+#ifdef VK_EXT_graphics_pipeline_library
+    // The parts keep what the link-time optimizations need
+    VkGraphicsPipelineLibraryCreateInfoEXT library_create_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+        .flags = parts,
+    };
+#endif
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+#ifdef VK_EXT_graphics_pipeline_library
+        .pNext = library ? &library_create_info : nullptr,
+        .flags = library ? static_cast<VkPipelineCreateFlags>(VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT) : 0u,
+#endif
+        .stageCount = static_cast<uint32_t>(shader_stages.size()),
+        .pStages = shader_stages.data(),
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &assembly_state_create_info,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = scene_pipeline->getLayout(),
+        .renderPass = scene_pipeline->getRenderPass(),
+        .subpass = scene_pipeline->getMainSubpass(),
+    };
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline);
+    for (const VkShaderModule shader_module : shader_modules)
+        vkDestroyShaderModule(graphics_device, shader_module, nullptr);
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the pipeline variant (parts 0x%x)", pipeline_result, parts);
+        return utils::Result<VkPipeline>::Error((char*)"Cannot create the pipeline variant");
+    }
+    return utils::Result<VkPipeline>::Ok(pipeline);
+}
+
+utils::Result<VkPipeline> app::graphics::PipelineLibrary::link(const VkPipeline (&parts)[PART_COUNT], const bool optimized) const
+{
+    const VkPipelineLibraryCreateInfoKHR library_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+        .libraryCount = PART_COUNT,
+        .pLibraries = parts,
+    };
+    const VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &library_info,
+#ifdef VK_EXT_graphics_pipeline_library
+        .flags = optimized ? static_cast<VkPipelineCreateFlags>(VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT) : 0u,
+#endif
+        .layout = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getLayout(),
+    };
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (const auto result = vkCreateGraphicsPipelines(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x when linking a pipeline variant (%s)", result, optimized ? "optimized" : "fast");
+        return utils::Result<VkPipeline>::Error((char*)"Cannot link the pipeline variant");
+    }
+    return utils::Result<VkPipeline>::Ok(pipeline);
+}
+
+void app::graphics::PipelineLibrary::workerLoop()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping)
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.erase(m_jobs.begin());
+        }
+        // The slow part, off the render thread
+        const auto result = m_use_libraries ? link(job.m_parts, true) : createPipeline(job.m_variant, ALL_PARTS, false);
+        const VkPipeline pipeline = result.IsError() ? VK_NULL_HANDLE : result.GetValue();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_results.emplace_back(std::move(job.m_key), pipeline);
+    }
+}
@@ -0,0 +1,178 @@
+//
+//  pipeline_library.hpp
+//
+
+#pragma once
+#ifndef pipeline_library_h
+#define pipeline_library_h
+
+#include "../project.hpp"
+#include "../utils/result.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Creates the variants of the scene pipeline (main subpass of the scene render
+        /// pass, scene vertex format and pipeline layout) without hitches on first use.
+        ///
+        /// With VK_EXT_graphics_pipeline_library, a variant is split in four parts: vertex
+        /// input, pre-rasterization shaders, fragment shader and fragment output. Each part is
+        /// compiled once and cached, shared by all the variants with the same state for this
+        /// part. A new variant is linked immediately from its parts without link-time
+        /// optimization (fast link), and an optimized version is linked on a background thread
+        /// and swapped in by `update` once ready.
+        /// Without the extension, the variants are compiled as a whole on the background
+        /// thread, and are not available until then.
+        class PipelineLibrary
+        {
+        public:
+            /// @brief The shaders and the state of a variant
+            struct Variant
+            {
+                /// @brief The SPIR-V vertex shader
+                std::string m_vertex_shader;
+                /// @brief The SPIR-V fragment shader
+                std::string m_fragment_shader;
+                /// @brief The topology of the primitives
+                VkPrimitiveTopology m_topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+                /// @brief The rasterization mode of the polygons
+                VkPolygonMode m_polygon_mode = VK_POLYGON_MODE_FILL;
+                /// @brief The faces that are culled
+                VkCullModeFlags m_cull_mode = VK_CULL_MODE_BACK_BIT;
+                /// @brief If the depth is written (ignored with the depth pre-pass, which
+                /// already wrote it)
+                bool m_depth_write = true;
+                /// @brief If the color is blended with its alpha (the other attachments are
+                /// written as is)
+                bool m_alpha_blending = false;
+            };
+
+            /// @brief Public constructor
+            PipelineLibrary();
+            /// @brief Public destructor
+            ~PipelineLibrary();
+            /// @brief Starts the background thread, and compiles the parts of the scene
+            /// shaders in their default state
+            /// @param vertex_shader The SPIR-V vertex shader of the scene
+            /// @param fragment_shader The SPIR-V fragment shader of the scene
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const char* vertex_shader, const char* fragment_shader);
+            /// @brief Compiles the parts of a variant ahead of its first use (e.g. while
+            /// loading a level), without linking it
+            /// @param variant The shaders and the state of the variant
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult precompile(const Variant& variant);
+            /// @brief Returns the pipeline of a variant: the optimized one if ready, else
+            /// the fast-linked one, created on the first call
+            /// @param variant The shaders and the state of the variant
+            /// @return The pipeline, or an error while it is compiled in the background
+            /// (without pipeline libraries) or if it cannot be compiled: the draws should
+            /// use the scene pipeline meanwhile
+            utils::Result<VkPipeline> getPipeline(const Variant& variant);
+            /// @brief Swaps in the pipelines optimized in the background (the cached draws
+            /// of the scene are recorded again), and destroys the ones they replaced
+            /// FRAMES_IN_FLIGHT frames ago. Should be called once per frame, before recording the
+            /// draws.
+            void update();
+
+        private:
+            /// @brief The parts of a variant
+            enum Part
+            {
+                VERTEX_INPUT,
+                PRE_RASTERIZATION,
+                FRAGMENT_SHADER,
+                FRAGMENT_OUTPUT,
+                PART_COUNT,
+            };
+            /// @brief The key of a variant: all of its shaders and state
+            using VariantKey = std::tuple<std::string, std::string, int, int, uint32_t, bool, bool>;
+            /// @brief The key of a part: its shader, if any, and the state of the variant it
+            /// depends on
+            using PartKey = std::tuple<int, std::string, int, int, uint32_t>;
+            /// @brief A variant, linked or being linked
+            struct Entry
+            {
+                /// @brief The pipeline bound by the draws (VK_NULL_HANDLE until available)
+                VkPipeline m_pipeline = VK_NULL_HANDLE;
+                /// @brief If the optimized pipeline is being linked in the background
+                bool m_pending = false;
+            };
+            /// @brief A link (or a compilation without pipeline libraries) of the background thread
+            struct Job
+            {
+                /// @brief The key of the variant
+                VariantKey m_key;
+                /// @brief The variant, compiled as a whole without pipeline libraries
+                Variant m_variant;
+                /// @brief The parts of the variant, with pipeline libraries
+                VkPipeline m_parts[PART_COUNT] = {};
+            };
+            /// @brief A pipeline replaced by its optimized version
+            struct RetiredPipeline
+            {
+                /// @brief The replaced pipeline
+                VkPipeline m_pipeline;
+                /// @brief The frame it was replaced at
+                uint64_t m_frame;
+            };
+            /// @brief PipelineLibrary should not be cloneable
+            PipelineLibrary(PipelineLibrary& other) = delete;
+            /// @brief PipelineLibrary should not be assignable
+            void operator=(const PipelineLibrary& other) = delete;
+            /// @brief Returns the key of a variant
+            static VariantKey getVariantKey(const Variant& variant);
+            /// @brief Returns the key of a part of a variant
+            static PartKey getPartKey(const Part part, const Variant& variant);
+            /// @brief Returns a part of a variant, compiled on its first use
+            utils::Result<VkPipeline> getPart(const Part part, const Variant& variant);
+            /// @brief Creates a pipeline with the state of some parts of a variant
+            /// @param variant The shaders and the state of the variant
+            /// @param parts The parts (VkGraphicsPipelineLibraryFlagsEXT) to create, all of them
+            /// for a complete pipeline
+            /// @param library If the pipeline is a library (a part), or a complete pipeline
+            /// @return The pipeline, or an error if a shader or the pipeline cannot be created
+            utils::Result<VkPipeline> createPipeline(const Variant& variant, const uint32_t parts, const bool library) const;
+            /// @brief Links the parts of a variant in a complete pipeline
+            /// @param parts The parts of the variant
+            /// @param optimized If the link-time optimizations are enabled (slow)
+            /// @return The pipeline, or an error if the link failed
+            utils::Result<VkPipeline> link(const VkPipeline (&parts)[PART_COUNT], const bool optimized) const;
+            /// @brief The loop of the background thread
+            void workerLoop();
+            /// @brief The variants created
+            std::map<VariantKey, Entry> m_entries;
+            /// @brief The parts compiled, shared by the variants
+            std::map<PartKey, VkPipeline> m_parts;
+            /// @brief The pipelines replaced, destroyed FRAMES_IN_FLIGHT frames later
+            std::vector<RetiredPipeline> m_retired;
+            /// @brief The number of calls to `update`
+            uint64_t m_frame = 0;
+            /// @brief If the variants are linked from pipeline libraries
+            bool m_use_libraries = false;
+            /// @brief The background thread
+            std::thread m_worker;
+            /// @brief Protects the jobs and the results
+            std::mutex m_mutex;
+            /// @brief Wakes the background thread up
+            std::condition_variable m_wake;
+            /// @brief The jobs of the background thread
+            std::vector<Job> m_jobs;
+            /// @brief The pipelines created by the background thread, swapped in by `update`
+            std::vector<std::pair<VariantKey, VkPipeline>> m_results;
+            /// @brief If the background thread should exit
+            bool m_stopping = false;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // pipeline_library_h
@@ -0,0 +1,428 @@
+//
+//  post_processing.cpp
+//
+
+#include "post_processing.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include <algorithm>
+#include <cmath>
+
+/// @brief Local size of the 2D compute shaders of the chain, on X and Y
+constexpr uint32_t GROUP_SIZE = 8;
+
+/// @brief Local size of the color grading LUT compute shader, on X, Y and Z
+constexpr uint32_t LUT_GROUP_SIZE = 4;
+
+/// @brief The smallest level of the bloom pyramid, in pixels
+constexpr uint32_t MIN_BLOOM_LEVEL_SIZE = 4;
+
+/// @brief Records a layout transition of a whole color image
+static void transitionImage(
+    VkCommandBuffer command_buffer,
+    VkImage image,
+    const VkImageLayout old_layout,
+    const VkImageLayout new_layout,
+    const VkPipelineStageFlags src_stage,
+    const VkAccessFlags src_access,
+    const VkPipelineStageFlags dst_stage,
+    const VkAccessFlags dst_access)
+{
+    VkImageMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+        .oldLayout = old_layout,
+        .newLayout = new_layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+/// @brief Records a barrier between two compute dispatches: the writes of the first
+/// are visible to the second
+static void computeBarrier(VkCommandBuffer command_buffer)
+{
+    VkMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+}
+
+/// @brief Returns the extent of the next level of a pyramid
+static VkExtent2D halfExtent(const VkExtent2D& extent)
+{
+    return VkExtent2D{std::max((extent.width + 1) / 2, 1u), std::max((extent.height + 1) / 2, 1u)};
+}
+
+app::graphics::PostProcessing::PostProcessing(){};
+
+app::graphics::PostProcessing::~PostProcessing()
+{
+    m_downsample_pass = nullptr;
+    m_upsample_pass = nullptr;
+    m_lut_pass = nullptr;
+    m_fxaa_pass = nullptr;
+    m_tonemapper = nullptr;
+    m_bloom_levels.clear();
+    m_lut = nullptr;
+    m_output = nullptr;
+    m_last_output = nullptr;
+    if (VK_NULL_HANDLE != m_sampler)
+    {
+        vkDestroySampler(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), m_sampler, nullptr);
+        m_sampler = VK_NULL_HANDLE;
+    }
+};
+
+utils::VResult app::graphics::PostProcessing::create(
+    const VkExtent2D& output_extent,
+    const std::vector<VkImageView>& input_views,
+    const uint32_t bloom_levels,
+    const uint32_t lut_size,
+    const Settings& settings)
+{
+    m_input_views = input_views;
+    m_settings = settings;
+
+    // The bloom starts at half resolution, and stops before the levels get too small to matter
+    m_bloom_levels.clear();
+    VkExtent2D level_extent = halfExtent(output_extent);
+    while (m_bloom_levels.size() < std::max(bloom_levels, 1u))
+    {
+        auto level = std::make_shared<app::graphics::Attachment>();
+        // Written, then read as the source of the next level, then accumulated into:
+        // the levels stay in the GENERAL layout
+        if (const auto result = level->create(level_extent, FORMAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT); result.IsError())
+        {
+            LogE("Error creating the level %d of the bloom pyramid", static_cast<uint32_t>(m_bloom_levels.size()));
+            return result;
+        }
+        m_bloom_levels.push_back(level);
+        if (std::min(level_extent.width, level_extent.height) < 2 * MIN_BLOOM_LEVEL_SIZE)
+            break;
+        level_extent = halfExtent(level_extent);
+    }
+    const uint32_t level_count = static_cast<uint32_t>(m_bloom_levels.size());
+    Log("> Creating the post-processing chain (%dx%d, %d bloom levels, %d^3 LUT)", output_extent.width, output_extent.height, level_count, lut_size);
+
+    m_lut = std::make_shared<app::graphics::Attachment>();
+    // Generated by a compute pass, then sampled by the tonemap pass
+    if (const auto result = m_lut->create(VkExtent2D{lut_size, lut_size}, FORMAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, 1, lut_size); result.IsError())
+    {
+        LogE("Error creating the color grading LUT");
+        return result;
+    }
+
+    m_output = std::make_shared<app::graphics::Attachment>();
+    // Written by the FXAA, then blitted to the swapchain image
+    if (const auto result = m_output->create(output_extent, FORMAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT); result.IsError())
+    {
+        LogE("Error creating the output of the post-processing chain");
+        return result;
+    }
+
+    // Bilinear filtering, and clamp to edge: the passes clamp their coordinates
+    // to the written part of the images
+    VkSamplerCreateInfo sampler_create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .maxLod = 0.0f,
+    };
+    if (const auto result = vkCreateSampler(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &sampler_create_info, nullptr, &m_sampler); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateSampler: error 0x%08x for the post-processing chain", result);
+        return utils::VResult::Error((char*)"Cannot create the sampler of the post-processing chain");
+    }
+
+    m_tonemapper = std::make_shared<app::graphics::Tonemapper>();
+    if (const auto result = m_tonemapper->create(output_extent, input_views, m_bloom_levels[0]->getImageView(), m_lut->getImageView(), m_sampler); result.IsError())
+        return result;
+
+    // 0: source, 1: destination, 2: exposure
+    const std::vector<VkDescriptorSetLayoutBinding> downsample_bindings = {
+        {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+    };
+    m_downsample_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_downsample_pass->create("shaders/bloom_downsample.comp.spv", downsample_bindings, sizeof(BloomPushConstants), level_count - 1, false, true); result.IsError())
+    {
+        LogE("Error creating the bloom downsample pass");
+        return result;
+    }
+    // The first level reads the input of the frame: its set is written each frame
+    for (uint32_t level = 1; level < level_count; ++level)
+    {
+        const uint32_t set_index = level - 1;
+        m_downsample_pass->writeImage(set_index, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_bloom_levels[level - 1]->getImageView(), VK_IMAGE_LAYOUT_GENERAL, m_sampler);
+        m_downsample_pass->writeImage(set_index, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_bloom_levels[level]->getImageView(), VK_IMAGE_LAYOUT_GENERAL);
+        m_downsample_pass->writeBuffer(set_index, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_tonemapper->getExposureBuffer());
+    }
+
+    // 0: lower level, 1: level to accumulate into
+    const std::vector<VkDescriptorSetLayoutBinding> upsample_bindings = {
+        {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+    };
+    if (level_count > 1)
+    {
+        m_upsample_pass = std::make_shared<app::graphics::ComputePass>();
+        if (const auto result = m_upsample_pass->create("shaders/bloom_upsample.comp.spv", upsample_bindings, sizeof(BloomPushConstants), level_count - 1); result.IsError())
+        {
+            LogE("Error creating the bloom upsample pass");
+            return result;
+        }
+        for (uint32_t level = 0; level + 1 < level_count; ++level)
+        {
+            m_upsample_pass->writeImage(level, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_bloom_levels[level + 1]->getImageView(), VK_IMAGE_LAYOUT_GENERAL, m_sampler);
+            m_upsample_pass->writeImage(level, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_bloom_levels[level]->getImageView(), VK_IMAGE_LAYOUT_GENERAL);
+        }
+    }
+
+    // 0: LUT
+    const std::vector<VkDescriptorSetLayoutBinding> lut_bindings = {
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+    };
+    m_lut_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_lut_pass->create("shaders/color_grading_lut.comp.spv", lut_bindings, sizeof(LutPushConstants), 1); result.IsError())
+    {
+        LogE("Error creating the color grading LUT pass");
+        return result;
+    }
+    m_lut_pass->writeImage(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_lut->getImageView(), VK_IMAGE_LAYOUT_GENERAL);
+
+    // 0: tonemapped image, 1: output
+    const std::vector<VkDescriptorSetLayoutBinding> fxaa_bindings = {
+        {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+    };
+    m_fxaa_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_fxaa_pass->create("shaders/fxaa.comp.spv", fxaa_bindings, sizeof(glm::uvec2), 1); result.IsError())
+    {
+        LogE("Error creating the FXAA pass");
+        return result;
+    }
+    m_fxaa_pass->writeImage(0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_tonemapper->getOutput()->getImageView(), VK_IMAGE_LAYOUT_GENERAL, m_sampler);
+    m_fxaa_pass->writeImage(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_output->getImageView(), VK_IMAGE_LAYOUT_GENERAL);
+
+    m_lut_dirty = true;
+    m_initialized = false;
+    return utils::VResult::Ok();
+}
+
+void app::graphics::PostProcessing::setSettings(const Settings& settings)
+{
+    if (settings.m_color_filter != m_settings.m_color_filter ||
+        settings.m_saturation != m_settings.m_saturation ||
+        settings.m_contrast != m_settings.m_contrast)
+        m_lut_dirty = true;
+    m_settings = settings;
+}
+
+const app::graphics::PostProcessing::Settings& app::graphics::PostProcessing::getSettings() const noexcept
+{
+    return m_settings;
+}
+
+void app::graphics::PostProcessing::record(VkCommandBuffer command_buffer, const uint32_t input_index, const VkExtent2D& extent)
+{
+    const auto gpu_timer = app::Engine::getInstance()->m_render->getGpuTimer();
+
+    if (!m_initialized)
+    {
+        // The levels of the bloom and the LUT stay in the GENERAL layout: those are bound
+        // to the tonemap pass even when their stage is disabled
+        for (const auto& level : m_bloom_levels)
+        {
+            transitionImage(
+                command_buffer,
+                level->getImage(),
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                0,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        }
+        transitionImage(
+            command_buffer,
+            m_lut->getImage(),
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            0,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        m_initialized = true;
+    }
+    // Only when its parameters change
+    if (m_lut_dirty)
+        recordColorGrading(command_buffer);
+
+    const uint32_t exposure_scope = gpu_timer->begin(command_buffer, "exposure");
+    m_tonemapper->recordExposure(command_buffer, input_index, extent);
+    gpu_timer->end(command_buffer, exposure_scope);
+
+    if (m_settings.m_bloom)
+    {
+        const uint32_t bloom_scope = gpu_timer->begin(command_buffer, "bloom");
+        recordBloom(command_buffer, input_index, extent);
+        gpu_timer->end(command_buffer, bloom_scope);
+    }
+
+    const uint32_t tonemap_scope = gpu_timer->begin(command_buffer, "tonemap");
+    m_tonemapper->recordTonemap(
+        command_buffer,
+        input_index,
+        extent,
+        m_settings.m_bloom ? m_settings.m_bloom_intensity : 0.0f,
+        m_settings.m_sharpness,
+        m_settings.m_color_grading);
+    gpu_timer->end(command_buffer, tonemap_scope);
+
+    m_last_output = m_tonemapper->getOutput();
+    if (m_settings.m_fxaa)
+    {
+        // The output has been copied to the swapchain image during the previous frame:
+        // its content can be discarded
+        transitionImage(
+            command_buffer,
+            m_output->getImage(),
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT);
+        computeBarrier(command_buffer);
+
+        const uint32_t fxaa_scope = gpu_timer->begin(command_buffer, "fxaa");
+        const glm::uvec2 push_constants(extent.width, extent.height);
+        m_fxaa_pass->dispatch(
+            command_buffer,
+            0,
+            &push_constants,
+            app::graphics::ComputePass::getGroupCount(extent.width, GROUP_SIZE),
+            app::graphics::ComputePass::getGroupCount(extent.height, GROUP_SIZE));
+        gpu_timer->end(command_buffer, fxaa_scope);
+        m_last_output = m_output;
+    }
+
+    transitionImage(
+        command_buffer,
+        m_last_output->getImage(),
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT);
+}
+
+void app::graphics::PostProcessing::recordColorGrading(VkCommandBuffer command_buffer)
+{
+    const LutPushConstants push_constants{
+        .m_color_filter = glm::vec4(m_settings.m_color_filter, 1.0f),
+        .m_saturation = m_settings.m_saturation,
+        .m_contrast = m_settings.m_contrast,
+    };
+    const uint32_t lut_size = m_lut->getDepth();
+    const uint32_t group_count = app::graphics::ComputePass::getGroupCount(lut_size, LUT_GROUP_SIZE);
+    m_lut_pass->dispatch(command_buffer, 0, &push_constants, group_count, group_count, group_count);
+    computeBarrier(command_buffer);
+    m_lut_dirty = false;
+}
+
+void app::graphics::PostProcessing::recordBloom(VkCommandBuffer command_buffer, const uint32_t input_index, const VkExtent2D& extent)
+{
+    const auto set_result = m_downsample_pass->allocateFrameSet();
+    if (set_result.IsError())
+    {
+        LogE("> Cannot allocate the descriptor set of the bloom");
+        return;
+    }
+    const uint32_t input_set_index = set_result.GetValue();
+    m_downsample_pass->writeImage(input_set_index, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_input_views[input_index], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_sampler);
+    m_downsample_pass->writeImage(input_set_index, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_bloom_levels[0]->getImageView(), VK_IMAGE_LAYOUT_GENERAL);
+    m_downsample_pass->writeBuffer(input_set_index, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_tonemapper->getExposureBuffer());
+
+    const uint32_t level_count = static_cast<uint32_t>(m_bloom_levels.size());
+    // The written part of each level, at the resolution of this frame
+    std::vector<VkExtent2D> level_extents(level_count);
+    level_extents[0] = halfExtent(extent);
+    for (uint32_t level = 1; level < level_count; ++level)
+        level_extents[level] = halfExtent(level_extents[level - 1]);
+
+    BloomPushConstants push_constants{
+        .m_source_extent = glm::uvec2(extent.width, extent.height),
+        .m_destination_extent = glm::uvec2(level_extents[0].width, level_extents[0].height),
+        .m_threshold = m_settings.m_bloom_threshold,
+        .m_knee = m_settings.m_bloom_knee,
+        .m_prefilter = 1,
+    };
+    // Thresholded downsample of the scene, then of each level
+    for (uint32_t level = 0; level < level_count; ++level)
+    {
+        if (level > 0)
+        {
+            push_constants.m_source_extent = glm::uvec2(level_extents[level - 1].width, level_extents[level - 1].height);
+            push_constants.m_destination_extent = glm::uvec2(level_extents[level].width, level_extents[level].height);
+            push_constants.m_prefilter = 0;
+        }
+        m_downsample_pass->dispatch(
+            command_buffer,
+            level == 0 ? input_set_index : level - 1,
+            &push_constants,
+            app::graphics::ComputePass::getGroupCount(level_extents[level].width, GROUP_SIZE),
+            app::graphics::ComputePass::getGroupCount(level_extents[level].height, GROUP_SIZE));
+        computeBarrier(command_buffer);
+    }
+    // Each level accumulates the lower ones, up to the first level
+    for (uint32_t level = level_count - 1; level > 0; --level)
+    {
+        push_constants.m_source_extent = glm::uvec2(level_extents[level].width, level_extents[level].height);
+        push_constants.m_destination_extent = glm::uvec2(level_extents[level - 1].width, level_extents[level - 1].height);
+        m_upsample_pass->dispatch(
+            command_buffer,
+            level - 1,
+            &push_constants,
+            app::graphics::ComputePass::getGroupCount(level_extents[level - 1].width, GROUP_SIZE),
+            app::graphics::ComputePass::getGroupCount(level_extents[level - 1].height, GROUP_SIZE));
+        computeBarrier(command_buffer);
+    }
+}
+
+std::shared_ptr<app::graphics::Attachment> app::graphics::PostProcessing::getOutput() const
+{
+    return m_last_output;
+}
+
+std::shared_ptr<app::graphics::Tonemapper> app::graphics::PostProcessing::getTonemapper() const
+{
+    return m_tonemapper;
+}
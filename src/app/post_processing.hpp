@@ -0,0 +1,164 @@
+//
+//  post_processing.hpp
+//
+
+#pragma once
+#ifndef post_processing_h
+#define post_processing_h
+
+#include "../utils/result.h"
+#include "attachment.hpp"
+#include "compute.hpp"
+#include "tonemap.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief The post-processing chain of the scene, only made of compute passes,
+        /// from the HDR scene to the image copied to the swapchain:
+        /// 1. exposure: luminance histogram and eye adaptation (see `Tonemapper`);
+        /// 2. bloom: a pyramid of downsamples starting at half resolution, then of
+        ///    upsamples accumulating the levels back into the half resolution level;
+        /// 3. tonemap: bloom composite, exposure, tonemapping, color grading (3D LUT)
+        ///    and sharpening, fused in a single pass;
+        /// 4. FXAA, on the tonemapped image.
+        /// Each stage is measured by the GPU timer of the renderer.
+        class PostProcessing
+        {
+        public:
+            /// @brief Format of the bloom pyramid, the color grading LUT and the output
+            static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+            /// @brief The stages of the chain, and their parameters
+            struct Settings
+            {
+                /// @brief Enables the bloom
+                bool m_bloom = true;
+                /// @brief The weight of the bloom added to the scene
+                float m_bloom_intensity = 0.04f;
+                /// @brief The exposed luminance above which the pixels bloom
+                float m_bloom_threshold = 1.0f;
+                /// @brief The width of the soft transition around the threshold
+                float m_bloom_knee = 0.5f;
+                /// @brief Enables the FXAA
+                bool m_fxaa = true;
+                /// @brief The strength of the sharpening, 0 to disable it
+                float m_sharpness = 0.0f;
+                /// @brief Enables the color grading
+                bool m_color_grading = false;
+                /// @brief Multiplies the colors (white balance, tint)
+                glm::vec3 m_color_filter = glm::vec3(1.0f);
+                /// @brief The saturation of the colors (1 keeps them as is)
+                float m_saturation = 1.0f;
+                /// @brief The contrast around middle grey (1 keeps it as is)
+                float m_contrast = 1.0f;
+            };
+
+            /// @brief Public constructor
+            PostProcessing();
+            /// @brief Public destructor
+            ~PostProcessing();
+            /// @brief Creates the tonemapper, the bloom pyramid, the color grading LUT,
+            /// the output and the compute passes
+            /// @param output_extent The extent of the output (the extent of the input images)
+            /// @param input_views The HDR images to process, in SHADER_READ_ONLY_OPTIMAL layout
+            /// @param bloom_levels The maximum number of levels of the bloom pyramid
+            /// @param lut_size The width, height and depth of the color grading LUT
+            /// @param settings The initial settings of the chain
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(
+                const VkExtent2D& output_extent,
+                const std::vector<VkImageView>& input_views,
+                const uint32_t bloom_levels,
+                const uint32_t lut_size,
+                const Settings& settings);
+            /// @brief Changes the settings of the chain. The color grading LUT is generated
+            /// again at the next `record` if its parameters changed.
+            void setSettings(const Settings& settings);
+            /// @brief Returns the settings of the chain
+            const Settings& getSettings() const noexcept;
+            /// @brief Records the whole chain on an input.
+            /// The output is left in the TRANSFER_SRC_OPTIMAL layout, to be copied
+            /// to the swapchain image.
+            /// @param command_buffer The command buffer being recorded
+            /// @param input_index The input image to process
+            /// @param extent The extent of the part of the input to read (top-left), which
+            /// is also the part of the output written
+            void record(VkCommandBuffer command_buffer, const uint32_t input_index, const VkExtent2D& extent);
+            /// @brief Returns the output of the last recorded chain
+            std::shared_ptr<app::graphics::Attachment> getOutput() const;
+            /// @brief Returns the tonemapper of the chain
+            std::shared_ptr<app::graphics::Tonemapper> getTonemapper() const;
+
+        private:
+            /// @brief The push constants of the bloom compute shaders
+            struct BloomPushConstants
+            {
+                /// @brief The written part of the source, in pixels
+                glm::uvec2 m_source_extent;
+                /// @brief The part of the destination to write, in pixels
+                glm::uvec2 m_destination_extent;
+                /// @brief The exposed luminance above which the pixels bloom
+                float m_threshold;
+                /// @brief The width of the soft transition around the threshold
+                float m_knee;
+                /// @brief Thresholds the source if not 0 (first downsample)
+                uint32_t m_prefilter;
+            };
+            /// @brief The push constants of the color grading LUT compute shader
+            struct LutPushConstants
+            {
+                /// @brief Multiplies the colors (w unused)
+                glm::vec4 m_color_filter;
+                /// @brief The saturation of the colors
+                float m_saturation;
+                /// @brief The contrast around middle grey
+                float m_contrast;
+            };
+            /// @brief PostProcessing should not be cloneable
+            PostProcessing(PostProcessing& other) = delete;
+            /// @brief PostProcessing should not be assignable
+            void operator=(const PostProcessing& other) = delete;
+            /// @brief Records the generation of the color grading LUT
+            void recordColorGrading(VkCommandBuffer command_buffer);
+            /// @brief Records the downsamples and the upsamples of the bloom pyramid
+            void recordBloom(VkCommandBuffer command_buffer, const uint32_t input_index, const VkExtent2D& extent);
+            /// @brief Exposure, tonemapping, color grading and sharpening
+            std::shared_ptr<app::graphics::Tonemapper> m_tonemapper = nullptr;
+            /// @brief The bloom pyramid: the first level is at half the output extent
+            std::vector<std::shared_ptr<app::graphics::Attachment>> m_bloom_levels;
+            /// @brief The color grading LUT (3D)
+            std::shared_ptr<app::graphics::Attachment> m_lut = nullptr;
+            /// @brief The output of the FXAA
+            std::shared_ptr<app::graphics::Attachment> m_output = nullptr;
+            /// @brief The output of the last recorded chain
+            std::shared_ptr<app::graphics::Attachment> m_last_output = nullptr;
+            /// @brief Downsamples: a descriptor set per frame (first level, from the input),
+            /// then one per level
+            std::shared_ptr<app::graphics::ComputePass> m_downsample_pass = nullptr;
+            /// @brief Upsamples: one descriptor set per level but the last one
+            std::shared_ptr<app::graphics::ComputePass> m_upsample_pass = nullptr;
+            /// @brief Generates the color grading LUT
+            std::shared_ptr<app::graphics::ComputePass> m_lut_pass = nullptr;
+            /// @brief FXAA, from the output of the tonemapper
+            std::shared_ptr<app::graphics::ComputePass> m_fxaa_pass = nullptr;
+            /// @brief The bilinear sampler of the passes
+            VkSampler m_sampler = VK_NULL_HANDLE;
+            /// @brief The HDR images to process (read by the first downsample)
+            std::vector<VkImageView> m_input_views;
+            /// @brief The settings of the chain
+            Settings m_settings{};
+            /// @brief If the color grading LUT has to be generated again
+            bool m_lut_dirty = true;
+            /// @brief If the bloom pyramid and the LUT have been transitioned from UNDEFINED
+            bool m_initialized = false;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // post_processing_h
@@ -5,11 +5,13 @@
 //
 
 #include "engine.hpp"
+#include "depth.hpp"
 #include "render.hpp"
 #include "../application.hpp"
 #include "../utils/debug_tools.h"
 #include "../utils/result.h"
 #include "../project.hpp"
+#include <cstddef>
 #include <vector>
 
 // #define GLFW_INCLUDE_VULKAN
@@ -17,15 +19,46 @@
 
 app::graphics::Render* app::graphics::Render::m_instance{nullptr};
 
+/// @brief The SPIR-V shaders of the scene pipeline, and of its variants
+static constexpr const char* SCENE_VERTEX_SHADER = "shaders/basic_triangle.vert.spv";
+static constexpr const char* SCENE_FRAGMENT_SHADER = Project::DEFERRED_SHADING ? "shaders/gbuffer.frag.spv" : "shaders/basic_triangle.frag.spv";
+
 app::graphics::Render::Render()
 {
     m_graphics_pipeline = std::shared_ptr<app::graphics::Pipeline>(new app::graphics::Pipeline());
     m_graphics_command = std::shared_ptr<app::graphics::Command>(new app::graphics::Command());
     m_transfert_command = std::shared_ptr<app::graphics::Command>(new app::graphics::Command());
+    m_gpu_timer = std::shared_ptr<app::graphics::GpuTimer>(new app::graphics::GpuTimer());
+    m_camera = std::shared_ptr<app::graphics::Camera>(new app::graphics::Camera());
+    m_descriptor_buffer = std::shared_ptr<app::graphics::DescriptorBuffer>(new app::graphics::DescriptorBuffer());
+    m_pipeline_library = std::shared_ptr<app::graphics::PipelineLibrary>(new app::graphics::PipelineLibrary());
+    m_shadow_atlas = std::shared_ptr<app::graphics::ShadowAtlas>(new app::graphics::ShadowAtlas());
+    m_cascaded_shadows = std::shared_ptr<app::graphics::CascadedShadowMaps>(new app::graphics::CascadedShadowMaps());
+    m_clustered_lighting = std::shared_ptr<app::graphics::ClusteredLighting>(new app::graphics::ClusteredLighting());
+    m_skinning = std::shared_ptr<app::graphics::GpuSkinning>(new app::graphics::GpuSkinning());
+    m_animation = std::shared_ptr<app::graphics::AnimationSystem>(new app::graphics::AnimationSystem());
+    m_levels_of_detail = std::shared_ptr<app::graphics::LevelsOfDetail>(new app::graphics::LevelsOfDetail());
+    m_occlusion_queries = std::shared_ptr<app::graphics::OcclusionQueries>(new app::graphics::OcclusionQueries());
+    m_meshlet_culling = std::shared_ptr<app::graphics::MeshletCulling>(new app::graphics::MeshletCulling());
+    m_vertex_pulling = std::shared_ptr<app::graphics::VertexPulling>(new app::graphics::VertexPulling());
+    m_sprite_batcher = std::shared_ptr<app::graphics::SpriteBatcher>(new app::graphics::SpriteBatcher());
+#ifdef DEBUG
+    m_debug_draw = std::shared_ptr<app::graphics::DebugDraw>(new app::graphics::DebugDraw());
+#endif
+    m_dynamic_resolution = std::shared_ptr<app::graphics::DynamicResolution>(new app::graphics::DynamicResolution(
+        Project::DYNAMIC_RESOLUTION ? Project::DYNAMIC_RESOLUTION_MIN_SCALE : 1.0f,
+        Project::DYNAMIC_RESOLUTION ? Project::DYNAMIC_RESOLUTION_MAX_SCALE : 1.0f,
+        Project::GPU_FRAME_BUDGET_MS));
 }
 
 app::graphics::Render::~Render()
 {
+    // Uses the layout and the render pass of the graphics pipeline
+    if (nullptr != m_pipeline_library)
+    {
+        Log("< Destroying the pipeline library...");
+        m_pipeline_library = nullptr;
+    }
     if (m_graphics_pipeline != nullptr)
     {
         Log("< Destroying the graphics pipeline...");
@@ -40,8 +73,8 @@ app::graphics::Render::~Render()
     if (m_image_views.size() > 0)
     {
         Log("< Destroying the image views...");
-        for (auto image_view : m_image_views)
-            vkDestroyImageView(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), image_view, nullptr);
+        for (const auto image_view : m_image_views)
+            app::Engine::getInstance()->m_resources->destroy(image_view);
         m_image_views.clear();
     }
     if (m_framebuffers.size() > 0)
@@ -51,6 +84,119 @@ app::graphics::Render::~Render()
             vkDestroyFramebuffer(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), framebuffer, nullptr);
         m_framebuffers.clear();
     }
+    if (m_ui_framebuffers.size() > 0)
+    {
+        Log("< Destroying the UI framebuffers...");
+        for (auto framebuffer : m_ui_framebuffers)
+            vkDestroyFramebuffer(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), framebuffer, nullptr);
+        m_ui_framebuffers.clear();
+    }
+    if (m_scene_attachments.size() > 0)
+    {
+        Log("< Destroying the scene attachments...");
+        m_scene_attachments.clear();
+    }
+    if (nullptr != m_post_processing)
+    {
+        Log("< Destroying the post-processing chain...");
+        m_post_processing = nullptr;
+    }
+    if (nullptr != m_temporal_upscaler)
+    {
+        Log("< Destroying the temporal upscaler...");
+        m_temporal_upscaler = nullptr;
+    }
+    if (m_motion_attachments.size() > 0)
+    {
+        Log("< Destroying the motion vector attachments...");
+        m_motion_attachments.clear();
+    }
+    if (m_motion_msaa_attachments.size() > 0)
+    {
+        Log("< Destroying the multisampled motion vector attachments...");
+        m_motion_msaa_attachments.clear();
+    }
+    if (nullptr != m_debug_draw)
+    {
+        Log("< Destroying the debug draw...");
+        m_debug_draw = nullptr;
+    }
+    if (nullptr != m_sprite_batcher)
+    {
+        Log("< Destroying the sprite batcher...");
+        m_sprite_batcher = nullptr;
+    }
+    if (nullptr != m_vertex_pulling)
+    {
+        Log("< Destroying the vertex pulling...");
+        m_vertex_pulling = nullptr;
+    }
+    if (nullptr != m_meshlet_culling)
+    {
+        Log("< Destroying the meshlet culling...");
+        m_meshlet_culling = nullptr;
+    }
+    if (nullptr != m_occlusion_queries)
+    {
+        Log("< Destroying the occlusion queries...");
+        m_occlusion_queries = nullptr;
+    }
+    if (nullptr != m_levels_of_detail)
+    {
+        Log("< Destroying the levels of detail...");
+        m_levels_of_detail = nullptr;
+    }
+    if (nullptr != m_animation)
+    {
+        Log("< Destroying the animation system...");
+        m_animation = nullptr;
+    }
+    if (nullptr != m_skinning)
+    {
+        Log("< Destroying the GPU skinning...");
+        m_skinning = nullptr;
+    }
+    if (nullptr != m_clustered_lighting)
+    {
+        Log("< Destroying the clustered lighting...");
+        m_clustered_lighting = nullptr;
+    }
+    if (nullptr != m_shadow_atlas)
+    {
+        Log("< Destroying the shadow atlas...");
+        m_shadow_atlas = nullptr;
+    }
+    if (nullptr != m_cascaded_shadows)
+    {
+        Log("< Destroying the cascaded shadow maps...");
+        m_cascaded_shadows = nullptr;
+    }
+    if (nullptr != m_descriptor_buffer)
+    {
+        Log("< Destroying the descriptor buffer...");
+        m_descriptor_buffer = nullptr;
+    }
+    if (nullptr != m_gpu_timer)
+    {
+        Log("< Destroying the GPU timer...");
+        m_gpu_timer = nullptr;
+    }
+    if (m_albedo_attachments.size() > 0 || m_normal_attachments.size() > 0)
+    {
+        Log("< Destroying the G-buffer attachments...");
+        m_albedo_attachments.clear();
+        m_normal_attachments.clear();
+    }
+    if (m_depth_attachments.size() > 0)
+    {
+        Log("< Destroying the depth attachments...");
+        m_depth_attachments.clear();
+    }
+    if (m_color_attachments.size() > 0)
+    {
+        Log("< Destroying the multisampled color attachments...");
+        m_color_attachments.clear();
+    }
     if (nullptr != m_graphics_command)
     {
         Log("< Destroying the Command object...");
@@ -61,6 +207,11 @@ app::graphics::Render::~Render()
         Log("< Destroying the Transfert object...");
         m_transfert_command = nullptr;
     }
+    if (m_submit_batchers.size() > 0)
+    {
+        Log("< Destroying the submit batchers...");
+        m_submit_batchers.clear();
+    }
     m_instance = nullptr;
 }
 
@@ -78,6 +229,11 @@ std::vector<VkFramebuffer> app::graphics::Render::getFramebuffers()
     return m_framebuffers;
 }
 
+std::vector<VkFramebuffer> app::graphics::Render::getUIFramebuffers()
+{
+    return m_ui_framebuffers;
+}
+
 utils::VResult app::graphics::Render::createSurface()
 {
     const auto window_surface_result = glfwCreateWindowSurface(
@@ -99,21 +255,52 @@ VkSurfaceKHR* app::graphics::Render::getSurface()
 
 utils::VResult app::graphics::Render::createFramebuffers()
 {
+    const VkExtent2D& swapchain_extent = app::Engine::getInstance()->m_swapchain->getExtent();
     Log("> There are %d framebuffers to create: ", m_image_views.size());
     m_framebuffers.resize(m_image_views.size());
+    m_ui_framebuffers.resize(m_image_views.size());
     for (int i = 0; i < m_image_views.size(); ++i)
     {
-        const auto image_view = m_image_views[i];
-        VkImageView pAttachments[] = {
-            image_view,
-        };
+        const auto image_view = app::Engine::getInstance()->m_resources->getImage(m_image_views[i]).m_image_view;
+        const auto scene_image_view = m_scene_attachments[i]->getImageView();
+        // Same order as the render pass attachments: color, depth, then the
+        // scene target as resolve attachment if multisampling is enabled, then
+        // the motion vectors (multisampled, and resolved) for the temporal upscaler,
+        // then the G-buffer of the deferred shading
+        std::vector<VkImageView> attachments;
+        if (m_color_attachments.empty())
+        {
+            attachments = {scene_image_view, m_depth_attachments[i]->getImageView()};
+            if (!m_motion_attachments.empty())
+                attachments.push_back(m_motion_attachments[i]->getImageView());
+        }
+        else
+        {
+            attachments = {m_color_attachments[i]->getImageView(), m_depth_attachments[i]->getImageView(), scene_image_view};
+            if (!m_motion_attachments.empty())
+            {
+                attachments.push_back(m_motion_msaa_attachments[i]->getImageView());
+                attachments.push_back(m_motion_attachments[i]->getImageView());
+            }
+        }
+        if (!m_albedo_attachments.empty())
+        {
+            attachments.push_back(m_albedo_attachments[i]->getImageView());
+            attachments.push_back(m_normal_attachments[i]->getImageView());
+            // The lighting subpass reads the G-buffer of this framebuffer
+            m_graphics_pipeline->writeGBufferInputs(
+                i,
+                m_albedo_attachments[i]->getImageView(),
+                m_normal_attachments[i]->getImageView(),
+                m_depth_attachments[i]->getImageView());
+        }
         VkFramebufferCreateInfo framebuffer_info{};
         framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebuffer_info.renderPass = m_graphics_pipeline->getRenderPass();
-        framebuffer_info.attachmentCount = 1;
-        framebuffer_info.pAttachments = pAttachments;
-        framebuffer_info.height = app::Engine::getInstance()->m_swapchain->getExtent().height;
-        framebuffer_info.width = app::Engine::getInstance()->m_swapchain->getExtent().width;
+        framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebuffer_info.pAttachments = attachments.data();
+        framebuffer_info.height = swapchain_extent.height;
+        framebuffer_info.width = swapchain_extent.width;
         framebuffer_info.layers = 1;
 
         auto create_framebuffer_result_code = vkCreateFramebuffer(
@@ -122,17 +309,359 @@ utils::VResult app::graphics::Render::createFramebuffers()
             nullptr,
             &(m_framebuffers[i]));
 
+        if (create_framebuffer_result_code != VK_SUCCESS)
+        {
+            LogE("\t> Cannot create the framebuffer attached to the image at index %d", i);
+            return utils::VResult::Error((char*)"> failed to create the framebuffers");
+        }
+
+        // The UI is drawn directly in the swapchain image, at the native resolution
+        VkFramebufferCreateInfo ui_framebuffer_info{};
+        ui_framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        ui_framebuffer_info.renderPass = m_graphics_pipeline->getUIRenderPass();
+        ui_framebuffer_info.attachmentCount = 1;
+        ui_framebuffer_info.pAttachments = &image_view;
+        ui_framebuffer_info.height = swapchain_extent.height;
+        ui_framebuffer_info.width = swapchain_extent.width;
+        ui_framebuffer_info.layers = 1;
+
+        create_framebuffer_result_code = vkCreateFramebuffer(
+            app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+            &ui_framebuffer_info,
+            nullptr,
+            &(m_ui_framebuffers[i]));
+
         if (create_framebuffer_result_code == VK_SUCCESS)
         {
-            Log("\t> Framebuffer at index %d has been successfully created...", i);
+            Log("\t> Framebuffers at index %d have been successfully created...", i);
+            continue;
+        }
+        LogE("\t> Cannot create the UI framebuffer attached to the image at index %d", i);
+        return utils::VResult::Error((char*)"> failed to create the UI framebuffers");
+    }
+    return utils::VResult::Ok();
+}
+
+utils::VResult app::graphics::Render::createSceneResources()
+{
+    const auto scene_format_result = app::Engine::getInstance()->m_graphics_device.findHdrFormat();
+    if (scene_format_result.IsError())
+        return utils::VResult::Error((char*)"cannot create the scene resources without HDR format");
+    m_scene_format = scene_format_result.GetValue();
+
+    const size_t nb_scene_attachments = m_image_views.size();
+    Log("> %d scene attachments to create (for the render object)", nb_scene_attachments);
+    m_scene_attachments.clear();
+    m_motion_attachments.clear();
+    for (size_t i = 0; i < nb_scene_attachments; i++)
+    {
+        auto scene_attachment = std::make_shared<app::graphics::Attachment>();
+        // Rendered by the scene render pass in linear HDR, then sampled by the temporal
+        // upscaler or directly by the post-processing chain
+        if (const auto result = scene_attachment->create(
+                app::Engine::getInstance()->m_swapchain->getExtent(),
+                getSceneFormat(),
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT);
+            result.IsError())
+        {
+            LogE("Error creating the scene attachment %d", i);
+            return result;
+        }
+        m_scene_attachments.push_back(scene_attachment);
+
+        if (!Project::TEMPORAL_UPSCALING)
             continue;
+        auto motion_attachment = std::make_shared<app::graphics::Attachment>();
+        // Written by the scene render pass, then sampled by the temporal upscaler
+        if (const auto result = motion_attachment->create(
+                app::Engine::getInstance()->m_swapchain->getExtent(),
+                getMotionFormat(),
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT);
+            result.IsError())
+        {
+            LogE("Error creating the motion vector attachment %d", i);
+            return result;
         }
-        LogE("\t> Cannot create the framebuffer attached to the image at index %d", i);
-        return utils::VResult::Error((char*)"> failed to create the framebuffers");
+        m_motion_attachments.push_back(motion_attachment);
     }
     return utils::VResult::Ok();
 }
 
+VkFormat app::graphics::Render::getMotionFormat() const noexcept
+{
+    return VK_FORMAT_R16G16_SFLOAT;
+}
+
+utils::VResult app::graphics::Render::createTemporalUpscaler()
+{
+    if (!Project::TEMPORAL_UPSCALING)
+        return utils::VResult::Ok();
+    std::vector<VkImageView> color_views;
+    std::vector<VkImageView> motion_views;
+    for (size_t i = 0; i < m_scene_attachments.size(); ++i)
+    {
+        color_views.push_back(m_scene_attachments[i]->getImageView());
+        motion_views.push_back(m_motion_attachments[i]->getImageView());
+    }
+    m_temporal_upscaler = std::make_shared<app::graphics::TemporalUpscaler>();
+    return m_temporal_upscaler->create(app::Engine::getInstance()->m_swapchain->getExtent(), color_views, motion_views);
+}
+
+std::shared_ptr<app::graphics::TemporalUpscaler> app::graphics::Render::getTemporalUpscaler() const
+{
+    return m_temporal_upscaler;
+}
+
+utils::VResult app::graphics::Render::createPostProcessing()
+{
+    // The chain reads the output of the temporal upscaler (its two history
+    // images) if enabled, else the scene targets
+    std::vector<VkImageView> input_views;
+    if (nullptr != m_temporal_upscaler)
+    {
+        for (uint32_t i = 0; i < 2; ++i)
+            input_views.push_back(m_temporal_upscaler->getHistory(i)->getImageView());
+    }
+    else
+    {
+        for (const auto& scene_attachment : m_scene_attachments)
+            input_views.push_back(scene_attachment->getImageView());
+    }
+    const app::graphics::PostProcessing::Settings settings{
+        .m_bloom = Project::POST_BLOOM,
+        .m_bloom_intensity = Project::POST_BLOOM_INTENSITY,
+        .m_bloom_threshold = Project::POST_BLOOM_THRESHOLD,
+        .m_fxaa = Project::POST_FXAA,
+        .m_sharpness = Project::POST_SHARPNESS,
+        .m_color_grading = Project::POST_COLOR_GRADING,
+    };
+    m_post_processing = std::make_shared<app::graphics::PostProcessing>();
+    return m_post_processing->create(
+        app::Engine::getInstance()->m_swapchain->getExtent(),
+        input_views,
+        Project::POST_BLOOM_LEVELS,
+        Project::POST_COLOR_LUT_SIZE,
+        settings);
+}
+
+std::shared_ptr<app::graphics::PostProcessing> app::graphics::Render::getPostProcessing() const
+{
+    return m_post_processing;
+}
+
+std::shared_ptr<app::graphics::Attachment> app::graphics::Render::getSceneAttachment(const uint32_t index) const
+{
+    return index < m_scene_attachments.size() ? m_scene_attachments[index] : nullptr;
+}
+
+VkFormat app::graphics::Render::getSceneFormat() const noexcept
+{
+    return m_scene_format;
+}
+
+VkExtent2D app::graphics::Render::getRenderExtent() const noexcept
+{
+    return m_dynamic_resolution->getRenderExtent(app::Engine::getInstance()->m_swapchain->getExtent());
+}
+
+utils::VResult app::graphics::Render::createGpuTimer()
+{
+    // One scope for the whole frame, and some room for the passes
+    constexpr uint32_t MAX_GPU_TIMER_SCOPES = 16;
+    return m_gpu_timer->create(MAX_GPU_TIMER_SCOPES);
+}
+
+std::shared_ptr<app::graphics::GpuTimer> app::graphics::Render::getGpuTimer() const
+{
+    return m_gpu_timer;
+}
+
+utils::VResult app::graphics::Render::createShadowAtlas()
+{
+    return m_shadow_atlas->create(Project::SHADOW_ATLAS_SIZE, Project::SHADOW_TILE_SIZE, Project::SHADOW_UPDATES_PER_FRAME);
+}
+
+std::shared_ptr<app::graphics::ShadowAtlas> app::graphics::Render::getShadowAtlas() const
+{
+    return m_shadow_atlas;
+}
+
+utils::VResult app::graphics::Render::createCascadedShadows()
+{
+    m_cascaded_shadows->setSplitLambda(Project::SHADOW_CASCADE_SPLIT_LAMBDA);
+    m_cascaded_shadows->setShadowDistance(Project::SHADOW_DISTANCE);
+    return m_cascaded_shadows->create(Project::SHADOW_CASCADE_COUNT, Project::SHADOW_CASCADE_SIZE);
+}
+
+std::shared_ptr<app::graphics::CascadedShadowMaps> app::graphics::Render::getCascadedShadows() const
+{
+    return m_cascaded_shadows;
+}
+
+utils::VResult app::graphics::Render::createDescriptorBuffer()
+{
+    return m_descriptor_buffer->create(Project::DESCRIPTOR_BUFFER_PERSISTENT_SIZE, Project::DESCRIPTOR_BUFFER_FRAME_SIZE);
+}
+
+std::shared_ptr<app::graphics::DescriptorBuffer> app::graphics::Render::getDescriptorBuffer() const
+{
+    return m_descriptor_buffer;
+}
+
+utils::VResult app::graphics::Render::createClusteredLighting()
+{
+    return m_clustered_lighting->create(Project::MAX_LIGHTS, m_shadow_atlas, m_cascaded_shadows);
+}
+
+std::shared_ptr<app::graphics::ClusteredLighting> app::graphics::Render::getClusteredLighting() const
+{
+    return m_clustered_lighting;
+}
+
+utils::VResult app::graphics::Render::createSkinning()
+{
+    if (const auto result = m_skinning->create(
+            Project::SKINNING_MAX_MESH_VERTICES,
+            Project::SKINNING_MAX_SKINNED_VERTICES,
+            Project::SKINNING_MAX_JOINTS,
+            Project::SKINNING_MAX_INSTANCES);
+        result.IsError())
+        return result;
+
+    // The skinned instances cast shadows from the vertices skinned for the frame, already
+    // in world space: dynamic casters of the shadow atlas, never culled per cascade
+    m_shadow_atlas->setCasterRecorder([](VkCommandBuffer command_buffer, const glm::mat4&, const bool static_casters) {
+        if (static_casters)
+            return;
+        const auto shadow_atlas = app::Engine::getInstance()->m_render->getShadowAtlas();
+        const glm::mat4 model(1.0f);
+        vkCmdPushConstants(
+            command_buffer,
+            shadow_atlas->getPipelineLayout(),
+            VK_SHADER_STAGE_VERTEX_BIT,
+            offsetof(app::graphics::ShadowAtlas::PushConstants, m_model),
+            sizeof(model),
+            &model);
+        app::Engine::getInstance()->m_render->getSkinning()->draw(command_buffer);
+    });
+    m_cascaded_shadows->setCasterRecorder([](VkCommandBuffer command_buffer) {
+        const auto cascaded_shadows = app::Engine::getInstance()->m_render->getCascadedShadows();
+        const app::graphics::CascadedShadowMaps::PushConstants push_constants{
+            .m_model = glm::mat4(1.0f),
+            .m_bounds = glm::vec4(0.0f),
+        };
+        vkCmdPushConstants(
+            command_buffer,
+            cascaded_shadows->getPipelineLayout(),
+            VK_SHADER_STAGE_VERTEX_BIT,
+            0,
+            sizeof(push_constants),
+            &push_constants);
+        app::Engine::getInstance()->m_render->getSkinning()->draw(command_buffer);
+    });
+    return utils::VResult::Ok();
+}
+
+std::shared_ptr<app::graphics::GpuSkinning> app::graphics::Render::getSkinning() const
+{
+    return m_skinning;
+}
+
+utils::VResult app::graphics::Render::createAnimation()
+{
+    return m_animation->create(Project::ANIMATION_WORKER_THREADS);
+}
+
+std::shared_ptr<app::graphics::AnimationSystem> app::graphics::Render::getAnimation() const
+{
+    return m_animation;
+}
+
+utils::VResult app::graphics::Render::createLevelsOfDetail()
+{
+    if (const auto result = m_levels_of_detail->create(Project::LOD_MAX_MESHES, Project::LOD_MAX_MESHES * Project::LOD_MAX_LEVELS, Project::LOD_MAX_INSTANCES); result.IsError())
+        return result;
+    m_levels_of_detail->setErrorThreshold(Project::LOD_PIXEL_ERROR, Project::LOD_HYSTERESIS);
+    return utils::VResult::Ok();
+}
+
+std::shared_ptr<app::graphics::LevelsOfDetail> app::graphics::Render::getLevelsOfDetail() const
+{
+    return m_levels_of_detail;
+}
+
+utils::VResult app::graphics::Render::createOcclusionQueries()
+{
+    return m_occlusion_queries->create(Project::MAX_OCCLUSION_QUERIES);
+}
+
+std::shared_ptr<app::graphics::OcclusionQueries> app::graphics::Render::getOcclusionQueries() const
+{
+    return m_occlusion_queries;
+}
+
+utils::VResult app::graphics::Render::createMeshletCulling()
+{
+    return m_meshlet_culling->create(
+        Project::MESHLET_MAX_COUNT,
+        Project::MESHLET_MAX_VERTEX_COUNT,
+        Project::MESHLET_MAX_INSTANCES,
+        Project::MESHLET_MAX_CLUSTERS,
+        m_occlusion_queries);
+}
+
+std::shared_ptr<app::graphics::MeshletCulling> app::graphics::Render::getMeshletCulling() const
+{
+    return m_meshlet_culling;
+}
+
+utils::VResult app::graphics::Render::createVertexPulling()
+{
+    return m_vertex_pulling->create(
+        Project::VERTEX_PULLING_MAX_VERTEX_BYTES,
+        Project::VERTEX_PULLING_MAX_INDICES,
+        Project::VERTEX_PULLING_MAX_MESHES);
+}
+
+std::shared_ptr<app::graphics::VertexPulling> app::graphics::Render::getVertexPulling() const
+{
+    return m_vertex_pulling;
+}
+
+utils::VResult app::graphics::Render::createSpriteBatcher()
+{
+    return m_sprite_batcher->create(Project::SPRITE_MAX_COUNT, Project::SPRITE_TEXTURE_SIZE, Project::SPRITE_TEXTURE_LAYERS);
+}
+
+std::shared_ptr<app::graphics::SpriteBatcher> app::graphics::Render::getSpriteBatcher() const
+{
+    return m_sprite_batcher;
+}
+
+utils::VResult app::graphics::Render::createDebugDraw()
+{
+    if (nullptr == m_debug_draw)
+        return utils::VResult::Ok();
+    return m_debug_draw->create(Project::DEBUG_DRAW_MAX_LINES);
+}
+
+std::shared_ptr<app::graphics::DebugDraw> app::graphics::Render::getDebugDraw() const
+{
+    return m_debug_draw;
+}
+
+std::shared_ptr<app::graphics::Camera> app::graphics::Render::getCamera() const
+{
+    return m_camera;
+}
+
+std::shared_ptr<app::graphics::DynamicResolution> app::graphics::Render::getDynamicResolution() const
+{
+    return m_dynamic_resolution;
+}
+
 utils::VResult app::graphics::Render::createImageViews()
 {
     const auto swapchain_images = app::Engine::getInstance()->m_swapchain->getImages();
@@ -141,64 +670,187 @@ utils::VResult app::graphics::Render::createImageViews()
     Log("> %d image views to create (for the render object)", nb_swapchain_images);
     for (size_t i = 0; i < nb_swapchain_images; i++)
     {
-        // Create a VkImageView for each VkImage from the swapchain
-        VkImageViewCreateInfo image_view_create_info{
-
-            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-            .image = swapchain_images[i],
-            // How the image data should be interpreted
-            .viewType = VK_IMAGE_VIEW_TYPE_2D, // could be 1D / 2D / 3D texture, or cube maps
-            .format = app::Engine::getInstance()->m_swapchain->getImageFormat().format,
-            // Default mapping
-            .components = {
-                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .a = VK_COMPONENT_SWIZZLE_IDENTITY,
-            },
-            .subresourceRange = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1,
-            }};
-        const auto image_view_result = vkCreateImageView(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
-                                                         &image_view_create_info,
-                                                         nullptr,
-                                                         &m_image_views[i]);
-        if (image_view_result == VK_SUCCESS)
+        // Create a VkImageView for each VkImage from the swapchain, which keeps
+        // the ownership of the images
+        const auto image_view_result = app::Engine::getInstance()->m_resources->importImage(
+            swapchain_images[i],
+            app::Engine::getInstance()->m_swapchain->getImageFormat().format,
+            app::Engine::getInstance()->m_swapchain->getExtent(),
+            VK_IMAGE_ASPECT_COLOR_BIT);
+        if (image_view_result.IsError())
         {
-            Log("\t* image view %d... ok!", i);
+            LogE("Error creating the image view %d", i);
+            return utils::VResult::Error((char*)"Cannot create the image views of the swapchain");
+        }
+        m_image_views[i] = image_view_result.GetValue();
+        Log("\t* image view %d... ok!", i);
+    }
+    return utils::VResult::Ok();
+}
+
+utils::VResult app::graphics::Render::createColorResources()
+{
+    // The deferred shading lights each pixel once, from a single-sampled G-buffer
+    m_sample_count = Project::DEFERRED_SHADING ? VK_SAMPLE_COUNT_1_BIT : app::Engine::getInstance()->m_graphics_device.getUsableSampleCount();
+    m_color_attachments.clear();
+    m_motion_msaa_attachments.clear();
+    if (VK_SAMPLE_COUNT_1_BIT == m_sample_count)
+    {
+        Log("> No multisampled color attachment to create");
+        return utils::VResult::Ok();
+    }
+
+    const size_t nb_color_attachments = m_image_views.size();
+    Log("> %d multisampled color attachments to create (for the render object)", nb_color_attachments);
+    for (size_t i = 0; i < nb_color_attachments; i++)
+    {
+        auto color_attachment = std::make_shared<app::graphics::Attachment>();
+        // The samples are resolved into the scene target at the end of the subpass,
+        // and never stored: those can live in lazily allocated memory
+        if (const auto result = color_attachment->create(
+                app::Engine::getInstance()->m_swapchain->getExtent(),
+                getSceneFormat(),
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT,
+                m_sample_count);
+            result.IsError())
+        {
+            LogE("Error creating the multisampled color attachment %d", i);
+            return result;
+        }
+        m_color_attachments.push_back(color_attachment);
+
+        if (!Project::TEMPORAL_UPSCALING)
             continue;
+        // Same for the motion vectors, resolved into the motion vector target
+        auto motion_attachment = std::make_shared<app::graphics::Attachment>();
+        if (const auto result = motion_attachment->create(
+                app::Engine::getInstance()->m_swapchain->getExtent(),
+                getMotionFormat(),
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT,
+                m_sample_count);
+            result.IsError())
+        {
+            LogE("Error creating the multisampled motion vector attachment %d", i);
+            return result;
         }
+        m_motion_msaa_attachments.push_back(motion_attachment);
+    }
+    return utils::VResult::Ok();
+}
 
-        char* error_msg;
-        switch (image_view_result)
+VkSampleCountFlagBits app::graphics::Render::getSampleCount() const noexcept
+{
+    return m_sample_count;
+}
+
+utils::VResult app::graphics::Render::createDepthResources()
+{
+    const auto depth_format_result = app::Engine::getInstance()->m_graphics_device.findDepthFormat();
+    if (depth_format_result.IsError())
+        return utils::VResult::Error((char*)"cannot create the depth resources without depth format");
+    m_depth_format = depth_format_result.GetValue();
+
+    const size_t nb_depth_attachments = m_image_views.size();
+    Log("> %d depth attachments to create (for the render object)", nb_depth_attachments);
+    m_depth_attachments.clear();
+    // The deferred lighting subpass reads the depth to rebuild the position of the pixels
+    VkImageUsageFlags depth_usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    if (Project::DEFERRED_SHADING)
+        depth_usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    for (size_t i = 0; i < nb_depth_attachments; i++)
+    {
+        auto depth_attachment = std::make_shared<app::graphics::Attachment>();
+        // The depth is only used during the render pass: it never has to be stored
+        // nor read back, so let the driver keep it in tile memory when possible
+        if (const auto result = depth_attachment->create(
+                app::Engine::getInstance()->m_swapchain->getExtent(),
+                m_depth_format,
+                depth_usage,
+                app::graphics::Depth::getAspect(m_depth_format),
+                m_sample_count);
+            result.IsError())
         {
-            case VK_ERROR_OUT_OF_HOST_MEMORY:
-                error_msg = (char*)"out of host memory";
-                break;
-            case VK_ERROR_OUT_OF_DEVICE_MEMORY:
-                error_msg = (char*)"out of device memory";
-                break;
-            default:
-                LogE("> vkCreateImageView: unknown error 0x%08x", image_view_result);
-                error_msg = (char*)"undocumented error";
-                break;
+            LogE("Error creating the depth attachment %d", i);
+            return result;
+        }
+        m_depth_attachments.push_back(depth_attachment);
+    }
+    return utils::VResult::Ok();
+}
+
+VkFormat app::graphics::Render::getDepthFormat() const noexcept
+{
+    return m_depth_format;
+}
+
+utils::VResult app::graphics::Render::createGBufferResources()
+{
+    m_albedo_attachments.clear();
+    m_normal_attachments.clear();
+    if (!Project::DEFERRED_SHADING)
+    {
+        Log("> No G-buffer attachment to create");
+        return utils::VResult::Ok();
+    }
+
+    const size_t nb_gbuffer_attachments = m_image_views.size();
+    Log("> %d G-buffers to create (for the render object)", nb_gbuffer_attachments);
+    // Written by the G-buffer subpass and read by the lighting subpass of the same
+    // render pass, never stored: those can live in lazily allocated memory
+    const VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    for (size_t i = 0; i < nb_gbuffer_attachments; i++)
+    {
+        auto albedo_attachment = std::make_shared<app::graphics::Attachment>();
+        if (const auto result = albedo_attachment->create(
+                app::Engine::getInstance()->m_swapchain->getExtent(),
+                getAlbedoFormat(),
+                usage,
+                VK_IMAGE_ASPECT_COLOR_BIT,
+                m_sample_count);
+            result.IsError())
+        {
+            LogE("Error creating the albedo attachment %d", i);
+            return result;
+        }
+        m_albedo_attachments.push_back(albedo_attachment);
+
+        auto normal_attachment = std::make_shared<app::graphics::Attachment>();
+        if (const auto result = normal_attachment->create(
+                app::Engine::getInstance()->m_swapchain->getExtent(),
+                getNormalFormat(),
+                usage,
+                VK_IMAGE_ASPECT_COLOR_BIT,
+                m_sample_count);
+            result.IsError())
+        {
+            LogE("Error creating the normal attachment %d", i);
+            return result;
         }
-        LogE("Error creating the image view %d: %s", i, error_msg);
-        return utils::VResult::Error(error_msg);
+        m_normal_attachments.push_back(normal_attachment);
     }
     return utils::VResult::Ok();
 }
 
+VkFormat app::graphics::Render::getAlbedoFormat() const noexcept
+{
+    // Albedo, and coverage in the alpha channel (0 where nothing has been drawn)
+    return VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+VkFormat app::graphics::Render::getNormalFormat() const noexcept
+{
+    // View space normal, mapped to [0, 1]: 10 bits per axis in 32 bits per pixel
+    return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+}
+
 utils::VResult app::graphics::Render::createShaderModule()
 {
     // TODO: vector of ShaderModule type
     const utils::Result<std::vector<app::graphics::Shader::Module>> shaders_compile_result = m_graphics_pipeline->createGraphicsApplication(
-        "shaders/basic_triangle.vert.spv",
-        "shaders/basic_triangle.frag.spv");
+        SCENE_VERTEX_SHADER,
+        SCENE_FRAGMENT_SHADER);
     if (shaders_compile_result.IsError())
         return utils::VResult::Error((char*)"cannot compile the application shaders");
     const std::vector<app::graphics::Shader::Module> shaders_compiled = shaders_compile_result.GetValue();
@@ -312,6 +964,11 @@ utils::VResult app::graphics::Render::createGraphicsPipeline()
         LogE("< Error setuping the render pass");
         return result;
     }
+    if (const auto result = m_graphics_pipeline->setupUIRenderPass(); result.IsError())
+    {
+        LogE("< Error setuping the UI render pass");
+        return result;
+    }
     if (const auto result = m_graphics_pipeline->preconfigure(); result.IsError())
     {
         LogE("< Error pre-configuring the graphics pipeline");
@@ -329,9 +986,9 @@ utils::VResult app::graphics::Render::createGraphicsPipeline()
         LogE("< Error creating the pool of the Transfert command object");
         return result;
     }
-    if (const auto result = m_transfert_command->createBuffer(); result.IsError())
+    if (const auto result = m_transfert_command->createFramePools(); result.IsError())
     {
-        LogE("< Error creating the buffer of the Transfert command object");
+        LogE("< Error creating the frame pools of the Transfert command object");
         return result;
     }
     // Graphics Command Pool / Buffer
@@ -351,9 +1008,9 @@ utils::VResult app::graphics::Render::createGraphicsPipeline()
         LogE("< Error creating the index buffer object of the Graphics command object");
         return result;
     }
-    if (const auto result = m_graphics_command->createBuffer(); result.IsError())
+    if (const auto result = m_graphics_command->createFramePools(); result.IsError())
     {
-        LogE("< Error creating the buffer of the Graphics command object");
+        LogE("< Error creating the frame pools of the Graphics command object");
         return result;
     }
     return utils::VResult::Ok();
@@ -364,6 +1021,62 @@ std::shared_ptr<app::graphics::Pipeline> app::graphics::Render::getGraphicsPipel
     return m_graphics_pipeline;
 }
 
+utils::VResult app::graphics::Render::createPipelineLibrary()
+{
+    m_scene_variant = app::graphics::PipelineLibrary::Variant{
+        .m_vertex_shader = SCENE_VERTEX_SHADER,
+        .m_fragment_shader = SCENE_FRAGMENT_SHADER,
+    };
+    return m_pipeline_library->create(SCENE_VERTEX_SHADER, SCENE_FRAGMENT_SHADER);
+}
+
+std::shared_ptr<app::graphics::PipelineLibrary> app::graphics::Render::getPipelineLibrary() const
+{
+    return m_pipeline_library;
+}
+
+void app::graphics::Render::setSceneVariant(const app::graphics::PipelineLibrary::Variant& variant)
+{
+    m_scene_variant = variant;
+    // The cached draws of the main subpass bind the pipeline of the previous variant
+    m_graphics_command->invalidateStatic();
+}
+
+VkPipeline app::graphics::Render::getScenePipeline() const
+{
+    if (const auto result = m_pipeline_library->getPipeline(m_scene_variant); !result.IsError())
+        return result.GetValue();
+    // Not linked yet, or its parts failed to compile
+    return m_graphics_pipeline->getPipeline();
+}
+
+utils::VResult app::graphics::Render::createSubmitBatchers()
+{
+    auto& graphics_device = app::Engine::getInstance()->m_graphics_device;
+    // Two batchers on the same queue would submit to it concurrently
+    for (const VkQueue queue : {graphics_device.getGraphicsQueue(), graphics_device.getPresentsQueue(), graphics_device.getTransfertQueue()})
+    {
+        if (nullptr != getSubmitBatcher(queue))
+            continue;
+        auto submit_batcher = std::shared_ptr<app::graphics::SubmitBatcher>(new app::graphics::SubmitBatcher());
+        if (const auto result = submit_batcher->create(queue); result.IsError())
+            return result;
+        m_submit_batchers.push_back(submit_batcher);
+    }
+    Log("> %d submit batchers created", static_cast<uint32_t>(m_submit_batchers.size()));
+    return utils::VResult::Ok();
+}
+
+std::shared_ptr<app::graphics::SubmitBatcher> app::graphics::Render::getSubmitBatcher(const VkQueue queue) const
+{
+    for (const auto& submit_batcher : m_submit_batchers)
+    {
+        if (submit_batcher->getQueue() == queue)
+            return submit_batcher;
+    }
+    return nullptr;
+}
+
 std::shared_ptr<app::graphics::Command> app::graphics::Render::getGraphicsCommand() const
 {
     return m_graphics_command;
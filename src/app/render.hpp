@@ -9,8 +9,29 @@
 #define render_h
 
 #include "../utils/result.h"
+#include "animation.hpp"
+#include "attachment.hpp"
+#include "camera.hpp"
+#include "cascaded_shadows.hpp"
 #include "command.hpp"
+#include "debug_draw.hpp"
+#include "descriptor_buffer.hpp"
+#include "dynamic_resolution.hpp"
+#include "gpu_timer.hpp"
+#include "lighting.hpp"
+#include "lod.hpp"
+#include "meshlets.hpp"
+#include "occlusion.hpp"
 #include "pipeline.hpp"
+#include "pipeline_library.hpp"
+#include "post_processing.hpp"
+#include "resources.hpp"
+#include "shadow_atlas.hpp"
+#include "skinning.hpp"
+#include "sprites.hpp"
+#include "submit.hpp"
+#include "temporal.hpp"
+#include "vertex_pulling.hpp"
 #include "vulkan/vulkan.h"
 #include <vector>
 #ifdef WIN32
@@ -36,13 +57,174 @@ namespace app
             utils::VResult createSurface();
             /// @brief Returns the KHR surface as a pointer
             VkSurfaceKHR* getSurface();
-            /// @brief Returns the framebuffers
+            /// @brief Returns the framebuffers of the scene render pass
             std::vector<VkFramebuffer> getFramebuffers();
+            /// @brief Returns the framebuffers of the UI render pass
+            std::vector<VkFramebuffer> getUIFramebuffers();
             /// @brief Creates the image views for the Render, from the
             /// images from the SwapChain object.
             /// @return A VResult type to know if the function succeeded
             /// or not.
             utils::VResult createImageViews();
+            /// @brief Picks the number of samples per pixel and, if multisampling
+            /// is enabled, creates one multisampled color attachment per swapchain
+            /// image (resolved into the scene target at the end of the render pass).
+            /// Should be called before the creation of the render pass.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createColorResources();
+            /// @brief Creates the offscreen color targets of the scene (and the motion vector
+            /// targets, if the temporal upscaling is enabled), one per swapchain image.
+            /// Those are allocated at the swapchain extent, the scene being rendered in a
+            /// part of it (see `getRenderExtent`) before being upscaled to the swapchain image.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createSceneResources();
+            /// @brief Returns the offscreen color target of the scene, for a swapchain image
+            /// @param index The swapchain image index
+            std::shared_ptr<app::graphics::Attachment> getSceneAttachment(const uint32_t index) const;
+            /// @brief Returns the format of the offscreen color targets of the scene (linear HDR)
+            VkFormat getSceneFormat() const noexcept;
+            /// @brief Returns the format of the motion vector targets
+            VkFormat getMotionFormat() const noexcept;
+            /// @brief Creates the temporal upscaler, if TEMPORAL_UPSCALING is enabled.
+            /// Should be called once the scene resources are created.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createTemporalUpscaler();
+            /// @brief Returns the temporal upscaler, or nullptr if TEMPORAL_UPSCALING is disabled
+            std::shared_ptr<app::graphics::TemporalUpscaler> getTemporalUpscaler() const;
+            /// @brief Creates the post-processing chain, which exposes the HDR scene and maps
+            /// it to the display range. Should be called once the temporal upscaler is created.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createPostProcessing();
+            /// @brief Returns the post-processing chain of the renderer
+            std::shared_ptr<app::graphics::PostProcessing> getPostProcessing() const;
+            /// @brief Returns the extent to render the scene at, for the current frame
+            VkExtent2D getRenderExtent() const noexcept;
+            /// @brief Creates the descriptor buffer of the compute passes, if supported.
+            /// Should be called before the creation of any compute pass.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createDescriptorBuffer();
+            /// @brief Returns the descriptor buffer of the renderer (disabled if the
+            /// descriptors are allocated from the descriptor pool)
+            std::shared_ptr<app::graphics::DescriptorBuffer> getDescriptorBuffer() const;
+            /// @brief Creates the GPU timer used to measure the frames
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createGpuTimer();
+            /// @brief Returns the GPU timer of the renderer
+            std::shared_ptr<app::graphics::GpuTimer> getGpuTimer() const;
+            /// @brief Creates the shadow atlas of the lights.
+            /// Should be called before the creation of the clustered lighting, which
+            /// reads the shadow maps.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createShadowAtlas();
+            /// @brief Returns the shadow atlas of the renderer
+            std::shared_ptr<app::graphics::ShadowAtlas> getShadowAtlas() const;
+            /// @brief Creates the cascaded shadow maps of the directional light.
+            /// Should be called before the creation of the clustered lighting, which
+            /// reads the cascades.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createCascadedShadows();
+            /// @brief Returns the cascaded shadow maps of the renderer
+            std::shared_ptr<app::graphics::CascadedShadowMaps> getCascadedShadows() const;
+            /// @brief Creates the clustered lighting.
+            /// Should be called before the creation of the graphics pipeline, which
+            /// reads the lights.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createClusteredLighting();
+            /// @brief Returns the clustered lighting of the renderer
+            std::shared_ptr<app::graphics::ClusteredLighting> getClusteredLighting() const;
+            /// @brief Creates the GPU skinning of the animated meshes, and draws them in the
+            /// shadow atlas and the cascades (created before)
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createSkinning();
+            /// @brief Returns the GPU skinning of the renderer
+            std::shared_ptr<app::graphics::GpuSkinning> getSkinning() const;
+            /// @brief Creates the animation system (its worker threads start with the first
+            /// evaluation of several characters)
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createAnimation();
+            /// @brief Returns the animation system, evaluating the skinning matrices of the
+            /// animated mesh instances
+            std::shared_ptr<app::graphics::AnimationSystem> getAnimation() const;
+            /// @brief Creates the levels of detail tables, and their GPU selection pass
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createLevelsOfDetail();
+            /// @brief Returns the levels of detail of the renderer
+            std::shared_ptr<app::graphics::LevelsOfDetail> getLevelsOfDetail() const;
+            /// @brief Creates the occlusion queries of the expensive objects.
+            /// Should be called once the graphics pipeline is created: the proxies
+            /// are drawn in its main subpass.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createOcclusionQueries();
+            /// @brief Returns the occlusion queries of the renderer
+            std::shared_ptr<app::graphics::OcclusionQueries> getOcclusionQueries() const;
+            /// @brief Creates the meshlet culling.
+            /// Should be called once the occlusion queries are created: the meshlets of the
+            /// instances are culled with their results.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createMeshletCulling();
+            /// @brief Returns the meshlet culling of the renderer
+            std::shared_ptr<app::graphics::MeshletCulling> getMeshletCulling() const;
+            /// @brief Creates the vertex pulling arenas, and their pipeline.
+            /// Should be called once the graphics pipeline is created.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createVertexPulling();
+            /// @brief Returns the vertex pulling of the renderer
+            std::shared_ptr<app::graphics::VertexPulling> getVertexPulling() const;
+            /// @brief Creates the sprite batcher, drawn in the UI render pass.
+            /// Should be called once the graphics pipeline is created.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createSpriteBatcher();
+            /// @brief Returns the sprite batcher of the renderer
+            std::shared_ptr<app::graphics::SpriteBatcher> getSpriteBatcher() const;
+            /// @brief Creates the debug draw, drawn in the last subpass of the scene.
+            /// Only in debug builds: otherwise, does nothing.
+            /// Should be called once the graphics pipeline is created.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createDebugDraw();
+            /// @brief Returns the debug draw of the renderer (nullptr without DEBUG)
+            std::shared_ptr<app::graphics::DebugDraw> getDebugDraw() const;
+            /// @brief Returns the camera of the scene
+            std::shared_ptr<app::graphics::Camera> getCamera() const;
+            /// @brief Returns the dynamic resolution controller of the renderer
+            std::shared_ptr<app::graphics::DynamicResolution> getDynamicResolution() const;
+            /// @brief Picks the depth format and creates one depth attachment
+            /// per swapchain image.
+            /// Should be called before the creation of the render pass.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createDepthResources();
+            /// @brief Returns the format of the depth attachments
+            VkFormat getDepthFormat() const noexcept;
+            /// @brief Creates the G-buffer attachments (albedo, normal) of the deferred
+            /// shading, one set per swapchain image, if DEFERRED_SHADING is enabled.
+            /// Those only live during the render pass: they are transient and lazily allocated.
+            /// Should be called before the creation of the render pass.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createGBufferResources();
+            /// @brief Returns the format of the albedo attachments of the G-buffer
+            VkFormat getAlbedoFormat() const noexcept;
+            /// @brief Returns the format of the normal attachments of the G-buffer
+            VkFormat getNormalFormat() const noexcept;
+            /// @brief Returns the number of samples per pixel of the color and depth attachments
+            VkSampleCountFlagBits getSampleCount() const noexcept;
             /// @brief Creates the framebuffers for the objects to render
             /// @return A VResult type to know if the function succeeded
             /// or not.
@@ -63,6 +245,31 @@ namespace app
             std::shared_ptr<app::graphics::Command> getTransfertCommand() const;
             /// @brief Returns the associated Graphics pipeline object if it exists
             std::shared_ptr<app::graphics::Pipeline> getGraphicsPipeline() const;
+            /// @brief Creates the pipeline library of the scene pipeline variants, and
+            /// compiles the parts of the scene shaders.
+            /// Should be called after the creation of the graphics pipeline.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createPipelineLibrary();
+            /// @brief Returns the pipeline library of the scene pipeline variants
+            std::shared_ptr<app::graphics::PipelineLibrary> getPipelineLibrary() const;
+            /// @brief Sets the variant of the scene pipeline bound by the scene draws (the
+            /// scene shaders in the state of the scene pipeline by default)
+            /// @param variant The shaders and the state of the variant
+            void setSceneVariant(const app::graphics::PipelineLibrary::Variant& variant);
+            /// @brief Returns the pipeline of the current scene variant, from the pipeline
+            /// library. The scene pipeline, created with the default state, is returned while
+            /// the variant is not ready.
+            VkPipeline getScenePipeline() const;
+            /// @brief Creates the submit batchers, one per distinct queue of the device
+            /// (the graphics, present and transfert queues may be the same queue).
+            /// Should be called after the creation of the logical device.
+            /// @return A VResult type to know if the function succeeded
+            /// or not.
+            utils::VResult createSubmitBatchers();
+            /// @brief Returns the submit batcher of a queue of the device, nullptr if
+            /// the queue is not a queue of the device
+            std::shared_ptr<app::graphics::SubmitBatcher> getSubmitBatcher(const VkQueue queue) const;
 
         private:
             /// @brief Constructor
@@ -78,15 +285,82 @@ namespace app
             static Render* m_instance;
             /// @brief Literal views to different images - describe how
             /// to access images and which part of the images to access
-            std::vector<VkImageView> m_image_views;
-            /// @brief Reference all of the VkImageView objects
+            std::vector<app::graphics::ImageHandle> m_image_views;
+            /// @brief Reference all of the VkImageView objects of the scene render pass
             std::vector<VkFramebuffer> m_framebuffers;
+            /// @brief Reference the swapchain image views, for the UI render pass
+            std::vector<VkFramebuffer> m_ui_framebuffers;
+            /// @brief The offscreen color targets of the scene, one per swapchain image
+            std::vector<std::shared_ptr<app::graphics::Attachment>> m_scene_attachments;
+            /// @brief The format of the offscreen color targets of the scene
+            VkFormat m_scene_format = VK_FORMAT_UNDEFINED;
+            /// @brief The motion vector targets, one per swapchain image.
+            /// Empty if the temporal upscaling is disabled.
+            std::vector<std::shared_ptr<app::graphics::Attachment>> m_motion_attachments;
+            /// @brief The multisampled motion vector attachments, one per swapchain image.
+            /// Empty if multisampling or the temporal upscaling is disabled.
+            std::vector<std::shared_ptr<app::graphics::Attachment>> m_motion_msaa_attachments;
+            /// @brief Reconstructs the scene at the swapchain resolution
+            std::shared_ptr<app::graphics::TemporalUpscaler> m_temporal_upscaler = nullptr;
+            /// @brief Exposes, tonemaps and post-processes the HDR scene
+            std::shared_ptr<app::graphics::PostProcessing> m_post_processing = nullptr;
+            /// @brief Measures the GPU time of the frames
+            std::shared_ptr<app::graphics::GpuTimer> m_gpu_timer = nullptr;
+            /// @brief The point of view of the scene
+            std::shared_ptr<app::graphics::Camera> m_camera = nullptr;
+            /// @brief The descriptors of the compute passes, written in place
+            std::shared_ptr<app::graphics::DescriptorBuffer> m_descriptor_buffer = nullptr;
+            /// @brief The variants of the scene pipeline, linked from their parts
+            std::shared_ptr<app::graphics::PipelineLibrary> m_pipeline_library = nullptr;
+            /// @brief The variant of the scene pipeline bound by the scene draws
+            app::graphics::PipelineLibrary::Variant m_scene_variant{};
+            /// @brief The shadow maps of the lights
+            std::shared_ptr<app::graphics::ShadowAtlas> m_shadow_atlas = nullptr;
+            /// @brief The directional light, and its shadow cascades
+            std::shared_ptr<app::graphics::CascadedShadowMaps> m_cascaded_shadows = nullptr;
+            /// @brief Bins the lights of the scene in clusters
+            std::shared_ptr<app::graphics::ClusteredLighting> m_clustered_lighting = nullptr;
+            /// @brief Skins the animated mesh instances, once per frame for all the passes
+            std::shared_ptr<app::graphics::GpuSkinning> m_skinning = nullptr;
+            /// @brief Samples the animation clips of the skinned instances, on worker threads
+            std::shared_ptr<app::graphics::AnimationSystem> m_animation = nullptr;
+            /// @brief Selects the levels of detail of the mesh instances
+            std::shared_ptr<app::graphics::LevelsOfDetail> m_levels_of_detail = nullptr;
+            /// @brief Gates the draws of the expensive objects with occlusion queries
+            std::shared_ptr<app::graphics::OcclusionQueries> m_occlusion_queries = nullptr;
+            /// @brief Culls the meshlets of the mesh instances on the GPU
+            std::shared_ptr<app::graphics::MeshletCulling> m_meshlet_culling = nullptr;
+            /// @brief Draws the meshes of any vertex layout with a single pipeline
+            std::shared_ptr<app::graphics::VertexPulling> m_vertex_pulling = nullptr;
+            /// @brief Draws the 2D sprites (HUD, overlays, markers) on top of the scene
+            std::shared_ptr<app::graphics::SpriteBatcher> m_sprite_batcher = nullptr;
+            /// @brief Draws the debug geometry over the scene (debug builds only)
+            std::shared_ptr<app::graphics::DebugDraw> m_debug_draw = nullptr;
+            /// @brief Controls the resolution of the scene from the GPU time
+            std::shared_ptr<app::graphics::DynamicResolution> m_dynamic_resolution = nullptr;
+            /// @brief The multisampled color attachments, one per swapchain image.
+            /// Empty if multisampling is disabled.
+            std::vector<std::shared_ptr<app::graphics::Attachment>> m_color_attachments;
+            /// @brief The number of samples per pixel of the color and depth attachments
+            VkSampleCountFlagBits m_sample_count = VK_SAMPLE_COUNT_1_BIT;
+            /// @brief The depth attachments, one per swapchain image
+            std::vector<std::shared_ptr<app::graphics::Attachment>> m_depth_attachments;
+            /// @brief The format of the depth attachments
+            VkFormat m_depth_format = VK_FORMAT_UNDEFINED;
+            /// @brief The albedo attachments of the G-buffer, one per swapchain image.
+            /// Empty if the deferred shading is disabled.
+            std::vector<std::shared_ptr<app::graphics::Attachment>> m_albedo_attachments;
+            /// @brief The normal attachments of the G-buffer, one per swapchain image.
+            /// Empty if the deferred shading is disabled.
+            std::vector<std::shared_ptr<app::graphics::Attachment>> m_normal_attachments;
             /// @brief The graphics pipeline, associated to a Renderer
             std::shared_ptr<app::graphics::Pipeline> m_graphics_pipeline = nullptr;
             /// @brief Graphics command pool
             std::shared_ptr<app::graphics::Command> m_graphics_command = nullptr;
             /// @brief Transfert command pool
             std::shared_ptr<app::graphics::Command> m_transfert_command = nullptr;
+            /// @brief The submit batchers, one per distinct queue
+            std::vector<std::shared_ptr<app::graphics::SubmitBatcher>> m_submit_batchers;
             /// @brief Creates the shader module:
             /// 1. Read the SPIR-V shaders,
             /// 2. Create the shader modules,
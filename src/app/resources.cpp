@@ -0,0 +1,216 @@
+//
+//  resources.cpp
+//
+
+#include "resources.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include "memory.hpp"
+
+app::graphics::Resources::Resources(){};
+
+app::graphics::Resources::~Resources()
+{
+    if (!m_buffers.empty() || !m_images.empty())
+        Log("< Destroying the %d remaining buffers and %d remaining images...", static_cast<uint32_t>(m_buffers.size()), static_cast<uint32_t>(m_images.size()));
+    for (const auto& buffer : m_buffers.getValues())
+        release(buffer);
+    m_buffers.clear();
+    for (const auto& image : m_images.getValues())
+        release(image);
+    m_images.clear();
+};
+
+utils::Result<app::graphics::BufferHandle> app::graphics::Resources::createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const bool host_visible)
+{
+    auto resources_allocator = app::Engine::getInstance()->m_allocator;
+    // With descriptor buffers, the descriptor of a uniform or storage buffer is written
+    // from its device address
+    VkBufferUsageFlags buffer_usage = usage;
+    if (app::Engine::getInstance()->m_graphics_device.supportsDescriptorBuffers() &&
+        (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)))
+        buffer_usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    BufferResource buffer{
+        .m_size = size,
+        .m_usage = buffer_usage,
+    };
+    if (const auto result = app::graphics::Memory::initBuffer(
+            resources_allocator,
+            &buffer.m_allocation,
+            app::Engine::getInstance()->m_graphics_device.getLogicalDevice(),
+            size,
+            buffer.m_buffer,
+            buffer_usage,
+            VK_SHARING_MODE_EXCLUSIVE,
+            host_visible ? VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT : 0);
+        result.IsError())
+        return utils::Result<BufferHandle>::Error((char*)"Cannot create the buffer");
+    if (host_visible)
+    {
+        if (const auto result = vmaMapMemory(resources_allocator, buffer.m_allocation, &buffer.m_mapped_data); result != VK_SUCCESS)
+        {
+            LogE("> vmaMapMemory: error 0x%08x for a buffer of %llu bytes", result, size);
+            release(buffer);
+            return utils::Result<BufferHandle>::Error((char*)"Cannot map the memory of the buffer");
+        }
+    }
+    const BufferHandle handle = m_buffers.insert(buffer);
+    if (handle.isNull())
+    {
+        release(buffer);
+        return utils::Result<BufferHandle>::Error((char*)"The buffer pool is full");
+    }
+    return utils::Result<BufferHandle>::Ok(handle);
+}
+
+utils::Result<app::graphics::ImageHandle> app::graphics::Resources::createImage(
+    const VkExtent2D& extent,
+    const VkFormat format,
+    const VkImageUsageFlags usage,
+    const VkImageAspectFlags aspect,
+    const VkSampleCountFlagBits samples,
+    const uint32_t layers,
+    const uint32_t depth)
+{
+    auto resources_allocator = app::Engine::getInstance()->m_allocator;
+    ImageResource image{
+        .m_format = format,
+        .m_extent = extent,
+        .m_layers = layers,
+        .m_depth = depth,
+    };
+    if (const auto result = app::graphics::Memory::initImage(
+            resources_allocator,
+            &image.m_allocation,
+            image.m_image,
+            extent,
+            format,
+            usage,
+            samples,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            layers,
+            depth);
+        result.IsError())
+        return utils::Result<ImageHandle>::Error((char*)"Cannot create the image");
+    image.m_image_view = createImageView(image.m_image, format, aspect, layers, depth);
+    if (VK_NULL_HANDLE == image.m_image_view)
+    {
+        release(image);
+        return utils::Result<ImageHandle>::Error((char*)"Cannot create the image view");
+    }
+    const ImageHandle handle = m_images.insert(image);
+    if (handle.isNull())
+    {
+        release(image);
+        return utils::Result<ImageHandle>::Error((char*)"The image pool is full");
+    }
+    return utils::Result<ImageHandle>::Ok(handle);
+}
+
+utils::Result<app::graphics::ImageHandle> app::graphics::Resources::importImage(
+    const VkImage image,
+    const VkFormat format,
+    const VkExtent2D& extent,
+    const VkImageAspectFlags aspect)
+{
+    ImageResource imported_image{
+        .m_image = image,
+        .m_format = format,
+        .m_extent = extent,
+    };
+    imported_image.m_image_view = createImageView(image, format, aspect, 1, 1);
+    if (VK_NULL_HANDLE == imported_image.m_image_view)
+        return utils::Result<ImageHandle>::Error((char*)"Cannot create the image view");
+    const ImageHandle handle = m_images.insert(imported_image);
+    if (handle.isNull())
+    {
+        release(imported_image);
+        return utils::Result<ImageHandle>::Error((char*)"The image pool is full");
+    }
+    return utils::Result<ImageHandle>::Ok(handle);
+}
+
+void app::graphics::Resources::destroy(const BufferHandle handle)
+{
+    if (const BufferResource* buffer = m_buffers.find(handle); nullptr != buffer)
+    {
+        release(*buffer);
+        m_buffers.erase(handle);
+    }
+}
+
+void app::graphics::Resources::destroy(const ImageHandle handle)
+{
+    if (const ImageResource* image = m_images.find(handle); nullptr != image)
+    {
+        release(*image);
+        m_images.erase(handle);
+    }
+}
+
+bool app::graphics::Resources::isValid(const BufferHandle handle) const noexcept
+{
+    return m_buffers.contains(handle);
+}
+
+bool app::graphics::Resources::isValid(const ImageHandle handle) const noexcept
+{
+    return m_images.contains(handle);
+}
+
+const app::graphics::BufferResource& app::graphics::Resources::getBuffer(const BufferHandle handle) const noexcept
+{
+    return m_buffers.get(handle);
+}
+
+const app::graphics::ImageResource& app::graphics::Resources::getImage(const ImageHandle handle) const noexcept
+{
+    return m_images.get(handle);
+}
+
+VkImageView app::graphics::Resources::createImageView(const VkImage image, const VkFormat format, const VkImageAspectFlags aspect, const uint32_t layers, const uint32_t depth)
+{
+    VkImageViewCreateInfo image_view_create_info{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image,
+        .viewType = depth > 1 ? VK_IMAGE_VIEW_TYPE_3D : (layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D),
+        .format = format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+        },
+        .subresourceRange = {
+            .aspectMask = aspect,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = layers,
+        }};
+    VkImageView image_view = VK_NULL_HANDLE;
+    if (const auto result = vkCreateImageView(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &image_view_create_info, nullptr, &image_view); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateImageView: error 0x%08x", result);
+        return VK_NULL_HANDLE;
+    }
+    return image_view;
+}
+
+void app::graphics::Resources::release(const BufferResource& buffer)
+{
+    auto resources_allocator = app::Engine::getInstance()->m_allocator;
+    if (nullptr != buffer.m_mapped_data)
+        vmaUnmapMemory(resources_allocator, buffer.m_allocation);
+    if (VK_NULL_HANDLE != buffer.m_buffer)
+        vmaDestroyBuffer(resources_allocator, buffer.m_buffer, buffer.m_allocation);
+}
+
+void app::graphics::Resources::release(const ImageResource& image)
+{
+    if (VK_NULL_HANDLE != image.m_image_view)
+        vkDestroyImageView(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), image.m_image_view, nullptr);
+    // An imported image is owned elsewhere
+    if (VK_NULL_HANDLE != image.m_allocation)
+        vmaDestroyImage(app::Engine::getInstance()->m_allocator, image.m_image, image.m_allocation);
+}
@@ -0,0 +1,155 @@
+//
+//  resources.hpp
+//
+
+#pragma once
+#ifndef resources_h
+#define resources_h
+
+#include "../utils/handle_pool.h"
+#include "../utils/result.h"
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief The tag of the buffer handles
+        struct BufferTag
+        {
+        };
+        /// @brief The tag of the image handles
+        struct ImageTag
+        {
+        };
+        /// @brief A handle to a buffer of the resource pools
+        using BufferHandle = utils::Handle<BufferTag>;
+        /// @brief A handle to an image of the resource pools
+        using ImageHandle = utils::Handle<ImageTag>;
+
+        /// @brief A buffer of the resource pools, and its metadata
+        struct BufferResource
+        {
+            /// @brief The buffer
+            VkBuffer m_buffer = VK_NULL_HANDLE;
+            /// @brief The buffer allocation object
+            VmaAllocation m_allocation = VK_NULL_HANDLE;
+            /// @brief The mapped memory, for host-visible buffers
+            void* m_mapped_data = nullptr;
+            /// @brief The size of the buffer, in bytes
+            VkDeviceSize m_size = 0;
+            /// @brief Usage flag(s) of the buffer
+            VkBufferUsageFlags m_usage = 0;
+        };
+
+        /// @brief An image of the resource pools, its view, and its metadata
+        struct ImageResource
+        {
+            /// @brief The image
+            VkImage m_image = VK_NULL_HANDLE;
+            /// @brief The image allocation object (VK_NULL_HANDLE for an imported image,
+            /// owned by the swapchain)
+            VmaAllocation m_allocation = VK_NULL_HANDLE;
+            /// @brief The view to the image
+            VkImageView m_image_view = VK_NULL_HANDLE;
+            /// @brief The format of the image
+            VkFormat m_format = VK_FORMAT_UNDEFINED;
+            /// @brief The size of the image
+            VkExtent2D m_extent = {0, 0};
+            /// @brief The number of layers of the image
+            uint32_t m_layers = 1;
+            /// @brief The depth of the image (1 for 2D images)
+            uint32_t m_depth = 1;
+        };
+
+        /// @brief Owns the GPU buffers and images behind generational handles.
+        ///
+        /// The metadata of the resources are stored contiguously in a pool per type, and a
+        /// handle is resolved in O(1) without reference counting. Destroying a resource bumps
+        /// the generation of its slot: the handles still referring to it are stale, which
+        /// is detected in debug builds, instead of aliasing the next resource of the slot.
+        /// The index of a handle is stable for the lifetime of the resource, and can be used
+        /// as its index in a bindless descriptor array.
+        /// The modules own their resources through `Buffer` and `Attachment`, which destroy
+        /// their handle with them.
+        /// The resources are created, resolved and destroyed on the render thread, and the
+        /// caller destroys a resource once the GPU does not use it anymore.
+        class Resources
+        {
+        public:
+            /// @brief Public constructor
+            Resources();
+            /// @brief Public destructor, destroys the remaining resources
+            ~Resources();
+            /// @brief Creates a buffer and its memory
+            /// @param size The size of the buffer, in bytes
+            /// @param usage Usage flag(s) of the buffer
+            /// @param host_visible If the CPU writes the buffer (mapped for its whole lifetime),
+            /// or if only the GPU accesses it
+            /// @return The handle of the buffer, or an error
+            utils::Result<BufferHandle> createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const bool host_visible);
+            /// @brief Creates an image, its memory and its view
+            /// @param extent The size of the image, in pixels
+            /// @param format The format of the image
+            /// @param usage Usage flag(s) of the image
+            /// @param aspect The aspect of the image view (color, depth, ...)
+            /// @param samples The number of samples per pixel
+            /// @param layers The number of layers: the view is a 2D array view if more than one
+            /// @param depth The depth, in pixels: the image and its view are 3D if more than one
+            /// @return The handle of the image, or an error
+            utils::Result<ImageHandle> createImage(
+                const VkExtent2D& extent,
+                const VkFormat format,
+                const VkImageUsageFlags usage,
+                const VkImageAspectFlags aspect,
+                const VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT,
+                const uint32_t layers = 1,
+                const uint32_t depth = 1);
+            /// @brief Creates the view of an image owned elsewhere (e.g. a swapchain image):
+            /// only the view is destroyed with the handle
+            /// @param image The image
+            /// @param format The format of the image
+            /// @param extent The size of the image, in pixels
+            /// @param aspect The aspect of the image view
+            /// @return The handle of the image, or an error
+            utils::Result<ImageHandle> importImage(
+                const VkImage image,
+                const VkFormat format,
+                const VkExtent2D& extent,
+                const VkImageAspectFlags aspect);
+            /// @brief Destroys a buffer and its memory (no-op for a null or stale handle)
+            void destroy(const BufferHandle handle);
+            /// @brief Destroys an image view, and the image and its memory if not imported
+            /// (no-op for a null or stale handle)
+            void destroy(const ImageHandle handle);
+            /// @brief Returns if the handle refers to an existing buffer
+            bool isValid(const BufferHandle handle) const noexcept;
+            /// @brief Returns if the handle refers to an existing image
+            bool isValid(const ImageHandle handle) const noexcept;
+            /// @brief Returns the buffer of a valid handle
+            const BufferResource& getBuffer(const BufferHandle handle) const noexcept;
+            /// @brief Returns the image of a valid handle
+            const ImageResource& getImage(const ImageHandle handle) const noexcept;
+
+        private:
+            /// @brief Resources should not be cloneable
+            Resources(Resources& other) = delete;
+            /// @brief Resources should not be assignable
+            void operator=(const Resources& other) = delete;
+            /// @brief Creates the view of an image
+            /// @return The view, or VK_NULL_HANDLE if it cannot be created
+            static VkImageView createImageView(const VkImage image, const VkFormat format, const VkImageAspectFlags aspect, const uint32_t layers, const uint32_t depth);
+            /// @brief Destroys the Vulkan objects of a buffer
+            static void release(const BufferResource& buffer);
+            /// @brief Destroys the Vulkan objects of an image
+            static void release(const ImageResource& image);
+            /// @brief The buffers
+            utils::HandlePool<BufferTag, BufferResource> m_buffers;
+            /// @brief The images
+            utils::HandlePool<ImageTag, ImageResource> m_images;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // resources_h
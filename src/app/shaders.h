@@ -24,6 +24,14 @@ namespace app
             glm::vec3 m_color;
         };
 
+        /// @brief Push constants of the scene pipeline (vertex stage)
+        struct ScenePushConstants
+        {
+            /// @brief Sub-pixel offset of the projection, in NDC units,
+            /// for the temporal upscaling (0 if disabled)
+            glm::vec2 m_jitter;
+        };
+
         class VertexUtils
         {
         public:
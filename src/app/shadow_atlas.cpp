@@ -0,0 +1,730 @@
+//
+//  shadow_atlas.cpp
+//
+
+#include "shadow_atlas.hpp"
+#include "../utils/debug_tools.h"
+#include "depth.hpp"
+#include "engine.hpp"
+#include "lighting.hpp"
+#include "pipeline.hpp"
+#include "shaders.h"
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+/// @brief Number of shadow views of a point light: one per cube face
+constexpr uint32_t POINT_LIGHT_VIEWS = 6;
+/// @brief Near plane of the shadow views, relative to the radius of the light
+constexpr float SHADOW_NEAR_RATIO = 0.01f;
+
+/// @brief Returns a layout transition of a whole depth image
+static VkImageMemoryBarrier depthBarrier(
+    VkImage image,
+    const VkImageLayout old_layout,
+    const VkImageLayout new_layout,
+    const VkAccessFlags src_access,
+    const VkAccessFlags dst_access)
+{
+    return VkImageMemoryBarrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+        .oldLayout = old_layout,
+        .newLayout = new_layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+}
+
+/// @brief Returns a view matrix looking along `direction`, with an up vector not parallel to it
+static glm::mat4 lookAlong(const glm::vec3& eye, const glm::vec3& direction)
+{
+    const glm::vec3 up = glm::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::lookAtRH(eye, eye + direction, up);
+}
+
+app::graphics::ShadowAtlas::ShadowAtlas(){};
+
+app::graphics::ShadowAtlas::~ShadowAtlas()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    if (VK_NULL_HANDLE != m_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_pipeline_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_pipeline_layout, nullptr);
+        m_pipeline_layout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_atlas_framebuffer)
+    {
+        vkDestroyFramebuffer(graphics_device, m_atlas_framebuffer, nullptr);
+        m_atlas_framebuffer = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_static_framebuffer)
+    {
+        vkDestroyFramebuffer(graphics_device, m_static_framebuffer, nullptr);
+        m_static_framebuffer = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_render_pass)
+    {
+        vkDestroyRenderPass(graphics_device, m_render_pass, nullptr);
+        m_render_pass = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_sampler)
+    {
+        vkDestroySampler(graphics_device, m_sampler, nullptr);
+        m_sampler = VK_NULL_HANDLE;
+    }
+    m_atlas = nullptr;
+    m_static_cache = nullptr;
+    m_views_buffer = nullptr;
+    m_views.clear();
+    m_light_views.clear();
+    m_gpu_views.clear();
+};
+
+utils::VResult app::graphics::ShadowAtlas::create(const uint32_t atlas_size, const uint32_t tile_size, const uint32_t updates_per_frame)
+{
+    Log("> Creating the shadow atlas (%dx%d, tiles of %dx%d, %d updates per frame)", atlas_size, atlas_size, tile_size, tile_size, updates_per_frame);
+    if (tile_size == 0 || atlas_size < tile_size)
+        return utils::VResult::Error((char*)"The shadow atlas should contain at least one tile");
+    m_atlas_size = atlas_size;
+    m_tile_size = tile_size;
+    m_tiles_per_row = atlas_size / tile_size;
+    m_updates_per_frame = updates_per_frame;
+    m_views.resize(m_tiles_per_row * m_tiles_per_row);
+    m_gpu_views.resize(m_views.size());
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+
+    // The atlas is sampled with depth comparisons, and both are copied to / from
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(app::Engine::getInstance()->m_graphics_device.getPhysicalDevice(), FORMAT, &format_properties);
+    constexpr VkFormatFeatureFlags required_features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                       VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                       VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((format_properties.optimalTilingFeatures & required_features) != required_features)
+        return utils::VResult::Error((char*)"The format of the shadow atlas is not supported");
+
+    const VkExtent2D extent{m_atlas_size, m_atlas_size};
+    m_atlas = std::make_shared<app::graphics::Attachment>();
+    if (const auto result = m_atlas->create(
+            extent,
+            FORMAT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_IMAGE_ASPECT_DEPTH_BIT);
+        result.IsError())
+    {
+        LogE("Error creating the shadow atlas");
+        return result;
+    }
+    m_static_cache = std::make_shared<app::graphics::Attachment>();
+    if (const auto result = m_static_cache->create(
+            extent,
+            FORMAT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_IMAGE_ASPECT_DEPTH_BIT);
+        result.IsError())
+    {
+        LogE("Error creating the static shadow cache");
+        return result;
+    }
+
+    m_views_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_views_buffer->create(m_gpu_views.size() * sizeof(GpuView), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+
+    // Linear filtering with a comparison: the hardware averages 2x2 depth tests
+    VkSamplerCreateInfo sampler_create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .compareEnable = VK_TRUE,
+        // Lit if the fragment is at least as close as the closest occluder
+        .compareOp = Project::DEPTH_REVERSED_Z ? VK_COMPARE_OP_GREATER_OR_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL,
+        .maxLod = 0.0f,
+    };
+    if (const auto result = vkCreateSampler(graphics_device, &sampler_create_info, nullptr, &m_sampler); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateSampler: error 0x%08x for the shadow atlas", result);
+        return utils::VResult::Error((char*)"Cannot create the sampler of the shadow atlas");
+    }
+
+    if (const auto result = createRenderPass(); result.IsError())
+        return result;
+
+    VkImageView atlas_view = m_atlas->getImageView();
+    VkFramebufferCreateInfo framebuffer_create_info{
+        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .renderPass = m_render_pass,
+        .attachmentCount = 1,
+        .pAttachments = &atlas_view,
+        .width = m_atlas_size,
+        .height = m_atlas_size,
+        .layers = 1,
+    };
+    if (const auto result = vkCreateFramebuffer(graphics_device, &framebuffer_create_info, nullptr, &m_atlas_framebuffer); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateFramebuffer: error 0x%08x for the shadow atlas", result);
+        return utils::VResult::Error((char*)"Cannot create the framebuffer of the shadow atlas");
+    }
+    VkImageView static_view = m_static_cache->getImageView();
+    framebuffer_create_info.pAttachments = &static_view;
+    if (const auto result = vkCreateFramebuffer(graphics_device, &framebuffer_create_info, nullptr, &m_static_framebuffer); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateFramebuffer: error 0x%08x for the static shadow cache", result);
+        return utils::VResult::Error((char*)"Cannot create the framebuffer of the static shadow cache");
+    }
+
+    return createPipeline();
+}
+
+utils::VResult app::graphics::ShadowAtlas::createRenderPass()
+{
+    // Only some tiles are rendered each frame: the others are kept (LOAD), and the
+    // rendered ones are cleared one by one. The layout transitions are recorded
+    // outside of the render pass, as the atlas is also copied to.
+    VkAttachmentDescription depth_attachment{
+        .format = FORMAT,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+    VkAttachmentReference depth_attachment_reference{
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+    VkSubpassDescription subpass{
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 0,
+        .pDepthStencilAttachment = &depth_attachment_reference,
+    };
+    VkRenderPassCreateInfo render_pass_create_info{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &depth_attachment,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+    };
+    if (const auto result = vkCreateRenderPass(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &render_pass_create_info, nullptr, &m_render_pass); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateRenderPass: error 0x%08x for the shadow atlas", result);
+        return utils::VResult::Error((char*)"Cannot create the render pass of the shadow atlas");
+    }
+    return utils::VResult::Ok();
+}
+
+utils::VResult app::graphics::ShadowAtlas::createPipeline()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 0,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+    if (const auto result = vkCreatePipelineLayout(graphics_device, &pipeline_layout_create_info, nullptr, &m_pipeline_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for the shadow atlas", result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the shadow atlas");
+    }
+
+    const char* shader_filepath = "shaders/shadow.vert.spv";
+    const auto shader_module_result = app::graphics::Pipeline::loadShaderModule(shader_filepath);
+    if (shader_module_result.IsError())
+        return utils::VResult::Error((char*)"Cannot create the shader module of the shadow atlas");
+    const VkShaderModule shader_module = shader_module_result.GetValue();
+    VkPipelineShaderStageCreateInfo shader_stage{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+        .module = shader_module,
+        .pName = "main",
+    };
+
+    // Same vertex buffers as the scene, positions only
+    const auto vertex_binding_description = app::shaders::VertexUtils::getVertexBindingDescription();
+    const auto vertex_attribute_descriptions = app::shaders::VertexUtils::getVertexAttributeDescriptions();
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &vertex_binding_description,
+        .vertexAttributeDescriptionCount = 1,
+        .pVertexAttributeDescriptions = &vertex_attribute_descriptions[0],
+    };
+    VkPipelineInputAssemblyStateCreateInfo assembly_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    // Each tile sets its own viewport and scissor
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    // No culling: the casters are seen from any side by the lights. The bias pushes the
+    // stored depth away from the light (towards 0 with a reversed depth range), to avoid
+    // self-shadowing on the lit surfaces
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_TRUE,
+        .depthBiasConstantFactor = Project::DEPTH_REVERSED_Z ? -1.25f : 1.25f,
+        .depthBiasClamp = 0.0f,
+        .depthBiasSlopeFactor = Project::DEPTH_REVERSED_Z ? -1.75f : 1.75f,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+    };
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = app::graphics::Depth::getCompareOp(),
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 0,
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 1,
+        .pStages = &shader_stage,
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &assembly_state_create_info,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_pipeline_layout,
+        .renderPass = m_render_pass,
+        .subpass = 0,
+    };
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_pipeline);
+    // The module is not needed anymore once the pipeline is created
+    vkDestroyShaderModule(graphics_device, shader_module, nullptr);
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the shadow atlas", pipeline_result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline of the shadow atlas");
+    }
+    return utils::VResult::Ok();
+}
+
+void app::graphics::ShadowAtlas::setCasterRecorder(CasterRecorder recorder)
+{
+    m_caster_recorder = recorder;
+}
+
+void app::graphics::ShadowAtlas::invalidateStatic() noexcept
+{
+    for (auto& view : m_views)
+        view.m_static_dirty = true;
+}
+
+uint32_t app::graphics::ShadowAtlas::allocateTiles(const uint32_t count) noexcept
+{
+    const uint32_t nb_tiles = static_cast<uint32_t>(m_views.size());
+    uint32_t run_start = 0;
+    for (uint32_t tile = 0; tile < nb_tiles; ++tile)
+    {
+        if (m_views[tile].m_light != NO_SHADOW)
+        {
+            run_start = tile + 1;
+            continue;
+        }
+        if (tile + 1 - run_start == count)
+            return run_start;
+    }
+    return NO_SHADOW;
+}
+
+void app::graphics::ShadowAtlas::releaseTiles(const uint32_t light_index) noexcept
+{
+    LightViews& light_views = m_light_views[light_index];
+    for (uint32_t i = 0; i < light_views.m_count; ++i)
+        m_views[light_views.m_first + i].m_light = NO_SHADOW;
+    light_views = LightViews{};
+}
+
+VkRect2D app::graphics::ShadowAtlas::getTileRect(const uint32_t tile) const noexcept
+{
+    return VkRect2D{
+        .offset = {
+            static_cast<int32_t>((tile % m_tiles_per_row) * m_tile_size),
+            static_cast<int32_t>((tile / m_tiles_per_row) * m_tile_size),
+        },
+        .extent = {m_tile_size, m_tile_size},
+    };
+}
+
+void app::graphics::ShadowAtlas::initialize(VkCommandBuffer command_buffer)
+{
+    const VkImageMemoryBarrier to_transfer_dst[2] = {
+        depthBarrier(m_atlas->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT),
+        depthBarrier(m_static_cache->getImage(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT),
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, to_transfer_dst);
+
+    // Tiles never rendered cast no shadow
+    const VkClearDepthStencilValue far_plane = app::graphics::Depth::getClearValue().depthStencil;
+    const VkImageSubresourceRange range = to_transfer_dst[0].subresourceRange;
+    vkCmdClearDepthStencilImage(command_buffer, m_atlas->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &far_plane, 1, &range);
+    vkCmdClearDepthStencilImage(command_buffer, m_static_cache->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &far_plane, 1, &range);
+
+    const VkImageMemoryBarrier to_steady_state[2] = {
+        depthBarrier(m_atlas->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT),
+        depthBarrier(m_static_cache->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT),
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        2, to_steady_state);
+    m_initialized = true;
+}
+
+void app::graphics::ShadowAtlas::drawCasters(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, const std::vector<uint32_t>& views, const bool static_casters)
+{
+    VkRenderPassBeginInfo render_pass_begin_info{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = m_render_pass,
+        .framebuffer = framebuffer,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = {m_atlas_size, m_atlas_size},
+        },
+    };
+    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    for (const uint32_t tile : views)
+    {
+        const VkRect2D rect = getTileRect(tile);
+        VkViewport viewport{
+            .x = static_cast<float>(rect.offset.x),
+            .y = static_cast<float>(rect.offset.y),
+            .width = static_cast<float>(rect.extent.width),
+            .height = static_cast<float>(rect.extent.height),
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        };
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(command_buffer, 0, 1, &rect);
+        // The static casters start from an empty tile, the dynamic ones are
+        // rendered on top of the copied static depth
+        if (static_casters)
+        {
+            const VkClearAttachment clear_attachment{
+                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .colorAttachment = 0,
+                .clearValue = app::graphics::Depth::getClearValue(),
+            };
+            const VkClearRect clear_rect{
+                .rect = rect,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            };
+            vkCmdClearAttachments(command_buffer, 1, &clear_attachment, 1, &clear_rect);
+        }
+        const glm::mat4& view_projection = m_views[tile].m_view_projection;
+        vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &view_projection);
+        if (nullptr != m_caster_recorder)
+            m_caster_recorder(command_buffer, view_projection, static_casters);
+    }
+    vkCmdEndRenderPass(command_buffer);
+}
+
+void app::graphics::ShadowAtlas::record(VkCommandBuffer command_buffer, const std::vector<Light>& lights, const app::graphics::Camera& camera)
+{
+    ++m_frame;
+    m_update_count = 0;
+    if (!m_initialized)
+        initialize(command_buffer);
+
+    // Assign the tiles, and invalidate the views of the lights that changed
+    const uint32_t nb_lights = static_cast<uint32_t>(lights.size());
+    for (uint32_t i = nb_lights; i < m_light_views.size(); ++i)
+        releaseTiles(i);
+    m_light_views.resize(nb_lights);
+    for (uint32_t i = 0; i < nb_lights; ++i)
+    {
+        const Light& light = lights[i];
+        LightViews& light_views = m_light_views[i];
+        const uint32_t nb_views = light.m_type == LightType::POINT ? POINT_LIGHT_VIEWS : 1;
+        if (light_views.m_count > 0 && (!light.m_casts_shadows || light_views.m_count != nb_views))
+            releaseTiles(i);
+        if (!light.m_casts_shadows)
+            continue;
+        bool changed = false;
+        if (light_views.m_count == 0)
+        {
+            // The light stays without shadows while the atlas is full
+            const uint32_t first = allocateTiles(nb_views);
+            if (first == NO_SHADOW)
+                continue;
+            light_views.m_first = first;
+            light_views.m_count = nb_views;
+            for (uint32_t view = first; view < first + nb_views; ++view)
+                m_views[view].m_light = i;
+            changed = true;
+        }
+        changed = changed ||
+                  light_views.m_position != light.m_position ||
+                  light_views.m_radius != light.m_radius ||
+                  (light.m_type == LightType::SPOT && (light_views.m_direction != light.m_direction || light_views.m_outer_angle != light.m_outer_angle));
+        if (!changed)
+            continue;
+        light_views.m_position = light.m_position;
+        light_views.m_direction = light.m_direction;
+        light_views.m_radius = light.m_radius;
+        light_views.m_outer_angle = light.m_outer_angle;
+
+        const float z_near = std::max(light.m_radius * SHADOW_NEAR_RATIO, 0.01f);
+        if (light.m_type == LightType::SPOT)
+        {
+            const float fovy = glm::clamp(2.0f * light.m_outer_angle, glm::radians(1.0f), glm::radians(170.0f));
+            View& view = m_views[light_views.m_first];
+            view.m_view_projection = app::graphics::Depth::perspective(fovy, 1.0f, z_near, light.m_radius) *
+                                     lookAlong(light.m_position, glm::normalize(light.m_direction));
+            view.m_static_dirty = true;
+        }
+        else
+        {
+            const glm::vec3 face_directions[POINT_LIGHT_VIEWS] = {
+                glm::vec3(1.0f, 0.0f, 0.0f),
+                glm::vec3(-1.0f, 0.0f, 0.0f),
+                glm::vec3(0.0f, 1.0f, 0.0f),
+                glm::vec3(0.0f, -1.0f, 0.0f),
+                glm::vec3(0.0f, 0.0f, 1.0f),
+                glm::vec3(0.0f, 0.0f, -1.0f),
+            };
+            const glm::mat4 projection = app::graphics::Depth::perspective(glm::radians(90.0f), 1.0f, z_near, light.m_radius);
+            for (uint32_t face = 0; face < POINT_LIGHT_VIEWS; ++face)
+            {
+                View& view = m_views[light_views.m_first + face];
+                view.m_view_projection = projection * lookAlong(light.m_position, face_directions[face]);
+                view.m_static_dirty = true;
+            }
+        }
+    }
+
+    // The shaders work in the view space of the camera: the matrices are uploaded every frame
+    const glm::mat4 inverse_view = glm::inverse(camera.getView());
+    const float tile_scale = static_cast<float>(m_tile_size) / static_cast<float>(m_atlas_size);
+    std::vector<uint32_t> candidates;
+    for (uint32_t tile = 0; tile < m_views.size(); ++tile)
+    {
+        if (m_views[tile].m_light == NO_SHADOW)
+            continue;
+        const VkRect2D rect = getTileRect(tile);
+        m_gpu_views[tile] = GpuView{
+            .m_view_to_clip = m_views[tile].m_view_projection * inverse_view,
+            .m_rect = glm::vec4(
+                static_cast<float>(rect.offset.x) / static_cast<float>(m_atlas_size),
+                static_cast<float>(rect.offset.y) / static_cast<float>(m_atlas_size),
+                tile_scale,
+                tile_scale),
+        };
+        candidates.push_back(tile);
+    }
+    if (!candidates.empty())
+        m_views_buffer->write(m_gpu_views.data(), m_gpu_views.size() * sizeof(GpuView));
+
+    // Pick the views to refresh: outdated caches first, then the least recently refreshed
+    m_update_count = std::min(static_cast<uint32_t>(candidates.size()), m_updates_per_frame);
+    if (m_update_count == 0)
+        return;
+    std::partial_sort(
+        candidates.begin(),
+        candidates.begin() + m_update_count,
+        candidates.end(),
+        [this](const uint32_t a, const uint32_t b)
+        {
+            if (m_views[a].m_static_dirty != m_views[b].m_static_dirty)
+                return m_views[a].m_static_dirty;
+            return m_views[a].m_last_update < m_views[b].m_last_update;
+        });
+    candidates.resize(m_update_count);
+    std::vector<uint32_t> static_updates;
+    for (const uint32_t tile : candidates)
+    {
+        if (m_views[tile].m_static_dirty)
+            static_updates.push_back(tile);
+    }
+
+    // 1. Static casters, in the cache (already in DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+    if (!static_updates.empty())
+        drawCasters(command_buffer, m_static_framebuffer, static_updates, true);
+
+    // 2. Copy of the cached tiles in the atlas, once the previous frame stopped sampling it
+    const VkImageMemoryBarrier before_copy[2] = {
+        depthBarrier(m_atlas->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT),
+        depthBarrier(m_static_cache->getImage(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        2, before_copy);
+    std::vector<VkImageCopy> copies;
+    copies.reserve(candidates.size());
+    for (const uint32_t tile : candidates)
+    {
+        const VkRect2D rect = getTileRect(tile);
+        copies.push_back(VkImageCopy{
+            .srcSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .srcOffset = {rect.offset.x, rect.offset.y, 0},
+            .dstSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .dstOffset = {rect.offset.x, rect.offset.y, 0},
+            .extent = {rect.extent.width, rect.extent.height, 1},
+        });
+    }
+    vkCmdCopyImage(
+        command_buffer,
+        m_static_cache->getImage(),
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        m_atlas->getImage(),
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(copies.size()),
+        copies.data());
+
+    const VkImageMemoryBarrier after_copy[2] = {
+        depthBarrier(m_atlas->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT),
+        depthBarrier(m_static_cache->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 0, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT),
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        2, after_copy);
+
+    // 3. Dynamic casters, on top of the static ones
+    drawCasters(command_buffer, m_atlas_framebuffer, candidates, false);
+
+    const VkImageMemoryBarrier to_shader_read = depthBarrier(
+        m_atlas->getImage(),
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_ACCESS_SHADER_READ_BIT);
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &to_shader_read);
+
+    for (const uint32_t tile : candidates)
+    {
+        m_views[tile].m_static_dirty = false;
+        m_views[tile].m_last_update = m_frame;
+    }
+}
+
+glm::uvec2 app::graphics::ShadowAtlas::getLightViews(const uint32_t light_index) const noexcept
+{
+    if (light_index >= m_light_views.size() || m_light_views[light_index].m_count == 0)
+        return glm::uvec2(NO_SHADOW, 0);
+    return glm::uvec2(m_light_views[light_index].m_first, m_light_views[light_index].m_count);
+}
+
+std::shared_ptr<app::graphics::Attachment> app::graphics::ShadowAtlas::getAtlas() const
+{
+    return m_atlas;
+}
+
+VkSampler app::graphics::ShadowAtlas::getSampler() const noexcept
+{
+    return m_sampler;
+}
+
+std::shared_ptr<app::graphics::Buffer> app::graphics::ShadowAtlas::getViewsBuffer() const
+{
+    return m_views_buffer;
+}
+
+VkPipelineLayout app::graphics::ShadowAtlas::getPipelineLayout() const noexcept
+{
+    return m_pipeline_layout;
+}
+
+uint32_t app::graphics::ShadowAtlas::getUpdateCount() const noexcept
+{
+    return m_update_count;
+}
+
+uint32_t app::graphics::ShadowAtlas::getViewCount() const noexcept
+{
+    return static_cast<uint32_t>(std::count_if(
+        m_views.begin(),
+        m_views.end(),
+        [](const View& view)
+        { return view.m_light != NO_SHADOW; }));
+}
@@ -0,0 +1,194 @@
+//
+//  shadow_atlas.hpp
+//
+
+#pragma once
+#ifndef shadow_atlas_h
+#define shadow_atlas_h
+
+#include "../utils/result.h"
+#include "attachment.hpp"
+#include "buffer.hpp"
+#include "camera.hpp"
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        struct Light;
+
+        /// @brief Shadow maps of many lights, packed as tiles of one large depth atlas.
+        /// A spot light uses one tile, a point light six (one per cube face).
+        ///
+        /// The static casters are rendered in a second atlas, the cache, only when the
+        /// light or the static content changes. Refreshing a shadow view copies its
+        /// cached tile in the atlas and renders the dynamic casters on top.
+        /// At most `updates_per_frame` views are refreshed each frame: the ones with an
+        /// outdated cache first, then the ones refreshed the longest time ago.
+        class ShadowAtlas
+        {
+        public:
+            /// @brief Format of the atlas and of the cache
+            static constexpr VkFormat FORMAT = VK_FORMAT_D32_SFLOAT;
+            /// @brief Returned by `getLightViews` for a light without shadows
+            static constexpr uint32_t NO_SHADOW = UINT32_MAX;
+
+            /// @brief Push constants of the shadow pipeline (vertex stage)
+            struct PushConstants
+            {
+                /// @brief From world space to the clip space of the shadow view
+                glm::mat4 m_view_projection;
+                /// @brief From object space to world space, pushed by the caster recorder
+                glm::mat4 m_model;
+            };
+            /// @brief Records the draws of the shadow casters of a view. The shadow pipeline
+            /// and the view projection are already bound; the recorder binds its geometry and
+            /// pushes `PushConstants::m_model` (offset 64) for each draw.
+            /// @param command_buffer The command buffer being recorded
+            /// @param view_projection From world space to the clip space of the shadow view
+            /// @param static_casters If the static casters (true) or the dynamic ones (false) are requested
+            using CasterRecorder = std::function<void(VkCommandBuffer command_buffer, const glm::mat4& view_projection, const bool static_casters)>;
+
+            /// @brief Public constructor
+            ShadowAtlas();
+            /// @brief Public destructor
+            ~ShadowAtlas();
+            /// @brief Creates the atlas, the static cache, the render pass and the shadow pipeline
+            /// @param atlas_size The width and the height of the atlas, in pixels
+            /// @param tile_size The width and the height of a shadow view, in pixels
+            /// @param updates_per_frame The maximum number of shadow views refreshed each frame
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t atlas_size, const uint32_t tile_size, const uint32_t updates_per_frame);
+            /// @brief Sets the function that draws the shadow casters
+            void setCasterRecorder(CasterRecorder recorder);
+            /// @brief Marks the cache of every shadow view as outdated, e.g. when static
+            /// geometry has been added, removed or moved
+            void invalidateStatic() noexcept;
+            /// @brief Assigns tiles to the lights casting shadows (and releases the tiles of
+            /// the others), updates the shadow matrices, uploads them in the view space of the
+            /// camera, and records the refresh of the views picked for this frame.
+            /// Should be recorded outside of any render pass, before the scene.
+            /// @param command_buffer The command buffer being recorded
+            /// @param lights The lights of the scene, in world space
+            /// @param camera The point of view of the frame
+            void record(VkCommandBuffer command_buffer, const std::vector<Light>& lights, const app::graphics::Camera& camera);
+            /// @brief Returns the first shadow view of a light and its number of views,
+            /// or NO_SHADOW as the first view if the light has no tile
+            /// @param light_index The index of the light
+            glm::uvec2 getLightViews(const uint32_t light_index) const noexcept;
+            /// @brief Returns the atlas, in SHADER_READ_ONLY_OPTIMAL layout after `record`
+            std::shared_ptr<app::graphics::Attachment> getAtlas() const;
+            /// @brief Returns the comparison sampler to read the atlas with
+            VkSampler getSampler() const noexcept;
+            /// @brief Returns the buffer of the shadow views, as read by the shaders
+            std::shared_ptr<app::graphics::Buffer> getViewsBuffer() const;
+            /// @brief Returns the layout of the shadow pipeline, to push the model matrices
+            VkPipelineLayout getPipelineLayout() const noexcept;
+            /// @brief Returns the number of shadow views refreshed by the last `record`
+            uint32_t getUpdateCount() const noexcept;
+            /// @brief Returns the number of shadow views in use
+            uint32_t getViewCount() const noexcept;
+
+        private:
+            /// @brief A shadow view: a tile of the atlas, and its projection
+            struct View
+            {
+                /// @brief The light rendered in the tile, or NO_SHADOW if the tile is free
+                uint32_t m_light = NO_SHADOW;
+                /// @brief From world space to the clip space of the view
+                glm::mat4 m_view_projection = glm::mat4(1.0f);
+                /// @brief If the static casters have to be rendered again in the cache
+                bool m_static_dirty = true;
+                /// @brief The frame the view was last refreshed at
+                uint64_t m_last_update = 0;
+            };
+            /// @brief The tiles of a light casting shadows
+            struct LightViews
+            {
+                /// @brief The first tile
+                uint32_t m_first = NO_SHADOW;
+                /// @brief The number of tiles (1 for spot lights, 6 for point lights)
+                uint32_t m_count = 0;
+                /// @brief The values of the light the shadows were rendered for
+                glm::vec3 m_position = glm::vec3(0.0f);
+                glm::vec3 m_direction = glm::vec3(0.0f);
+                float m_radius = 0.0f;
+                float m_outer_angle = 0.0f;
+            };
+            /// @brief A shadow view, as read by the shaders (std430)
+            struct GpuView
+            {
+                /// @brief From the view space of the camera to the clip space of the shadow view
+                glm::mat4 m_view_to_clip;
+                /// @brief Offset (xy) and scale (zw) of the tile, in atlas UV units
+                glm::vec4 m_rect;
+            };
+            /// @brief ShadowAtlas should not be cloneable
+            ShadowAtlas(ShadowAtlas& other) = delete;
+            /// @brief ShadowAtlas should not be assignable
+            void operator=(const ShadowAtlas& other) = delete;
+            /// @brief Creates the render pass shared by the atlas and the cache
+            utils::VResult createRenderPass();
+            /// @brief Creates the depth-only pipeline of the shadow casters
+            utils::VResult createPipeline();
+            /// @brief Allocates `count` contiguous tiles, or returns NO_SHADOW if the atlas is full
+            uint32_t allocateTiles(const uint32_t count) noexcept;
+            /// @brief Releases the tiles of a light
+            void releaseTiles(const uint32_t light_index) noexcept;
+            /// @brief Returns the rectangle of a tile, in pixels
+            VkRect2D getTileRect(const uint32_t tile) const noexcept;
+            /// @brief Transitions the atlases from UNDEFINED, cleared to the far plane
+            void initialize(VkCommandBuffer command_buffer);
+            /// @brief Draws the casters of the given views, each in its tile, in a framebuffer
+            void drawCasters(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, const std::vector<uint32_t>& views, const bool static_casters);
+            /// @brief The shadow maps sampled by the scene
+            std::shared_ptr<app::graphics::Attachment> m_atlas = nullptr;
+            /// @brief The shadow maps of the static casters only
+            std::shared_ptr<app::graphics::Attachment> m_static_cache = nullptr;
+            /// @brief The shadow views, for each light, in view space (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_views_buffer = nullptr;
+            /// @brief Depth-only render pass, loading and storing the atlas (tiles are cleared
+            /// one by one)
+            VkRenderPass m_render_pass = VK_NULL_HANDLE;
+            /// @brief Framebuffer of the atlas
+            VkFramebuffer m_atlas_framebuffer = VK_NULL_HANDLE;
+            /// @brief Framebuffer of the static cache
+            VkFramebuffer m_static_framebuffer = VK_NULL_HANDLE;
+            /// @brief Layout of the shadow pipeline
+            VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+            /// @brief Depth-only pipeline, with a slope-scaled depth bias
+            VkPipeline m_pipeline = VK_NULL_HANDLE;
+            /// @brief Comparison sampler of the atlas (hardware 2x2 PCF)
+            VkSampler m_sampler = VK_NULL_HANDLE;
+            /// @brief Draws the shadow casters
+            CasterRecorder m_caster_recorder = nullptr;
+            /// @brief The tiles of the atlas
+            std::vector<View> m_views;
+            /// @brief The tiles of each light, indexed as the lights
+            std::vector<LightViews> m_light_views;
+            /// @brief The shadow views of the frame (staging for the upload)
+            std::vector<GpuView> m_gpu_views;
+            /// @brief The width and the height of the atlas, in pixels
+            uint32_t m_atlas_size = 0;
+            /// @brief The width and the height of a tile, in pixels
+            uint32_t m_tile_size = 0;
+            /// @brief The number of tiles on a row of the atlas
+            uint32_t m_tiles_per_row = 0;
+            /// @brief The maximum number of shadow views refreshed each frame
+            uint32_t m_updates_per_frame = 0;
+            /// @brief The number of shadow views refreshed by the last `record`
+            uint32_t m_update_count = 0;
+            /// @brief The number of recorded frames
+            uint64_t m_frame = 0;
+            /// @brief If the atlases have been transitioned from UNDEFINED
+            bool m_initialized = false;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // shadow_atlas_h
@@ -0,0 +1,234 @@
+//
+//  skinning.cpp
+//
+
+#include "skinning.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include <algorithm>
+#include <cstring>
+
+app::graphics::GpuSkinning::GpuSkinning(){};
+
+app::graphics::GpuSkinning::~GpuSkinning()
+{
+    m_pass = nullptr;
+    for (uint32_t slot = 0; slot < Project::FRAMES_IN_FLIGHT; ++slot)
+    {
+        m_palette_buffers[slot] = nullptr;
+        m_vertex_buffers[slot] = nullptr;
+    }
+    m_mesh_vertex_buffer = nullptr;
+    m_instance_buffer = nullptr;
+    m_meshes.clear();
+    m_instances.clear();
+    m_instance_meshes.clear();
+    m_joint_matrices.clear();
+};
+
+utils::VResult app::graphics::GpuSkinning::create(const uint32_t max_mesh_vertices, const uint32_t max_skinned_vertices, const uint32_t max_joints, const uint32_t max_instances)
+{
+    Log("> Creating the GPU skinning (%d mesh vertices, %d skinned vertices, %d joints, %d instances)",
+        max_mesh_vertices,
+        max_skinned_vertices,
+        max_joints,
+        max_instances);
+    m_max_mesh_vertices = max_mesh_vertices;
+    m_max_skinned_vertices = max_skinned_vertices;
+    m_max_joints = max_joints;
+    m_max_instances = max_instances;
+    m_instances.reserve(m_max_instances);
+    m_instance_meshes.reserve(m_max_instances);
+    m_joint_matrices.reserve(m_max_joints);
+
+    m_mesh_vertex_buffer = std::make_shared<app::graphics::Buffer>();
+    m_instance_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_mesh_vertex_buffer->create(std::max(m_max_mesh_vertices, 1u) * sizeof(GpuVertex), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    if (const auto result = m_instance_buffer->create(std::max(m_max_instances, 1u) * sizeof(GpuInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        return result;
+    for (uint32_t slot = 0; slot < Project::FRAMES_IN_FLIGHT; ++slot)
+    {
+        m_palette_buffers[slot] = std::make_shared<app::graphics::Buffer>();
+        if (const auto result = m_palette_buffers[slot]->create(std::max(m_max_joints, 1u) * sizeof(glm::mat4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true); result.IsError())
+        {
+            LogE("Error creating the joint palettes of the skinning");
+            return result;
+        }
+        m_vertex_buffers[slot] = std::make_shared<app::graphics::Buffer>();
+        if (const auto result = m_vertex_buffers[slot]->create(
+                static_cast<VkDeviceSize>(std::max(m_max_skinned_vertices, 1u)) * sizeof(app::shaders::Vertex),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                false);
+            result.IsError())
+        {
+            LogE("Error creating the skinned vertex buffers");
+            return result;
+        }
+    }
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Bind pose vertices
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Instances
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Joint palette
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}, // Skinned vertices
+    };
+    m_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_pass->create("shaders/skinning.comp.spv", bindings, 0, Project::FRAMES_IN_FLIGHT); result.IsError())
+    {
+        LogE("Error creating the skinning pass");
+        return result;
+    }
+    for (uint32_t slot = 0; slot < Project::FRAMES_IN_FLIGHT; ++slot)
+    {
+        m_pass->writeBuffer(slot, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_mesh_vertex_buffer);
+        m_pass->writeBuffer(slot, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_instance_buffer);
+        m_pass->writeBuffer(slot, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_palette_buffers[slot]);
+        m_pass->writeBuffer(slot, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_vertex_buffers[slot]);
+    }
+    return utils::VResult::Ok();
+}
+
+utils::Result<uint32_t> app::graphics::GpuSkinning::addMesh(const std::vector<SkinnedVertex>& vertices, const uint32_t joint_count)
+{
+    if (m_mesh_vertex_count + vertices.size() > m_max_mesh_vertices)
+    {
+        LogE("> The skinned mesh tables are full (%d vertices)", m_max_mesh_vertices);
+        return utils::Result<uint32_t>::Error((char*)"Too many vertices for the skinned mesh tables");
+    }
+    std::vector<GpuVertex> gpu_vertices;
+    gpu_vertices.reserve(vertices.size());
+    for (const SkinnedVertex& vertex : vertices)
+    {
+        // The unused influences may point anywhere: they are zeroed
+        glm::uvec4 joints = vertex.m_joints;
+        glm::vec4 weights = glm::max(vertex.m_weights, glm::vec4(0.0f));
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            if (weights[i] <= 0.0f)
+                joints[i] = 0;
+            else if (joints[i] >= joint_count)
+                return utils::Result<uint32_t>::Error((char*)"A vertex is influenced by a joint out of the skeleton");
+        }
+        const float weight_sum = weights.x + weights.y + weights.z + weights.w;
+        if (weight_sum <= 0.0f)
+            return utils::Result<uint32_t>::Error((char*)"A vertex is not influenced by any joint");
+        gpu_vertices.push_back(GpuVertex{
+            .m_position = glm::vec4(vertex.m_position, 1.0f),
+            .m_normal = glm::vec4(vertex.m_normal, 0.0f),
+            .m_color = glm::vec4(vertex.m_color, 1.0f),
+            .m_joints = joints,
+            .m_weights = weights / weight_sum,
+        });
+    }
+    m_meshes.push_back(Mesh{
+        .m_first_vertex = m_mesh_vertex_count,
+        .m_vertex_count = static_cast<uint32_t>(vertices.size()),
+        .m_joint_count = joint_count,
+    });
+    // Meshes are added at load time: no GPU pass reads the table yet
+    if (!gpu_vertices.empty())
+        m_mesh_vertex_buffer->write(gpu_vertices.data(), gpu_vertices.size() * sizeof(GpuVertex), m_mesh_vertex_count * sizeof(GpuVertex));
+    m_mesh_vertex_count += static_cast<uint32_t>(vertices.size());
+    return utils::Result<uint32_t>::Ok(static_cast<uint32_t>(m_meshes.size() - 1));
+}
+
+utils::Result<uint32_t> app::graphics::GpuSkinning::addInstance(const uint32_t mesh)
+{
+    assert(mesh < m_meshes.size());
+    const Mesh& skinned_mesh = m_meshes[mesh];
+    if (m_instances.size() >= m_max_instances ||
+        m_skinned_vertex_count + skinned_mesh.m_vertex_count > m_max_skinned_vertices ||
+        m_joint_matrices.size() + skinned_mesh.m_joint_count > m_max_joints)
+    {
+        LogE("> The skinned instance tables are full (%d instances, %d vertices, %d joints)", m_max_instances, m_max_skinned_vertices, m_max_joints);
+        return utils::Result<uint32_t>::Error((char*)"Too many skinned instances");
+    }
+    m_instances.push_back(GpuInstance{
+        .m_first_vertex = skinned_mesh.m_first_vertex,
+        .m_vertex_count = skinned_mesh.m_vertex_count,
+        .m_first_output = m_skinned_vertex_count,
+        .m_first_joint = static_cast<uint32_t>(m_joint_matrices.size()),
+    });
+    m_instance_meshes.push_back(mesh);
+    // The bind pose, until the first `setJoints`
+    m_joint_matrices.resize(m_joint_matrices.size() + skinned_mesh.m_joint_count, glm::mat4(1.0f));
+    m_skinned_vertex_count += skinned_mesh.m_vertex_count;
+    m_max_instance_vertices = std::max(m_max_instance_vertices, skinned_mesh.m_vertex_count);
+    // Appended: the frames in flight only read the previous instances
+    m_instance_buffer->write(&m_instances.back(), sizeof(GpuInstance), (m_instances.size() - 1) * sizeof(GpuInstance));
+    return utils::Result<uint32_t>::Ok(static_cast<uint32_t>(m_instances.size() - 1));
+}
+
+void app::graphics::GpuSkinning::setJoints(const uint32_t instance, const glm::mat4* joint_matrices)
+{
+    assert(instance < m_instances.size());
+    const uint32_t joint_count = m_meshes[m_instance_meshes[instance]].m_joint_count;
+    if (joint_count > 0)
+        std::memcpy(&m_joint_matrices[m_instances[instance].m_first_joint], joint_matrices, joint_count * sizeof(glm::mat4));
+}
+
+void app::graphics::GpuSkinning::record(VkCommandBuffer command_buffer)
+{
+    if (m_instances.empty())
+        return;
+    // The palette and the vertices of the frame before the previous one are not read anymore
+    m_slot = (m_slot + 1) % Project::FRAMES_IN_FLIGHT;
+    m_recorded_instances = static_cast<uint32_t>(m_instances.size());
+    if (!m_joint_matrices.empty())
+        m_palette_buffers[m_slot]->write(m_joint_matrices.data(), m_joint_matrices.size() * sizeof(glm::mat4));
+
+    // The draws of the frame before the previous one are done reading the vertex buffer
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        0, nullptr);
+    // One row of workgroups per instance
+    m_pass->dispatch(
+        command_buffer,
+        m_slot,
+        nullptr,
+        app::graphics::ComputePass::getGroupCount(m_max_instance_vertices, GROUP_SIZE),
+        m_recorded_instances);
+
+    VkMemoryBarrier after_skinning{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        0,
+        1, &after_skinning,
+        0, nullptr,
+        0, nullptr);
+}
+
+void app::graphics::GpuSkinning::draw(VkCommandBuffer command_buffer) const
+{
+    // The instances added since the last `record` have no skinned vertices yet
+    if (0 == m_recorded_instances)
+        return;
+    const VkBuffer vertex_buffer = getVertexBuffer()->getBuffer();
+    const VkDeviceSize memory_offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, &memory_offset);
+    for (uint32_t instance = 0; instance < m_recorded_instances; ++instance)
+        vkCmdDraw(command_buffer, m_instances[instance].m_vertex_count, 1, getVertexOffset(instance), 0);
+}
+
+std::shared_ptr<app::graphics::Buffer> app::graphics::GpuSkinning::getVertexBuffer() const noexcept
+{
+    return m_vertex_buffers[m_slot];
+}
+
+uint32_t app::graphics::GpuSkinning::getVertexOffset(const uint32_t instance) const
+{
+    assert(instance < m_instances.size());
+    return m_instances[instance].m_first_output;
+}
@@ -0,0 +1,179 @@
+//
+//  skinning.hpp
+//
+
+#pragma once
+#ifndef skinning_h
+#define skinning_h
+
+#include "../project.hpp"
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include "compute.hpp"
+#include "shaders.h"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief A vertex of a skinned mesh, in its bind pose
+        struct SkinnedVertex
+        {
+            /// @brief The position, in mesh units
+            glm::vec3 m_position = glm::vec3(0.0f);
+            /// @brief The normal
+            glm::vec3 m_normal = glm::vec3(0.0f, 0.0f, 1.0f);
+            /// @brief The color, shaded by the skinned normal
+            glm::vec3 m_color = glm::vec3(1.0f);
+            /// @brief The joints influencing the vertex, in the joints of the mesh
+            glm::uvec4 m_joints = glm::uvec4(0);
+            /// @brief The weights of the joints (normalized by `addMesh`)
+            glm::vec4 m_weights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        };
+
+        /// @brief Skins the mesh instances on the GPU, once per frame.
+        ///
+        /// The CPU only evaluates the joint matrices of the instances (`setJoints`): they
+        /// are copied each frame into a persistently mapped palette, and a compute pass
+        /// writes the skinned vertices of all the instances into the vertex buffer of the
+        /// frame, in the layout of the scene vertices (`app::shaders::Vertex`). Every pass
+        /// of the frame (shadows, depth pre-pass, main) then draws the same skinned
+        /// vertices with its own pipeline (`draw`): nothing is skinned twice.
+        /// One vertex buffer per frame in flight: a frame does not overwrite the vertices
+        /// the previous one may still be drawing.
+        class GpuSkinning
+        {
+        public:
+            /// @brief The number of vertices skinned by a workgroup
+            static constexpr uint32_t GROUP_SIZE = 64;
+
+            /// @brief Public constructor
+            GpuSkinning();
+            /// @brief Public destructor
+            ~GpuSkinning();
+            /// @brief Creates the vertex tables, the palettes, and the skinning pass
+            /// @param max_mesh_vertices The maximum number of bind pose vertices of all the meshes
+            /// @param max_skinned_vertices The maximum number of skinned vertices of all the instances
+            /// @param max_joints The maximum number of joints of all the instances
+            /// @param max_instances The maximum number of instances
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t max_mesh_vertices, const uint32_t max_skinned_vertices, const uint32_t max_joints, const uint32_t max_instances);
+            /// @brief Registers a skinned mesh
+            /// @param vertices The vertices of the mesh, in its bind pose (a triangle list)
+            /// @param joint_count The number of joints of the skeleton of the mesh
+            /// @return The identifier of the mesh, or an error if a joint is out of the
+            /// skeleton or if the tables are full
+            utils::Result<uint32_t> addMesh(const std::vector<SkinnedVertex>& vertices, const uint32_t joint_count);
+            /// @brief Adds an instance of a skinned mesh, with its own pose and vertices
+            /// @param mesh The identifier returned by `addMesh`
+            /// @return The identifier of the instance, or an error if the tables are full
+            utils::Result<uint32_t> addInstance(const uint32_t mesh);
+            /// @brief Sets the pose of an instance, kept until the next call
+            /// @param instance The identifier returned by `addInstance`
+            /// @param joint_matrices The skinning matrices of the joints of the mesh (the
+            /// pose of a joint times its inverse bind matrix), as many as its joint count
+            void setJoints(const uint32_t instance, const glm::mat4* joint_matrices);
+            /// @brief Uploads the poses, and skins the vertices of all the instances in the
+            /// vertex buffer of the frame.
+            /// Should be recorded outside of any render pass, before the passes that draw
+            /// the skinned instances.
+            /// @param command_buffer The command buffer being recorded
+            void record(VkCommandBuffer command_buffer);
+            /// @brief Draws the instances skinned by the last `record`, with the bound pipeline
+            /// and push constants: binds the vertex buffer of the frame, and draws each
+            /// instance from its vertex offset.
+            /// @param command_buffer The command buffer being recorded, in a render pass
+            void draw(VkCommandBuffer command_buffer) const;
+            /// @brief Returns the vertices skinned by the last `record` (app::shaders::Vertex)
+            std::shared_ptr<app::graphics::Buffer> getVertexBuffer() const noexcept;
+            /// @brief Returns the first vertex of an instance in the vertex buffers: the
+            /// vertex offset of its draws
+            /// @param instance The identifier returned by `addInstance`
+            uint32_t getVertexOffset(const uint32_t instance) const;
+
+        private:
+            /// @brief A bind pose vertex, as read by the skinning pass (std430)
+            struct GpuVertex
+            {
+                /// @brief The position (w unused)
+                glm::vec4 m_position;
+                /// @brief The normal (w unused)
+                glm::vec4 m_normal;
+                /// @brief The color (w unused)
+                glm::vec4 m_color;
+                /// @brief The joints, in the joints of the mesh
+                glm::uvec4 m_joints;
+                /// @brief The weights of the joints
+                glm::vec4 m_weights;
+            };
+            /// @brief An instance, as read by the skinning pass (std430)
+            struct GpuInstance
+            {
+                /// @brief The first bind pose vertex of the mesh
+                uint32_t m_first_vertex;
+                /// @brief The number of vertices of the mesh
+                uint32_t m_vertex_count;
+                /// @brief The first skinned vertex of the instance
+                uint32_t m_first_output;
+                /// @brief The first joint of the instance in the palette
+                uint32_t m_first_joint;
+            };
+            /// @brief A mesh: its range of bind pose vertices, and its skeleton size
+            struct Mesh
+            {
+                /// @brief The first vertex of the mesh
+                uint32_t m_first_vertex;
+                /// @brief The number of vertices of the mesh
+                uint32_t m_vertex_count;
+                /// @brief The number of joints of the skeleton
+                uint32_t m_joint_count;
+            };
+            /// @brief GpuSkinning should not be cloneable
+            GpuSkinning(GpuSkinning& other) = delete;
+            /// @brief GpuSkinning should not be assignable
+            void operator=(const GpuSkinning& other) = delete;
+            /// @brief The meshes
+            std::vector<Mesh> m_meshes;
+            /// @brief The instances
+            std::vector<GpuInstance> m_instances;
+            /// @brief The mesh of each instance
+            std::vector<uint32_t> m_instance_meshes;
+            /// @brief The skinning matrices of all the instances, copied each frame to the palette
+            std::vector<glm::mat4> m_joint_matrices;
+            /// @brief The number of bind pose vertices of all the meshes
+            uint32_t m_mesh_vertex_count = 0;
+            /// @brief The number of skinned vertices of all the instances
+            uint32_t m_skinned_vertex_count = 0;
+            /// @brief The largest number of vertices of an instance
+            uint32_t m_max_instance_vertices = 0;
+            /// @brief The maximum number of bind pose vertices of all the meshes
+            uint32_t m_max_mesh_vertices = 0;
+            /// @brief The maximum number of skinned vertices of all the instances
+            uint32_t m_max_skinned_vertices = 0;
+            /// @brief The maximum number of joints of all the instances
+            uint32_t m_max_joints = 0;
+            /// @brief The maximum number of instances
+            uint32_t m_max_instances = 0;
+            /// @brief The bind pose vertices (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_mesh_vertex_buffer = nullptr;
+            /// @brief The instances (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_instance_buffer = nullptr;
+            /// @brief The joint palettes, one per frame (host-visible, persistently mapped)
+            std::shared_ptr<app::graphics::Buffer> m_palette_buffers[Project::FRAMES_IN_FLIGHT] = {};
+            /// @brief The skinned vertices, one buffer per frame
+            std::shared_ptr<app::graphics::Buffer> m_vertex_buffers[Project::FRAMES_IN_FLIGHT] = {};
+            /// @brief The skinning pass, with a descriptor set per frame
+            std::shared_ptr<app::graphics::ComputePass> m_pass = nullptr;
+            /// @brief The slot of the last recorded frame
+            uint32_t m_slot = 0;
+            /// @brief The number of instances skinned by the last `record`
+            uint32_t m_recorded_instances = 0;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // skinning_h
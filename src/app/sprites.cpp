@@ -0,0 +1,593 @@
+//
+//  sprites.cpp
+//
+
+#include "sprites.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include "pipeline.hpp"
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+
+/// @brief The number of vertices of a quad
+constexpr uint32_t QUAD_VERTEX_COUNT = 4;
+/// @brief The number of indices of a quad: two triangles
+constexpr uint32_t QUAD_INDEX_COUNT = 6;
+
+app::graphics::SpriteBatcher::SpriteBatcher(){};
+
+app::graphics::SpriteBatcher::~SpriteBatcher()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    if (VK_NULL_HANDLE != m_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_pipeline_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_pipeline_layout, nullptr);
+        m_pipeline_layout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_descriptor_set)
+    {
+        vkFreeDescriptorSets(graphics_device, app::Engine::getInstance()->getDescriptorPool(), 1, &m_descriptor_set);
+        m_descriptor_set = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_descriptor_set_layout)
+    {
+        vkDestroyDescriptorSetLayout(graphics_device, m_descriptor_set_layout, nullptr);
+        m_descriptor_set_layout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_sampler)
+    {
+        vkDestroySampler(graphics_device, m_sampler, nullptr);
+        m_sampler = VK_NULL_HANDLE;
+    }
+    for (uint32_t slot = 0; slot < Project::FRAMES_IN_FLIGHT; ++slot)
+        m_vertex_buffers[slot] = nullptr;
+    m_index_buffer = nullptr;
+    m_index_staging = nullptr;
+    m_pending_uploads.clear();
+    m_retired_staging.clear();
+    m_textures = nullptr;
+    m_quads.clear();
+    m_sort_keys.clear();
+};
+
+utils::VResult app::graphics::SpriteBatcher::create(const uint32_t max_sprites, const uint32_t texture_size, const uint32_t texture_layers)
+{
+    Log("> Creating the sprite batcher (%d sprites, %d textures of %dx%d)", max_sprites, texture_layers, texture_size, texture_size);
+    m_max_sprites = max_sprites;
+    m_texture_size = texture_size;
+    // An array view even for a single texture: the shader reads a sampler2DArray
+    m_textures = std::make_shared<app::graphics::Attachment>();
+    if (const auto result = m_textures->create(
+            VkExtent2D{m_texture_size, m_texture_size},
+            TEXTURE_FORMAT,
+            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_SAMPLE_COUNT_1_BIT,
+            std::max(texture_layers, 2u));
+        result.IsError())
+    {
+        LogE("Error creating the texture array of the sprites");
+        return result;
+    }
+    m_texture_scales.reserve(m_textures->getLayers());
+
+    for (uint32_t slot = 0; slot < Project::FRAMES_IN_FLIGHT; ++slot)
+    {
+        m_vertex_buffers[slot] = std::make_shared<app::graphics::Buffer>();
+        if (const auto result = m_vertex_buffers[slot]->create(
+                static_cast<VkDeviceSize>(m_max_sprites) * QUAD_VERTEX_COUNT * sizeof(Vertex),
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                true);
+            result.IsError())
+        {
+            LogE("Error creating the vertex buffers of the sprites");
+            return result;
+        }
+    }
+
+    // The same two triangles for every quad: written once, copied at the first `prepare`.
+    // 32-bit indices: more than 16384 quads do not fit in 16 bits
+    const VkDeviceSize index_buffer_size = static_cast<VkDeviceSize>(m_max_sprites) * QUAD_INDEX_COUNT * sizeof(uint32_t);
+    m_index_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_index_buffer->create(index_buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false); result.IsError())
+    {
+        LogE("Error creating the index buffer of the sprites");
+        return result;
+    }
+    m_index_staging = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_index_staging->create(index_buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true); result.IsError())
+        return result;
+    uint32_t* indices = static_cast<uint32_t*>(m_index_staging->getMappedData());
+    for (uint32_t quad = 0; quad < m_max_sprites; ++quad)
+    {
+        const uint32_t first_vertex = quad * QUAD_VERTEX_COUNT;
+        indices[quad * QUAD_INDEX_COUNT + 0] = first_vertex + 0;
+        indices[quad * QUAD_INDEX_COUNT + 1] = first_vertex + 1;
+        indices[quad * QUAD_INDEX_COUNT + 2] = first_vertex + 2;
+        indices[quad * QUAD_INDEX_COUNT + 3] = first_vertex + 2;
+        indices[quad * QUAD_INDEX_COUNT + 4] = first_vertex + 3;
+        indices[quad * QUAD_INDEX_COUNT + 5] = first_vertex + 0;
+    }
+    m_index_staging->flush(index_buffer_size);
+
+    m_quads.reserve(m_max_sprites);
+    m_sort_keys.reserve(m_max_sprites);
+
+    VkSamplerCreateInfo sampler_create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .compareEnable = VK_FALSE,
+        .maxLod = 0.0f,
+    };
+    if (const auto result = vkCreateSampler(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &sampler_create_info, nullptr, &m_sampler); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateSampler: error 0x%08x for the sprites", result);
+        return utils::VResult::Error((char*)"Cannot create the sampler of the sprites");
+    }
+
+    return createPipeline();
+}
+
+utils::VResult app::graphics::SpriteBatcher::createPipeline()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+
+    const VkDescriptorSetLayoutBinding binding{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
+    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings = &binding,
+    };
+    if (const auto result = vkCreateDescriptorSetLayout(graphics_device, &descriptor_set_layout_create_info, nullptr, &m_descriptor_set_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateDescriptorSetLayout: error 0x%08x for the sprites", result);
+        return utils::VResult::Error((char*)"Cannot create the descriptor set layout of the sprites");
+    }
+    VkDescriptorSetAllocateInfo allocate_info{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = app::Engine::getInstance()->getDescriptorPool(),
+        .descriptorSetCount = 1,
+        .pSetLayouts = &m_descriptor_set_layout,
+    };
+    if (const auto result = vkAllocateDescriptorSets(graphics_device, &allocate_info, &m_descriptor_set); result != VK_SUCCESS)
+    {
+        m_descriptor_set = VK_NULL_HANDLE;
+        LogE("> vkAllocateDescriptorSets: error 0x%08x for the sprites", result);
+        return utils::VResult::Error((char*)"Cannot allocate the descriptor set of the sprites");
+    }
+    VkDescriptorImageInfo image_info{
+        .sampler = m_sampler,
+        .imageView = m_textures->getImageView(),
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptor_set,
+        .dstBinding = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &image_info,
+    };
+    vkUpdateDescriptorSets(graphics_device, 1, &write, 0, nullptr);
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_descriptor_set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+    if (const auto result = vkCreatePipelineLayout(graphics_device, &pipeline_layout_create_info, nullptr, &m_pipeline_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for the sprites", result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the sprites");
+    }
+
+    const char* shader_filepaths[2] = {"shaders/sprite.vert.spv", "shaders/sprite.frag.spv"};
+    const VkShaderStageFlagBits shader_stages[2] = {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT};
+    VkShaderModule shader_modules[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkPipelineShaderStageCreateInfo shader_stage_create_infos[2];
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        const auto shader_module_result = app::graphics::Pipeline::loadShaderModule(shader_filepaths[i]);
+        if (shader_module_result.IsError())
+        {
+            if (VK_NULL_HANDLE != shader_modules[0])
+                vkDestroyShaderModule(graphics_device, shader_modules[0], nullptr);
+            return utils::VResult::Error((char*)"Cannot create the shader modules of the sprites");
+        }
+        shader_modules[i] = shader_module_result.GetValue();
+        shader_stage_create_infos[i] = VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = shader_stages[i],
+            .module = shader_modules[i],
+            .pName = "main",
+        };
+    }
+
+    const VkVertexInputBindingDescription vertex_binding_description{
+        .binding = 0,
+        .stride = sizeof(Vertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+    const VkVertexInputAttributeDescription vertex_attribute_descriptions[4] = {
+        {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, m_position)},
+        {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, m_uv)},
+        {2, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Vertex, m_color)},
+        {3, 0, VK_FORMAT_R32_UINT, offsetof(Vertex, m_texture)},
+    };
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &vertex_binding_description,
+        .vertexAttributeDescriptionCount = 4,
+        .pVertexAttributeDescriptions = vertex_attribute_descriptions,
+    };
+    VkPipelineInputAssemblyStateCreateInfo assembly_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    // Mirrored quads (negative scales) are drawn too
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+    };
+    // No depth in the UI render pass: the sort gives the order
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_FALSE,
+        .depthWriteEnable = VK_FALSE,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    VkPipelineColorBlendAttachmentState color_blend_attachment{
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+    };
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 1,
+        .pAttachments = &color_blend_attachment,
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 2,
+        .pStages = shader_stage_create_infos,
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &assembly_state_create_info,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_pipeline_layout,
+        .renderPass = app::Engine::getInstance()->m_render->getGraphicsPipeline()->getUIRenderPass(),
+        .subpass = 0,
+    };
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_pipeline);
+    // The modules are not needed anymore once the pipeline is created
+    for (uint32_t i = 0; i < 2; ++i)
+        vkDestroyShaderModule(graphics_device, shader_modules[i], nullptr);
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the sprites", pipeline_result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline of the sprites");
+    }
+    return utils::VResult::Ok();
+}
+
+utils::Result<uint32_t> app::graphics::SpriteBatcher::uploadTexture(const uint8_t* pixels, const uint32_t width, const uint32_t height)
+{
+    if (nullptr == m_textures || m_texture_scales.size() >= m_textures->getLayers())
+        return utils::Result<uint32_t>::Error((char*)"No texture layer left for the sprites");
+    if (0 == width || 0 == height || width > m_texture_size || height > m_texture_size)
+        return utils::Result<uint32_t>::Error((char*)"The sprite texture does not fit in a layer of the texture array");
+    const VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+    auto staging = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = staging->create(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true); result.IsError())
+        return utils::Result<uint32_t>::Error((char*)"Cannot create the staging buffer of a sprite texture");
+    staging->write(pixels, size);
+
+    const uint32_t layer = static_cast<uint32_t>(m_texture_scales.size());
+    // The texture lies in the top-left corner of its layer
+    m_texture_scales.push_back(glm::vec2(width, height) / static_cast<float>(m_texture_size));
+    m_pending_uploads.push_back(Upload{
+        .m_staging = staging,
+        .m_layer = layer,
+        .m_extent = VkExtent2D{width, height},
+    });
+    return utils::Result<uint32_t>::Ok(layer);
+}
+
+void app::graphics::SpriteBatcher::draw(const Sprite& sprite)
+{
+    const float c = glm::cos(sprite.m_rotation);
+    const float s = glm::sin(sprite.m_rotation);
+    // Columns: the X and Y axes of the quad, then its center (Y down on screen)
+    const glm::mat3 transform(
+        glm::vec3(c * sprite.m_size.x, s * sprite.m_size.x, 0.0f),
+        glm::vec3(-s * sprite.m_size.y, c * sprite.m_size.y, 0.0f),
+        glm::vec3(sprite.m_position, 1.0f));
+    drawQuad(transform, sprite.m_uv, sprite.m_color, sprite.m_texture, sprite.m_layer);
+}
+
+void app::graphics::SpriteBatcher::drawQuad(const glm::mat3& transform, const glm::vec4& uv, const glm::vec4& color, const uint32_t texture, const int16_t layer)
+{
+    if (m_quads.size() >= m_max_sprites)
+    {
+        // Reported once per frame, by record
+        ++m_dropped_sprites;
+        return;
+    }
+    const bool textured = texture < m_texture_scales.size();
+    const glm::vec2 uv_scale = textured ? m_texture_scales[texture] : glm::vec2(1.0f);
+    Quad quad{
+        .m_uv = uv * glm::vec4(uv_scale, uv_scale),
+        .m_color = glm::packUnorm4x8(color),
+        .m_texture = textured ? texture : NO_TEXTURE,
+    };
+    quad.m_corners[0] = glm::vec2(transform * glm::vec3(-0.5f, -0.5f, 1.0f));
+    quad.m_corners[1] = glm::vec2(transform * glm::vec3(0.5f, -0.5f, 1.0f));
+    quad.m_corners[2] = glm::vec2(transform * glm::vec3(0.5f, 0.5f, 1.0f));
+    quad.m_corners[3] = glm::vec2(transform * glm::vec3(-0.5f, 0.5f, 1.0f));
+    // Layer (biased to sort the negative ones first), texture, then submission order:
+    // the keys are unique, so an unstable sort keeps the submission order
+    const uint64_t sort_key = (static_cast<uint64_t>(static_cast<uint16_t>(layer + 0x8000)) << 48) |
+                              (static_cast<uint64_t>(quad.m_texture & 0xFFFF) << 32) |
+                              static_cast<uint64_t>(m_quads.size());
+    m_sort_keys.push_back(sort_key);
+    m_quads.push_back(quad);
+}
+
+uint32_t app::graphics::SpriteBatcher::getSpriteCount() const noexcept
+{
+    return static_cast<uint32_t>(m_quads.size());
+}
+
+void app::graphics::SpriteBatcher::prepare(VkCommandBuffer command_buffer)
+{
+    // The copies of the previous frame are complete
+    m_retired_staging.clear();
+    if (m_initialized && m_pending_uploads.empty())
+        return;
+
+    const VkImageSubresourceRange texture_range{
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = m_textures->getLayers(),
+    };
+    VkImageMemoryBarrier to_transfer_dst{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = m_initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = m_textures->getImage(),
+        .subresourceRange = texture_range,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &to_transfer_dst);
+
+    if (!m_initialized)
+    {
+        // The bilinear filter reads transparent texels around the textures smaller than a layer
+        const VkClearColorValue transparent{{0.0f, 0.0f, 0.0f, 0.0f}};
+        vkCmdClearColorImage(command_buffer, m_textures->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &transparent, 1, &texture_range);
+
+        const VkBufferCopy index_copy{
+            .srcOffset = 0,
+            .dstOffset = 0,
+            .size = m_index_buffer->getSize(),
+        };
+        vkCmdCopyBuffer(command_buffer, m_index_staging->getBuffer(), m_index_buffer->getBuffer(), 1, &index_copy);
+        VkBufferMemoryBarrier to_index_read{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INDEX_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = m_index_buffer->getBuffer(),
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        };
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0,
+            0, nullptr,
+            1, &to_index_read,
+            0, nullptr);
+        m_retired_staging.push_back(m_index_staging);
+        m_index_staging = nullptr;
+        // The clear has to land before the copies of the textures
+        VkMemoryBarrier clear_to_copy{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        };
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            1, &clear_to_copy,
+            0, nullptr,
+            0, nullptr);
+    }
+
+    for (const auto& upload : m_pending_uploads)
+    {
+        const VkBufferImageCopy copy{
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = upload.m_layer,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {upload.m_extent.width, upload.m_extent.height, 1},
+        };
+        vkCmdCopyBufferToImage(command_buffer, upload.m_staging->getBuffer(), m_textures->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+        m_retired_staging.push_back(upload.m_staging);
+    }
+    m_pending_uploads.clear();
+
+    VkImageMemoryBarrier to_shader_read{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = m_textures->getImage(),
+        .subresourceRange = texture_range,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &to_shader_read);
+    m_initialized = true;
+}
+
+void app::graphics::SpriteBatcher::record(VkCommandBuffer command_buffer, const VkExtent2D& extent)
+{
+    if (m_dropped_sprites > 0)
+    {
+        LogW("> More sprites than the maximum of %d: %d sprites are ignored this frame", m_max_sprites, m_dropped_sprites);
+        m_dropped_sprites = 0;
+    }
+    if (m_quads.empty() || !m_initialized)
+    {
+        m_quads.clear();
+        m_sort_keys.clear();
+        return;
+    }
+    std::sort(m_sort_keys.begin(), m_sort_keys.end());
+
+    // Sequential writes only, straight to the mapped memory of this frame
+    const auto vertex_buffer = m_vertex_buffers[m_slot];
+    Vertex* vertices = static_cast<Vertex*>(vertex_buffer->getMappedData());
+    for (const uint64_t sort_key : m_sort_keys)
+    {
+        const Quad& quad = m_quads[static_cast<uint32_t>(sort_key & 0xFFFFFFFF)];
+        const glm::vec2 uvs[QUAD_VERTEX_COUNT] = {
+            glm::vec2(quad.m_uv.x, quad.m_uv.y),
+            glm::vec2(quad.m_uv.z, quad.m_uv.y),
+            glm::vec2(quad.m_uv.z, quad.m_uv.w),
+            glm::vec2(quad.m_uv.x, quad.m_uv.w),
+        };
+        for (uint32_t i = 0; i < QUAD_VERTEX_COUNT; ++i)
+        {
+            *vertices++ = Vertex{
+                .m_position = quad.m_corners[i],
+                .m_uv = uvs[i],
+                .m_color = quad.m_color,
+                .m_texture = quad.m_texture,
+            };
+        }
+    }
+    const uint32_t quad_count = static_cast<uint32_t>(m_quads.size());
+    vertex_buffer->flush(static_cast<VkDeviceSize>(quad_count) * QUAD_VERTEX_COUNT * sizeof(Vertex));
+
+    // From pixels (top-left origin) to NDC
+    const PushConstants push_constants{
+        .m_scale = glm::vec2(2.0f / static_cast<float>(extent.width), 2.0f / static_cast<float>(extent.height)),
+        .m_offset = glm::vec2(-1.0f),
+    };
+    VkViewport viewport{
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = extent,
+    };
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &m_descriptor_set, 0, nullptr);
+    vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &push_constants);
+    const VkBuffer vertex_buffer_handle = vertex_buffer->getBuffer();
+    const VkDeviceSize vertex_offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer_handle, &vertex_offset);
+    vkCmdBindIndexBuffer(command_buffer, m_index_buffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    // The whole batch at once: the texture of each quad is in its vertices
+    vkCmdDrawIndexed(command_buffer, quad_count * QUAD_INDEX_COUNT, 1, 0, 0, 0);
+
+    m_slot = (m_slot + 1) % Project::FRAMES_IN_FLIGHT;
+    m_quads.clear();
+    m_sort_keys.clear();
+}
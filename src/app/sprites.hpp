@@ -0,0 +1,193 @@
+//
+//  sprites.hpp
+//
+
+#pragma once
+#ifndef sprites_h
+#define sprites_h
+
+#include "../project.hpp"
+#include "../utils/result.h"
+#include "attachment.hpp"
+#include "buffer.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Draws 2D quads (HUD, overlays, markers) on top of the scene, at the
+        /// native resolution, in the UI render pass before ImGui.
+        ///
+        /// The quads submitted during a frame are sorted by layer (painter's order), then
+        /// by texture, and written in the vertex buffer of the frame: a host-visible ring
+        /// of FRAMES_IN_FLIGHT slots, filled once per frame with sequential writes.
+        /// All the textures are layers of a single array image, so the texture of a quad
+        /// is a vertex attribute: the whole batch is a single indexed draw, whatever the
+        /// number of textures, with a static index buffer shared by all the quads.
+        class SpriteBatcher
+        {
+        public:
+            /// @brief Format of the texture array: the colors are decoded to linear
+            /// when sampled, and encoded again by the sRGB swapchain
+            static constexpr VkFormat TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+            /// @brief The texture of the quads with a plain color
+            static constexpr uint32_t NO_TEXTURE = 0xFFFF;
+
+            /// @brief A sprite: a textured quad, rotated around its center
+            struct Sprite
+            {
+                /// @brief The center of the quad, in pixels from the top-left corner
+                glm::vec2 m_position = glm::vec2(0.0f);
+                /// @brief The width and the height of the quad, in pixels
+                glm::vec2 m_size = glm::vec2(1.0f);
+                /// @brief The rotation around the center, in radians (clockwise on screen)
+                float m_rotation = 0.0f;
+                /// @brief The part of the texture to map: top-left (xy) and bottom-right (zw)
+                /// UV, from 0 to 1 over the uploaded texture
+                glm::vec4 m_uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+                /// @brief Multiplies the texture (linear RGB, alpha)
+                glm::vec4 m_color = glm::vec4(1.0f);
+                /// @brief The texture returned by `uploadTexture`, or NO_TEXTURE
+                uint32_t m_texture = NO_TEXTURE;
+                /// @brief The draw order: the lower layers are drawn first, below the others
+                int16_t m_layer = 0;
+            };
+
+            /// @brief Public constructor
+            SpriteBatcher();
+            /// @brief Public destructor
+            ~SpriteBatcher();
+            /// @brief Creates the texture array, the vertex and index buffers and the pipeline.
+            /// Should be called once the UI render pass is created.
+            /// @param max_sprites The maximum number of quads per frame
+            /// @param texture_size The width and the height of a layer of the texture array
+            /// @param texture_layers The maximum number of textures
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t max_sprites, const uint32_t texture_size, const uint32_t texture_layers);
+            /// @brief Copies a texture to the next free layer of the texture array. The copy
+            /// is recorded by the next `prepare`.
+            /// @param pixels The RGBA8 pixels (sRGB), row by row, without padding
+            /// @param width The width of the texture, up to the size of a layer
+            /// @param height The height of the texture, up to the size of a layer
+            /// @return The identifier of the texture, to set in the sprites
+            utils::Result<uint32_t> uploadTexture(const uint8_t* pixels, const uint32_t width, const uint32_t height);
+            /// @brief Submits a sprite for this frame
+            void draw(const Sprite& sprite);
+            /// @brief Submits a quad for this frame, with any 2D affine transform (ignored past
+            /// SPRITE_MAX_COUNT quads, with a warning at the next `record`)
+            /// @param transform From the unit quad (-0.5 to 0.5 on both axes) to pixels
+            /// @param uv The part of the texture to map: top-left (xy) and bottom-right (zw)
+            /// @param color Multiplies the texture
+            /// @param texture The texture returned by `uploadTexture`, or NO_TEXTURE
+            /// @param layer The draw order
+            void drawQuad(const glm::mat3& transform, const glm::vec4& uv, const glm::vec4& color, const uint32_t texture, const int16_t layer);
+            /// @brief Returns the number of quads submitted for this frame
+            uint32_t getSpriteCount() const noexcept;
+            /// @brief Records the pending uploads (textures, index buffer).
+            /// Should be recorded outside of any render pass, once the fence of the
+            /// previous frame has been waited.
+            /// @param command_buffer The command buffer being recorded
+            void prepare(VkCommandBuffer command_buffer);
+            /// @brief Sorts the quads of this frame, writes them in the vertex buffer of the
+            /// frame and records their draw, then forgets them.
+            /// Should be recorded in the UI render pass.
+            /// @param command_buffer The command buffer being recorded
+            /// @param extent The extent of the UI render pass
+            void record(VkCommandBuffer command_buffer, const VkExtent2D& extent);
+
+        private:
+            /// @brief A vertex of a quad, as read by the vertex shader
+            struct Vertex
+            {
+                /// @brief In pixels from the top-left corner
+                glm::vec2 m_position;
+                /// @brief In the texture array layer
+                glm::vec2 m_uv;
+                /// @brief RGBA8, linear
+                uint32_t m_color;
+                /// @brief The layer of the texture array, or NO_TEXTURE
+                uint32_t m_texture;
+            };
+            /// @brief A submitted quad, transformed
+            struct Quad
+            {
+                /// @brief The corners, in pixels: top-left, top-right, bottom-right, bottom-left
+                glm::vec2 m_corners[4];
+                /// @brief Top-left (xy) and bottom-right (zw) UV, in the texture array layer
+                glm::vec4 m_uv;
+                /// @brief RGBA8, linear
+                uint32_t m_color;
+                /// @brief The layer of the texture array, or NO_TEXTURE
+                uint32_t m_texture;
+            };
+            /// @brief A texture waiting to be copied to its layer
+            struct Upload
+            {
+                /// @brief The pixels (host-visible)
+                std::shared_ptr<app::graphics::Buffer> m_staging;
+                /// @brief The destination layer
+                uint32_t m_layer;
+                /// @brief The size of the texture, in pixels
+                VkExtent2D m_extent;
+            };
+            /// @brief The push constants of the sprite pipeline (vertex stage)
+            struct PushConstants
+            {
+                /// @brief From pixels to NDC: scale
+                glm::vec2 m_scale;
+                /// @brief From pixels to NDC: offset
+                glm::vec2 m_offset;
+            };
+            /// @brief SpriteBatcher should not be cloneable
+            SpriteBatcher(SpriteBatcher& other) = delete;
+            /// @brief SpriteBatcher should not be assignable
+            void operator=(const SpriteBatcher& other) = delete;
+            /// @brief Creates the descriptor set of the texture array, and the pipeline
+            utils::VResult createPipeline();
+            /// @brief The texture array
+            std::shared_ptr<app::graphics::Attachment> m_textures = nullptr;
+            /// @brief The scale from the UV of a texture to the UV of its layer
+            std::vector<glm::vec2> m_texture_scales;
+            /// @brief The vertex buffers of the frames (host-visible): 4 vertices per quad
+            std::shared_ptr<app::graphics::Buffer> m_vertex_buffers[Project::FRAMES_IN_FLIGHT] = {};
+            /// @brief The index buffer: 6 indices per quad (device-local)
+            std::shared_ptr<app::graphics::Buffer> m_index_buffer = nullptr;
+            /// @brief The indices to copy to the index buffer at the first `prepare`
+            std::shared_ptr<app::graphics::Buffer> m_index_staging = nullptr;
+            /// @brief The textures to copy at the next `prepare`
+            std::vector<Upload> m_pending_uploads;
+            /// @brief The staging buffers of the copies recorded by the previous frame
+            std::vector<std::shared_ptr<app::graphics::Buffer>> m_retired_staging;
+            /// @brief The quads submitted for this frame
+            std::vector<Quad> m_quads;
+            /// @brief The sort keys of the quads: layer, texture, then submission index
+            std::vector<uint64_t> m_sort_keys;
+            /// @brief The number of quads ignored this frame, past the maximum
+            uint32_t m_dropped_sprites = 0;
+            /// @brief Samples the texture array (bilinear)
+            VkSampler m_sampler = VK_NULL_HANDLE;
+            /// @brief The layout of the descriptor set of the texture array
+            VkDescriptorSetLayout m_descriptor_set_layout = VK_NULL_HANDLE;
+            /// @brief The descriptor set of the texture array
+            VkDescriptorSet m_descriptor_set = VK_NULL_HANDLE;
+            /// @brief The layout of the sprite pipeline
+            VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+            /// @brief Draws the quads with alpha blending
+            VkPipeline m_pipeline = VK_NULL_HANDLE;
+            /// @brief The maximum number of quads per frame
+            uint32_t m_max_sprites = 0;
+            /// @brief The width and the height of a layer of the texture array
+            uint32_t m_texture_size = 0;
+            /// @brief The slot of the vertex ring written by this frame
+            uint32_t m_slot = 0;
+            /// @brief If the index buffer and the texture array have been initialized
+            bool m_initialized = false;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // sprites_h
@@ -0,0 +1,138 @@
+//
+//  submit.cpp
+//
+
+#include "submit.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+
+app::graphics::SubmitBatcher::SubmitBatcher(){};
+
+app::graphics::SubmitBatcher::~SubmitBatcher()
+{
+    if (!m_batches.empty())
+        LogW("< %d batches destroyed without being submitted", static_cast<uint32_t>(m_batches.size()));
+    if (m_submit_count > 0)
+        Log("< %llu command buffers submitted in %llu calls", m_command_buffer_count, m_submit_count);
+    m_queue = VK_NULL_HANDLE;
+};
+
+utils::VResult app::graphics::SubmitBatcher::create(const VkQueue queue)
+{
+    if (VK_NULL_HANDLE == queue)
+        return utils::VResult::Error((char*)"Cannot create a submit batcher without queue");
+    m_queue = queue;
+    return utils::VResult::Ok();
+}
+
+void app::graphics::SubmitBatcher::add(
+    VkCommandBuffer command_buffer,
+    const std::vector<VkSemaphoreSubmitInfo>& waits,
+    const std::vector<VkSemaphoreSubmitInfo>& signals)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    addLocked(command_buffer, waits, signals);
+}
+
+utils::VResult app::graphics::SubmitBatcher::flush(const VkFence fence, const std::vector<VkSemaphoreSubmitInfo>& signals)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return flushLocked(fence, signals);
+}
+
+bool app::graphics::SubmitBatcher::hasPending()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_batches.empty();
+}
+
+VkResult app::graphics::SubmitBatcher::present(const VkPresentInfoKHR& present_info)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The semaphores waited for by the present are signaled by the pending batches
+    if (const auto result = flushLocked(VK_NULL_HANDLE); result.IsError())
+        return VK_ERROR_UNKNOWN;
+    return vkQueuePresentKHR(m_queue, &present_info);
+}
+
+VkQueue app::graphics::SubmitBatcher::getQueue() const noexcept
+{
+    return m_queue;
+}
+
+void app::graphics::SubmitBatcher::addLocked(
+    VkCommandBuffer command_buffer,
+    const std::vector<VkSemaphoreSubmitInfo>& waits,
+    const std::vector<VkSemaphoreSubmitInfo>& signals)
+{
+    // A batch waits before all of its command buffers, and signals after all of them: a
+    // command buffer that waits for nothing can join a batch that signals nothing yet
+    if (m_batches.empty() || !waits.empty() || 0 != m_batches.back().m_signal_count)
+    {
+        m_batches.push_back(Batch{
+            .m_first_wait = static_cast<uint32_t>(m_waits.size()),
+            .m_wait_count = static_cast<uint32_t>(waits.size()),
+            .m_first_command_buffer = static_cast<uint32_t>(m_command_buffers.size()),
+            .m_command_buffer_count = 0,
+            .m_first_signal = static_cast<uint32_t>(m_signals.size()),
+            .m_signal_count = 0,
+        });
+        m_waits.insert(m_waits.end(), waits.begin(), waits.end());
+    }
+    Batch& batch = m_batches.back();
+    m_command_buffers.push_back(VkCommandBufferSubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+        .commandBuffer = command_buffer,
+    });
+    ++batch.m_command_buffer_count;
+    m_signals.insert(m_signals.end(), signals.begin(), signals.end());
+    batch.m_signal_count += static_cast<uint32_t>(signals.size());
+}
+
+utils::VResult app::graphics::SubmitBatcher::flushLocked(const VkFence fence, const std::vector<VkSemaphoreSubmitInfo>& signals)
+{
+    if (m_batches.empty() && VK_NULL_HANDLE == fence && signals.empty())
+        return utils::VResult::Ok();
+    if (!signals.empty())
+    {
+        // A trailing batch without command buffers: it signals once the previous ones have
+        // completed
+        m_batches.push_back(Batch{
+            .m_first_wait = static_cast<uint32_t>(m_waits.size()),
+            .m_wait_count = 0,
+            .m_first_command_buffer = static_cast<uint32_t>(m_command_buffers.size()),
+            .m_command_buffer_count = 0,
+            .m_first_signal = static_cast<uint32_t>(m_signals.size()),
+            .m_signal_count = static_cast<uint32_t>(signals.size()),
+        });
+        m_signals.insert(m_signals.end(), signals.begin(), signals.end());
+    }
+    std::vector<VkSubmitInfo2> submit_infos;
+    submit_infos.reserve(m_batches.size());
+    for (const Batch& batch : m_batches)
+    {
+        submit_infos.push_back(VkSubmitInfo2{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+            .waitSemaphoreInfoCount = batch.m_wait_count,
+            .pWaitSemaphoreInfos = batch.m_wait_count > 0 ? &m_waits[batch.m_first_wait] : nullptr,
+            .commandBufferInfoCount = batch.m_command_buffer_count,
+            .pCommandBufferInfos = batch.m_command_buffer_count > 0 ? &m_command_buffers[batch.m_first_command_buffer] : nullptr,
+            .signalSemaphoreInfoCount = batch.m_signal_count,
+            .pSignalSemaphoreInfos = batch.m_signal_count > 0 ? &m_signals[batch.m_first_signal] : nullptr,
+        });
+    }
+    // No batch: the fence is only signaled once the previous submissions have completed
+    const auto submit_result = vkQueueSubmit2(m_queue, static_cast<uint32_t>(submit_infos.size()), submit_infos.data(), fence);
+    m_command_buffer_count += m_command_buffers.size();
+    ++m_submit_count;
+    m_batches.clear();
+    m_waits.clear();
+    m_command_buffers.clear();
+    m_signals.clear();
+    if (submit_result != VK_SUCCESS)
+    {
+        LogE("> vkQueueSubmit2: error 0x%08x for %d batches", submit_result, static_cast<uint32_t>(submit_infos.size()));
+        return utils::VResult::Error((char*)"Cannot submit the batches to the queue");
+    }
+    return utils::VResult::Ok();
+}
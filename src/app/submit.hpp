@@ -0,0 +1,110 @@
+//
+//  submit.hpp
+//
+
+#pragma once
+#ifndef submit_h
+#define submit_h
+
+#include "../utils/result.h"
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Batches the submissions to a queue, and serializes the access to it.
+        ///
+        /// The command buffers are added with the semaphores they wait for and signal, and
+        /// are submitted at the sync points (`flush`, `present`) in a single vkQueueSubmit2.
+        /// A command buffer without waits is merged in the batch of the previous one if that
+        /// batch signals nothing, so that the driver sees as few batches as possible.
+        /// Any thread can add command buffers: the batches and the queue are protected by the
+        /// same lock, which a queue shared by several roles (e.g. graphics and present) shares
+        /// through a single batcher.
+        class SubmitBatcher
+        {
+        public:
+            /// @brief Public constructor
+            SubmitBatcher();
+            /// @brief Public destructor
+            ~SubmitBatcher();
+            /// @brief Sets the queue of the batcher
+            /// @param queue The queue the command buffers are submitted to
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const VkQueue queue);
+            /// @brief Adds a command buffer to the pending batches
+            /// @param command_buffer The recorded command buffer
+            /// @param waits The semaphores waited for before the command buffer, with their stages
+            /// @param signals The semaphores signaled after the command buffer, with their stages
+            void add(
+                VkCommandBuffer command_buffer,
+                const std::vector<VkSemaphoreSubmitInfo>& waits = {},
+                const std::vector<VkSemaphoreSubmitInfo>& signals = {});
+            /// @brief Submits the pending batches in a single call
+            /// @param fence The fence signaled once all of them have completed, if any
+            /// @param signals The semaphores signaled once all of them have completed, if any
+            /// (e.g. uploads waited for by the frame on another queue)
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult flush(const VkFence fence = VK_NULL_HANDLE, const std::vector<VkSemaphoreSubmitInfo>& signals = {});
+            /// @brief Returns if command buffers have been added since the last flush
+            bool hasPending();
+            /// @brief Submits the pending batches, then presents on the queue
+            /// @param present_info The images to present and the semaphores to wait for
+            /// @return The result of vkQueuePresentKHR (e.g. VK_ERROR_OUT_OF_DATE_KHR)
+            VkResult present(const VkPresentInfoKHR& present_info);
+            /// @brief Returns the queue of the batcher
+            VkQueue getQueue() const noexcept;
+
+        private:
+            /// @brief A VkSubmitInfo2, by ranges of the arrays of the batcher (stable until the
+            /// flush, whatever the number of batches)
+            struct Batch
+            {
+                /// @brief The first wait semaphore of the batch
+                uint32_t m_first_wait;
+                /// @brief The number of wait semaphores of the batch
+                uint32_t m_wait_count;
+                /// @brief The first command buffer of the batch
+                uint32_t m_first_command_buffer;
+                /// @brief The number of command buffers of the batch
+                uint32_t m_command_buffer_count;
+                /// @brief The first signal semaphore of the batch
+                uint32_t m_first_signal;
+                /// @brief The number of signal semaphores of the batch
+                uint32_t m_signal_count;
+            };
+            /// @brief SubmitBatcher should not be cloneable
+            SubmitBatcher(SubmitBatcher& other) = delete;
+            /// @brief SubmitBatcher should not be assignable
+            void operator=(const SubmitBatcher& other) = delete;
+            /// @brief Adds a command buffer, with the lock held
+            void addLocked(
+                VkCommandBuffer command_buffer,
+                const std::vector<VkSemaphoreSubmitInfo>& waits,
+                const std::vector<VkSemaphoreSubmitInfo>& signals);
+            /// @brief Submits the pending batches, with the lock held
+            utils::VResult flushLocked(const VkFence fence, const std::vector<VkSemaphoreSubmitInfo>& signals = {});
+            /// @brief The queue
+            VkQueue m_queue = VK_NULL_HANDLE;
+            /// @brief Protects the batches and the queue
+            std::mutex m_mutex;
+            /// @brief The pending batches
+            std::vector<Batch> m_batches;
+            /// @brief The wait semaphores of the pending batches
+            std::vector<VkSemaphoreSubmitInfo> m_waits;
+            /// @brief The command buffers of the pending batches
+            std::vector<VkCommandBufferSubmitInfo> m_command_buffers;
+            /// @brief The signal semaphores of the pending batches
+            std::vector<VkSemaphoreSubmitInfo> m_signals;
+            /// @brief The number of vkQueueSubmit2 calls
+            uint64_t m_submit_count = 0;
+            /// @brief The number of command buffers submitted
+            uint64_t m_command_buffer_count = 0;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // submit_h
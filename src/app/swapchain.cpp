@@ -184,7 +184,8 @@ utils::VResult app::graphics::SwapChain::create()
         .imageColorSpace = m_format.colorSpace,
         .imageExtent = m_extent,
         .imageArrayLayers = 1,                             // Always one (except stereoscopic 3D app)
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, // color attachment, use VK_IMAGE_USAGE_TRANSFER_DST_BIT instead
+        // color attachment for the UI, and transfer destination for the upscaled scene
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
     };
     uint32_t indices[3] = {
         app::Engine::getInstance()->m_graphics_device.m_graphics_queue_family_index,
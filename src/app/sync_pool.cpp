@@ -0,0 +1,98 @@
+//
+//  sync_pool.cpp
+//
+
+#include "sync_pool.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+
+app::graphics::SyncPool::SyncPool(){};
+
+app::graphics::SyncPool::~SyncPool()
+{
+    const VkDevice graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    const size_t returned_fences = m_free_fences.size() + m_released_fences.size();
+    if (returned_fences < m_fence_count || m_free_semaphores.size() < m_semaphore_count)
+        LogW("< %d fences and %d semaphores not released to the sync pool",
+             static_cast<uint32_t>(m_fence_count - returned_fences),
+             static_cast<uint32_t>(m_semaphore_count - m_free_semaphores.size()));
+    for (const VkFence fence : m_free_fences)
+        vkDestroyFence(graphics_device, fence, nullptr);
+    for (const VkFence fence : m_released_fences)
+        vkDestroyFence(graphics_device, fence, nullptr);
+    for (const VkSemaphore semaphore : m_free_semaphores)
+        vkDestroySemaphore(graphics_device, semaphore, nullptr);
+    m_free_fences.clear();
+    m_released_fences.clear();
+    m_free_semaphores.clear();
+};
+
+utils::Result<VkFence> app::graphics::SyncPool::acquireFence()
+{
+    const VkDevice graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free_fences.empty() && !m_released_fences.empty())
+    {
+        if (const auto result = vkResetFences(graphics_device, static_cast<uint32_t>(m_released_fences.size()), m_released_fences.data()); result != VK_SUCCESS)
+        {
+            LogE("> vkResetFences: error 0x%08x for %d fences", result, static_cast<uint32_t>(m_released_fences.size()));
+            return utils::Result<VkFence>::Error((char*)"Cannot reset the released fences");
+        }
+        m_free_fences.swap(m_released_fences);
+    }
+    if (!m_free_fences.empty())
+    {
+        const VkFence fence = m_free_fences.back();
+        m_free_fences.pop_back();
+        return utils::Result<VkFence>::Ok(fence);
+    }
+    VkFenceCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+    };
+    VkFence fence = VK_NULL_HANDLE;
+    if (const auto result = vkCreateFence(graphics_device, &create_info, nullptr, &fence); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateFence: error 0x%08x", result);
+        return utils::Result<VkFence>::Error((char*)"Cannot create a fence");
+    }
+    ++m_fence_count;
+    return utils::Result<VkFence>::Ok(fence);
+}
+
+void app::graphics::SyncPool::releaseFence(const VkFence fence)
+{
+    if (VK_NULL_HANDLE == fence)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_released_fences.push_back(fence);
+}
+
+utils::Result<VkSemaphore> app::graphics::SyncPool::acquireSemaphore()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_free_semaphores.empty())
+    {
+        const VkSemaphore semaphore = m_free_semaphores.back();
+        m_free_semaphores.pop_back();
+        return utils::Result<VkSemaphore>::Ok(semaphore);
+    }
+    VkSemaphoreCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    if (const auto result = vkCreateSemaphore(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &create_info, nullptr, &semaphore); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateSemaphore: error 0x%08x", result);
+        return utils::Result<VkSemaphore>::Error((char*)"Cannot create a semaphore");
+    }
+    ++m_semaphore_count;
+    return utils::Result<VkSemaphore>::Ok(semaphore);
+}
+
+void app::graphics::SyncPool::releaseSemaphore(const VkSemaphore semaphore)
+{
+    if (VK_NULL_HANDLE == semaphore)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free_semaphores.push_back(semaphore);
+}
@@ -0,0 +1,68 @@
+//
+//  sync_pool.hpp
+//
+
+#pragma once
+#ifndef sync_pool_h
+#define sync_pool_h
+
+#include "../utils/result.h"
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Recycles the fences and the binary semaphores, instead of creating and
+        /// destroying one per use.
+        ///
+        /// An acquired fence is unsignaled. The released fences are reset together, in a
+        /// single vkResetFences, once the free ones run out. A semaphore must be released
+        /// unsignaled, without pending wait: e.g. once the submission that waited for it has
+        /// completed. The objects are destroyed with the pool: it should be destroyed once
+        /// the device is idle.
+        /// Any thread can acquire and release objects.
+        class SyncPool
+        {
+        public:
+            /// @brief Public constructor
+            SyncPool();
+            /// @brief Public destructor, destroys the fences and semaphores of the pool
+            ~SyncPool();
+            /// @brief Returns an unsignaled fence, recycled if possible
+            /// @return The fence, or an error
+            utils::Result<VkFence> acquireFence();
+            /// @brief Gives a fence back to the pool, signaled or not, once no wait or
+            /// submission uses it anymore
+            void releaseFence(const VkFence fence);
+            /// @brief Returns an unsignaled binary semaphore, recycled if possible
+            /// @return The semaphore, or an error
+            utils::Result<VkSemaphore> acquireSemaphore();
+            /// @brief Gives an unsignaled semaphore back to the pool, once no submission
+            /// uses it anymore
+            void releaseSemaphore(const VkSemaphore semaphore);
+
+        private:
+            /// @brief SyncPool should not be cloneable
+            SyncPool(SyncPool& other) = delete;
+            /// @brief SyncPool should not be assignable
+            void operator=(const SyncPool& other) = delete;
+            /// @brief Protects the pool
+            std::mutex m_mutex;
+            /// @brief The unsignaled fences, ready to be acquired
+            std::vector<VkFence> m_free_fences;
+            /// @brief The released fences, to reset before being acquired again
+            std::vector<VkFence> m_released_fences;
+            /// @brief The semaphores ready to be acquired
+            std::vector<VkSemaphore> m_free_semaphores;
+            /// @brief The number of fences created by the pool
+            uint32_t m_fence_count = 0;
+            /// @brief The number of semaphores created by the pool
+            uint32_t m_semaphore_count = 0;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // sync_pool_h
@@ -0,0 +1,258 @@
+//
+//  temporal.cpp
+//
+
+#include "temporal.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include <algorithm>
+#include <cmath>
+
+/// @brief Format of the history: HDR-friendly, and a storage image format
+/// every device supports
+constexpr VkFormat HISTORY_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+/// @brief Weight of the reprojected history in the accumulation
+constexpr float HISTORY_WEIGHT = 0.9f;
+
+/// @brief Number of jitter phases at native resolution - multiplied by the
+/// square of the upscale ratio
+constexpr uint32_t BASE_JITTER_PHASES = 8;
+
+/// @brief Maximal number of jitter phases
+constexpr uint32_t MAX_JITTER_PHASES = 64;
+
+/// @brief Local size of the temporal upscale compute shader, on X and Y
+constexpr uint32_t GROUP_SIZE = 8;
+
+/// @brief Returns the `index`-th element of the Halton sequence of base `base`, in [0, 1[
+static float halton(uint32_t index, const uint32_t base)
+{
+    float fraction = 1.0f;
+    float result = 0.0f;
+    while (index > 0)
+    {
+        fraction /= static_cast<float>(base);
+        result += fraction * static_cast<float>(index % base);
+        index /= base;
+    }
+    return result;
+}
+
+/// @brief Records a layout transition of a whole color image
+static void transitionImage(
+    VkCommandBuffer command_buffer,
+    VkImage image,
+    const VkImageLayout old_layout,
+    const VkImageLayout new_layout,
+    const VkPipelineStageFlags src_stage,
+    const VkAccessFlags src_access,
+    const VkPipelineStageFlags dst_stage,
+    const VkAccessFlags dst_access)
+{
+    VkImageMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+        .oldLayout = old_layout,
+        .newLayout = new_layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+app::graphics::TemporalUpscaler::TemporalUpscaler(){};
+
+app::graphics::TemporalUpscaler::~TemporalUpscaler()
+{
+    m_pass = nullptr;
+    m_history[0] = nullptr;
+    m_history[1] = nullptr;
+    if (VK_NULL_HANDLE != m_sampler)
+    {
+        vkDestroySampler(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), m_sampler, nullptr);
+        m_sampler = VK_NULL_HANDLE;
+    }
+};
+
+utils::VResult app::graphics::TemporalUpscaler::create(
+    const VkExtent2D& output_extent,
+    const std::vector<VkImageView>& color_views,
+    const std::vector<VkImageView>& motion_views)
+{
+    Log("> Creating the temporal upscaler (%dx%d)", output_extent.width, output_extent.height);
+    if (color_views.size() != motion_views.size())
+        return utils::VResult::Error((char*)"The temporal upscaler needs one motion target per color target");
+    m_output_extent = output_extent;
+
+    for (auto& history : m_history)
+    {
+        history = std::make_shared<app::graphics::Attachment>();
+        // Written by the upscale, read back as history, and sampled by the tonemapper
+        if (const auto result = history->create(
+                m_output_extent,
+                HISTORY_FORMAT,
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT);
+            result.IsError())
+        {
+            LogE("Error creating the history of the temporal upscaler");
+            return result;
+        }
+    }
+
+    // Bilinear filtering, and clamp to edge: the reprojection can fall outside the screen
+    VkSamplerCreateInfo sampler_create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .maxLod = 0.0f,
+    };
+    if (const auto result = vkCreateSampler(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &sampler_create_info, nullptr, &m_sampler); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateSampler: error 0x%08x for the temporal upscaler", result);
+        return utils::VResult::Error((char*)"Cannot create the sampler of the temporal upscaler");
+    }
+
+    // 0: current color, 1: motion vectors, 2: history to read, 3: history to write
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+    };
+    // The targets of the swapchain image and the history images swap every frame:
+    // the set is written each frame
+    m_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_pass->create("shaders/temporal_upscale.comp.spv", bindings, sizeof(PushConstants), 0, false, true); result.IsError())
+    {
+        LogE("Error creating the compute pass of the temporal upscaler");
+        return result;
+    }
+    m_color_views = color_views;
+    m_motion_views = motion_views;
+    m_history_valid = false;
+    return utils::VResult::Ok();
+}
+
+glm::vec2 app::graphics::TemporalUpscaler::updateJitter(const VkExtent2D& render_extent)
+{
+    const float upscale_ratio = static_cast<float>(m_output_extent.width) / static_cast<float>(std::max(render_extent.width, 1u));
+    const uint32_t nb_phases = std::min(
+        static_cast<uint32_t>(std::ceil(static_cast<float>(BASE_JITTER_PHASES) * upscale_ratio * upscale_ratio)),
+        MAX_JITTER_PHASES);
+    // Halton(2, 3), skipping the first element (0, 0)
+    const uint32_t phase = static_cast<uint32_t>(m_frame_count % nb_phases) + 1;
+    m_jitter = glm::vec2(halton(phase, 2) - 0.5f, halton(phase, 3) - 0.5f);
+    // From render pixels to NDC units (the NDC range spans 2 units)
+    return glm::vec2(
+        2.0f * m_jitter.x / static_cast<float>(render_extent.width),
+        2.0f * m_jitter.y / static_cast<float>(render_extent.height));
+}
+
+void app::graphics::TemporalUpscaler::record(VkCommandBuffer command_buffer, const uint32_t image_index, const VkExtent2D& render_extent)
+{
+    assert(image_index < m_color_views.size());
+    const auto set_result = m_pass->allocateFrameSet();
+    if (set_result.IsError())
+    {
+        LogE("> Cannot allocate the descriptor set of the temporal upscale");
+        return;
+    }
+    const uint32_t set_index = set_result.GetValue();
+    const uint32_t read_index = m_output_index;
+    const uint32_t write_index = 1 - m_output_index;
+    m_output_index = write_index;
+    m_pass->writeImage(set_index, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_color_views[image_index], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_sampler);
+    m_pass->writeImage(set_index, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_motion_views[image_index], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_sampler);
+    m_pass->writeImage(set_index, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_history[read_index]->getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_sampler);
+    m_pass->writeImage(set_index, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_history[write_index]->getImageView(), VK_IMAGE_LAYOUT_GENERAL);
+
+    // The history to read has been left in SHADER_READ_ONLY_OPTIMAL by the previous
+    // upscale (and only read since, by the tonemapper)
+    if (!m_history_valid)
+    {
+        transitionImage(
+            command_buffer,
+            m_history[read_index]->getImage(),
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            0,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT);
+    }
+    // The history to write has been read by the previous upscale: its content can be discarded
+    transitionImage(
+        command_buffer,
+        m_history[write_index]->getImage(),
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+
+    const PushConstants push_constants{
+        .m_render_extent = glm::vec2(render_extent.width, render_extent.height),
+        .m_output_extent = glm::vec2(m_output_extent.width, m_output_extent.height),
+        .m_input_extent = glm::vec2(m_output_extent.width, m_output_extent.height),
+        .m_jitter = m_jitter,
+        .m_history_weight = HISTORY_WEIGHT,
+        .m_reset = m_history_valid ? 0u : 1u,
+    };
+    m_pass->dispatch(
+        command_buffer,
+        set_index,
+        &push_constants,
+        app::graphics::ComputePass::getGroupCount(m_output_extent.width, GROUP_SIZE),
+        app::graphics::ComputePass::getGroupCount(m_output_extent.height, GROUP_SIZE));
+
+    transitionImage(
+        command_buffer,
+        m_history[write_index]->getImage(),
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT);
+
+    m_history_valid = true;
+    ++m_frame_count;
+}
+
+std::shared_ptr<app::graphics::Attachment> app::graphics::TemporalUpscaler::getOutput() const
+{
+    return m_history[m_output_index];
+}
+
+uint32_t app::graphics::TemporalUpscaler::getOutputIndex() const noexcept
+{
+    return m_output_index;
+}
+
+std::shared_ptr<app::graphics::Attachment> app::graphics::TemporalUpscaler::getHistory(const uint32_t index) const
+{
+    assert(index < 2);
+    return m_history[index];
+}
+
+void app::graphics::TemporalUpscaler::resetHistory() noexcept
+{
+    m_history_valid = false;
+}
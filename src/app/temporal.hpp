@@ -0,0 +1,109 @@
+//
+//  temporal.hpp
+//
+
+#pragma once
+#ifndef temporal_h
+#define temporal_h
+
+#include "../utils/result.h"
+#include "attachment.hpp"
+#include "compute.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Reconstructs the scene at the swapchain resolution from jittered,
+        /// lower resolution frames: the history of the previous frames is reprojected
+        /// with the motion vectors, clamped to the neighbourhood of the current
+        /// samples, and accumulated with them (compute pass).
+        class TemporalUpscaler
+        {
+        public:
+            /// @brief The push constants of the temporal upscale compute shader
+            struct PushConstants
+            {
+                /// @brief The extent the scene has been rendered at, in pixels
+                glm::vec2 m_render_extent;
+                /// @brief The extent of the output, in pixels
+                glm::vec2 m_output_extent;
+                /// @brief The extent of the color and motion targets, in pixels
+                glm::vec2 m_input_extent;
+                /// @brief The jitter of the current frame, in render pixels
+                glm::vec2 m_jitter;
+                /// @brief The weight of the history in the accumulation
+                float m_history_weight;
+                /// @brief Discards the history if not 0
+                uint32_t m_reset;
+            };
+            /// @brief Public constructor
+            TemporalUpscaler();
+            /// @brief Public destructor
+            ~TemporalUpscaler();
+            /// @brief Creates the history images, the sampler and the compute pass
+            /// @param output_extent The extent of the output (the swapchain extent)
+            /// @param color_views The scene color targets, one per swapchain image
+            /// @param motion_views The motion vector targets, one per swapchain image
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(
+                const VkExtent2D& output_extent,
+                const std::vector<VkImageView>& color_views,
+                const std::vector<VkImageView>& motion_views);
+            /// @brief Computes the jitter of the next frame.
+            /// The length of the sequence grows with the upscale ratio, so that each
+            /// output pixel receives about the same number of samples.
+            /// @param render_extent The extent the scene will be rendered at
+            /// @return The jitter of the frame, in NDC units, to offset the projection with
+            glm::vec2 updateJitter(const VkExtent2D& render_extent);
+            /// @brief Records the temporal upscale of the scene.
+            /// The output is left in the SHADER_READ_ONLY_OPTIMAL layout, to be read
+            /// by the tonemapper (and as history by the next upscale).
+            /// @param command_buffer The command buffer being recorded
+            /// @param image_index The swapchain image index (selects the scene targets)
+            /// @param render_extent The extent the scene has been rendered at
+            void record(VkCommandBuffer command_buffer, const uint32_t image_index, const VkExtent2D& render_extent);
+            /// @brief Returns the output of the last recorded upscale
+            std::shared_ptr<app::graphics::Attachment> getOutput() const;
+            /// @brief Returns the index of the history image written by the last recorded upscale
+            uint32_t getOutputIndex() const noexcept;
+            /// @brief Returns one of the two history images
+            /// @param index The index of the history image (0 or 1)
+            std::shared_ptr<app::graphics::Attachment> getHistory(const uint32_t index) const;
+            /// @brief Discards the history at the next frame (camera cut, resize, ...)
+            void resetHistory() noexcept;
+
+        private:
+            /// @brief TemporalUpscaler should not be cloneable
+            TemporalUpscaler(TemporalUpscaler& other) = delete;
+            /// @brief TemporalUpscaler should not be assignable
+            void operator=(const TemporalUpscaler& other) = delete;
+            /// @brief The history images: one is read while the other is written
+            std::shared_ptr<app::graphics::Attachment> m_history[2] = {nullptr, nullptr};
+            /// @brief The index of the history image written by the last upscale
+            uint32_t m_output_index = 1;
+            /// @brief If the history image to read contains a valid frame
+            bool m_history_valid = false;
+            /// @brief The bilinear sampler for the scene targets and the history
+            VkSampler m_sampler = VK_NULL_HANDLE;
+            /// @brief The compute pass: a descriptor set per frame
+            std::shared_ptr<app::graphics::ComputePass> m_pass = nullptr;
+            /// @brief The scene color targets, one per swapchain image
+            std::vector<VkImageView> m_color_views;
+            /// @brief The motion vector targets, one per swapchain image
+            std::vector<VkImageView> m_motion_views;
+            /// @brief The extent of the output
+            VkExtent2D m_output_extent = {0, 0};
+            /// @brief The number of frames upscaled since the creation
+            uint64_t m_frame_count = 0;
+            /// @brief The jitter of the current frame, in render pixels
+            glm::vec2 m_jitter = glm::vec2(0.0f);
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // temporal_h
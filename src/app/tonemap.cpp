@@ -0,0 +1,298 @@
+//
+//  tonemap.cpp
+//
+
+#include "tonemap.hpp"
+#include "../project.hpp"
+#include "../utils/debug_tools.h"
+#include "engine.hpp"
+#include <cmath>
+
+/// @brief Local size of the histogram compute shader, on X and Y: one invocation per bin
+constexpr uint32_t HISTOGRAM_GROUP_SIZE = 16;
+
+/// @brief Local size of the tonemap compute shader, on X and Y
+constexpr uint32_t TONEMAP_GROUP_SIZE = 8;
+
+app::graphics::Tonemapper::Tonemapper(){};
+
+app::graphics::Tonemapper::~Tonemapper()
+{
+    m_histogram_pass = nullptr;
+    m_average_pass = nullptr;
+    m_tonemap_pass = nullptr;
+    m_histogram_buffer = nullptr;
+    m_exposure_buffer = nullptr;
+    m_output = nullptr;
+    if (VK_NULL_HANDLE != m_sampler)
+    {
+        vkDestroySampler(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), m_sampler, nullptr);
+        m_sampler = VK_NULL_HANDLE;
+    }
+};
+
+utils::VResult app::graphics::Tonemapper::create(
+    const VkExtent2D& output_extent,
+    const std::vector<VkImageView>& input_views,
+    const VkImageView bloom_view,
+    const VkImageView lut_view,
+    const VkSampler linear_sampler)
+{
+    Log("> Creating the tonemapper (%dx%d, %d inputs)", output_extent.width, output_extent.height, static_cast<uint32_t>(input_views.size()));
+
+    m_output = std::make_shared<app::graphics::Attachment>();
+    // Written by the tonemap pass, then read by the FXAA or blitted to the swapchain image
+    if (const auto result = m_output->create(
+            output_extent,
+            OUTPUT_FORMAT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT);
+        result.IsError())
+    {
+        LogE("Error creating the output of the tonemapper");
+        return result;
+    }
+
+    m_histogram_buffer = std::make_shared<app::graphics::Buffer>();
+    m_exposure_buffer = std::make_shared<app::graphics::Buffer>();
+    // Only the GPU reads and writes those: they are initialized with transfer commands
+    if (const auto result = m_histogram_buffer->create(HISTOGRAM_BINS * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false); result.IsError())
+        return result;
+    if (const auto result = m_exposure_buffer->create(2 * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false); result.IsError())
+        return result;
+
+    // Texel fetches only: no filtering
+    VkSamplerCreateInfo sampler_create_info{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .maxLod = 0.0f,
+    };
+    if (const auto result = vkCreateSampler(app::Engine::getInstance()->m_graphics_device.getLogicalDevice(), &sampler_create_info, nullptr, &m_sampler); result != VK_SUCCESS)
+    {
+        LogE("> vkCreateSampler: error 0x%08x for the tonemapper", result);
+        return utils::VResult::Error((char*)"Cannot create the sampler of the tonemapper");
+    }
+
+    // The input changes with the swapchain image: the sets reading it are written each frame
+    m_input_views = input_views;
+    m_bloom_view = bloom_view;
+    m_lut_view = lut_view;
+    m_linear_sampler = linear_sampler;
+
+    // 0: input, 1: histogram
+    const std::vector<VkDescriptorSetLayoutBinding> histogram_bindings = {
+        {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+    };
+    m_histogram_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_histogram_pass->create("shaders/luminance_histogram.comp.spv", histogram_bindings, sizeof(PushConstants), 0, false, true); result.IsError())
+    {
+        LogE("Error creating the luminance histogram pass");
+        return result;
+    }
+
+    // 0: histogram, 1: exposure
+    const std::vector<VkDescriptorSetLayoutBinding> average_bindings = {
+        {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+    };
+    m_average_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_average_pass->create("shaders/luminance_average.comp.spv", average_bindings, sizeof(PushConstants), 1); result.IsError())
+    {
+        LogE("Error creating the luminance average pass");
+        return result;
+    }
+    m_average_pass->writeBuffer(0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_histogram_buffer);
+    m_average_pass->writeBuffer(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_exposure_buffer);
+
+    // 0: input, 1: exposure, 2: output, 3: bloom, 4: color grading LUT
+    const std::vector<VkDescriptorSetLayoutBinding> tonemap_bindings = {
+        {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        {4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+    };
+    m_tonemap_pass = std::make_shared<app::graphics::ComputePass>();
+    if (const auto result = m_tonemap_pass->create("shaders/tonemap.comp.spv", tonemap_bindings, sizeof(PushConstants), 0, false, true); result.IsError())
+    {
+        LogE("Error creating the tonemap pass");
+        return result;
+    }
+    m_initialized = false;
+    m_last_record = std::nullopt;
+    return utils::VResult::Ok();
+}
+
+void app::graphics::Tonemapper::recordExposure(VkCommandBuffer command_buffer, const uint32_t input_index, const VkExtent2D& extent)
+{
+    // Exponential adaptation, independent of the frame rate. The first frame
+    // starts from its own luminance.
+    const auto now = std::chrono::steady_clock::now();
+    float adaptation = 1.0f;
+    if (m_last_record.has_value())
+    {
+        const float delta_time = std::chrono::duration<float>(now - m_last_record.value()).count();
+        adaptation = 1.0f - std::exp(-delta_time * Project::AUTO_EXPOSURE_ADAPTATION_SPEED);
+    }
+    m_last_record = now;
+
+    VkAccessFlags src_access = VK_ACCESS_SHADER_WRITE_BIT;
+    if (!m_initialized)
+    {
+        // Empty histogram, and a luminance / exposure of 1.0f
+        vkCmdFillBuffer(command_buffer, m_histogram_buffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(command_buffer, m_exposure_buffer->getBuffer(), 0, VK_WHOLE_SIZE, 0x3f800000);
+        src_access |= VK_ACCESS_TRANSFER_WRITE_BIT;
+        m_initialized = true;
+    }
+    // The histogram has been cleared, and the exposure written, by the average
+    // pass of the previous frame (or by the initialization)
+    VkMemoryBarrier before_histogram{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = src_access,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &before_histogram,
+        0, nullptr,
+        0, nullptr);
+
+    m_push_constants = PushConstants{
+        .m_extent = glm::uvec2(extent.width, extent.height),
+        .m_min_log_luminance = Project::AUTO_EXPOSURE_MIN_LOG_LUMINANCE,
+        .m_log_luminance_range = Project::AUTO_EXPOSURE_MAX_LOG_LUMINANCE - Project::AUTO_EXPOSURE_MIN_LOG_LUMINANCE,
+        .m_adaptation = adaptation,
+        .m_exposure_key = Project::AUTO_EXPOSURE_KEY,
+        .m_bloom_intensity = 0.0f,
+        .m_sharpness = 0.0f,
+        .m_color_grading = 0,
+    };
+    const auto set_result = m_histogram_pass->allocateFrameSet();
+    if (set_result.IsError())
+    {
+        LogE("> Cannot allocate the descriptor set of the luminance histogram");
+        return;
+    }
+    const uint32_t set_index = set_result.GetValue();
+    m_histogram_pass->writeImage(set_index, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_input_views[input_index], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_sampler);
+    m_histogram_pass->writeBuffer(set_index, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_histogram_buffer);
+    m_histogram_pass->dispatch(
+        command_buffer,
+        set_index,
+        &m_push_constants,
+        app::graphics::ComputePass::getGroupCount(extent.width, HISTOGRAM_GROUP_SIZE),
+        app::graphics::ComputePass::getGroupCount(extent.height, HISTOGRAM_GROUP_SIZE));
+
+    VkMemoryBarrier after_histogram{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &after_histogram,
+        0, nullptr,
+        0, nullptr);
+
+    // A single workgroup: one invocation per bin
+    m_average_pass->dispatch(command_buffer, 0, &m_push_constants, 1, 1);
+
+    VkMemoryBarrier after_average{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &after_average,
+        0, nullptr,
+        0, nullptr);
+}
+
+void app::graphics::Tonemapper::recordTonemap(
+    VkCommandBuffer command_buffer,
+    const uint32_t input_index,
+    const VkExtent2D& extent,
+    const float bloom_intensity,
+    const float sharpness,
+    const bool color_grading)
+{
+    // The output has been read by the FXAA or copied to the swapchain image during
+    // the previous frame: its content can be discarded
+    VkImageMemoryBarrier output_to_general{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = m_output->getImage(),
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &output_to_general);
+
+    PushConstants push_constants = m_push_constants;
+    push_constants.m_extent = glm::uvec2(extent.width, extent.height);
+    push_constants.m_bloom_intensity = bloom_intensity;
+    push_constants.m_sharpness = sharpness;
+    push_constants.m_color_grading = color_grading ? 1u : 0u;
+    const auto set_result = m_tonemap_pass->allocateFrameSet();
+    if (set_result.IsError())
+    {
+        LogE("> Cannot allocate the descriptor set of the tonemapping");
+        return;
+    }
+    const uint32_t set_index = set_result.GetValue();
+    m_tonemap_pass->writeImage(set_index, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_input_views[input_index], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_sampler);
+    m_tonemap_pass->writeBuffer(set_index, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_exposure_buffer);
+    m_tonemap_pass->writeImage(set_index, 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_output->getImageView(), VK_IMAGE_LAYOUT_GENERAL);
+    m_tonemap_pass->writeImage(set_index, 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_bloom_view, VK_IMAGE_LAYOUT_GENERAL, m_linear_sampler);
+    m_tonemap_pass->writeImage(set_index, 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_lut_view, VK_IMAGE_LAYOUT_GENERAL, m_linear_sampler);
+    m_tonemap_pass->dispatch(
+        command_buffer,
+        set_index,
+        &push_constants,
+        app::graphics::ComputePass::getGroupCount(extent.width, TONEMAP_GROUP_SIZE),
+        app::graphics::ComputePass::getGroupCount(extent.height, TONEMAP_GROUP_SIZE));
+}
+
+std::shared_ptr<app::graphics::Attachment> app::graphics::Tonemapper::getOutput() const
+{
+    return m_output;
+}
+
+std::shared_ptr<app::graphics::Buffer> app::graphics::Tonemapper::getExposureBuffer() const
+{
+    return m_exposure_buffer;
+}
@@ -0,0 +1,146 @@
+//
+//  tonemap.hpp
+//
+
+#pragma once
+#ifndef tonemap_h
+#define tonemap_h
+
+#include "../utils/result.h"
+#include "attachment.hpp"
+#include "buffer.hpp"
+#include "compute.hpp"
+#include <chrono>
+#include <glm/glm.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Exposes the linear HDR scene and maps it to the display range, with
+        /// three compute passes that never leave the GPU:
+        /// 1. a histogram of the log2 luminance of the frame, built with shared-memory
+        ///    atomics in each workgroup, then merged in a global histogram;
+        /// 2. a single workgroup that averages the histogram, adapts the luminance of the
+        ///    previous frames to it, derives the exposure, and clears the histogram;
+        /// 3. the tonemapping itself (ACES fit), with the exposure read from the GPU buffer.
+        ///    This pass also composites the bloom, applies the color grading LUT and
+        ///    sharpens the result: the tonemapped colors of a tile (and its border) are
+        ///    kept in shared memory, so the sharpening needs no extra pass.
+        /// The output is linear and display-referred: the blit to the sRGB swapchain
+        /// image encodes it. Its alpha holds the perceptual luma, for the FXAA.
+        class Tonemapper
+        {
+        public:
+            /// @brief Format of the output: a storage image format every device supports,
+            /// precise enough not to band before the sRGB encoding
+            static constexpr VkFormat OUTPUT_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+            /// @brief Number of bins of the luminance histogram (bin 0 gathers the black pixels)
+            static constexpr uint32_t HISTOGRAM_BINS = 256;
+
+            /// @brief The push constants, shared by the three compute shaders
+            struct PushConstants
+            {
+                /// @brief The extent of the part of the input to read, in pixels
+                glm::uvec2 m_extent;
+                /// @brief The log2 luminance of the first bin of the histogram
+                float m_min_log_luminance;
+                /// @brief The log2 luminance range covered by the histogram
+                float m_log_luminance_range;
+                /// @brief The weight of the luminance of this frame in the adapted luminance
+                float m_adaptation;
+                /// @brief The exposed value of the adapted luminance (middle grey)
+                float m_exposure_key;
+                /// @brief The weight of the bloom (0 if disabled)
+                float m_bloom_intensity;
+                /// @brief The strength of the sharpening (0 if disabled)
+                float m_sharpness;
+                /// @brief Applies the color grading LUT if not 0
+                uint32_t m_color_grading;
+            };
+            /// @brief Public constructor
+            Tonemapper();
+            /// @brief Public destructor
+            ~Tonemapper();
+            /// @brief Creates the output image, the buffers and the compute passes
+            /// @param output_extent The extent of the output (the extent of the input images)
+            /// @param input_views The HDR images to tonemap, in SHADER_READ_ONLY_OPTIMAL layout
+            /// @param bloom_view The bloom to composite, at half the output extent (GENERAL layout)
+            /// @param lut_view The 3D color grading LUT (GENERAL layout)
+            /// @param linear_sampler The bilinear sampler to read the bloom and the LUT with
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(
+                const VkExtent2D& output_extent,
+                const std::vector<VkImageView>& input_views,
+                const VkImageView bloom_view,
+                const VkImageView lut_view,
+                const VkSampler linear_sampler);
+            /// @brief Records the luminance histogram of an input and the adaptation of
+            /// the exposure. The exposure buffer is then ready to be read by compute shaders.
+            /// @param command_buffer The command buffer being recorded
+            /// @param input_index The input image to expose
+            /// @param extent The extent of the part of the input to read (top-left)
+            void recordExposure(VkCommandBuffer command_buffer, const uint32_t input_index, const VkExtent2D& extent);
+            /// @brief Records the tonemapping of an input, after `recordExposure`.
+            /// The output is left in the GENERAL layout.
+            /// @param command_buffer The command buffer being recorded
+            /// @param input_index The input image to tonemap
+            /// @param extent The extent of the part of the input to read (top-left), which
+            /// is also the part of the output written
+            /// @param bloom_intensity The weight of the bloom, 0 if the bloom has not been recorded
+            /// @param sharpness The strength of the sharpening, 0 to disable it
+            /// @param color_grading If the color grading LUT has to be applied
+            void recordTonemap(
+                VkCommandBuffer command_buffer,
+                const uint32_t input_index,
+                const VkExtent2D& extent,
+                const float bloom_intensity,
+                const float sharpness,
+                const bool color_grading);
+            /// @brief Returns the tonemapped image
+            std::shared_ptr<app::graphics::Attachment> getOutput() const;
+            /// @brief Returns the buffer of the adapted luminance and of the exposure (two floats)
+            std::shared_ptr<app::graphics::Buffer> getExposureBuffer() const;
+
+        private:
+            /// @brief Tonemapper should not be cloneable
+            Tonemapper(Tonemapper& other) = delete;
+            /// @brief Tonemapper should not be assignable
+            void operator=(const Tonemapper& other) = delete;
+            /// @brief The tonemapped image
+            std::shared_ptr<app::graphics::Attachment> m_output = nullptr;
+            /// @brief The luminance histogram of the frame (device-local)
+            std::shared_ptr<app::graphics::Buffer> m_histogram_buffer = nullptr;
+            /// @brief The adapted luminance and the exposure (device-local)
+            std::shared_ptr<app::graphics::Buffer> m_exposure_buffer = nullptr;
+            /// @brief Builds the histogram: a descriptor set per frame
+            std::shared_ptr<app::graphics::ComputePass> m_histogram_pass = nullptr;
+            /// @brief Averages the histogram and adapts the exposure
+            std::shared_ptr<app::graphics::ComputePass> m_average_pass = nullptr;
+            /// @brief Tonemaps the input: a descriptor set per frame
+            std::shared_ptr<app::graphics::ComputePass> m_tonemap_pass = nullptr;
+            /// @brief The HDR images to tonemap
+            std::vector<VkImageView> m_input_views;
+            /// @brief The bloom to composite
+            VkImageView m_bloom_view = VK_NULL_HANDLE;
+            /// @brief The color grading LUT
+            VkImageView m_lut_view = VK_NULL_HANDLE;
+            /// @brief The bilinear sampler of the bloom and the LUT (owned by the caller)
+            VkSampler m_linear_sampler = VK_NULL_HANDLE;
+            /// @brief The sampler of the inputs (texel fetches only)
+            VkSampler m_sampler = VK_NULL_HANDLE;
+            /// @brief The push constants of the last `recordExposure`
+            PushConstants m_push_constants{};
+            /// @brief The time of the last `recordExposure`, to adapt at the same speed at any frame rate
+            std::optional<std::chrono::steady_clock::time_point> m_last_record = std::nullopt;
+            /// @brief If the buffers have been initialized
+            bool m_initialized = false;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // tonemap_h
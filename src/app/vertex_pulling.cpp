@@ -0,0 +1,355 @@
+//
+//  vertex_pulling.cpp
+//
+
+#include "vertex_pulling.hpp"
+#include "../project.hpp"
+#include "../utils/debug_tools.h"
+#include "depth.hpp"
+#include "engine.hpp"
+#include "pipeline.hpp"
+#include "shaders.h"
+#include <algorithm>
+
+app::graphics::VertexPulling::VertexPulling(){};
+
+app::graphics::VertexPulling::~VertexPulling()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    if (VK_NULL_HANDLE != m_pipeline)
+    {
+        vkDestroyPipeline(graphics_device, m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_pipeline_layout)
+    {
+        vkDestroyPipelineLayout(graphics_device, m_pipeline_layout, nullptr);
+        m_pipeline_layout = VK_NULL_HANDLE;
+    }
+    m_vertex_buffer = nullptr;
+    m_index_buffer = nullptr;
+    m_record_buffer = nullptr;
+    m_draw_buffer = nullptr;
+    m_draws.clear();
+    m_index_counts.clear();
+};
+
+utils::VResult app::graphics::VertexPulling::create(const uint32_t max_vertex_bytes, const uint32_t max_indices, const uint32_t max_meshes)
+{
+    // The pipeline replaces the main subpass draws: it would need a depth-only variant for
+    // the pre-pass
+    if (!Project::VERTEX_PULLING || Project::DEPTH_PRE_PASS)
+        return utils::VResult::Ok();
+    if (!app::Engine::getInstance()->m_graphics_device.supportsBufferDeviceAddress())
+    {
+        LogW("> Buffer device addresses are not supported: the vertex pulling is disabled");
+        return utils::VResult::Ok();
+    }
+    Log("> Creating the vertex pulling (%d vertex bytes, %d indices, %d meshes)", max_vertex_bytes, max_indices, max_meshes);
+    m_max_vertex_bytes = max_vertex_bytes;
+    m_max_indices = max_indices;
+    m_max_meshes = max_meshes;
+    m_draws.reserve(m_max_meshes);
+    m_index_counts.reserve(m_max_meshes);
+
+    // The arenas and the records are only read through their addresses
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    m_vertex_buffer = std::make_shared<app::graphics::Buffer>();
+    m_index_buffer = std::make_shared<app::graphics::Buffer>();
+    m_record_buffer = std::make_shared<app::graphics::Buffer>();
+    m_draw_buffer = std::make_shared<app::graphics::Buffer>();
+    if (const auto result = m_vertex_buffer->create(std::max(m_max_vertex_bytes, 4u), usage, true); result.IsError())
+        return result;
+    if (const auto result = m_index_buffer->create(std::max(m_max_indices, 1u) * sizeof(uint32_t), usage, true); result.IsError())
+        return result;
+    if (const auto result = m_record_buffer->create(std::max(m_max_meshes, 1u) * sizeof(GpuDraw), usage, true); result.IsError())
+        return result;
+    if (const auto result = m_draw_buffer->create(
+            std::max(m_max_meshes, 1u) * sizeof(VkDrawIndirectCommand),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            true);
+        result.IsError())
+        return result;
+    m_record_address = m_record_buffer->getDeviceAddress();
+    if (const auto result = createPipeline(); result.IsError())
+    {
+        LogE("Error creating the vertex pulling pipeline");
+        return result;
+    }
+    return utils::VResult::Ok();
+}
+
+utils::VResult app::graphics::VertexPulling::createPipeline()
+{
+    const auto graphics_device = app::Engine::getInstance()->m_graphics_device.getLogicalDevice();
+    const auto graphics_pipeline = app::Engine::getInstance()->m_render->getGraphicsPipeline();
+
+    // Set 0 is the lights of the scene fragment shader, as in the scene pipeline layout
+    const VkDescriptorSetLayout lighting_set_layout = app::Engine::getInstance()->m_render->getClusteredLighting()->getDescriptorSetLayout();
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &lighting_set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+    if (const auto result = vkCreatePipelineLayout(graphics_device, &pipeline_layout_create_info, nullptr, &m_pipeline_layout); result != VK_SUCCESS)
+    {
+        LogE("> vkCreatePipelineLayout: error 0x%08x for the vertex pulling", result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline layout of the vertex pulling");
+    }
+
+    // The fragment shader of the scene: same outputs from the vertex shader
+    const char* shader_filepaths[2] = {
+        "shaders/vertex_pulling.vert.spv",
+        Project::DEFERRED_SHADING ? "shaders/gbuffer.frag.spv" : "shaders/basic_triangle.frag.spv",
+    };
+    const VkShaderStageFlagBits shader_stages[2] = {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT};
+    VkShaderModule shader_modules[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkPipelineShaderStageCreateInfo shader_stage_create_infos[2];
+    const auto destroy_shader_modules = [&]() {
+        for (uint32_t i = 0; i < 2; ++i)
+        {
+            if (VK_NULL_HANDLE != shader_modules[i])
+                vkDestroyShaderModule(graphics_device, shader_modules[i], nullptr);
+        }
+    };
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        const auto shader_module_result = app::graphics::Pipeline::loadShaderModule(shader_filepaths[i]);
+        if (shader_module_result.IsError())
+        {
+            destroy_shader_modules();
+            return utils::VResult::Error((char*)"Cannot create the shader modules of the vertex pulling");
+        }
+        shader_modules[i] = shader_module_result.GetValue();
+        shader_stage_create_infos[i] = VkPipelineShaderStageCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = shader_stages[i],
+            .module = shader_modules[i],
+            .pName = "main",
+        };
+    }
+
+    // No vertex bindings nor attributes: the same pipeline draws every vertex layout
+    VkPipelineVertexInputStateCreateInfo vertex_input_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    };
+    VkPipelineInputAssemblyStateCreateInfo assembly_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    // Same viewport and scissor as the scene
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = sizeof(dynamic_states) / sizeof(VkDynamicState),
+        .pDynamicStates = dynamic_states,
+    };
+    VkPipelineViewportStateCreateInfo viewport_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+    // Same rasterization as the scene pipeline
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_BACK_BIT,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1,
+    };
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = app::Engine::getInstance()->m_render->getSampleCount(),
+        .sampleShadingEnable = VK_FALSE,
+    };
+    // Never with the depth pre-pass (see create)
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = app::graphics::Depth::getCompareOp(),
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE,
+    };
+    // The color (or the G-buffer) and the motion vectors, written unmodified
+    const std::vector<VkPipelineColorBlendAttachmentState> color_blend_attachments(
+        graphics_pipeline->getMainColorAttachmentCount(),
+        VkPipelineColorBlendAttachmentState{
+            .blendEnable = VK_FALSE,
+            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        });
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = static_cast<uint32_t>(color_blend_attachments.size()),
+        .pAttachments = color_blend_attachments.data(),
+    };
+    VkGraphicsPipelineCreateInfo pipeline_info{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 2,
+        .pStages = shader_stage_create_infos,
+        .pVertexInputState = &vertex_input_create_info,
+        .pInputAssemblyState = &assembly_state_create_info,
+        .pViewportState = &viewport_state_create_info,
+        .pRasterizationState = &rasterizer_state_create_info,
+        .pMultisampleState = &multisample_state_create_info,
+        .pDepthStencilState = &depth_stencil_state_create_info,
+        .pColorBlendState = &color_blend_state_create_info,
+        .pDynamicState = &dynamic_state_create_info,
+        .layout = m_pipeline_layout,
+        .renderPass = graphics_pipeline->getRenderPass(),
+        .subpass = graphics_pipeline->getMainSubpass(),
+    };
+    const auto pipeline_result = vkCreateGraphicsPipelines(graphics_device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_pipeline);
+    // The modules are not needed anymore once the pipeline is created
+    destroy_shader_modules();
+    if (pipeline_result != VK_SUCCESS)
+    {
+        LogE("> vkCreateGraphicsPipelines: error 0x%08x for the vertex pulling", pipeline_result);
+        return utils::VResult::Error((char*)"Cannot create the pipeline of the vertex pulling");
+    }
+    return utils::VResult::Ok();
+}
+
+bool app::graphics::VertexPulling::isEnabled() const noexcept
+{
+    return VK_NULL_HANDLE != m_pipeline;
+}
+
+app::graphics::VertexPulling::VertexFormat app::graphics::VertexPulling::getSceneVertexFormat() noexcept
+{
+    return VertexFormat{
+        .m_stride = sizeof(app::shaders::Vertex),
+        .m_position_offset = offsetof(app::shaders::Vertex, m_position),
+        .m_position_size = 2,
+        .m_color_offset = offsetof(app::shaders::Vertex, m_color),
+    };
+}
+
+utils::Result<uint32_t> app::graphics::VertexPulling::addMesh(
+    const void* vertices,
+    const uint32_t vertex_count,
+    const VertexFormat& format,
+    const std::vector<uint32_t>& indices)
+{
+    if (!isEnabled())
+        return utils::Result<uint32_t>::Error((char*)"The vertex pulling is disabled");
+    // The shader reads 32 bits floats
+    const bool aligned = format.m_stride % sizeof(float) == 0 &&
+                         format.m_position_offset % sizeof(float) == 0 &&
+                         (format.m_color_offset == NO_COLOR || format.m_color_offset % sizeof(float) == 0);
+    const bool in_vertex = format.m_position_offset + format.m_position_size * sizeof(float) <= format.m_stride &&
+                           (format.m_color_offset == NO_COLOR || format.m_color_offset + 3 * sizeof(float) <= format.m_stride);
+    if (!aligned || !in_vertex || format.m_position_size < 2 || format.m_position_size > 3)
+        return utils::Result<uint32_t>::Error((char*)"Invalid vertex format for the vertex pulling");
+    for (const uint32_t index : indices)
+    {
+        if (index >= vertex_count)
+            return utils::Result<uint32_t>::Error((char*)"An index of the mesh is out of its vertices");
+    }
+    const uint64_t vertex_bytes = static_cast<uint64_t>(vertex_count) * format.m_stride;
+    if (m_draws.size() >= m_max_meshes ||
+        m_vertex_bytes + vertex_bytes > m_max_vertex_bytes ||
+        m_index_count + indices.size() > m_max_indices)
+    {
+        LogE("> The vertex pulling arenas are full (%d meshes, %d vertex bytes, %d indices)", m_max_meshes, m_max_vertex_bytes, m_max_indices);
+        return utils::Result<uint32_t>::Error((char*)"Too many meshes for the vertex pulling");
+    }
+
+    // Meshes are added at load time: appended, the frames in flight only read the previous ones
+    if (vertex_bytes > 0)
+        m_vertex_buffer->write(vertices, vertex_bytes, m_vertex_bytes);
+    if (!indices.empty())
+        m_index_buffer->write(indices.data(), indices.size() * sizeof(uint32_t), m_index_count * sizeof(uint32_t));
+    const uint32_t float_size = static_cast<uint32_t>(sizeof(float));
+    m_draws.push_back(GpuDraw{
+        .m_vertices = m_vertex_buffer->getDeviceAddress() + m_vertex_bytes,
+        .m_indices = m_index_buffer->getDeviceAddress() + m_index_count * sizeof(uint32_t),
+        .m_stride = format.m_stride / float_size,
+        .m_position_offset = format.m_position_offset / float_size,
+        .m_position_size = format.m_position_size,
+        .m_color_offset = format.m_color_offset == NO_COLOR ? NO_COLOR : format.m_color_offset / float_size,
+    });
+    m_index_counts.push_back(static_cast<uint32_t>(indices.size()));
+    const uint32_t mesh = static_cast<uint32_t>(m_draws.size() - 1);
+    m_record_buffer->write(&m_draws.back(), sizeof(GpuDraw), mesh * sizeof(GpuDraw));
+    // The first instance selects the record of the mesh in a merged draw
+    const VkDrawIndirectCommand draw_command{
+        .vertexCount = static_cast<uint32_t>(indices.size()),
+        .instanceCount = 1,
+        .firstVertex = 0,
+        .firstInstance = mesh,
+    };
+    m_draw_buffer->write(&draw_command, sizeof(VkDrawIndirectCommand), mesh * sizeof(VkDrawIndirectCommand));
+    m_vertex_bytes += static_cast<uint32_t>(vertex_bytes);
+    m_index_count += static_cast<uint32_t>(indices.size());
+    // The cached draws of the scene miss the new mesh
+    app::Engine::getInstance()->m_render->getGraphicsCommand()->invalidateStatic();
+    return utils::Result<uint32_t>::Ok(mesh);
+}
+
+void app::graphics::VertexPulling::bind(VkCommandBuffer command_buffer) const
+{
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    const VkDescriptorSet lighting_set = app::Engine::getInstance()->m_render->getClusteredLighting()->getDescriptorSet();
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &lighting_set, 0, nullptr);
+}
+
+void app::graphics::VertexPulling::draw(VkCommandBuffer command_buffer, const uint32_t mesh, const glm::vec2& jitter) const
+{
+    if (!isEnabled())
+        return;
+    assert(mesh < m_draws.size());
+    bind(command_buffer);
+    const PushConstants push_constants{
+        .m_jitter = jitter,
+        .m_draws = m_record_address,
+        .m_draw = m_draws[mesh],
+        .m_merged = 0,
+    };
+    vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &push_constants);
+    vkCmdDraw(command_buffer, m_index_counts[mesh], 1, 0, 0);
+}
+
+void app::graphics::VertexPulling::drawAll(VkCommandBuffer command_buffer, const glm::vec2& jitter) const
+{
+    if (!isEnabled() || m_draws.empty())
+        return;
+    bind(command_buffer);
+    const PushConstants push_constants{
+        .m_jitter = jitter,
+        .m_draws = m_record_address,
+        .m_draw = {},
+        .m_merged = 1,
+    };
+    vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &push_constants);
+    const uint32_t draw_count = static_cast<uint32_t>(m_draws.size());
+    if (app::Engine::getInstance()->m_graphics_device.supportsMultiDrawIndirect())
+    {
+        vkCmdDrawIndirect(command_buffer, m_draw_buffer->getBuffer(), 0, draw_count, sizeof(VkDrawIndirectCommand));
+    }
+    else
+    {
+        for (uint32_t i = 0; i < draw_count; ++i)
+            vkCmdDrawIndirect(command_buffer, m_draw_buffer->getBuffer(), i * sizeof(VkDrawIndirectCommand), 1, sizeof(VkDrawIndirectCommand));
+    }
+}
+
+std::shared_ptr<app::graphics::Buffer> app::graphics::VertexPulling::getDrawBuffer() const noexcept
+{
+    return m_draw_buffer;
+}
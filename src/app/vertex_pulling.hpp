@@ -0,0 +1,166 @@
+//
+//  vertex_pulling.hpp
+//
+
+#pragma once
+#ifndef vertex_pulling_h
+#define vertex_pulling_h
+
+#include "../utils/result.h"
+#include "buffer.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace app
+{
+    namespace graphics
+    {
+        /// @brief Draws meshes of any vertex layout with a single pipeline, without
+        /// fixed-function vertex input.
+        ///
+        /// The vertices and the indices of all the meshes are stored in two arenas, read
+        /// by the vertex shader through their buffer device address: the draw of a mesh
+        /// pushes the address of its vertices and indices, and the description of its
+        /// vertex layout (non-indexed draw of `index count` vertices, the shader reads the
+        /// index itself). As the pointers also live in a table of records, one per mesh,
+        /// meshes of different layouts are merged in a single indirect draw: each indirect
+        /// command selects its record with its first instance.
+        class VertexPulling
+        {
+        public:
+            /// @brief The value of VertexFormat::m_color_offset for meshes without colors
+            static constexpr uint32_t NO_COLOR = UINT32_MAX;
+
+            /// @brief The layout of the vertices of a mesh. The offsets and the stride are
+            /// in bytes, multiples of 4 (32 bits floats)
+            struct VertexFormat
+            {
+                /// @brief The size of a vertex
+                uint32_t m_stride;
+                /// @brief The offset of the position
+                uint32_t m_position_offset;
+                /// @brief The number of components of the position: 2 (at mid-depth) or 3
+                uint32_t m_position_size;
+                /// @brief The offset of the color (3 floats), or NO_COLOR (white)
+                uint32_t m_color_offset = NO_COLOR;
+            };
+
+            /// @brief Public constructor
+            VertexPulling();
+            /// @brief Public destructor
+            ~VertexPulling();
+            /// @brief Creates the vertex and index arenas, the draw records, and the pipeline.
+            /// Nothing is created if VERTEX_PULLING is disabled, if the device does not
+            /// support buffer device addresses, or with the depth pre-pass.
+            /// @param max_vertex_bytes The maximum size of the vertices of all the meshes, in bytes
+            /// @param max_indices The maximum number of indices of all the meshes
+            /// @param max_meshes The maximum number of meshes
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult create(const uint32_t max_vertex_bytes, const uint32_t max_indices, const uint32_t max_meshes);
+            /// @brief Returns if the meshes can be drawn with the vertex pulling
+            bool isEnabled() const noexcept;
+            /// @brief Returns the format of app::shaders::Vertex, the vertex of the scene
+            static VertexFormat getSceneVertexFormat() noexcept;
+            /// @brief Copies a mesh in the arenas
+            /// @param vertices The vertices of the mesh
+            /// @param vertex_count The number of vertices
+            /// @param format The layout of the vertices
+            /// @param indices The triangle list of the mesh
+            /// @return The identifier of the mesh, or an error if the format is invalid or
+            /// if the arenas are full
+            utils::Result<uint32_t> addMesh(
+                const void* vertices,
+                const uint32_t vertex_count,
+                const VertexFormat& format,
+                const std::vector<uint32_t>& indices);
+            /// @brief Draws a mesh, its pointers and layout in the push constants.
+            /// Should be recorded in the main subpass of the scene render pass (binds its own
+            /// pipeline and the lights: the scene pipeline has to be bound again for more draws).
+            /// @param command_buffer The command buffer being recorded
+            /// @param mesh The identifier returned by `addMesh`
+            /// @param jitter The sub-pixel offset of the projection of the frame
+            void draw(VkCommandBuffer command_buffer, const uint32_t mesh, const glm::vec2& jitter) const;
+            /// @brief Draws all the meshes, whatever their layout, in a single indirect draw
+            /// (a draw per mesh without multiDrawIndirect). Same recording rules as `draw`.
+            /// @param command_buffer The command buffer being recorded
+            /// @param jitter The sub-pixel offset of the projection of the frame
+            void drawAll(VkCommandBuffer command_buffer, const glm::vec2& jitter) const;
+            /// @brief Returns the indirect commands of the meshes (VkDrawIndirectCommand, in
+            /// the order of the meshes), for a GPU pass to compact them
+            std::shared_ptr<app::graphics::Buffer> getDrawBuffer() const noexcept;
+
+        private:
+            /// @brief The pointers and the vertex layout of a mesh, as read by the vertex
+            /// shader (std430). The offsets and the stride are in floats.
+            struct GpuDraw
+            {
+                /// @brief The address of the vertices
+                VkDeviceAddress m_vertices;
+                /// @brief The address of the indices
+                VkDeviceAddress m_indices;
+                /// @brief The size of a vertex
+                uint32_t m_stride;
+                /// @brief The offset of the position
+                uint32_t m_position_offset;
+                /// @brief The number of components of the position
+                uint32_t m_position_size;
+                /// @brief The offset of the color, or NO_COLOR
+                uint32_t m_color_offset;
+            };
+            /// @brief The push constants of the vertex shader
+            struct PushConstants
+            {
+                /// @brief The sub-pixel offset of the projection, in NDC units
+                glm::vec2 m_jitter;
+                /// @brief The address of the draw records
+                VkDeviceAddress m_draws;
+                /// @brief The mesh of a direct draw
+                GpuDraw m_draw;
+                /// @brief 1 if the draw record is selected by the first instance (merged
+                /// indirect draw), 0 to read `m_draw`
+                uint32_t m_merged;
+            };
+            /// @brief VertexPulling should not be cloneable
+            VertexPulling(VertexPulling& other) = delete;
+            /// @brief VertexPulling should not be assignable
+            void operator=(const VertexPulling& other) = delete;
+            /// @brief Creates the pipeline layout and the pipeline, without vertex input
+            /// @return A VResult type to know if the function succeeded or not
+            utils::VResult createPipeline();
+            /// @brief Binds the pipeline and the lights
+            void bind(VkCommandBuffer command_buffer) const;
+            /// @brief The draw record of each mesh
+            std::vector<GpuDraw> m_draws;
+            /// @brief The number of indices of each mesh
+            std::vector<uint32_t> m_index_counts;
+            /// @brief The size of the vertices of all the meshes, in bytes
+            uint32_t m_vertex_bytes = 0;
+            /// @brief The number of indices of all the meshes
+            uint32_t m_index_count = 0;
+            /// @brief The maximum size of the vertices of all the meshes, in bytes
+            uint32_t m_max_vertex_bytes = 0;
+            /// @brief The maximum number of indices of all the meshes
+            uint32_t m_max_indices = 0;
+            /// @brief The maximum number of meshes
+            uint32_t m_max_meshes = 0;
+            /// @brief The vertices of all the meshes (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_vertex_buffer = nullptr;
+            /// @brief The indices of all the meshes (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_index_buffer = nullptr;
+            /// @brief The draw records of the meshes (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_record_buffer = nullptr;
+            /// @brief An indirect draw command per mesh (host-visible)
+            std::shared_ptr<app::graphics::Buffer> m_draw_buffer = nullptr;
+            /// @brief The address of the draw records
+            VkDeviceAddress m_record_address = 0;
+            /// @brief The layout of the pipeline: the lights (set 0) and the push constants
+            VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+            /// @brief The pipeline, for all the vertex layouts
+            VkPipeline m_pipeline = VK_NULL_HANDLE;
+        };
+    } // namespace graphics
+} // namespace app
+
+#endif // vertex_pulling_h
@@ -110,11 +110,13 @@ void app::Application::setupImGui()
     init_info.Queue = m_engine->m_graphics_device.getGraphicsQueue();
     init_info.QueueFamily = m_engine->m_graphics_device.m_graphics_queue_family_index;
     init_info.DescriptorPool = m_engine->getDescriptorPool();
+    // ImGui is drawn in its own render pass, at the native resolution
+    init_info.Subpass = 0;
     // TODO: check to retrieve the information BETTER
     init_info.MinImageCount = 2;
     init_info.ImageCount = 2;
     init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
-    ImGui_ImplVulkan_Init(&init_info, m_engine->m_render->getGraphicsPipeline()->getRenderPass());
+    ImGui_ImplVulkan_Init(&init_info, m_engine->m_render->getGraphicsPipeline()->getUIRenderPass());
     Log("<< Ended up the init of ImplVulkan with ImGui...");
 
     Log("< Ending ImGui setup...");
@@ -123,53 +125,49 @@ void app::Application::setupImGui()
 utils::VResult app::Application::uploadImGuiFont()
 {
     Log("> Uploading ImGui font...");
-    // Use any command queue
-    auto command_buffer_obj = m_engine->m_render->getGraphicsCommand();
-    VkCommandPool* command_pool = command_buffer_obj->getPool();
-    VkCommandBuffer* command_buffer = command_buffer_obj->getBuffer();
-    VkDevice device = m_engine->m_graphics_device.getLogicalDevice();
-
-    if (const auto result_status = vkResetCommandPool(device, *command_pool, 0); result_status != VK_SUCCESS)
+    // Use any command queue, with a command buffer of the frame pools (recycled once the
+    // first frame has completed)
+    const auto command_buffer_result = m_engine->m_render->getGraphicsCommand()->acquireBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    if (command_buffer_result.IsError())
     {
-        LogE("vkResetCommandPool to upload ImGui font failed");
+        LogE("acquireBuffer to upload ImGui font failed");
         return utils::VResult::Error((char*)"canno't upload ImGui font");
     }
+    VkCommandBuffer command_buffer = command_buffer_result.GetValue();
+
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    if (const auto result_status = vkBeginCommandBuffer(*command_buffer, &begin_info); result_status != VK_SUCCESS)
+    if (const auto result_status = vkBeginCommandBuffer(command_buffer, &begin_info); result_status != VK_SUCCESS)
     {
         LogE("vkBeginCommandBuffer to upload ImGui font failed");
         return utils::VResult::Error((char*)"canno't upload ImGui font");
     }
 
-    ImGui_ImplVulkan_CreateFontsTexture(*command_buffer);
+    ImGui_ImplVulkan_CreateFontsTexture(command_buffer);
 
-    VkSubmitInfo end_info = {};
-    end_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    end_info.commandBufferCount = 1;
-    end_info.pCommandBuffers = command_buffer;
-    if (const auto result_status = vkEndCommandBuffer(*command_buffer); result_status != VK_SUCCESS)
+    if (const auto result_status = vkEndCommandBuffer(command_buffer); result_status != VK_SUCCESS)
     {
         LogE("vkEndCommandBuffer to upload ImGui font failed");
         return utils::VResult::Error((char*)"canno't upload ImGui font");
     }
-    if (const auto result_status = vkQueueSubmit(m_engine->m_graphics_device.getGraphicsQueue(), 1, &end_info, VK_NULL_HANDLE); result_status != VK_SUCCESS)
-    {
-        LogE("vkQueueSubmit to upload ImGui font failed");
-        return utils::VResult::Error((char*)"canno't upload ImGui font");
-    }
-
-    if (const auto result_status = vkDeviceWaitIdle(device); result_status != VK_SUCCESS)
-    {
-        LogE("vkDeviceWaitIdle to upload ImGui font failed");
-        return utils::VResult::Error((char*)"canno't upload ImGui font");
-    }
-    ImGui_ImplVulkan_DestroyFontUploadObjects();
+    // Submitted with the first frame, no wait: the staging objects are destroyed once it has
+    // completed
+    m_engine->m_render->getSubmitBatcher(m_engine->m_graphics_device.getGraphicsQueue())->add(command_buffer);
+    m_font_upload_frame = m_current_frame;
     Log("< Ending up uploading ImGui font...");
     return utils::VResult::Ok();
 }
 
+void app::Application::releaseImGuiFontUpload()
+{
+    // The fence of the previous frames has been waited for by acquireImage
+    if (m_font_upload_frame == std::nullopt || m_current_frame <= m_font_upload_frame.value())
+        return;
+    ImGui_ImplVulkan_DestroyFontUploadObjects();
+    m_font_upload_frame = std::nullopt;
+}
+
 void app::Application::drawDebugToolImGui()
 {
     // Optimization technique
@@ -215,6 +213,41 @@ void app::Application::drawDebugToolImGui()
             ImGui::Text("Number of bytes allocated in VkDeviceMemory blocks: %lluB", stats.blockBytes);
             ImGui::Text("Total number of bytes occupied by all VmaAllocation objects: %lluB", stats.allocationBytes);
 
+            ImGui::TreePop();
+            ImGui::Separator();
+        }
+        if (ImGui::TreeNode("GPU timings"))
+        {
+            const auto dynamic_resolution = m_engine->m_render->getDynamicResolution();
+            const VkExtent2D render_extent = m_engine->m_render->getRenderExtent();
+            ImGui::Text("Render scale: %.2f (%dx%d)", dynamic_resolution->getScale(), render_extent.width, render_extent.height);
+            ImGui::Text("Smoothed GPU frame time: %.3f ms", dynamic_resolution->getFrameTime());
+            ImGui::Text("Dynamic lights: %d", m_engine->m_render->getClusteredLighting()->getLightCount());
+            ImGui::Text(
+                "Shadow views: %d (%d refreshed)",
+                m_engine->m_render->getShadowAtlas()->getViewCount(),
+                m_engine->m_render->getShadowAtlas()->getUpdateCount());
+            for (const auto& timing : m_engine->m_render->getGpuTimer()->getTimings())
+                ImGui::Text("%s: %.3f ms", timing.m_name, timing.m_ms);
+
+            ImGui::TreePop();
+            ImGui::Separator();
+        }
+        if (ImGui::TreeNode("Post-processing"))
+        {
+            const auto post_processing = m_engine->m_render->getPostProcessing();
+            auto settings = post_processing->getSettings();
+            ImGui::Checkbox("Bloom", &settings.m_bloom);
+            ImGui::SliderFloat("Bloom intensity", &settings.m_bloom_intensity, 0.0f, 0.5f);
+            ImGui::SliderFloat("Bloom threshold", &settings.m_bloom_threshold, 0.0f, 4.0f);
+            ImGui::Checkbox("FXAA", &settings.m_fxaa);
+            ImGui::SliderFloat("Sharpness", &settings.m_sharpness, 0.0f, 1.0f);
+            ImGui::Checkbox("Color grading", &settings.m_color_grading);
+            ImGui::ColorEdit3("Color filter", &settings.m_color_filter.x);
+            ImGui::SliderFloat("Saturation", &settings.m_saturation, 0.0f, 2.0f);
+            ImGui::SliderFloat("Contrast", &settings.m_contrast, 0.5f, 2.0f);
+            post_processing->setSettings(settings);
+
             ImGui::TreePop();
             ImGui::Separator();
         }
@@ -262,6 +295,9 @@ void app::Application::drawFrame()
         // Real rendering time
         auto begin_real_rendering_timer = utils::Timer();
         m_engine->m_render->getGraphicsPipeline()->acquireImage();
+#ifdef IMGUI
+        releaseImGuiFontUpload();
+#endif
         m_engine->m_render->getGraphicsPipeline()->draw();
         m_engine->m_render->getGraphicsPipeline()->present();
         const auto rendering_time_diff = begin_real_rendering_timer.diff();
@@ -281,6 +317,9 @@ void app::Application::drawFrame()
     // Real rendering time
     auto begin_real_rendering_timer = utils::Timer();
     m_engine->m_render->getGraphicsPipeline()->acquireImage();
+#ifdef IMGUI
+    releaseImGuiFontUpload();
+#endif
     m_engine->m_render->getGraphicsPipeline()->draw();
     m_engine->m_render->getGraphicsPipeline()->present();
     const uint64_t rendering_time_diff = begin_real_rendering_timer.diff();
@@ -66,6 +66,12 @@ namespace app
         void setupImGui();
         /// @brief Upload the ImGui font to avoid rendering error(s)
         utils::VResult uploadImGuiFont();
+        /// @brief Destroy the staging objects of the ImGui font, once the frame that
+        /// uploaded it has completed
+        void releaseImGuiFontUpload();
+        /// @brief The frame the ImGui font is uploaded with, until its staging objects
+        /// are destroyed
+        std::optional<uint64_t> m_font_upload_frame = std::nullopt;
         /// @brief The draw function for the debug tool
         void drawDebugToolImGui();
         /// @brief Clean the instance(s) of ImGui
@@ -52,6 +52,159 @@ namespace Project
     /// @brief Minimum bug fix version number of the Vulkan API
     constexpr uint8_t const VULKAN_MIN_VERSION_BUGFIX = 211;
 
+    /// @brief The size of the rings of per-frame resources (transient command pools, upload
+    /// rings, query slots, descriptor regions). The renderer waits for the fence of the
+    /// previous frame before recording a new one, so a single slot is in use on the GPU
+    /// today: the second one lets a fence per frame overlap two frames without changing them
+    constexpr uint32_t const FRAMES_IN_FLIGHT = 2;
+
+    /// @brief Maps the near plane to 1 and the far plane to 0, with a GREATER depth test,
+    /// to spread the precision of float depth formats over the whole view distance
+    constexpr bool const DEPTH_REVERSED_Z = true;
+    /// @brief Renders a depth-only pre-pass before the main pass, which then only shades
+    /// the visible fragments (EQUAL depth test, no depth write)
+    constexpr bool const DEPTH_PRE_PASS = false;
+    /// @brief Writes the surface attributes in a G-buffer subpass, then shades each pixel
+    /// once in a lighting subpass of the same render pass, which reads the G-buffer as
+    /// input attachments (transient: on tile-based GPUs, the G-buffer never leaves the
+    /// tile memory). Disables MSAA.
+    constexpr bool const DEFERRED_SHADING = false;
+    /// @brief Number of samples per pixel for the multisample anti-aliasing (1, 2, 4 or 8).
+    /// Clamped to the maximum supported by the device - 1 disables MSAA
+    constexpr uint8_t const MSAA_SAMPLES = 4;
+    /// @brief Renders the scene at a resolution that adapts to the GPU frame time, and
+    /// upscales it to the swapchain (the UI always stays at the native resolution)
+    constexpr bool const DYNAMIC_RESOLUTION = true;
+    /// @brief Minimal scale of the scene resolution, for each axis
+    constexpr float const DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+    /// @brief Maximal scale of the scene resolution, for each axis
+    constexpr float const DYNAMIC_RESOLUTION_MAX_SCALE = 1.0f;
+    /// @brief The GPU frame time to stay under, in ms: 90% of the frame period
+    constexpr double const GPU_FRAME_BUDGET_MS = 0.9 * 1000.0 / APPLICATION_FPS_LIMIT.value_or(FPS_LIMIT_60);
+    /// @brief Jitters the projection and reconstructs the scene at the swapchain resolution
+    /// from the history of the previous frames, instead of a bilinear upscale
+    constexpr bool const TEMPORAL_UPSCALING = true;
+    /// @brief Maximum number of dynamic lights (point and spot) binned in the clusters each frame
+    constexpr uint32_t const MAX_LIGHTS = 4096;
+    /// @brief Width and height of the shadow atlas, in pixels
+    constexpr uint32_t const SHADOW_ATLAS_SIZE = 4096;
+    /// @brief Width and height of a shadow view in the atlas, in pixels (64 views in the atlas)
+    constexpr uint32_t const SHADOW_TILE_SIZE = 512;
+    /// @brief Maximum number of shadow views refreshed each frame, the others keeping
+    /// the shadows of a previous frame
+    constexpr uint32_t const SHADOW_UPDATES_PER_FRAME = 4;
+    /// @brief Number of shadow cascades of the directional light (2 to 4)
+    constexpr uint32_t const SHADOW_CASCADE_COUNT = 4;
+    /// @brief Width and height of a shadow cascade, in pixels
+    constexpr uint32_t const SHADOW_CASCADE_SIZE = 2048;
+    /// @brief Distribution of the cascade splits: 0 for uniform splits, 1 for logarithmic splits
+    constexpr float const SHADOW_CASCADE_SPLIT_LAMBDA = 0.75f;
+    /// @brief Distance from the camera after which the directional light casts no shadows
+    constexpr float const SHADOW_DISTANCE = 50.0f;
+    /// @brief Maximum number of objects tested each frame with an occlusion query
+    constexpr uint32_t const MAX_OCCLUSION_QUERIES = 1024;
+    /// @brief Skips the draws of the occluded objects on the GPU (VK_EXT_conditional_rendering),
+    /// if supported. Otherwise, the occlusion results are read back one frame later
+    constexpr bool const OCCLUSION_CONDITIONAL_RENDERING = true;
+    /// @brief Maximum number of levels of detail generated for a mesh, the base mesh included
+    constexpr uint32_t const LOD_MAX_LEVELS = 6;
+    /// @brief Number of indices of a level of detail, relative to the previous level
+    constexpr float const LOD_INDEX_RATIO = 0.5f;
+    /// @brief Maximum geometric error of the coarsest level of detail, relative to the mesh radius
+    constexpr float const LOD_MAX_ERROR = 0.1f;
+    /// @brief Maximum projected error of the drawn levels of detail, in pixels of the render extent
+    constexpr float const LOD_PIXEL_ERROR = 1.0f;
+    /// @brief Fraction of LOD_PIXEL_ERROR removed from the threshold of a switch to a coarser level
+    constexpr float const LOD_HYSTERESIS = 0.25f;
+    /// @brief Maximum number of meshes with levels of detail
+    constexpr uint32_t const LOD_MAX_MESHES = 1024;
+    /// @brief Maximum number of mesh instances whose level of detail is selected on the GPU
+    constexpr uint32_t const LOD_MAX_INSTANCES = 65536;
+    /// @brief Maximum number of bind pose vertices of all the skinned meshes
+    constexpr uint32_t const SKINNING_MAX_MESH_VERTICES = 262144;
+    /// @brief Maximum number of skinned vertices of all the instances, written each frame
+    constexpr uint32_t const SKINNING_MAX_SKINNED_VERTICES = 524288;
+    /// @brief Maximum number of joints of all the skinned instances
+    constexpr uint32_t const SKINNING_MAX_JOINTS = 65536;
+    /// @brief Maximum number of skinned instances
+    constexpr uint32_t const SKINNING_MAX_INSTANCES = 1024;
+    /// @brief Number of threads evaluating the animations, besides the main one (0 for one per hardware thread)
+    constexpr uint32_t const ANIMATION_WORKER_THREADS = 0;
+    /// @brief Maximum number of vertices of a meshlet (the mesh shader output limit)
+    constexpr uint32_t const MESHLET_MAX_VERTICES = 64;
+    /// @brief Maximum number of triangles of a meshlet
+    constexpr uint32_t const MESHLET_MAX_TRIANGLES = 124;
+    /// @brief Maximum number of meshlets of all the meshes
+    constexpr uint32_t const MESHLET_MAX_COUNT = 65536;
+    /// @brief Maximum number of mesh instances drawn by meshlets
+    constexpr uint32_t const MESHLET_MAX_INSTANCES = 4096;
+    /// @brief Maximum number of meshlets of all the instances, tested each frame
+    constexpr uint32_t const MESHLET_MAX_CLUSTERS = 262144;
+    /// @brief Maximum number of meshlet vertices, and of mesh vertices, of all the meshes
+    /// (mesh shader path: twice as many meshlet triangles)
+    constexpr uint32_t const MESHLET_MAX_VERTEX_COUNT = 1048576;
+    /// @brief Culls and draws the meshlets with task and mesh shaders (VK_EXT_mesh_shader) if
+    /// supported, rather than with a compute pass and indirect draws
+    constexpr bool const MESHLET_MESH_SHADERS = true;
+    /// @brief Reads the vertices and the indices of the meshes from storage buffers in the
+    /// vertex shader (buffer device address), with a single pipeline for all the vertex layouts
+    constexpr bool const VERTEX_PULLING = true;
+    /// @brief Maximum size of the vertices of all the meshes read by the vertex pulling, in bytes
+    constexpr uint32_t const VERTEX_PULLING_MAX_VERTEX_BYTES = 16 * 1024 * 1024;
+    /// @brief Maximum number of indices of all the meshes read by the vertex pulling
+    constexpr uint32_t const VERTEX_PULLING_MAX_INDICES = 4194304;
+    /// @brief Maximum number of meshes read by the vertex pulling
+    constexpr uint32_t const VERTEX_PULLING_MAX_MESHES = 4096;
+    /// @brief Writes the descriptors of the compute passes in descriptor buffers
+    /// (VK_EXT_descriptor_buffer) if supported, rather than in sets of the descriptor pool
+    constexpr bool const DESCRIPTOR_BUFFERS = true;
+    /// @brief Size of the descriptors written once (at the creation of the passes), in bytes
+    constexpr uint32_t const DESCRIPTOR_BUFFER_PERSISTENT_SIZE = 256 * 1024;
+    /// @brief Size of the descriptors written each frame, in bytes, per frame in flight
+    constexpr uint32_t const DESCRIPTOR_BUFFER_FRAME_SIZE = 64 * 1024;
+    /// @brief Links the new variants of the scene pipeline from precompiled parts
+    /// (VK_EXT_graphics_pipeline_library) if supported, and optimizes them in the background
+    constexpr bool const GRAPHICS_PIPELINE_LIBRARY = true;
+    /// @brief Records the draws of the main scene subpass once per swapchain image, in
+    /// secondary command buffers replayed until the scene, the camera or the framebuffers
+    /// change (static content: kiosks, display walls). Not used while the temporal upscaling
+    /// jitters the projection every frame.
+    constexpr bool const STATIC_COMMAND_CACHING = false;
+    /// @brief Maximum number of 2D sprites drawn each frame, in a single draw
+    constexpr uint32_t const SPRITE_MAX_COUNT = 131072;
+    /// @brief Width and height of a sprite texture (a layer of the sprite texture array), in pixels
+    constexpr uint32_t const SPRITE_TEXTURE_SIZE = 256;
+    /// @brief Maximum number of sprite textures (layers of the sprite texture array)
+    constexpr uint32_t const SPRITE_TEXTURE_LAYERS = 64;
+    /// @brief Maximum number of debug lines drawn each frame (debug builds only), texts included
+    constexpr uint32_t const DEBUG_DRAW_MAX_LINES = 65536;
+    /// @brief Log2 luminance of the darkest non-black pixels the auto-exposure accounts for
+    constexpr float const AUTO_EXPOSURE_MIN_LOG_LUMINANCE = -8.0f;
+    /// @brief Log2 luminance of the brightest pixels the auto-exposure accounts for
+    constexpr float const AUTO_EXPOSURE_MAX_LOG_LUMINANCE = 4.0f;
+    /// @brief Speed of the eye adaptation, per second: the exposure converges to 63% of a
+    /// luminance change in 1 / AUTO_EXPOSURE_ADAPTATION_SPEED seconds
+    constexpr float const AUTO_EXPOSURE_ADAPTATION_SPEED = 1.5f;
+    /// @brief The value the average luminance of the scene is exposed to (middle grey)
+    constexpr float const AUTO_EXPOSURE_KEY = 0.18f;
+    /// @brief Adds the glow of the bright parts of the scene, computed at half resolution and below
+    constexpr bool const POST_BLOOM = true;
+    /// @brief Maximum number of levels of the bloom pyramid (the first one is at half resolution)
+    constexpr uint32_t const POST_BLOOM_LEVELS = 6;
+    /// @brief Weight of the bloom added to the scene
+    constexpr float const POST_BLOOM_INTENSITY = 0.04f;
+    /// @brief Exposed luminance above which the pixels bloom
+    constexpr float const POST_BLOOM_THRESHOLD = 1.0f;
+    /// @brief Anti-aliases the tonemapped image - redundant with the temporal upscaling
+    constexpr bool const POST_FXAA = !TEMPORAL_UPSCALING;
+    /// @brief Strength of the sharpening of the tonemapped image, 0 to disable it - compensates
+    /// the softness of the temporal upscaling
+    constexpr float const POST_SHARPNESS = TEMPORAL_UPSCALING ? 0.2f : 0.0f;
+    /// @brief Applies the color grading LUT (neutral until graded at runtime)
+    constexpr bool const POST_COLOR_GRADING = false;
+    /// @brief Width, height and depth of the color grading LUT
+    constexpr uint32_t const POST_COLOR_LUT_SIZE = 32;
+
 } // namespace Project
 
 #endif // app_project_h
@@ -0,0 +1,210 @@
+//
+//  handle_pool.h
+//
+
+#pragma once
+#ifndef handle_pool_h
+#define handle_pool_h
+
+#include "debug_tools.h"
+#include <assert.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace utils {
+/// @brief A typed 32-bit handle to a value of a HandlePool: the index of its slot in the low
+/// bits, and the generation of the slot in the high bits. A handle is a plain integer, cheap
+/// to copy and to pass across threads, and its index is stable for the lifetime of the value
+/// (e.g. an index in a bindless descriptor array).
+/// @tparam Tag An empty type, so that the handles of different pools cannot be mixed up
+template <typename Tag>
+struct Handle
+{
+    /// @brief The number of bits of the slot index (about one million slots)
+    static constexpr uint32_t INDEX_BITS = 20;
+    /// @brief The mask of the slot index
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    /// @brief The mask of the generation, once shifted
+    static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    /// @brief Creates a null handle, valid in no pool
+    constexpr Handle() = default;
+    /// @brief Creates the handle of a slot
+    /// @param index The index of the slot
+    /// @param generation The generation of the slot (never 0)
+    constexpr Handle(const uint32_t index, const uint32_t generation)
+        : m_value(((generation & GENERATION_MASK) << INDEX_BITS) | (index & INDEX_MASK))
+    {
+    }
+    /// @brief Returns the index of the slot
+    constexpr uint32_t getIndex() const noexcept { return m_value & INDEX_MASK; }
+    /// @brief Returns the generation of the slot when the handle was created
+    constexpr uint32_t getGeneration() const noexcept { return m_value >> INDEX_BITS; }
+    /// @brief Returns if the handle is the null handle
+    constexpr bool isNull() const noexcept { return 0 == m_value; }
+    constexpr bool operator==(const Handle& other) const noexcept { return m_value == other.m_value; }
+    constexpr bool operator!=(const Handle& other) const noexcept { return m_value != other.m_value; }
+    constexpr bool operator<(const Handle& other) const noexcept { return m_value < other.m_value; }
+
+private:
+    /// @brief The generation and the index of the slot (0 for the null handle)
+    uint32_t m_value = 0;
+};
+
+/// @brief A slot map: the values are stored contiguously (dense array, in no particular
+/// order) and accessed in O(1) through a handle. Erasing a value moves the last one in its
+/// place, and bumps the generation of its slot, so that the handles to the erased value are
+/// detected as stale instead of aliasing the next value of the slot.
+/// The pool itself is not synchronized: the values are inserted, accessed and erased from a
+/// single thread (the render thread), only the handles travel.
+/// @tparam Tag The tag of the handles of the pool
+/// @tparam T The type of the values
+template <typename Tag, typename T>
+class HandlePool
+{
+public:
+    /// @brief Moves a value into the pool
+    /// @param value The value to store
+    /// @return The handle of the value, or the null handle if all the slots are used
+    Handle<Tag> insert(T value)
+    {
+        uint32_t slot_index;
+        if (!m_free_slots.empty())
+        {
+            slot_index = m_free_slots.back();
+            m_free_slots.pop_back();
+        }
+        else
+        {
+            if (m_slots.size() > Handle<Tag>::INDEX_MASK)
+            {
+                LogE("> The handle pool is full (%u values)", static_cast<uint32_t>(m_slots.size()));
+                return Handle<Tag>();
+            }
+            slot_index = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back(Slot{});
+        }
+        Slot& slot = m_slots[slot_index];
+        slot.m_dense_index = static_cast<uint32_t>(m_values.size());
+        m_values.push_back(std::move(value));
+        m_dense_slots.push_back(slot_index);
+        return Handle<Tag>(slot_index, slot.m_generation);
+    }
+    /// @brief Returns if the handle refers to a value of the pool
+    bool contains(const Handle<Tag> handle) const noexcept
+    {
+        const uint32_t index = handle.getIndex();
+        return !handle.isNull() &&
+               index < m_slots.size() &&
+               m_slots[index].m_generation == handle.getGeneration() &&
+               m_slots[index].m_dense_index != INVALID_INDEX;
+    }
+    /// @brief Returns the value of a handle, or nullptr if the handle is null or stale
+    T* find(const Handle<Tag> handle) noexcept
+    {
+        return contains(handle) ? &m_values[m_slots[handle.getIndex()].m_dense_index] : nullptr;
+    }
+    /// @brief Returns the value of a handle, or nullptr if the handle is null or stale
+    const T* find(const Handle<Tag> handle) const noexcept
+    {
+        return contains(handle) ? &m_values[m_slots[handle.getIndex()].m_dense_index] : nullptr;
+    }
+    /// @brief Returns the value of a valid handle. The generation is only checked in debug
+    /// builds: a stale handle is a bug of the caller.
+    T& get(const Handle<Tag> handle) noexcept
+    {
+        checkHandle(handle);
+        return m_values[m_slots[handle.getIndex()].m_dense_index];
+    }
+    /// @brief Returns the value of a valid handle. The generation is only checked in debug
+    /// builds: a stale handle is a bug of the caller.
+    const T& get(const Handle<Tag> handle) const noexcept
+    {
+        checkHandle(handle);
+        return m_values[m_slots[handle.getIndex()].m_dense_index];
+    }
+    /// @brief Erases the value of a handle
+    /// @param handle The handle of the value
+    /// @return If the value existed (false for a null or stale handle)
+    bool erase(const Handle<Tag> handle)
+    {
+        if (!contains(handle))
+            return false;
+        Slot& slot = m_slots[handle.getIndex()];
+        const uint32_t dense_index = slot.m_dense_index;
+        const uint32_t last_index = static_cast<uint32_t>(m_values.size()) - 1;
+        // Keeps the values contiguous
+        if (dense_index != last_index)
+        {
+            m_values[dense_index] = std::move(m_values[last_index]);
+            m_dense_slots[dense_index] = m_dense_slots[last_index];
+            m_slots[m_dense_slots[dense_index]].m_dense_index = dense_index;
+        }
+        m_values.pop_back();
+        m_dense_slots.pop_back();
+        slot.m_dense_index = INVALID_INDEX;
+        // Generation 0 is never used, so that no handle is equal to the null handle
+        slot.m_generation = (slot.m_generation + 1) & Handle<Tag>::GENERATION_MASK;
+        if (0 == slot.m_generation)
+            slot.m_generation = 1;
+        m_free_slots.push_back(handle.getIndex());
+        return true;
+    }
+    /// @brief Erases all the values, and invalidates all the handles
+    void clear()
+    {
+        // From the back: no value is moved
+        while (!m_values.empty())
+            erase(getHandle(m_values.size() - 1));
+    }
+    /// @brief Returns the number of values
+    size_t size() const noexcept { return m_values.size(); }
+    /// @brief Returns if the pool has no value
+    bool empty() const noexcept { return m_values.empty(); }
+    /// @brief Returns the values, contiguous, to be iterated without handles
+    std::vector<T>& getValues() noexcept { return m_values; }
+    /// @brief Returns the values, contiguous, to be iterated without handles
+    const std::vector<T>& getValues() const noexcept { return m_values; }
+    /// @brief Returns the handle of a value from its position in `getValues`
+    Handle<Tag> getHandle(const size_t dense_index) const noexcept
+    {
+        assert(dense_index < m_dense_slots.size());
+        const uint32_t slot_index = m_dense_slots[dense_index];
+        return Handle<Tag>(slot_index, m_slots[slot_index].m_generation);
+    }
+
+private:
+    /// @brief The dense index of a free slot
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+    /// @brief A slot, referred to by the handles
+    struct Slot
+    {
+        /// @brief The index of the value in the dense array, or INVALID_INDEX if free
+        uint32_t m_dense_index = INVALID_INDEX;
+        /// @brief The generation of the slot, bumped when its value is erased
+        uint32_t m_generation = 1;
+    };
+    /// @brief Detects the use of a null or stale handle, in debug builds
+    void checkHandle([[maybe_unused]] const Handle<Tag> handle) const noexcept
+    {
+#ifdef DEBUG
+        if (!contains(handle))
+        {
+            LogE("> Invalid handle (slot %u, generation %u): null, or its value has been erased", handle.getIndex(), handle.getGeneration());
+            assert(false);
+        }
+#endif
+    }
+    /// @brief The values, contiguous
+    std::vector<T> m_values;
+    /// @brief The slot of each value of the dense array
+    std::vector<uint32_t> m_dense_slots;
+    /// @brief The slots, indexed by the handles
+    std::vector<Slot> m_slots;
+    /// @brief The slots to reuse
+    std::vector<uint32_t> m_free_slots;
+};
+} // namespace utils
+
+#endif // handle_pool_h